@@ -0,0 +1,141 @@
+//! Minimal benchmark harness shared by the benchmarks of Aili crates.
+//!
+//! Each benchmark is run repeatedly for a fixed amount of time
+//! and the median duration of a single run is reported, along with
+//! throughput and the number of heap allocations made by one run.
+//!
+//! Benchmarks can be filtered by passing substrings of their names
+//! on the command line, e.g. `cargo bench --bench pipeline -- list`.
+//! The measurement time of each benchmark can be changed
+//! with the `AILI_BENCH_MS` environment variable.
+//!
+//! Allocations are counted by a global allocator defined by this crate,
+//! so it must only be a dev-dependency of benchmarks.
+
+use std::{
+    alloc::{GlobalAlloc, Layout, System},
+    sync::atomic::{AtomicUsize, Ordering},
+    time::{Duration, Instant},
+};
+
+/// Allocator that counts allocations made through it.
+struct CountingAllocator;
+
+static ALLOCATIONS: AtomicUsize = AtomicUsize::new(0);
+static ALLOCATED_BYTES: AtomicUsize = AtomicUsize::new(0);
+
+unsafe impl GlobalAlloc for CountingAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        ALLOCATED_BYTES.fetch_add(layout.size(), Ordering::Relaxed);
+        unsafe { System.alloc(layout) }
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        unsafe { System.dealloc(ptr, layout) }
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        ALLOCATED_BYTES.fetch_add(new_size, Ordering::Relaxed);
+        unsafe { System.realloc(ptr, layout, new_size) }
+    }
+}
+
+#[global_allocator]
+static GLOBAL: CountingAllocator = CountingAllocator;
+
+/// Runs benchmarks selected by command line arguments.
+pub struct Harness {
+    /// Benchmarks are only run if their name contains one of these.
+    filters: Vec<String>,
+
+    /// How long each benchmark should be measured for.
+    measurement_time: Duration,
+}
+
+impl Harness {
+    /// Constructs a harness configured by the command line
+    /// and the environment.
+    pub fn from_env() -> Self {
+        // Cargo passes flags such as `--bench`, those are not filters
+        let filters = std::env::args()
+            .skip(1)
+            .filter(|arg| !arg.starts_with('-'))
+            .collect();
+        let measurement_time = std::env::var("AILI_BENCH_MS")
+            .ok()
+            .and_then(|ms| ms.parse().ok())
+            .map(Duration::from_millis)
+            .unwrap_or(Duration::from_secs(1));
+        println!(
+            "{:<40} {:>12} {:>16} {:>12} {:>14}",
+            "benchmark", "time", "throughput", "allocs", "bytes"
+        );
+        Self {
+            filters,
+            measurement_time,
+        }
+    }
+
+    /// Measures a benchmark.
+    ///
+    /// ## Parameters
+    /// - `name` - Name of the benchmark.
+    /// - `units` - Number of units (nodes, bytes, ...) processed by one run,
+    ///   for computing throughput.
+    /// - `unit_name` - Name of the unit.
+    /// - `setup` - Prepares the input of a single run. It is not measured.
+    /// - `routine` - The measured code.
+    pub fn bench<I, R>(
+        &self,
+        name: &str,
+        units: usize,
+        unit_name: &str,
+        mut setup: impl FnMut() -> I,
+        mut routine: impl FnMut(I) -> R,
+    ) {
+        if !self.filters.is_empty() && !self.filters.iter().any(|f| name.contains(f.as_str())) {
+            return;
+        }
+        // The first run warms up caches and counts allocations
+        let input = setup();
+        let allocations_before = ALLOCATIONS.load(Ordering::Relaxed);
+        let bytes_before = ALLOCATED_BYTES.load(Ordering::Relaxed);
+        std::hint::black_box(routine(std::hint::black_box(input)));
+        let allocations = ALLOCATIONS.load(Ordering::Relaxed) - allocations_before;
+        let bytes = ALLOCATED_BYTES.load(Ordering::Relaxed) - bytes_before;
+
+        let mut samples = Vec::new();
+        let started = Instant::now();
+        while samples.len() < 5 || started.elapsed() < self.measurement_time {
+            let input = setup();
+            let start = Instant::now();
+            let output = routine(std::hint::black_box(input));
+            samples.push(start.elapsed());
+            // Do not measure the destructor of the output
+            drop(std::hint::black_box(output));
+        }
+        samples.sort();
+        let median = samples[samples.len() / 2];
+        let throughput = units as f64 / median.as_secs_f64();
+        println!(
+            "{name:<40} {:>12} {:>16} {allocations:>12} {bytes:>14}",
+            format!("{median:.2?}"),
+            format!("{} {unit_name}/s", format_count(throughput)),
+        );
+    }
+}
+
+/// Formats a large number with a metric prefix.
+fn format_count(count: f64) -> String {
+    if count >= 1e9 {
+        format!("{:.2}G", count / 1e9)
+    } else if count >= 1e6 {
+        format!("{:.2}M", count / 1e6)
+    } else if count >= 1e3 {
+        format!("{:.2}k", count / 1e3)
+    } else {
+        format!("{count:.2}")
+    }
+}
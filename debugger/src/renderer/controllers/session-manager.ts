@@ -39,6 +39,16 @@ export class DebugSessionManager {
                     await debuggerContainer.sendMiCommand(command, DebuggerInputSource.STATE)
                 )[0];
             },
+            async sendMiCommands(commands: string[]): Promise<string[]> {
+                // The debugger matches responses to commands by token,
+                // so all commands can be sent at once
+                const responses = await Promise.all(
+                    commands.map(command =>
+                        debuggerContainer.sendMiCommand(command, DebuggerInputSource.STATE),
+                    ),
+                );
+                return responses.map(response => response[0]);
+            },
         };
         this._status = this.session.status;
         this.session.onStatusChanged.hook(newStatus => {
@@ -52,6 +52,11 @@ export const DEFAULT_STYLESHEET: string = `/**
   fill: "#d0cdcd";
 }
 
+:trunc {
+  value: "...";
+  fill: "#d0cdcd";
+}
+
 :: {
   --root-extra: @(::extra);
 }
@@ -0,0 +1,245 @@
+/**
+ * Timing breakdown of the steps taken each time the debuggee stops.
+ *
+ * @module
+ */
+
+import { GdbUpdateStatistics, RenderStatistics } from 'aili-jsapi';
+import { Hook, Hookable, Logger, Severity } from 'aili-hooligan';
+
+/**
+ * Timing breakdown and counters of the work done after a single stop
+ * of the debuggee, from updating the state graph to laying out the visualization.
+ *
+ * All times are in milliseconds.
+ */
+export interface StopTrace {
+    /**
+     * Sequential number of the stop, starting from one.
+     */
+    readonly index: number;
+    /**
+     * Time taken to update the state graph, including waiting for GDB.
+     */
+    readonly gdbTime: number;
+    /**
+     * Time taken to apply the stylesheet to the state graph.
+     */
+    readonly cascadeTime: number;
+    /**
+     * Time taken to forward the resolved style to the visualization tree.
+     */
+    readonly writeTime: number;
+    /**
+     * Time between the visualization tree being updated and its layout
+     * being recalculated, or `undefined` if no layout has been needed.
+     */
+    readonly layoutTime: number | undefined;
+    /**
+     * Total number of GDB/MI commands sent.
+     */
+    readonly miCommands: number;
+    /**
+     * Numbers of GDB/MI commands sent, by the name of the command.
+     */
+    readonly miCommandsByKind: Readonly<Record<string, number>>;
+    /**
+     * Total length of GDB/MI responses parsed.
+     */
+    readonly bytesParsed: number;
+    /**
+     * Number of variable objects created.
+     */
+    readonly varObjectsCreated: number;
+    /**
+     * Number of variable objects deleted.
+     */
+    readonly varObjectsDeleted: number;
+    /**
+     * Number of variable objects of returned functions reused by a new call.
+     */
+    readonly varObjectsRestored: number;
+    /**
+     * Number of state nodes the stylesheet has been evaluated at.
+     */
+    readonly nodesVisited: number;
+    /**
+     * Number of state node visits reused from the previous stop.
+     */
+    readonly visitsReplayed: number;
+    /**
+     * Number of selector states advanced over a node.
+     */
+    readonly selectorStatesEvaluated: number;
+    /**
+     * Number of property values and selector conditions evaluated.
+     */
+    readonly expressionsEvaluated: number;
+    /**
+     * Number of operations issued to the visualization tree.
+     */
+    readonly visOperations: number;
+}
+
+/**
+ * Collects {@link StopTrace}s of the debugger pipeline.
+ *
+ * Each stop is recorded in two stages. The state graph update and rendering
+ * are recorded synchronously with {@link recordStop}, while the layout
+ * is only known to have finished once {@link layoutsUpdated} is called.
+ * A stop is reported once both are known, or when the next one is recorded.
+ *
+ * @example
+ * ```js
+ * const tracer = new StopTracer();
+ * tracer.logger = mainLogger.createTopic('perf');
+ * tracer.onTrace.hook(trace => console.log(trace.gdbTime));
+ * viewport.onLayoutsUpdated.hook(() => tracer.layoutsUpdated());
+ * // After the renderer has rendered the new state
+ * tracer.recordStop(stateGraph.lastUpdateStatistics, renderer.lastRenderStatistics);
+ * ```
+ */
+export class StopTracer {
+    constructor() {
+        this._onTrace = new Hook();
+    }
+    /**
+     * Records the update of the state graph after a stop
+     * and its rendering.
+     *
+     * Takes ownership of the statistics objects and frees them.
+     *
+     * @param gdb Counters of the state graph update.
+     * @param render Counters of the rendering, if the state has been rendered.
+     */
+    recordStop(gdb: GdbUpdateStatistics, render: RenderStatistics | undefined): void {
+        // The previous stop did not need a layout
+        this.flushPending(undefined);
+        this.stopCount += 1;
+        this.pending = {
+            trace: {
+                index: this.stopCount,
+                gdbTime: gdb.updateTime,
+                cascadeTime: render?.cascadeTime ?? 0,
+                writeTime: render?.writeTime ?? 0,
+                miCommands: gdb.commandCount,
+                miCommandsByKind: gdb.commandsByKind as Record<string, number>,
+                bytesParsed: gdb.bytesParsed,
+                varObjectsCreated: gdb.varObjectsCreated,
+                varObjectsDeleted: gdb.varObjectsDeleted,
+                varObjectsRestored: gdb.varObjectsRestored,
+                nodesVisited: render?.nodesVisited ?? 0,
+                visitsReplayed: render?.visitsReplayed ?? 0,
+                selectorStatesEvaluated: render?.selectorStatesEvaluated ?? 0,
+                expressionsEvaluated: render?.expressionsEvaluated ?? 0,
+                visOperations: render?.visOperations ?? 0,
+            },
+            renderedAt: performance.now(),
+        };
+        gdb.free();
+        render?.free();
+        // Nothing has been changed in the visualization, so there will be no layout
+        if (this.pending.trace.visOperations === 0) {
+            this.flushPending(undefined);
+        }
+    }
+    /**
+     * Notifies the tracer that layouts of the visualization have been updated.
+     */
+    layoutsUpdated(): void {
+        if (this.pending) {
+            this.flushPending(performance.now() - this.pending.renderedAt);
+        }
+    }
+    /**
+     * Triggers when a stop has been fully traced.
+     *
+     * @event
+     */
+    get onTrace(): Hookable<[StopTrace]> {
+        return this._onTrace;
+    }
+    /**
+     * Logger that receives a summary of each stop.
+     */
+    logger: Logger | undefined;
+    private flushPending(layoutTime: number | undefined): void {
+        if (!this.pending) {
+            return;
+        }
+        const trace: StopTrace = { ...this.pending.trace, layoutTime };
+        this.pending = undefined;
+        this.logger?.log(Severity.DEBUG, summarizeStopTrace(trace), describeStopTrace(trace));
+        this._onTrace.trigger(trace);
+    }
+    private readonly _onTrace: Hook<[StopTrace]>;
+    private pending: PendingStopTrace | undefined;
+    private stopCount: number = 0;
+}
+
+/**
+ * Total time taken by a stop, in milliseconds.
+ *
+ * @param trace The traced stop.
+ * @returns Sum of the times of all steps.
+ */
+export function stopTraceTotalTime(trace: StopTrace): number {
+    return trace.gdbTime + trace.cascadeTime + trace.writeTime + (trace.layoutTime ?? 0);
+}
+
+/**
+ * Formats a one-line summary of the timing breakdown of a stop.
+ *
+ * @param trace The traced stop.
+ * @returns Human-readable summary.
+ */
+export function summarizeStopTrace(trace: StopTrace): string {
+    return (
+        `Stop #${trace.index} took ${formatTime(stopTraceTotalTime(trace))}: ` +
+        `GDB ${formatTime(trace.gdbTime)}, cascade ${formatTime(trace.cascadeTime)}, ` +
+        `write ${formatTime(trace.writeTime)}, layout ${formatTime(trace.layoutTime)}`
+    );
+}
+
+/**
+ * Formats the counters of a stop.
+ *
+ * @param trace The traced stop.
+ * @returns Human-readable description, one counter per line.
+ */
+export function describeStopTrace(trace: StopTrace): string {
+    const commands = Object.entries(trace.miCommandsByKind)
+        .sort(([, a], [, b]) => b - a)
+        .map(([name, count]) => `  ${name}: ${count}`);
+    return [
+        `MI commands: ${trace.miCommands}`,
+        ...commands,
+        `Bytes parsed: ${trace.bytesParsed}`,
+        `Var objects created: ${trace.varObjectsCreated}`,
+        `Var objects deleted: ${trace.varObjectsDeleted}`,
+        `Var objects restored: ${trace.varObjectsRestored}`,
+        `Nodes visited: ${trace.nodesVisited}`,
+        `Visits replayed: ${trace.visitsReplayed}`,
+        `Selector states evaluated: ${trace.selectorStatesEvaluated}`,
+        `Expressions evaluated: ${trace.expressionsEvaluated}`,
+        `Vis operations: ${trace.visOperations}`,
+    ].join('\n');
+}
+
+/**
+ * Formats a duration in milliseconds.
+ *
+ * @param time The duration, or `undefined` if it has not been measured.
+ * @returns Human-readable duration.
+ */
+export function formatTime(time: number | undefined): string {
+    return time === undefined ? '-' : `${time.toFixed(1)} ms`;
+}
+
+/**
+ * Stop that has been rendered, but whose layout has not finished yet.
+ */
+interface PendingStopTrace {
+    trace: Omit<StopTrace, 'layoutTime'>;
+    renderedAt: number;
+}
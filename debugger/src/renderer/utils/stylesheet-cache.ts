@@ -0,0 +1,184 @@
+/**
+ * Cache of compiled stylesheets that skips parsing of sources
+ * that have been compiled before.
+ *
+ * @module
+ */
+
+import { StylesheetParseError } from 'aili-jsapi';
+
+/**
+ * Static interface of a compiled stylesheet type,
+ * such as {@link aili-jsapi!Stylesheet} or {@link aili-jsapi!LengthHintSheet}.
+ *
+ * @typeParam T Type of the compiled stylesheet.
+ */
+export interface StylesheetType<T extends SerializableStylesheet> {
+    parse(source: string, errorHandler?: (e: StylesheetParseError) => void): T;
+    fromBytes(bytes: Uint8Array): T;
+    sourceHash(source: string): string;
+}
+
+/**
+ * Compiled stylesheet that can be serialized.
+ */
+export interface SerializableStylesheet {
+    toBytes(): Uint8Array;
+}
+
+/**
+ * Default number of compiled stylesheets kept in memory by a {@link StylesheetCache}.
+ */
+export const DEFAULT_STYLESHEET_CACHE_CAPACITY: number = 16;
+
+/**
+ * Cache of compiled stylesheets, keyed by hashes of their sources.
+ *
+ * Recently compiled stylesheets are kept in memory, so that re-applying
+ * a source while editing does not parse it again. The most recently
+ * compiled stylesheet is also persisted in local storage,
+ * so the next start of the application does not parse it either.
+ *
+ * Only stylesheets that compiled without recovered errors are cached,
+ * so that the errors are reported again each time the source is applied.
+ *
+ * @typeParam T Type of the compiled stylesheet.
+ *
+ * @example
+ * ```js
+ * const cache = new StylesheetCache(Stylesheet, 'main-stylesheet');
+ * // Parses the source
+ * const first = cache.compile(source);
+ * // Loads the compiled form without parsing
+ * const second = cache.compile(source);
+ * ```
+ */
+export class StylesheetCache<T extends SerializableStylesheet> {
+    /**
+     * Constructs a cache and loads the stylesheet persisted in local storage.
+     *
+     * @param stylesheetType Type of stylesheets that the cache compiles.
+     * @param storageKey Key under which the most recent stylesheet is persisted.
+     *                   Caches of different stylesheet types must use different keys.
+     * @param capacity Maximum number of compiled stylesheets kept in memory.
+     */
+    constructor(
+        stylesheetType: StylesheetType<T>,
+        storageKey: string,
+        capacity: number = DEFAULT_STYLESHEET_CACHE_CAPACITY,
+    ) {
+        this.stylesheetType = stylesheetType;
+        this.storageKey = `${STORAGE_KEY_PREFIX}${storageKey}`;
+        this.capacity = capacity;
+        this.entries = new Map();
+        this.loadPersistedEntry();
+    }
+    /**
+     * Compiles a stylesheet source, loading its compiled form from the cache if possible.
+     *
+     * Bound to the cache, so it can be passed around as a callback.
+     *
+     * @param source Source code of the stylesheet.
+     * @param errorHandler Callback that receives recoverable syntax errors.
+     * @returns The compiled stylesheet.
+     * @throws Error if the source cannot be parsed.
+     */
+    readonly compile = (
+        source: string,
+        errorHandler?: (e: StylesheetParseError) => void,
+    ): T => {
+        const hash = this.stylesheetType.sourceHash(source);
+        const cached = this.entries.get(hash);
+        if (cached) {
+            try {
+                const stylesheet = this.stylesheetType.fromBytes(cached);
+                // Mark the entry as the most recently used one
+                this.entries.delete(hash);
+                this.entries.set(hash, cached);
+                this.persistEntry(hash, cached);
+                return stylesheet;
+            } catch {
+                // Written by a different version of the library, parse it again
+                this.entries.delete(hash);
+            }
+        }
+        let hasErrors = false;
+        const stylesheet = this.stylesheetType.parse(source, err => {
+            hasErrors = true;
+            errorHandler?.(err);
+        });
+        if (!hasErrors) {
+            const bytes = stylesheet.toBytes();
+            this.entries.set(hash, bytes);
+            if (this.entries.size > this.capacity) {
+                // Maps iterate in insertion order, so the first entry is the oldest
+                this.entries.delete(this.entries.keys().next().value!);
+            }
+            this.persistEntry(hash, bytes);
+        }
+        return stylesheet;
+    };
+    private loadPersistedEntry(): void {
+        try {
+            const persisted = localStorage.getItem(this.storageKey);
+            if (persisted) {
+                const { hash, bytes } = JSON.parse(persisted) as PersistedEntry;
+                this.entries.set(hash, base64ToBytes(bytes));
+            }
+        } catch {
+            // Storage is unavailable or corrupted, start with an empty cache
+        }
+    }
+    private persistEntry(hash: string, bytes: Uint8Array): void {
+        if (this.persistedHash === hash) {
+            return;
+        }
+        try {
+            const entry: PersistedEntry = { hash, bytes: bytesToBase64(bytes) };
+            localStorage.setItem(this.storageKey, JSON.stringify(entry));
+            this.persistedHash = hash;
+        } catch {
+            // Storage is unavailable or full, the cache still works in memory
+        }
+    }
+    private readonly stylesheetType: StylesheetType<T>;
+    private readonly storageKey: string;
+    private readonly capacity: number;
+    private readonly entries: Map<string, Uint8Array>;
+    private persistedHash: string | undefined;
+}
+
+/**
+ * Prefix of local storage keys of persisted stylesheets.
+ */
+const STORAGE_KEY_PREFIX: string = 'aili-compiled-stylesheet:';
+
+/**
+ * Maximum number of bytes passed to `String.fromCharCode` at once.
+ */
+const BASE64_CHUNK_SIZE: number = 0x8000;
+
+/**
+ * Compiled stylesheet as stored in local storage.
+ */
+interface PersistedEntry {
+    hash: string;
+    bytes: string;
+}
+
+function bytesToBase64(bytes: Uint8Array): string {
+    let binary = '';
+    for (let i = 0; i < bytes.length; i += BASE64_CHUNK_SIZE) {
+        binary += String.fromCharCode(...bytes.subarray(i, i + BASE64_CHUNK_SIZE));
+    }
+    return btoa(binary);
+}
+
+function base64ToBytes(base64: string): Uint8Array {
+    const binary = atob(base64);
+    const bytes = new Uint8Array(binary.length);
+    for (let i = 0; i < binary.length; ++i) {
+        bytes[i] = binary.charCodeAt(i);
+    }
+    return bytes;
+}
@@ -0,0 +1,228 @@
+//! Benchmarks of the construction and update of the state graph
+//! over GDB/MI transcripts recorded from the debugger examples.
+//!
+//! - `construct` builds the state graph at the first stop of an example.
+//! - `update` updates it at each of the following stops.
+//!
+//! Replayed sessions do not wait for GDB, so the benchmarks only measure
+//! the cost of the construction itself. The time a real session would
+//! have spent waiting for GDB is estimated from the number of round trips
+//! and reported after the benchmarks, both for a stream that sends
+//! commands one by one and for one that pipelines batches of commands.
+//! The simulated latency of a single round trip can be changed
+//! with the `AILI_BENCH_LATENCY_US` environment variable.
+//!
+//! Transcripts are read from `benches/transcripts`. They are recorded
+//! by running the benchmark with the `AILI_RECORD_TRANSCRIPTS`
+//! environment variable set, which requires GDB and a C compiler
+//! as described by the integration tests.
+//!
+//! ```sh
+//! AILI_RECORD_TRANSCRIPTS=1 cargo bench --bench replay
+//! ```
+
+#[allow(
+    dead_code,
+    reason = "Only the GDB session is needed, not all test utilities"
+)]
+#[path = "../tests/utils/mod.rs"]
+mod utils;
+
+use aili_bench::Harness;
+use aili_gdbstate::{
+    gdbmi::transcript::{GdbMiTranscript, RecordingGdbMiStream, ReplayGdbMiStream},
+    state::GdbStateGraph,
+};
+use std::{
+    path::{Path, PathBuf},
+    time::Duration,
+};
+use utils::{future::ExpectReady as _, gdb_from_source};
+
+/// Maximum number of stops recorded from each example.
+const MAX_RECORDED_STOPS: usize = 40;
+
+/// Default simulated latency of a single round trip to GDB.
+const DEFAULT_LATENCY: Duration = Duration::from_micros(200);
+
+fn main() {
+    if std::env::var_os("AILI_RECORD_TRANSCRIPTS").is_some() {
+        record_examples();
+        return;
+    }
+    let examples = load_examples();
+    if examples.is_empty() {
+        println!(
+            "No transcripts found in {}, record them with AILI_RECORD_TRANSCRIPTS=1",
+            transcript_directory().display()
+        );
+        return;
+    }
+    let harness = Harness::from_env();
+    for (name, stops) in &examples {
+        bench_example(&harness, name, stops);
+    }
+    let latency = std::env::var("AILI_BENCH_LATENCY_US")
+        .ok()
+        .and_then(|us| us.parse().ok())
+        .map(Duration::from_micros)
+        .unwrap_or(DEFAULT_LATENCY);
+    println!();
+    println!(
+        "{:<40} {:>12} {:>12} {:>14} {:>12} {:>14}",
+        "round trips", "commands", "sequential", "", "pipelined", ""
+    );
+    for (name, stops) in &examples {
+        report_round_trips(name, stops, latency);
+    }
+}
+
+/// Runs benchmarks over the transcripts of one example.
+fn bench_example(harness: &Harness, name: &str, stops: &[GdbMiTranscript]) {
+    let Some((first_stop, next_stops)) = stops.split_first() else {
+        return;
+    };
+    harness.bench(
+        &format!("construct/{name}"),
+        first_stop.exchanges.len(),
+        "commands",
+        || ReplayGdbMiStream::new(first_stop.clone()),
+        |mut gdb| GdbStateGraph::new(&mut gdb).expect_ready().unwrap(),
+    );
+    if next_stops.is_empty() {
+        return;
+    }
+    harness.bench(
+        &format!("update/{name}"),
+        next_stops.len(),
+        "stops",
+        || {
+            let graph = GdbStateGraph::new(&mut ReplayGdbMiStream::new(first_stop.clone()))
+                .expect_ready()
+                .unwrap();
+            let streams = Vec::from_iter(next_stops.iter().cloned().map(ReplayGdbMiStream::new));
+            (graph, streams)
+        },
+        |(mut graph, streams)| {
+            for mut gdb in streams {
+                graph.update(&mut gdb).expect_ready().unwrap();
+            }
+            graph
+        },
+    );
+}
+
+/// Replays all stops of an example and prints how long
+/// a real session would have waited for GDB.
+fn report_round_trips(name: &str, stops: &[GdbMiTranscript], latency: Duration) {
+    let replay = |max_in_flight: usize| {
+        let mut graph = None;
+        let mut commands = 0;
+        let mut round_trips = 0;
+        let mut waited = Duration::ZERO;
+        for stop in stops {
+            let mut gdb = ReplayGdbMiStream::new(stop.clone())
+                .with_latency(latency)
+                .with_max_in_flight(max_in_flight);
+            match &mut graph {
+                None => graph = Some(GdbStateGraph::new(&mut gdb).expect_ready().unwrap()),
+                Some(graph) => graph.update(&mut gdb).expect_ready().unwrap(),
+            }
+            commands += gdb.commands_replayed();
+            round_trips += gdb.round_trips();
+            waited += gdb.simulated_latency();
+        }
+        (commands, round_trips, waited)
+    };
+    let (commands, sequential, sequential_wait) = replay(1);
+    let (_, pipelined, pipelined_wait) = replay(usize::MAX);
+    println!(
+        "{name:<40} {commands:>12} {sequential:>12} {:>14} {pipelined:>12} {:>14}",
+        format!("{sequential_wait:.2?}"),
+        format!("{pipelined_wait:.2?}"),
+    );
+}
+
+/// Directory where transcripts of the examples are stored.
+fn transcript_directory() -> PathBuf {
+    Path::new(env!("CARGO_MANIFEST_DIR")).join("benches/transcripts")
+}
+
+/// Directory that contains the debugger examples.
+fn example_directory() -> PathBuf {
+    Path::new(env!("CARGO_MANIFEST_DIR")).join("../debugger/examples")
+}
+
+/// Path to the transcript of one stop of an example.
+fn stop_path(example: &Path, stop: usize) -> PathBuf {
+    example.join(format!("{stop:02}.mi"))
+}
+
+/// Reads the transcripts of all recorded examples, sorted by name.
+fn load_examples() -> Vec<(String, Vec<GdbMiTranscript>)> {
+    let Ok(entries) = std::fs::read_dir(transcript_directory()) else {
+        return Vec::new();
+    };
+    let mut examples = Vec::from_iter(entries.filter_map(|entry| {
+        let path = entry.ok()?.path();
+        let name = path.file_name()?.to_str()?.to_owned();
+        let stops = Vec::from_iter((0..).map_while(|stop| {
+            let source = std::fs::read_to_string(stop_path(&path, stop)).ok()?;
+            Some(GdbMiTranscript::parse(&source).expect("Transcript should be well-formed"))
+        }));
+        (!stops.is_empty()).then_some((name, stops))
+    }));
+    examples.sort_by(|(a, _), (b, _)| a.cmp(b));
+    examples
+}
+
+/// Records transcripts of all debugger examples.
+fn record_examples() {
+    let mut examples = Vec::from_iter(
+        std::fs::read_dir(example_directory())
+            .expect("Examples should be readable")
+            .filter_map(|entry| entry.ok().map(|entry| entry.path()))
+            .filter(|path| path.is_dir()),
+    );
+    examples.sort();
+    for example in examples {
+        let name = example.file_name().unwrap().to_string_lossy().into_owned();
+        let source_path = example.join(format!("{name}.c"));
+        let Ok(source) = std::fs::read_to_string(&source_path) else {
+            continue;
+        };
+        let stops = record_example(&source);
+        let directory = transcript_directory().join(&name);
+        // Stale stops of a previous recording must not be replayed
+        let _ = std::fs::remove_dir_all(&directory);
+        std::fs::create_dir_all(&directory).expect("Transcript directory should be writable");
+        for (index, stop) in stops.iter().enumerate() {
+            let text = format!("# {name}, stop {index}\n{stop}");
+            std::fs::write(stop_path(&directory, index), text)
+                .expect("Transcript should be writable");
+        }
+        println!("Recorded {} stops of {name}", stops.len());
+    }
+}
+
+/// Steps through an example program from the start of `main`,
+/// recording the construction of the state graph at the first stop
+/// and its update at each of the following ones.
+fn record_example(source: &str) -> Vec<GdbMiTranscript> {
+    let mut gdb = RecordingGdbMiStream::new(gdb_from_source(source));
+    let mut graph = GdbStateGraph::new(&mut gdb)
+        .expect_ready()
+        .expect("State graph should be constructed at the start of main");
+    let mut stops = vec![gdb.take_transcript()];
+    while stops.len() < MAX_RECORDED_STOPS {
+        if gdb.inner_mut().step().is_err() {
+            break;
+        }
+        // The update fails once the program has exited
+        if graph.update(&mut gdb).expect_ready().is_err() {
+            break;
+        }
+        stops.push(gdb.take_transcript());
+    }
+    stops
+}
@@ -0,0 +1,327 @@
+//! Lookup of the variable nodes that occupy a memory address.
+
+use crate::state::VariableHandle;
+
+/// Blocks of memory occupied by variable nodes.
+///
+/// Blocks are kept in a randomized balanced search tree ordered
+/// by their start addresses, where each subtree knows the last address
+/// covered by any block in it. Subtrees that end before an address
+/// cannot contain it, so a lookup only visits the blocks that contain
+/// the address and the paths that lead to them.
+///
+/// Any number of blocks may start at the same address,
+/// such as a structure and its first member.
+/// A variable node occupies at most one block that starts at any address.
+#[derive(Debug, Default)]
+pub(crate) struct AddressMap {
+    nodes: Vec<AddressMapNode>,
+    free_nodes: Vec<usize>,
+    root: Option<usize>,
+    /// State of the generator of node priorities.
+    seed: u64,
+}
+
+/// Block of memory occupied by a variable node
+/// in [`GdbStateGraph::address_mapping`](crate::state::GdbStateGraph::address_mapping).
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+pub(crate) struct AddressRange {
+    /// Size of the block in bytes.
+    ///
+    /// Zero if the size is not known, in which case
+    /// only the start address belongs to the node.
+    pub size: u64,
+
+    /// Handle to the node that occupies the block.
+    pub var_object: VariableHandle,
+}
+
+impl AddressRange {
+    /// Gets the last address that belongs to a block that starts at an address.
+    fn last_address(&self, start: u64) -> u64 {
+        start.saturating_add(self.size.max(1) - 1)
+    }
+}
+
+#[derive(Debug)]
+struct AddressMapNode {
+    start: u64,
+    range: AddressRange,
+    priority: u64,
+    /// Last address covered by any block in the subtree of the node.
+    subtree_last_address: u64,
+    left: Option<usize>,
+    right: Option<usize>,
+}
+
+impl AddressMapNode {
+    fn key(&self) -> (u64, VariableHandle) {
+        (self.start, self.range.var_object)
+    }
+}
+
+impl AddressMap {
+    /// Inserts a block that starts at an address,
+    /// replacing the block of the same variable node that started there before.
+    pub fn insert(&mut self, address: u64, range: AddressRange) -> Option<AddressRange> {
+        let previous = self.remove(address, range.var_object);
+        let node = self.allocate_node(address, range);
+        let (left, right) = self.split(self.root, |key| key < (address, range.var_object));
+        let left = self.merge(left, Some(node));
+        self.root = self.merge(left, right);
+        previous
+    }
+
+    /// Removes the block of a variable node that starts at an address.
+    pub fn remove(&mut self, address: u64, var_object: VariableHandle) -> Option<AddressRange> {
+        let key = (address, var_object);
+        let (left, rest) = self.split(self.root, |k| k < key);
+        let (found, right) = self.split(rest, |k| k <= key);
+        self.root = self.merge(left, right);
+        let found = found?;
+        self.free_nodes.push(found);
+        Some(self.nodes[found].range)
+    }
+
+    /// Finds all blocks that contain an address.
+    ///
+    /// Of the blocks that contain the address, the innermost one
+    /// starts the closest before it, and if multiple blocks start there,
+    /// it is the smallest of them.
+    ///
+    /// ## Return Value
+    /// Start addresses of the blocks and the blocks themselves,
+    /// starting from the innermost one.
+    pub fn containing(&self, address: u64) -> Vec<(u64, AddressRange)> {
+        let mut blocks = Vec::new();
+        self.visit_containing(self.root, address, &mut |start, range| {
+            blocks.push((start, range))
+        });
+        blocks.sort_by_key(|(start, range)| Self::nesting_key(*start, range));
+        blocks
+    }
+
+    /// Orders blocks that contain the same address starting from the innermost one.
+    fn nesting_key(start: u64, range: &AddressRange) -> (std::cmp::Reverse<u64>, u64) {
+        (std::cmp::Reverse(start), range.size.max(1))
+    }
+
+    fn visit_containing(
+        &self,
+        node: Option<usize>,
+        address: u64,
+        visit: &mut impl FnMut(u64, AddressRange),
+    ) {
+        let Some(node) = node.map(|node| &self.nodes[node]) else {
+            return;
+        };
+        // No block in the subtree reaches the address
+        if node.subtree_last_address < address {
+            return;
+        }
+        self.visit_containing(node.left, address, visit);
+        // Blocks in the right subtree start even later
+        if node.start > address {
+            return;
+        }
+        if node.range.last_address(node.start) >= address {
+            visit(node.start, node.range);
+        }
+        self.visit_containing(node.right, address, visit);
+    }
+
+    fn allocate_node(&mut self, start: u64, range: AddressRange) -> usize {
+        // Splitmix64, the priorities only need to be well distributed
+        self.seed = self.seed.wrapping_add(0x9e3779b97f4a7c15);
+        let mut priority = self.seed;
+        priority = (priority ^ (priority >> 30)).wrapping_mul(0xbf58476d1ce4e5b9);
+        priority = (priority ^ (priority >> 27)).wrapping_mul(0x94d049bb133111eb);
+        priority ^= priority >> 31;
+        let node = AddressMapNode {
+            start,
+            range,
+            priority,
+            subtree_last_address: range.last_address(start),
+            left: None,
+            right: None,
+        };
+        if let Some(index) = self.free_nodes.pop() {
+            self.nodes[index] = node;
+            index
+        } else {
+            self.nodes.push(node);
+            self.nodes.len() - 1
+        }
+    }
+
+    /// Splits a subtree into nodes whose keys satisfy a predicate
+    /// and the nodes after them.
+    ///
+    /// The predicate must hold for a prefix of the nodes in key order.
+    fn split(
+        &mut self,
+        node: Option<usize>,
+        goes_left: impl Fn((u64, VariableHandle)) -> bool + Copy,
+    ) -> (Option<usize>, Option<usize>) {
+        let Some(index) = node else {
+            return (None, None);
+        };
+        if goes_left(self.nodes[index].key()) {
+            let (left, right) = self.split(self.nodes[index].right, goes_left);
+            self.nodes[index].right = left;
+            self.update_subtree(index);
+            (Some(index), right)
+        } else {
+            let (left, right) = self.split(self.nodes[index].left, goes_left);
+            self.nodes[index].left = right;
+            self.update_subtree(index);
+            (left, Some(index))
+        }
+    }
+
+    /// Joins two subtrees where all keys in the left one
+    /// are less than all keys in the right one.
+    fn merge(&mut self, left: Option<usize>, right: Option<usize>) -> Option<usize> {
+        let (l, r) = match (left, right) {
+            (None, subtree) | (subtree, None) => return subtree,
+            (Some(l), Some(r)) => (l, r),
+        };
+        if self.nodes[l].priority > self.nodes[r].priority {
+            self.nodes[l].right = self.merge(self.nodes[l].right, Some(r));
+            self.update_subtree(l);
+            Some(l)
+        } else {
+            self.nodes[r].left = self.merge(Some(l), self.nodes[r].left);
+            self.update_subtree(r);
+            Some(r)
+        }
+    }
+
+    fn update_subtree(&mut self, index: usize) {
+        let node = &self.nodes[index];
+        let subtree_last_address = [node.left, node.right]
+            .into_iter()
+            .flatten()
+            .map(|child| self.nodes[child].subtree_last_address)
+            .fold(node.range.last_address(node.start), u64::max);
+        self.nodes[index].subtree_last_address = subtree_last_address;
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use crate::{
+        gdbmi::types::VariableObject,
+        state::{GdbStateNode, GdbStateNodeForVariable, VariableArena},
+    };
+    use aili_model::state::NodeTypeClass;
+
+    fn handles(count: usize) -> Vec<VariableHandle> {
+        let mut arena = VariableArena::default();
+        (0..count)
+            .map(|i| {
+                let node = GdbStateNode::new(NodeTypeClass::Atom);
+                let object = VariableObject(format!("var{i}"));
+                arena.insert(GdbStateNodeForVariable::new(node, object, None))
+            })
+            .collect()
+    }
+
+    fn innermost(map: &AddressMap, address: u64) -> Option<(u64, AddressRange)> {
+        map.containing(address).first().copied()
+    }
+
+    fn block(size: u64, var_object: VariableHandle) -> AddressRange {
+        AddressRange { size, var_object }
+    }
+
+    #[test]
+    fn address_map_finds_innermost_containing_block() {
+        let [outer, inner, point] = handles(3)[..] else {
+            unreachable!()
+        };
+        let mut map = AddressMap::default();
+        map.insert(100, block(100, outer));
+        map.insert(150, block(4, inner));
+        map.insert(300, block(0, point));
+        let found = |address| innermost(&map, address).map(|(start, r)| (start, r.var_object));
+        assert_eq!(found(100), Some((100, outer)));
+        assert_eq!(found(152), Some((150, inner)));
+        // Past the end of the inner block, but still in the outer one
+        assert_eq!(found(160), Some((100, outer)));
+        assert_eq!(found(200), None);
+        // Blocks of unknown size only contain their start
+        assert_eq!(found(300), Some((300, point)));
+        assert_eq!(found(301), None);
+        assert_eq!(found(99), None);
+    }
+
+    #[test]
+    fn address_map_keeps_nested_blocks_with_same_start() {
+        let [structure, first_member, element] = handles(3)[..] else {
+            unreachable!()
+        };
+        let mut map = AddressMap::default();
+        map.insert(64, block(16, structure));
+        map.insert(64, block(8, first_member));
+        map.insert(64, block(4, element));
+        // The smallest block that starts at the address is the innermost
+        assert_eq!(innermost(&map, 64), Some((64, block(4, element))));
+        assert_eq!(innermost(&map, 70), Some((64, block(8, first_member))));
+        assert_eq!(innermost(&map, 79), Some((64, block(16, structure))));
+        assert_eq!(
+            map.containing(66),
+            [
+                (64, block(4, element)),
+                (64, block(8, first_member)),
+                (64, block(16, structure)),
+            ]
+        );
+        // Removing one of them leaves the others in place
+        assert_eq!(map.remove(64, first_member), Some(block(8, first_member)));
+        assert_eq!(map.remove(64, first_member), None);
+        assert_eq!(innermost(&map, 70), Some((64, block(16, structure))));
+        // Inserting a block of the same node again replaces it
+        assert_eq!(map.insert(64, block(2, element)), Some(block(4, element)));
+        assert_eq!(map.containing(64).len(), 2);
+    }
+
+    #[test]
+    fn address_map_finds_large_block_among_small_ones() {
+        const SMALL_BLOCKS: u64 = 10_000;
+        let handles = handles(SMALL_BLOCKS as usize + 1);
+        let mut map = AddressMap::default();
+        // A large block is followed by many small blocks
+        // that do not overlap with it or with each other
+        map.insert(0, block(1 << 20, handles[0]));
+        for i in 0..SMALL_BLOCKS {
+            map.insert((1 << 20) + 8 * i, block(8, handles[i as usize + 1]));
+        }
+        assert_eq!(
+            innermost(&map, 1 << 19),
+            Some((0, block(1 << 20, handles[0])))
+        );
+        assert_eq!(
+            innermost(&map, (1 << 20) + 8 * 500 + 3),
+            Some(((1 << 20) + 8 * 500, block(8, handles[501])))
+        );
+        assert_eq!(innermost(&map, (1 << 20) + 8 * SMALL_BLOCKS), None);
+        // The tree stays balanced, so lookups do not degrade to linear scans
+        assert!(tree_depth(&map, map.root) < 64);
+        // Removing the large block leaves only the small ones
+        map.remove(0, handles[0]);
+        assert_eq!(innermost(&map, 1 << 19), None);
+        assert_eq!(
+            innermost(&map, 1 << 20),
+            Some((1 << 20, block(8, handles[1])))
+        );
+    }
+
+    fn tree_depth(map: &AddressMap, node: Option<usize>) -> usize {
+        node.map_or(0, |node| {
+            let node = &map.nodes[node];
+            1 + tree_depth(map, node.left).max(tree_depth(map, node.right))
+        })
+    }
+}
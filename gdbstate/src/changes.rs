@@ -0,0 +1,163 @@
+//! Bounded log of the changes made to a [`GdbStateGraph`] by its updates.
+//!
+//! Consumers that keep results derived from the graph, such as incremental
+//! stylesheet applications, each hold their own [`ChangeCursor`].
+//! Reading the changes does not consume them, so any number of consumers
+//! can follow the same graph independently.
+
+use crate::state::{GdbStateGraph, GdbStateNodeId};
+use std::{
+    collections::{HashSet, VecDeque},
+    sync::atomic::{AtomicU64, Ordering},
+};
+
+/// Source of identifiers that tell change logs of different graphs apart.
+static NEXT_LOG_ID: AtomicU64 = AtomicU64::new(0);
+
+/// Position of a consumer in the sequence of updates of a [`GdbStateGraph`],
+/// obtained from [`GdbStateGraph::change_cursor`].
+///
+/// A cursor is only meaningful for the graph that issued it.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct ChangeCursor {
+    /// Identifier of the log that issued the cursor.
+    log_id: u64,
+
+    /// Number of updates that had been recorded when the cursor was issued.
+    version: u64,
+}
+
+/// Bounded sequence of the sets of nodes changed by updates of a graph.
+#[derive(Debug)]
+pub(crate) struct ChangeLog {
+    /// Identifier that is unique to this log.
+    log_id: u64,
+
+    /// Nodes changed by each recorded update, from the oldest to the newest.
+    updates: VecDeque<HashSet<GdbStateNodeId>>,
+
+    /// Number of updates recorded so far, including forgotten ones.
+    version: u64,
+}
+
+impl ChangeLog {
+    /// Maximum number of updates whose changes are kept.
+    ///
+    /// Consumers that fall further behind have to start over.
+    pub(crate) const CAPACITY: usize = 16;
+
+    /// Constructs an empty log with a new identity.
+    pub(crate) fn new() -> Self {
+        Self {
+            log_id: NEXT_LOG_ID.fetch_add(1, Ordering::Relaxed),
+            updates: VecDeque::new(),
+            version: 0,
+        }
+    }
+
+    /// Records the nodes changed by an update.
+    pub(crate) fn record(&mut self, changed_nodes: &HashSet<GdbStateNodeId>) {
+        if self.updates.len() >= Self::CAPACITY {
+            self.updates.pop_front();
+        }
+        self.updates.push_back(changed_nodes.clone());
+        self.version += 1;
+    }
+
+    /// Position after all updates recorded so far.
+    pub(crate) fn cursor(&self) -> ChangeCursor {
+        ChangeCursor {
+            log_id: self.log_id,
+            version: self.version,
+        }
+    }
+
+    /// Collects the nodes changed by updates recorded after a cursor was issued.
+    ///
+    /// ## Return Value
+    /// `None` if the cursor has been issued by a different log
+    /// or the updates it is missing have already been forgotten.
+    pub(crate) fn changes_since(&self, cursor: ChangeCursor) -> Option<HashSet<GdbStateNodeId>> {
+        if cursor.log_id != self.log_id {
+            return None;
+        }
+        let missed = usize::try_from(self.version.checked_sub(cursor.version)?).ok()?;
+        if missed > self.updates.len() {
+            return None;
+        }
+        Some(
+            self.updates
+                .iter()
+                .rev()
+                .take(missed)
+                .flatten()
+                .cloned()
+                .collect(),
+        )
+    }
+}
+
+impl GdbStateGraph {
+    /// Position after all updates of the graph made so far.
+    ///
+    /// Pass it to [`GdbStateGraph::changed_nodes_since`] later
+    /// to find out what the updates made in the meantime have changed.
+    pub fn change_cursor(&self) -> ChangeCursor {
+        self.change_log.cursor()
+    }
+
+    /// Collects the nodes that have been added, removed or modified
+    /// by updates made since a cursor was obtained.
+    ///
+    /// Unlike [`GdbStateGraph::take_changed_nodes`], this does not
+    /// consume the changes, so each consumer of the graph can track
+    /// its own position with a separate cursor.
+    ///
+    /// ## Return Value
+    /// `None` if the cursor has been obtained from a different graph
+    /// or it is too far behind, in which case the whole graph
+    /// must be considered changed.
+    pub fn changed_nodes_since(&self, cursor: ChangeCursor) -> Option<HashSet<GdbStateNodeId>> {
+        self.change_log.changes_since(cursor)
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    fn changes(frames: &[usize]) -> HashSet<GdbStateNodeId> {
+        frames.iter().copied().map(GdbStateNodeId::Frame).collect()
+    }
+
+    #[test]
+    fn cursors_follow_updates_independently() {
+        let mut log = ChangeLog::new();
+        let first = log.cursor();
+        log.record(&changes(&[1]));
+        let second = log.cursor();
+        log.record(&changes(&[2]));
+        assert_eq!(log.changes_since(first), Some(changes(&[1, 2])));
+        assert_eq!(log.changes_since(second), Some(changes(&[2])));
+        // Reading the changes does not consume them
+        assert_eq!(log.changes_since(first), Some(changes(&[1, 2])));
+        assert_eq!(log.changes_since(log.cursor()), Some(HashSet::new()));
+    }
+
+    #[test]
+    fn cursors_of_other_logs_are_rejected() {
+        let log = ChangeLog::new();
+        let other = ChangeLog::new();
+        assert_eq!(log.changes_since(other.cursor()), None);
+    }
+
+    #[test]
+    fn forgotten_updates_are_reported() {
+        let mut log = ChangeLog::new();
+        let cursor = log.cursor();
+        for i in 0..=ChangeLog::CAPACITY {
+            log.record(&changes(&[i]));
+        }
+        assert_eq!(log.changes_since(cursor), None);
+    }
+}
@@ -1,22 +1,28 @@
 //! Construction of a [`GdbStateGraph`] using a [`GdbMiSession`].
 
 use crate::{
-    gdbmi::{result::Result, session::GdbMiSession, types::*},
+    changes::ChangeLog,
+    gdbmi::{
+        result::{Error, Result},
+        session::GdbMiSession,
+        types::*,
+    },
+    hint_cache::{HintSnapshot, resolve_hint_rules},
     hints::PointerLengthHintKey,
+    reachability::ReachabilitySheet,
     state::*,
 };
-use aili_model::state::*;
+use aili_model::{state::*, symbol};
 use aili_style::{
     cascade::{CascadeStyle, SelectionCaret, SelectorResolver},
     eval::{context::EvaluationContext, evaluate, unwrap_node_value, variable_pool::VariablePool},
-    stylesheet::StyleKey,
     values::PropertyValue,
 };
 use derive_more::{Debug, Deref, DerefMut};
 use regex::Regex;
 use std::{
-    collections::{BTreeMap, HashMap, VecDeque},
-    sync::LazyLock,
+    collections::{HashMap, HashSet, VecDeque},
+    sync::{Arc, LazyLock},
 };
 
 impl GdbStateGraph {
@@ -25,10 +31,27 @@ impl GdbStateGraph {
         Self {
             root_node: GdbStateNode::new(NodeTypeClass::Root),
             stack_trace: Vec::new(),
-            variables: HashMap::new(),
-            length_nodes: HashMap::new(),
-            address_mapping: BTreeMap::new(),
+            stack_frame_addresses: Vec::new(),
+            popped_frames: VecDeque::new(),
+            popped_frame_cache_size: Self::DEFAULT_POPPED_FRAME_CACHE_SIZE,
+            variables: VariableArena::default(),
+            type_names: HashSet::new(),
+            address_mapping: AddressMap::default(),
+            struct_layouts: HashMap::new(),
+            type_sizes: HashMap::new(),
+            scalar_layouts: HashMap::new(),
             resolved_length_hints: HashMap::new(),
+            length_hint_cache: Default::default(),
+            pending_dereferences: HashSet::new(),
+            changed_nodes: HashSet::new(),
+            change_log: ChangeLog::new(),
+            expansion_batch_size: Self::DEFAULT_EXPANSION_BATCH_SIZE,
+            bulk_read_min_length: Self::DEFAULT_BULK_READ_MIN_LENGTH,
+            budget: ConstructionBudget::default(),
+            target_endianness: None,
+            endianness_setting_read: false,
+            statistics: UpdateStatistics::default(),
+            history: None,
         }
     }
 
@@ -48,12 +71,50 @@ impl GdbStateGraph {
     pub async fn new_with_hints(
         gdb: &mut impl GdbMiSession,
         pointer_hints: &CascadeStyle<PointerLengthHintKey>,
+    ) -> Result<Self> {
+        Self::construct(gdb, pointer_hints, None).await
+    }
+
+    /// Constructs a new state graph using a provided GDB session
+    /// and a hint sheet, only dereferencing pointers
+    /// that are reachable by a stylesheet.
+    ///
+    /// Pointers that the stylesheet does not reach past are left
+    /// without their [`EdgeLabel::Deref`] edges, so the memory they point to
+    /// is never read. They are revisited on each
+    /// [update](GdbStateGraph::update_with_reachability), in case they
+    /// have become reachable.
+    ///
+    /// Variables are always constructed in full, so expressions
+    /// of the stylesheet can inspect them even if its selectors do not.
+    /// Expressions that inspect memory past a dereference that the selectors
+    /// do not reach see it as missing.
+    ///
+    /// This function sends commands to GDB and awaits responses
+    /// asynchronously.
+    pub async fn new_with_reachability(
+        gdb: &mut impl GdbMiSession,
+        pointer_hints: &CascadeStyle<PointerLengthHintKey>,
+        reachability: &ReachabilitySheet<'_>,
+    ) -> Result<Self> {
+        Self::construct(gdb, pointer_hints, Some(reachability)).await
+    }
+
+    async fn construct(
+        gdb: &mut impl GdbMiSession,
+        pointer_hints: &CascadeStyle<PointerLengthHintKey>,
+        reachability: Option<&ReachabilitySheet<'_>>,
     ) -> Result<Self> {
         let mut graph = Self::empty();
-        let mut writer = GdbStateGraphWriter::new(&mut graph, gdb, pointer_hints);
+        let mut writer = GdbStateGraphWriter::new(&mut graph, gdb, pointer_hints, reachability);
         writer.update_stack_trace().await?;
-        writer.resolve_length_hints_from(&GdbStateNodeId::Root);
-        writer.resolve_deferred_dereferences().await?;
+        writer.resolve_root_length_hints();
+        writer.resolve_reachability_from(&GdbStateNodeId::Root);
+        let result = writer.resolve_deferred_dereferences().await;
+        writer.finish_root_length_hints();
+        result?;
+        // Only track changes made by updates
+        graph.changed_nodes.clear();
         Ok(graph)
     }
 
@@ -74,28 +135,95 @@ impl GdbStateGraph {
     /// to [`GdbStateGraph::new`] in order to recude the number
     /// of commands that need to be invoked. Modifying the session
     /// in between calls can yield unexpected results.
+    /// To switch to a different hint sheet, call
+    /// [`GdbStateGraph::discard_length_hint_cache`] first.
     pub async fn update_with_hints(
         &mut self,
         gdb: &mut impl GdbMiSession,
         pointer_hints: &CascadeStyle<PointerLengthHintKey>,
     ) -> Result<()> {
-        let mut writer = GdbStateGraphWriter::new(self, gdb, pointer_hints);
+        self.update_with_optional_reachability(gdb, pointer_hints, None)
+            .await
+    }
+
+    /// Updates an existing state graph using a provided GDB session
+    /// and a hint sheet, only dereferencing pointers
+    /// that are reachable by a stylesheet.
+    ///
+    /// See [`GdbStateGraph::new_with_reachability`].
+    /// Pointers that have been left without their dereferences
+    /// by previous updates are dereferenced if they have become reachable.
+    /// Updating without a reachability sheet dereferences all of them.
+    ///
+    /// It is assumed that it is the same session and hint sheet that was passed
+    /// to [`GdbStateGraph::new_with_reachability`] in order to recude the number
+    /// of commands that need to be invoked. Modifying the session
+    /// in between calls can yield unexpected results.
+    /// To switch to a different hint sheet, call
+    /// [`GdbStateGraph::discard_length_hint_cache`] first.
+    pub async fn update_with_reachability(
+        &mut self,
+        gdb: &mut impl GdbMiSession,
+        pointer_hints: &CascadeStyle<PointerLengthHintKey>,
+        reachability: &ReachabilitySheet<'_>,
+    ) -> Result<()> {
+        self.update_with_optional_reachability(gdb, pointer_hints, Some(reachability))
+            .await
+    }
+
+    async fn update_with_optional_reachability(
+        &mut self,
+        gdb: &mut impl GdbMiSession,
+        pointer_hints: &CascadeStyle<PointerLengthHintKey>,
+        reachability: Option<&ReachabilitySheet<'_>>,
+    ) -> Result<()> {
+        // Set aside the changes that have not been taken yet,
+        // so that only the changes made by this update are recorded
+        let pending_changes = std::mem::take(&mut self.changed_nodes);
+        let result = self
+            .update_variables_and_frames(gdb, pointer_hints, reachability)
+            .await;
+        self.change_log.record(&self.changed_nodes);
+        if let Some(mut history) = self.history.take() {
+            // A failed update may have left the graph half-updated,
+            // which is not a state the program has ever been in
+            if result.is_ok() {
+                history.record(self, &self.changed_nodes);
+            } else {
+                history.skip(&self.changed_nodes);
+            }
+            self.history = Some(history);
+        }
+        self.changed_nodes.extend(pending_changes);
+        result
+    }
+
+    async fn update_variables_and_frames(
+        &mut self,
+        gdb: &mut impl GdbMiSession,
+        pointer_hints: &CascadeStyle<PointerLengthHintKey>,
+        reachability: Option<&ReachabilitySheet<'_>>,
+    ) -> Result<()> {
+        let mut writer = GdbStateGraphWriter::new(self, gdb, pointer_hints, reachability);
         writer.update_variable_objects().await?;
+        writer.update_bulk_scalar_arrays().await?;
         writer.update_stack_trace().await?;
-        writer.resolve_length_hints_from(&GdbStateNodeId::Root);
-        writer.resolve_deferred_dereferences().await?;
-        Ok(())
+        writer.resolve_root_length_hints();
+        writer.resolve_reachability_from(&GdbStateNodeId::Root);
+        let result = writer.resolve_deferred_dereferences().await;
+        writer.finish_root_length_hints();
+        result
     }
 
     /// Erases all variable objects associated with this state graph
     /// from the provided GDB session.
     pub async fn drop_variable_objects(&self, gdb: &mut impl GdbMiSession) -> Result<()> {
-        for (variable_handle, node) in &self.variables {
+        for (_, node) in self.variables.iter() {
             // Only top level nodes need to be deleted,
             // the rest will be cleaned up by GDB recursively
             if node.is_top_level() {
                 // TODO: Better error handling; only some errors may be ignored
-                let _ = gdb.var_delete(variable_handle).await;
+                let _ = gdb.var_delete(&node.object).await;
             }
         }
         Ok(())
@@ -120,17 +248,38 @@ struct GdbStateGraphWriter<'a, T: GdbMiSession> {
 
     /// References to [`NodeTypeClass::Ref`] nodes whose
     /// [`EdgeLabel::Deref`] should be evaluated later.
-    deferred_pointers: VecDeque<VariableObject>,
+    deferred_pointers: VecDeque<VariableHandle>,
 
     /// Cloned stylesheet resolution variable pools
     /// at each [`NodeTypeClass::Ref`] node.
-    stylesheet_snapshots: HashMap<
-        VariableObject,
+    stylesheet_snapshots: HashMap<VariableHandle, HintSnapshot<'a>>,
+
+    /// Nodes that had changed before the hint sheet was resolved
+    /// from the root, set aside so that the changes made afterwards
+    /// can be told apart.
+    changed_before_root_hints: HashSet<GdbStateNodeId>,
+
+    /// Number of objects that have been dereferenced by this update.
+    dereference_count: usize,
+
+    /// Stylesheet that decides which pointers should be dereferenced,
+    /// or [`None`] if all of them should.
+    reachability_sheet: Option<&'a ReachabilitySheet<'a>>,
+
+    /// Cloned reachability resolution variable pools
+    /// at each reachable [`NodeTypeClass::Ref`] node.
+    reachability_snapshots: HashMap<
+        VariableHandle,
         (
             VariablePool<&'a str, GdbStateNodeId>,
             SelectorResolver<'a, GdbStateNodeId>,
         ),
     >,
+
+    /// Local variables that GDB has reported to be out of scope,
+    /// kept until the stack trace is updated, so that the locals
+    /// of popped frames can be set aside instead of being deleted.
+    out_of_scope_locals: HashSet<VariableHandle>,
 }
 
 impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
@@ -138,13 +287,23 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
         graph: &'a mut GdbStateGraph,
         gdb: &'a mut T,
         pointer_hints: &'a CascadeStyle<PointerLengthHintKey>,
+        reachability: Option<&'a ReachabilitySheet<'a>>,
     ) -> Self {
+        // Nodes removed by the previous update are no longer referenced
+        // by anyone, so their handles can be given to new nodes
+        graph.variables.recycle();
+        graph.statistics = UpdateStatistics::default();
         Self {
             pointer_hint_sheet: pointer_hints,
             graph,
             gdb,
             deferred_pointers: VecDeque::new(),
             stylesheet_snapshots: HashMap::new(),
+            changed_before_root_hints: HashSet::new(),
+            dereference_count: 0,
+            reachability_sheet: reachability,
+            reachability_snapshots: HashMap::new(),
+            out_of_scope_locals: HashSet::new(),
         }
     }
 
@@ -164,42 +323,84 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
         if var_object.new_type_name.is_some() {
             // TODO: Warn
         }
-        if var_object.in_scope != InScope::True {
+        let handle = self.variables.handle(&var_object.object);
+        let is_local = handle
+            .and_then(|handle| self.variables.get(handle))
+            .is_some_and(|variable| matches!(variable.parent, Some(GdbStateNodeId::Frame(_))));
+        if var_object.in_scope == InScope::False && is_local {
+            // Whether the frame of the variable has been popped
+            // is only known once the stack trace has been updated
+            self.out_of_scope_locals
+                .insert(handle.expect("Only existing variables are local"));
+        } else if var_object.in_scope != InScope::True {
             self.variable_object_out_of_scope(&var_object.object)
                 .await?;
-        } else if let Some(variable) = self.variables.get_mut(&var_object.object) {
+        } else if let Some(handle) = self.variables.handle(&var_object.object) {
+            let variable = self
+                .variables
+                .get_mut(handle)
+                .expect("Handle has just been looked up");
             // Otherwise, the value must have changed, so reevaluate it
             let new_value = var_object.value.as_deref().and_then(Self::parse_node_value);
             variable.value = new_value;
             // If the variable is a pointer, update its dereference
             if variable.type_class == NodeTypeClass::Ref {
-                if let Some(GdbStateNodeId::VarObject(old_deref_id)) =
-                    variable.remove_successor(&EdgeLabel::Deref)
-                {
-                    let dropped_last_ref = self.free_dereference(&var_object.object, &old_deref_id);
-                    if dropped_last_ref {
-                        self.remove_variables_recursive(&old_deref_id);
+                match variable.remove_successor(&EdgeLabel::Deref) {
+                    Some(
+                        old_deref_id @ (GdbStateNodeId::VarObject(_)
+                        | GdbStateNodeId::ArrayElement(_, _)),
+                    ) => {
+                        if let Some(owner) = self.dereference_owner(&old_deref_id) {
+                            let dropped_last_ref = self.free_dereference(handle, owner);
+                            if dropped_last_ref {
+                                self.remove_variables_recursive(owner);
+                            }
+                        }
                     }
+                    Some(truncated_id @ GdbStateNodeId::Truncated(_)) => {
+                        variable.truncation_node = None;
+                        self.changed_nodes.insert(truncated_id);
+                    }
+                    _ => {}
                 }
                 // Resolve the dereference later
-                self.add_deferred_dereference(var_object.object.clone());
+                self.add_deferred_dereference(handle);
             }
+            self.changed_nodes.insert(GdbStateNodeId::VarObject(handle));
         }
         // If we do not know about the object, someone else must have
         // created it in the session, so we ignore it
         Ok(())
     }
 
-    fn add_deferred_dereference(&mut self, var_object: VariableObject) {
+    fn add_deferred_dereference(&mut self, var_object: VariableHandle) {
         self.deferred_pointers.push_back(var_object);
     }
 
     async fn resolve_deferred_dereferences(&mut self) -> Result<()> {
+        // Pointers that were not reachable before may have become reachable
+        let pending_pointers = std::mem::take(&mut self.pending_dereferences);
+        self.deferred_pointers.extend(pending_pointers);
+        // Pointers of popped frames are dereferenced again if they are restored
+        let popped_locals = self.popped_local_variables();
         while let Some(ref_object) = self.deferred_pointers.pop_front() {
+            if popped_locals.contains(&self.top_level_variable(ref_object)) {
+                continue;
+            }
             // Get the pointer node, bail if it has been removed
-            let Some(node) = self.variables.get_mut(&ref_object) else {
+            let Some(node) = self.variables.get_mut(ref_object) else {
                 continue;
             };
+            // A pending pointer may have been deferred again by an update,
+            // in which case it has already been dereferenced
+            if node
+                .successors
+                .iter()
+                .any(|(e, n)| *e == EdgeLabel::Deref && !matches!(n, GdbStateNodeId::Truncated(_)))
+            {
+                continue;
+            }
+            let depth = node.depth;
             // Get the pointer's type name so we can cast properly
             let pointer_type_name = node.type_name.clone();
             // If it's a null pointer, it should not appear in the state graph
@@ -209,14 +410,17 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
             if address == 0 {
                 continue;
             }
-            let can_access_target_address = self
-                .gdb
-                .data_evaluate_expression(&format!("*(char*){address}"))
-                .await
-                .is_ok();
-            if !can_access_target_address {
-                continue;
-            }
+            // If nothing past the pointer can be reached by the stylesheet,
+            // do not read the memory yet
+            let reachability_snapshot = if self.reachability_sheet.is_some() {
+                let Some(snapshot) = self.reachability_snapshots.get(&ref_object).cloned() else {
+                    self.pending_dereferences.insert(ref_object);
+                    continue;
+                };
+                Some(snapshot)
+            } else {
+                None
+            };
             let Some(type_name) = pointer_type_name else {
                 continue;
             };
@@ -227,7 +431,7 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
                 .and_then(|hint| {
                     let context = EvaluationContext::from_graph(
                         self.graph,
-                        GdbStateNodeId::VarObject(ref_object.clone()),
+                        GdbStateNodeId::VarObject(ref_object),
                     );
                     let unwrapped_hint = unwrap_node_value(hint.clone(), &context);
                     if let PropertyValue::Value(NodeValue::Uint(l)) = unwrapped_hint {
@@ -236,22 +440,61 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
                         None
                     }
                 });
-            // TODO: Some errors can be ignored here
-            let deref_var_object = self
-                .get_or_create_dereference_variable_node(address, &type_name, length_hint)
+            // Objects that already exist cost nothing to link,
+            // so only new objects count against the budget.
+            // Past the budget, do not spend commands on looking for them either.
+            let is_over_budget = self.is_dereference_over_budget(depth);
+            // If the pointer points into an object that already exists,
+            // link it to that object instead of creating a duplicate
+            let existing_target = self
+                .find_dereference_target(
+                    address,
+                    &type_name,
+                    length_hint.is_some(),
+                    !is_over_budget,
+                )
                 .await?;
-            self.link_dereference_relation(&ref_object, &deref_var_object);
+            if existing_target.is_none() && is_over_budget {
+                self.insert_truncation_node(ref_object, None);
+                self.pending_dereferences.insert(ref_object);
+                continue;
+            }
+            self.remove_truncation_node(ref_object);
+            let (owner, deref_id) = if let Some(target) = existing_target {
+                target
+            } else {
+                let can_access_target_address = self
+                    .gdb
+                    .data_evaluate_expression(&format!("*(char*){address}"))
+                    .await
+                    .is_ok();
+                if !can_access_target_address {
+                    continue;
+                }
+                // TODO: Some errors can be ignored here
+                let deref_var_object = self
+                    .create_dereference_variable_node(address, &type_name, length_hint, depth + 1)
+                    .await?;
+                self.dereference_count += 1;
+                self.statistics.dereferences += 1;
+                (
+                    deref_var_object,
+                    GdbStateNodeId::VarObject(deref_var_object),
+                )
+            };
+            self.link_dereference_relation(ref_object, owner, deref_id.clone());
             // Resolve the hint sheet from that node
             // so we can correctly identify pointers on the heap
             if let Some((variable_pool, mut resolver)) =
                 self.stylesheet_snapshots.get(&ref_object).cloned()
             {
                 resolver.push_edge(&EdgeLabel::Deref);
-                self.resolve_length_hints_from_snapshot(
-                    &GdbStateNodeId::VarObject(deref_var_object),
-                    variable_pool,
-                    resolver,
-                );
+                self.resolve_length_hints_from_snapshot(&deref_id, variable_pool, resolver);
+            }
+            // Resolve reachability from that node
+            // so we know which pointers on the heap to follow
+            if let Some((variable_pool, resolver)) = reachability_snapshot {
+                self.resolve_reachability_from_snapshot(&deref_id, variable_pool, resolver);
             }
         }
         Ok(())
@@ -271,8 +514,8 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
     #[must_use]
     fn free_dereference(
         &mut self,
-        referer_handle: &VariableObject,
-        dereference_handle: &VariableObject,
+        referer_handle: VariableHandle,
+        dereference_handle: VariableHandle,
     ) -> bool {
         let Some(dereference_node) = self.variables.get_mut(dereference_handle) else {
             // TODO: Warn
@@ -282,7 +525,7 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
             .referers
             .iter()
             .enumerate()
-            .find(|(_, r)| *r == referer_handle)
+            .find(|(_, r)| **r == referer_handle)
             .map(|(i, _)| i)
         else {
             // TODO: Warn
@@ -296,26 +539,30 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
     }
 
     async fn variable_object_out_of_scope(&mut self, var_object: &VariableObject) -> Result<()> {
-        // The variable has gone out of scope, so we destroy it
-        let parent_node = self.remove_variables_recursive(var_object);
-        // Remove the reference to it from its parent frame
-        if let Some(GdbStateNodeId::Frame(frame_index)) = parent_node {
-            if let Some(frame) = self.stack_trace.get_mut(frame_index) {
-                frame.remove_successor_by_id(&GdbStateNodeId::VarObject(var_object.clone()));
+        if let Some(handle) = self.variables.handle(var_object) {
+            // The variable has gone out of scope, so we destroy it
+            let parent_node = self.remove_variables_recursive(handle);
+            // Remove the reference to it from its parent frame
+            if let Some(GdbStateNodeId::Frame(frame_index)) = parent_node {
+                if let Some(frame) = self.stack_trace.get_mut(frame_index) {
+                    frame.remove_successor_by_id(&GdbStateNodeId::VarObject(handle));
+                    self.changed_nodes
+                        .insert(GdbStateNodeId::Frame(frame_index));
+                }
+            } else {
+                // Only local variables can go out of scope
+                // TODO: warn
             }
-        } else {
-            // Only local variables can go out of scope
-            // TODO: warn
         }
         self.gdb.var_delete(var_object).await?;
         Ok(())
     }
 
-    fn remove_variables_recursive(&mut self, handle: &VariableObject) -> Option<GdbStateNodeId> {
-        let mut to_remove = vec![handle.clone()];
+    fn remove_variables_recursive(&mut self, handle: VariableHandle) -> Option<GdbStateNodeId> {
+        let mut to_remove = vec![handle];
         let mut parent = None;
         while let Some(handle) = to_remove.pop() {
-            if let Some((parent_id, deferred)) = self.remove_variable(&handle) {
+            if let Some((parent_id, deferred)) = self.remove_variable(handle) {
                 // If this is the first node (the one passed to the function as argument),
                 // save its parent so we can return it at the end
                 parent.get_or_insert(parent_id);
@@ -338,21 +585,28 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
     #[must_use]
     fn remove_variable(
         &mut self,
-        handle: &VariableObject,
-    ) -> Option<(Option<GdbStateNodeId>, Vec<VariableObject>)> {
+        handle: VariableHandle,
+    ) -> Option<(Option<GdbStateNodeId>, Vec<VariableHandle>)> {
         let node = self.variables.remove(handle)?;
+        self.statistics.variables_removed += 1;
+        self.changed_nodes.insert(GdbStateNodeId::VarObject(handle));
         // Keep track of what children need to be removed as well
         let mut to_remove = Vec::new();
         // If the node has an address, remove it from the address map
         if let Some(address) = node.address {
-            self.address_mapping.remove(&address);
+            self.address_mapping.remove(address, handle);
         }
         // If the node has a length hint, remove it from that map
-        self.resolved_length_hints.remove(handle);
+        self.resolved_length_hints.remove(&handle);
+        self.stylesheet_snapshots.remove(&handle);
+        self.reachability_snapshots.remove(&handle);
+        self.pending_dereferences.remove(&handle);
         // Unlink dangling references
         for referer in node.referers {
-            if let Some(referer_node) = self.variables.get_mut(&referer) {
+            if let Some(referer_node) = self.variables.get_mut(referer) {
                 referer_node.remove_successor(&EdgeLabel::Deref);
+                self.changed_nodes
+                    .insert(GdbStateNodeId::VarObject(referer));
             } else {
                 // TODO: Warn
                 // Referers should be kept up-to-date
@@ -370,18 +624,28 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
                         GdbStateNodeId::VarObject(v) => {
                             to_remove.push(v);
                         }
-                        GdbStateNodeId::Length(v) => {
-                            self.length_nodes.remove(&v);
+                        // Length nodes, bulk-read elements, and truncation nodes
+                        // have been removed together with their parent
+                        GdbStateNodeId::Length(_)
+                        | GdbStateNodeId::ArrayElement(_, _)
+                        | GdbStateNodeId::Truncated(_) => {
+                            self.changed_nodes.insert(next_object);
                         }
                     }
                 }
                 // Dereference edges have their own freeing mechanism
                 EdgeLabel::Deref => {
-                    if let GdbStateNodeId::VarObject(dereference) = next_object {
-                        let dropped_last_ref = self.free_dereference(handle, &dereference);
-                        if dropped_last_ref {
-                            to_remove.push(dereference);
+                    if let GdbStateNodeId::VarObject(_) | GdbStateNodeId::ArrayElement(_, _) =
+                        next_object
+                    {
+                        if let Some(owner) = self.dereference_owner(&next_object) {
+                            let dropped_last_ref = self.free_dereference(handle, owner);
+                            if dropped_last_ref {
+                                to_remove.push(owner);
+                            }
                         }
+                    } else if let GdbStateNodeId::Truncated(_) = next_object {
+                        self.changed_nodes.insert(next_object);
                     } else {
                         // TODO: Warn, only variable nodes should
                     }
@@ -398,10 +662,13 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
 
     async fn update_stack_trace(&mut self) -> Result<()> {
         let stack_trace = self.gdb.stack_list_frames().await?;
-        // There is no way to tell if the top stack frame has
-        // returned and then the same function was called
-        // (as opposed to still being in that function),
-        // so this update is done on a best-effort basis.
+        let frame_addresses = self.stack_frame_addresses(&stack_trace).await?;
+        // Reverse the trace from GDB, it lists frames starting from the top
+        let stack_trace: Vec<_> = stack_trace.into_iter().rev().zip(frame_addresses).collect();
+        // A function that has returned and then been called again
+        // at the same depth can only be told apart from one that is still
+        // running by its frame address. If the address is not known,
+        // this update is done on a best-effort basis.
         //
         // Traverse the stack from the bottom up and update
         // everything after the first frame that does not match
@@ -409,32 +676,127 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
         let update_index = self
             .stack_trace
             .iter()
-            // Reverse the trace from GDB, it lists frames starting from the top
-            .zip(stack_trace.iter().rev())
+            .zip(&self.graph.stack_frame_addresses)
+            .zip(&stack_trace)
             .enumerate()
-            // Find the first function that does not have the same name
+            // Find the first frame that does not belong to the same function
+            // or does not have the same address
             // Unwrap is safe here because all stack frame nodes have a name
-            .find(|(_, (cached, new))| cached.type_name.as_deref().unwrap() != new.func)
+            .find(|(_, ((cached, cached_address), (new, new_address)))| {
+                cached.type_name.as_deref().unwrap() != new.func || *cached_address != new_address
+            })
             .map(|(i, _)| i)
             // If all available frames match, at least the frames that are only
             // cached but no longer reported by GDB (or vice versa) must be updated
             .unwrap_or(self.stack_trace.len().min(stack_trace.len()));
+        self.remove_out_of_scope_locals(update_index).await?;
         // Drop all cached frames starting at the first different frame
         self.drop_stack_frames_after(update_index);
         // New variables may have come into scope at the topmost unchanged frame
         if update_index > 0 {
             self.gdb
-                .stack_select_frame(stack_trace[stack_trace.len() - update_index].level)
+                .stack_select_frame(stack_trace[update_index - 1].0.level)
                 .await?;
             self.update_local_variables(update_index - 1).await?;
         }
         // Create new frames starting at the first different frame
-        let frames_to_push = stack_trace.into_iter().rev().skip(update_index);
+        let frames_to_push = stack_trace.into_iter().skip(update_index);
         self.push_stack_frames(frames_to_push).await?;
+        // Frames are only discarded now, so that the ones popped by this update
+        // could be restored by the frames that have replaced them
+        self.discard_popped_frames().await
+    }
+
+    /// Retrieves the base addresses of stack frames.
+    ///
+    /// The frame address tells apart calls of the same function at the same depth,
+    /// and unlike the program counter, it does not change while the function is running.
+    ///
+    /// ## Parameters
+    /// - `stack_trace` - frames as listed by GDB, starting from the top.
+    ///
+    /// ## Return Value
+    /// Addresses of the frames starting from the bottom of the stack,
+    /// [`None`] for frames whose address could not be determined.
+    async fn stack_frame_addresses(
+        &mut self,
+        stack_trace: &[StackFrame],
+    ) -> Result<Vec<Option<u64>>> {
+        let levels: Vec<_> = stack_trace.iter().rev().map(|frame| frame.level).collect();
+        self.gdb
+            .data_evaluate_expression_in_frames("$fp", &levels)
+            .await?
+            .into_iter()
+            .map(|value| match value {
+                Ok(value) => match Self::parse_node_value(&value) {
+                    Some(NodeValue::Uint(value)) => Ok(Some(value)),
+                    _ => Ok(None),
+                },
+                Err(Error::ErrorResponse(_)) => Ok(None),
+                Err(err) => Err(err),
+            })
+            .collect()
+    }
+
+    /// Removes the local variables that GDB has reported to be out of scope
+    /// from the frames that are kept by a stack trace update.
+    ///
+    /// Locals of the frames that are about to be popped are set aside instead.
+    async fn remove_out_of_scope_locals(&mut self, kept_frames: usize) -> Result<()> {
+        let popped_locals = self.popped_local_variables();
+        let mut out_of_scope = Vec::from_iter(self.out_of_scope_locals.iter().copied());
+        // Keep the order of commands deterministic
+        out_of_scope.sort();
+        for handle in out_of_scope {
+            if popped_locals.contains(&handle) {
+                continue;
+            }
+            let Some(variable) = self.variables.get(handle) else {
+                continue;
+            };
+            if let Some(GdbStateNodeId::Frame(frame_index)) = variable.parent
+                && frame_index < kept_frames
+            {
+                let object = variable.object.clone();
+                self.variable_object_out_of_scope(&object).await?;
+            }
+        }
         Ok(())
     }
 
     async fn update_local_variables(&mut self, frame_index: usize) -> Result<()> {
+        let locals = self.list_local_variables().await?;
+        self.create_missing_local_variables(frame_index, locals)
+            .await
+    }
+
+    /// Creates the local variables of a frame that the frame does not know about yet.
+    async fn create_missing_local_variables(
+        &mut self,
+        frame_index: usize,
+        locals: Vec<(String, EdgeLabel)>,
+    ) -> Result<()> {
+        for (name, edge_id) in locals {
+            // Check that the parent (the stack frame node) knows about the variable
+            let has_the_variable = self.stack_trace[frame_index]
+                .successors
+                .iter()
+                .any(|(e, _)| *e == edge_id);
+            // If the stack frame does not know about the variable, create it now
+            if !has_the_variable {
+                self.create_local_variable(frame_index, &name, edge_id)
+                    .await?;
+            }
+        }
+        Ok(())
+    }
+
+    /// Lists the local variables visible in the selected frame.
+    ///
+    /// ## Return Value
+    /// Names of the variables and labels of the edges
+    /// that lead to them from their frame.
+    async fn list_local_variables(&mut self) -> Result<Vec<(String, EdgeLabel)>> {
         let mut locals = self
             .gdb
             .stack_list_variables(PrintValues::NoValues, false)
@@ -442,6 +804,7 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
         // Sort the output by name so that variables of the same name end up together
         locals.sort_by(|a, b| a.name.cmp(&b.name));
         let mut locals = locals.into_iter().peekable();
+        let mut visible = Vec::new();
         // Go through all local variables
         while let Some(local) = locals.next() {
             let name = local.name;
@@ -454,21 +817,12 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
             }
             // We can only get one variable value, assume it is the one
             // with largest discriminator (the most recently declared one)
-            let edge_id = EdgeLabel::Named(name.clone(), overloads);
-            // Check that the parent (the stack frame node) knows about the variable
-            let has_the_variable = self.stack_trace[frame_index]
-                .successors
-                .iter()
-                .any(|(e, _)| *e == edge_id);
-            // If the stack frame does not know about the variable, create it now
-            if !has_the_variable {
-                self.create_local_variable(frame_index, &name, edge_id)
-                    .await?;
-            }
+            let edge_id = EdgeLabel::Named(symbol::Symbol::new(&name), overloads);
+            visible.push((name, edge_id));
             // TODO: Check that the stack knows about all shadowed variables as well,
             // and warn if it does not (they are not reachable from our current point)
         }
-        Ok(())
+        Ok(visible)
     }
 
     async fn create_local_variable(
@@ -482,12 +836,14 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
             .var_create(VariableObjectFrameContext::CurrentFrame, name)
             .await?;
         let handle = self
-            .create_variable_tree(var_object, Some(GdbStateNodeId::Frame(frame_index)))
+            .create_variable_tree(var_object, Some(GdbStateNodeId::Frame(frame_index)), 0)
             .await?;
-        let id = GdbStateNodeId::VarObject(handle.clone());
+        let id = GdbStateNodeId::VarObject(handle);
         self.stack_trace[frame_index]
             .successors
             .push((edge_label, id));
+        self.changed_nodes
+            .insert(GdbStateNodeId::Frame(frame_index));
         self.add_variable_to_address_map(name, handle, false)
             .await?;
         Ok(())
@@ -499,57 +855,348 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
             self.pop_stack_frame();
         }
         // Unlink the reference in the preceding node
-        if update_index == 0 {
-            self.root_node.remove_successor(&EdgeLabel::Main);
+        let unlinked = if update_index == 0 {
+            self.root_node.remove_successor(&EdgeLabel::Main)
         } else {
-            self.stack_trace[update_index - 1].remove_successor(&EdgeLabel::Next);
+            self.stack_trace[update_index - 1].remove_successor(&EdgeLabel::Next)
+        };
+        if unlinked.is_some() {
+            let previous_node = update_index
+                .checked_sub(1)
+                .map_or(GdbStateNodeId::Root, GdbStateNodeId::Frame);
+            self.changed_nodes.insert(previous_node);
         }
     }
 
     /// Panics if the stack is empty
     fn pop_stack_frame(&mut self) {
-        // Variable objects should be invalidated by GDB,
-        // so we do not remove those manually
-        self.stack_trace.pop().unwrap();
+        let frame = self.stack_trace.pop().unwrap();
+        let frame_address = self.graph.stack_frame_addresses.pop().flatten();
+        let frame_index = self.stack_trace.len();
+        self.changed_nodes
+            .insert(GdbStateNodeId::Frame(frame_index));
+        // Set the local variables aside, the same frame may be pushed again
+        let mut locals = Vec::new();
+        for (edge_label, id) in frame.successors {
+            if let GdbStateNodeId::VarObject(handle) = id {
+                let (address_range, referers) = self.detach_variable_tree(handle);
+                locals.push(PoppedLocalVariable {
+                    edge_label,
+                    handle,
+                    address_range,
+                    referers,
+                });
+            }
+        }
+        self.graph.popped_frames.push_back(PoppedStackFrame {
+            function: frame.type_name.expect("All stack frame nodes have a name"),
+            frame_address,
+            locals,
+        });
+    }
+
+    /// Unlinks a variable tree from the rest of the graph,
+    /// keeping its variable objects so that it can be
+    /// [attached](GdbStateGraphWriter::attach_variable_tree) again.
+    ///
+    /// ## Return Value
+    /// Entry of the variable in the address map, which is removed
+    /// so that no pointers are resolved to the variable while it is detached,
+    /// and the pointers into the variable, whose dereferences are unlinked.
+    fn detach_variable_tree(
+        &mut self,
+        handle: VariableHandle,
+    ) -> (Option<AddressRange>, Vec<(VariableHandle, VariableObject)>) {
+        let address_range = self
+            .variables
+            .get(handle)
+            .and_then(|variable| variable.address)
+            .and_then(|address| self.address_mapping.remove(address, handle));
+        let mut unlinked_referers = Vec::new();
+        for id in self.variable_subtree(handle) {
+            // Pointers to the variable would be dangling
+            if let GdbStateNodeId::VarObject(member) = id
+                && let Some(variable) = self.variables.get_mut(member)
+            {
+                for referer in std::mem::take(&mut variable.referers) {
+                    if let Some(referer_node) = self.variables.get_mut(referer) {
+                        referer_node.remove_successor(&EdgeLabel::Deref);
+                        unlinked_referers.push((referer, referer_node.object.clone()));
+                        self.changed_nodes
+                            .insert(GdbStateNodeId::VarObject(referer));
+                    }
+                }
+            }
+            self.changed_nodes.insert(id);
+        }
+        (address_range, unlinked_referers)
+    }
+
+    /// Links a [detached](GdbStateGraphWriter::detach_variable_tree)
+    /// local variable to a stack frame.
+    async fn attach_variable_tree(
+        &mut self,
+        frame_index: usize,
+        local: PoppedLocalVariable,
+    ) -> Result<()> {
+        let handle = local.handle;
+        let Some(variable) = self.graph.variables.get_mut(handle) else {
+            return Ok(());
+        };
+        variable.parent = Some(GdbStateNodeId::Frame(frame_index));
+        if let (Some(address), Some(range)) = (variable.address, local.address_range) {
+            self.graph.address_mapping.insert(address, range);
+        }
+        self.stack_trace[frame_index]
+            .successors
+            .push((local.edge_label, GdbStateNodeId::VarObject(handle)));
+        self.statistics.variables_restored += 1;
+        let mut bulk_arrays = Vec::new();
+        for id in self.variable_subtree(handle) {
+            if let GdbStateNodeId::VarObject(member) = id {
+                let variable = self
+                    .variables
+                    .get(member)
+                    .expect("Subtree only consists of existing variables");
+                let (is_pointer, is_bulk_array) = (
+                    variable.type_class == NodeTypeClass::Ref,
+                    variable.bulk_array.is_some(),
+                );
+                // Dereferences have been unlinked or skipped while the variable was detached
+                if is_pointer {
+                    self.add_deferred_dereference(member);
+                }
+                if is_bulk_array {
+                    bulk_arrays.push(member);
+                }
+            }
+            self.changed_nodes.insert(id);
+        }
+        // Elements without variable objects have not been updated by GDB
+        self.reread_bulk_scalar_arrays(&bulk_arrays).await?;
+        // Pointers from outside the variable may still be pointing into it
+        for (referer, object) in local.referers {
+            if self.variables.handle(&object) == Some(referer) {
+                self.add_deferred_dereference(referer);
+                self.changed_nodes
+                    .insert(GdbStateNodeId::VarObject(referer));
+            }
+        }
+        Ok(())
+    }
+
+    /// Collects the IDs of a variable node and all nodes it owns,
+    /// not including the variables it points to.
+    fn variable_subtree(&self, handle: VariableHandle) -> Vec<GdbStateNodeId> {
+        let mut subtree = vec![GdbStateNodeId::VarObject(handle)];
+        let mut to_visit = vec![handle];
+        while let Some(handle) = to_visit.pop() {
+            let Some(variable) = self.variables.get(handle) else {
+                continue;
+            };
+            for (edge_label, id) in &variable.successors {
+                // Dereferenced variables are owned by someone else,
+                // unless they have been truncated
+                if *edge_label == EdgeLabel::Deref && !matches!(id, GdbStateNodeId::Truncated(_)) {
+                    continue;
+                }
+                if let GdbStateNodeId::VarObject(member) = id {
+                    to_visit.push(*member);
+                }
+                subtree.push(id.clone());
+            }
+        }
+        subtree
+    }
+
+    /// Finds the variable at the top of the tree that contains a variable node.
+    fn top_level_variable(&self, mut handle: VariableHandle) -> VariableHandle {
+        while let Some(GdbStateNodeId::VarObject(parent)) = self
+            .variables
+            .get(handle)
+            .and_then(|variable| variable.parent.as_ref())
+        {
+            handle = *parent;
+        }
+        handle
+    }
+
+    /// Collects the handles of the local variables of all popped frames.
+    fn popped_local_variables(&self) -> HashSet<VariableHandle> {
+        self.popped_frames
+            .iter()
+            .flat_map(|frame| &frame.locals)
+            .map(|local| local.handle)
+            .collect()
+    }
+
+    /// Restores the local variables of a recently popped frame
+    /// of the same function and with the same frame address.
+    ///
+    /// ## Parameters
+    /// - `frame_index` - index of the frame that has just been pushed.
+    /// - `frame_address` - base address of the frame on the stack.
+    /// - `visible_locals` - local variables that are visible in the frame,
+    ///   as [listed](GdbStateGraphWriter::list_local_variables) by GDB.
+    ///   Locals of the popped frame that are not among them are deleted.
+    async fn restore_popped_frame(
+        &mut self,
+        frame_index: usize,
+        frame_address: u64,
+        visible_locals: &[(String, EdgeLabel)],
+    ) -> Result<()> {
+        let function = self.stack_trace[frame_index].type_name.clone();
+        // Prefer the most recently popped frame
+        let Some(position) = self.popped_frames.iter().rposition(|frame| {
+            Some(&frame.function) == function.as_ref() && frame.frame_address == Some(frame_address)
+        }) else {
+            return Ok(());
+        };
+        let frame = self
+            .graph
+            .popped_frames
+            .remove(position)
+            .expect("Position has just been found");
+        for local in frame.locals {
+            let is_visible = visible_locals
+                .iter()
+                .any(|(_, edge_label)| *edge_label == local.edge_label);
+            // The variable object must refer to the same variable in the same frame
+            if is_visible && !self.out_of_scope_locals.contains(&local.handle) {
+                self.attach_variable_tree(frame_index, local).await?;
+            } else {
+                self.delete_variable_tree(local.handle).await?;
+            }
+        }
+        Ok(())
+    }
+
+    /// Deletes popped frames that do not fit into the cache,
+    /// along with the variable objects of their local variables.
+    async fn discard_popped_frames(&mut self) -> Result<()> {
+        let mut discarded = Vec::new();
+        // Frames without an address can never be restored
+        let (mut kept, unknown): (VecDeque<_>, VecDeque<_>) =
+            std::mem::take(&mut self.popped_frames)
+                .into_iter()
+                .partition(|frame| frame.frame_address.is_some());
+        discarded.extend(unknown);
+        while kept.len() > self.popped_frame_cache_size {
+            discarded.extend(kept.pop_front());
+        }
+        self.graph.popped_frames = kept;
+        for local in discarded.into_iter().flat_map(|frame| frame.locals) {
+            self.delete_variable_tree(local.handle).await?;
+        }
+        Ok(())
+    }
+
+    /// Deletes a detached variable tree along with its variable object.
+    async fn delete_variable_tree(&mut self, handle: VariableHandle) -> Result<()> {
+        let Some(variable) = self.variables.get(handle) else {
+            return Ok(());
+        };
+        let object = variable.object.clone();
+        self.remove_variables_recursive(handle);
+        self.gdb.var_delete(&object).await
     }
 
     async fn push_stack_frames(
         &mut self,
-        new_frames: impl IntoIterator<Item = StackFrame>,
+        new_frames: impl IntoIterator<Item = (StackFrame, Option<u64>)>,
     ) -> Result<()> {
-        for frame in new_frames {
-            self.push_stack_frame(frame).await?;
+        for (frame, frame_address) in new_frames {
+            self.push_stack_frame(frame, frame_address).await?;
         }
         Ok(())
     }
 
-    async fn push_stack_frame(&mut self, frame: StackFrame) -> Result<()> {
+    /// Pushes a frame to the top of the stack trace.
+    ///
+    /// ## Parameters
+    /// - `frame` - the frame as reported by GDB.
+    /// - `frame_address` - [base address](GdbStateGraphWriter::stack_frame_addresses)
+    ///   of the frame, if it is known.
+    async fn push_stack_frame(
+        &mut self,
+        frame: StackFrame,
+        frame_address: Option<u64>,
+    ) -> Result<()> {
         // Get the expected index of the frame
         let frame_index = self.stack_trace.len();
         // Create the node and add it to the trace
         let mut frame_node = GdbStateNode::new(NodeTypeClass::Frame);
-        frame_node.type_name = Some(frame.func);
+        frame_node.type_name = Some(self.intern_type_name(frame.func));
         self.stack_trace.push(frame_node);
+        self.graph.stack_frame_addresses.push(frame_address);
+        self.changed_nodes
+            .insert(GdbStateNodeId::Frame(frame_index));
         // Link the frame to the previous one or to the root node
         if frame_index == 0 {
             self.root_node
                 .successors
                 .push((EdgeLabel::Main, GdbStateNodeId::Frame(0)));
+            self.changed_nodes.insert(GdbStateNodeId::Root);
         } else {
             self.stack_trace[frame_index - 1]
                 .successors
                 .push((EdgeLabel::Next, GdbStateNodeId::Frame(frame_index)));
+            self.changed_nodes
+                .insert(GdbStateNodeId::Frame(frame_index - 1));
         }
         // Populate all local variables
         self.gdb.stack_select_frame(frame.level).await?;
-        self.update_local_variables(frame_index).await?;
-        Ok(())
+        let locals = self.list_local_variables().await?;
+        // The locals of a popped frame are only restored into the same one
+        if self.popped_frame_cache_size > 0
+            && let Some(frame_address) = frame_address
+        {
+            self.restore_popped_frame(frame_index, frame_address, &locals)
+                .await?;
+        }
+        self.create_missing_local_variables(frame_index, locals)
+            .await
     }
 
-    fn resolve_length_hints_from(&mut self, origin: &GdbStateNodeId) {
-        let variable_pool = VariablePool::default();
-        let resolver = SelectorResolver::new(self.pointer_hint_sheet.selector_machine());
-        self.resolve_length_hints_from_snapshot(origin, variable_pool, resolver);
+    /// Resolves the hint sheet from the root, reusing the results
+    /// of the previous update for subtrees that have not changed.
+    ///
+    /// Must be followed by [`GdbStateGraphWriter::finish_root_length_hints`]
+    /// once the update is done.
+    fn resolve_root_length_hints(&mut self) {
+        // Set the changes aside, so that the ones made afterwards
+        // can be handed over to the next resolution
+        let changed_nodes = std::mem::take(&mut self.changed_nodes);
+        let mut cache = std::mem::take(&mut self.length_hint_cache);
+        // Pointers about to be dereferenced need snapshots to continue from
+        let needs_snapshot = self
+            .deferred_pointers
+            .iter()
+            .chain(&self.graph.pending_dereferences)
+            .copied();
+        let snapshots = cache.resolve(
+            self.graph,
+            self.pointer_hint_sheet,
+            &changed_nodes,
+            needs_snapshot,
+        );
+        for (var_object, length) in cache.hints() {
+            self.graph
+                .resolved_length_hints
+                .insert(*var_object, length.clone());
+        }
+        self.stylesheet_snapshots.extend(snapshots);
+        self.graph.length_hint_cache = cache;
+        self.changed_before_root_hints = changed_nodes;
+    }
+
+    /// Hands the changes made since [`GdbStateGraphWriter::resolve_root_length_hints`]
+    /// over to the next resolution and restores the set of changed nodes.
+    fn finish_root_length_hints(&mut self) {
+        let changed_before = std::mem::take(&mut self.changed_before_root_hints);
+        let changed_after = std::mem::replace(&mut self.changed_nodes, changed_before);
+        self.changed_nodes.extend(changed_after.iter().cloned());
+        self.graph.length_hint_cache.mark_changed(changed_after);
     }
 
     fn resolve_length_hints_from_snapshot(
@@ -584,47 +1231,21 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
         origin: &GdbStateNodeId,
         resolver: &mut SelectorResolver<'a, GdbStateNodeId>,
         variable_pool: &mut VariablePool<&'a str, GdbStateNodeId>,
-        resolved_hints: &mut HashMap<VariableObject, PropertyValue<GdbStateNodeId>>,
-        snapshots: &mut HashMap<
-            VariableObject,
-            (
-                VariablePool<&'a str, GdbStateNodeId>,
-                SelectorResolver<'a, GdbStateNodeId>,
-            ),
-        >,
+        resolved_hints: &mut HashMap<VariableHandle, PropertyValue<GdbStateNodeId>>,
+        snapshots: &mut HashMap<VariableHandle, HintSnapshot<'a>>,
         previous_edge: Option<&EdgeLabel>,
     ) {
-        let context = EvaluationContext::from_graph(self.graph, origin.clone())
-            .with_variables(variable_pool)
-            .with_optional_preceding_edge(previous_edge);
-        let matched_rules = resolver.resolve_node(origin.clone(), &context);
-        for (rule_index, caret) in matched_rules {
-            let rule = self.pointer_hint_sheet.rule_at(rule_index);
-            if caret == SelectionCaret::PrecedingEdge || rule.extra_label.is_some() {
-                // TODO: Warn, this kind of rules should not appear here
-                continue;
-            }
-            for property in &rule.properties {
-                let context = EvaluationContext::from_graph(self.graph, origin.clone())
-                    .with_variables(variable_pool)
-                    .with_optional_preceding_edge(previous_edge);
-                match &property.key {
-                    StyleKey::Variable(name) => {
-                        let variable_value = evaluate(&property.value, &context);
-                        variable_pool.insert(name, variable_value);
-                    }
-                    StyleKey::Property(PointerLengthHintKey::Length) => {
-                        // If it is a variable node, resolve the
-                        if let GdbStateNodeId::VarObject(var_object) = origin {
-                            let length_value = evaluate(&property.value, &context);
-                            resolved_hints.insert(var_object.clone(), length_value);
-                        } else {
-                            // TODO: Warn, only variables should be assigned lengths
-                        }
-                    }
-                }
-            }
-        }
+        resolve_hint_rules(
+            self.pointer_hint_sheet,
+            self.graph,
+            origin,
+            resolver,
+            variable_pool,
+            previous_edge,
+            |var_object, length| {
+                resolved_hints.insert(var_object, length);
+            },
+        );
         // Return early if we know no selectors can match past this point
         if !resolver.has_edges_to_resolve() {
             return;
@@ -636,10 +1257,7 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
             .is_some_and(|n| n.type_class == NodeTypeClass::Ref)
             && let GdbStateNodeId::VarObject(var_object) = origin
         {
-            snapshots.insert(
-                var_object.clone(),
-                (variable_pool.snapshot(), resolver.snapshot()),
-            );
+            snapshots.insert(*var_object, (variable_pool.snapshot(), resolver.snapshot()));
         }
         for (edge_label, successor) in self
             .graph
@@ -668,25 +1286,136 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
         }
     }
 
-    #[expect(unused)]
-    async fn populate_global_variables(&mut self) -> Result<()> {
-        // Get all global variables across all files
-        let query_result = self.gdb.symbol_info_variables().await?;
-        for file in query_result {
-            for symbol in &file.symbols {
-                self.create_global_variable(symbol).await?;
-            }
-        }
-        Ok(())
+    fn resolve_reachability_from(&mut self, origin: &GdbStateNodeId) {
+        let Some(reachability_sheet) = self.reachability_sheet else {
+            return;
+        };
+        // Reachability is resolved from scratch, previous results may be stale
+        self.reachability_snapshots.clear();
+        let variable_pool = VariablePool::default();
+        let resolver = SelectorResolver::new(reachability_sheet.selector_machine());
+        self.resolve_reachability_from_snapshot(origin, variable_pool, resolver);
     }
 
-    async fn create_global_variable(&mut self, variable_symbol: &Symbol) -> Result<()> {
-        let edge_name = variable_symbol.name.clone();
-        // Create the node
-        let handle = self.read_global_variable_node(variable_symbol).await?;
-        let id = GdbStateNodeId::VarObject(handle.clone());
+    fn resolve_reachability_from_snapshot(
+        &mut self,
+        origin: &GdbStateNodeId,
+        mut variable_pool: VariablePool<&'a str, GdbStateNodeId>,
+        mut resolver: SelectorResolver<'a, GdbStateNodeId>,
+    ) {
+        let Some(reachability_sheet) = self.reachability_sheet else {
+            return;
+        };
+        let mut snapshots = std::mem::take(&mut self.reachability_snapshots);
+        // If running from root, there is no preceding edge
+        // Otherwise the entry point is after a dereference edge
+        let preceding_edge = if *origin == GdbStateNodeId::Root {
+            None
+        } else {
+            Some(EdgeLabel::Deref)
+        };
+        self.resolve_reachability_with_resolver_from(
+            reachability_sheet,
+            origin,
+            &mut resolver,
+            &mut variable_pool,
+            &mut snapshots,
+            preceding_edge.as_ref(),
+        );
+        self.reachability_snapshots = snapshots;
+    }
+
+    /// Traverses the graph the same way stylesheet application would
+    /// and saves snapshots of the resolution past each pointer
+    /// whose dereference may be selected.
+    fn resolve_reachability_with_resolver_from(
+        &self,
+        reachability_sheet: &ReachabilitySheet<'a>,
+        origin: &GdbStateNodeId,
+        resolver: &mut SelectorResolver<'a, GdbStateNodeId>,
+        variable_pool: &mut VariablePool<&'a str, GdbStateNodeId>,
+        snapshots: &mut HashMap<
+            VariableHandle,
+            (
+                VariablePool<&'a str, GdbStateNodeId>,
+                SelectorResolver<'a, GdbStateNodeId>,
+            ),
+        >,
+        previous_edge: Option<&EdgeLabel>,
+    ) {
+        let context = EvaluationContext::from_graph(self.graph, origin.clone())
+            .with_variables(variable_pool)
+            .with_optional_preceding_edge(previous_edge);
+        let mut matched_rules = resolver.resolve_node(origin.clone(), &context);
+        // Assign variables in the same order as stylesheet application
+        matched_rules
+            .sort_by_key(|&(rule_index, caret)| (caret == SelectionCaret::Node, rule_index));
+        for (rule_index, _) in matched_rules {
+            for &(name, value) in reachability_sheet.variables_at(rule_index) {
+                let context = EvaluationContext::from_graph(self.graph, origin.clone())
+                    .with_variables(variable_pool)
+                    .with_optional_preceding_edge(previous_edge);
+                let variable_value = evaluate(value, &context);
+                variable_pool.insert(name, variable_value);
+            }
+        }
+        // Return early if we know no selectors can match past this point
+        if !resolver.has_edges_to_resolve() {
+            return;
+        }
+        let Some(node) = self.graph.get(origin) else {
+            return;
+        };
+        // Save a snapshot past a pointer that has not been dereferenced yet,
+        // so we can resume from it once it is
+        if node.type_class == NodeTypeClass::Ref
+            && let GdbStateNodeId::VarObject(var_object) = origin
+            && !node.successors.iter().any(|(e, _)| *e == EdgeLabel::Deref)
+        {
+            let mut deref_resolver = resolver.snapshot();
+            deref_resolver.push_edge(&EdgeLabel::Deref);
+            if deref_resolver.has_edges_to_resolve() {
+                snapshots.insert(*var_object, (variable_pool.snapshot(), deref_resolver));
+            }
+        }
+        // Unlike length hints, reachability continues past existing dereferences,
+        // because pointers that have been left pending may be there
+        for (edge_label, successor) in &node.successors {
+            variable_pool.push();
+            resolver.push_edge(edge_label);
+            self.resolve_reachability_with_resolver_from(
+                reachability_sheet,
+                successor,
+                resolver,
+                variable_pool,
+                snapshots,
+                Some(edge_label),
+            );
+            resolver.pop_edge();
+            variable_pool.pop();
+        }
+    }
+
+    #[expect(unused)]
+    async fn populate_global_variables(&mut self) -> Result<()> {
+        // Get all global variables across all files
+        let query_result = self.gdb.symbol_info_variables().await?;
+        for file in query_result {
+            for symbol in &file.symbols {
+                self.create_global_variable(symbol).await?;
+            }
+        }
+        Ok(())
+    }
+
+    async fn create_global_variable(&mut self, variable_symbol: &Symbol) -> Result<()> {
+        let edge_name = symbol::Symbol::new(&variable_symbol.name);
+        // Create the node
+        let handle = self.read_global_variable_node(variable_symbol).await?;
+        let id = GdbStateNodeId::VarObject(handle);
         // Insert the node into root
         self.root_node.add_named_successor(edge_name, id);
+        self.changed_nodes.insert(GdbStateNodeId::Root);
         // Add the variable to address map
         self.add_variable_to_address_map(&variable_symbol.name, handle, true)
             .await?;
@@ -696,7 +1425,7 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
     async fn add_variable_to_address_map(
         &mut self,
         variable_name: &str,
-        var_object: VariableObject,
+        var_object: VariableHandle,
         is_global: bool,
     ) -> Result<()> {
         let prefix = if is_global { "::" } else { "" };
@@ -705,11 +1434,16 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
             .data_evaluate_expression(&format!("&{prefix}{variable_name}"))
             .await?;
         if let Some(NodeValue::Uint(address)) = Self::parse_node_value(&address) {
+            // The size lets pointers into the variable be resolved to its members
+            let size = self
+                .variable_size(var_object, &format!("{prefix}{variable_name}"))
+                .await?;
             self.variables
-                .get_mut(&var_object)
+                .get_mut(var_object)
                 .expect("The variable node was just created")
                 .address = Some(address);
-            self.address_mapping.insert(address, var_object);
+            self.address_mapping
+                .insert(address, AddressRange { size, var_object });
             // TODO: Handle the case if the variable already exists
         } else {
             // TODO: Warn
@@ -720,7 +1454,7 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
     async fn read_global_variable_node(
         &mut self,
         variable_symbol: &Symbol,
-    ) -> Result<VariableObject> {
+    ) -> Result<VariableHandle> {
         let var_object = self
             .gdb
             .var_create(
@@ -728,42 +1462,81 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
                 &format!("::{}", variable_symbol.name),
             )
             .await?;
-        self.create_variable_tree(var_object, Some(GdbStateNodeId::Root))
+        self.create_variable_tree(var_object, Some(GdbStateNodeId::Root), 0)
             .await
     }
 
+    /// Creates a node for a variable object and all its descendants.
+    ///
+    /// ## Parameters
+    /// - `depth` - number of dereferences between the nearest variable in scope
+    ///   and the new node.
     async fn create_variable_tree(
         &mut self,
         var_object: VariableObjectData,
         parent: Option<GdbStateNodeId>,
-    ) -> Result<VariableObject> {
-        // Will contain handle to the root node (the one initially requested)
+        depth: usize,
+    ) -> Result<VariableHandle> {
+        // Handle to the root node (the one initially requested)
         // by the function's caller
         let mut root_handle = None;
-        let mut to_construct = vec![DeferredVariableTree {
+        let mut frontier = vec![DeferredVariableTree {
             parent_node: parent,
             node_data: var_object,
             successor_id: None,
         }];
-        while let Some(requested_node) = to_construct.pop() {
-            // If this is the first node (the one passed to the function as argument),
-            // save its handle so we can return it at the end
-            root_handle.get_or_insert(requested_node.node_data.object.clone());
-            // Create the actual node
-            let deferred = self.create_variable_tree_segment(requested_node).await?;
-            // Explore the whole tree recursively
-            to_construct.extend(deferred);
-        }
-        Ok(
-            root_handle
-                .expect("The loop has to run at least once, so this will always be assigned"),
-        )
-    }
-
-    async fn create_variable_tree_segment(
+        while !frontier.is_empty() {
+            // Create all nodes on the current level of the tree.
+            // The level is processed in reverse, which preserves the order
+            // in which successors have always been inserted into their parents
+            let mut containers = Vec::new();
+            for requested_node in frontier.drain(..).rev() {
+                // The root node is always created, but its descendants
+                // are left out once there is no room for them
+                if root_handle.is_some() && self.is_node_budget_exhausted() {
+                    self.truncate_variable_tree(requested_node);
+                    continue;
+                }
+                let (handle, container) = self.create_variable_tree_segment(requested_node);
+                if root_handle.is_none() {
+                    // Descendants inherit the depth of their parents,
+                    // so it only needs to be set on the root
+                    self.variables
+                        .get_mut(handle)
+                        .expect("The node was just created")
+                        .depth = depth;
+                    root_handle = Some(handle);
+                }
+                containers.extend(container);
+            }
+            // Expand containers on the level a bounded number at a time,
+            // so that their commands can be pipelined
+            for batch in containers.chunks(self.expansion_batch_size) {
+                frontier.extend(self.after_create_container_variable_nodes(batch).await?);
+            }
+        }
+        Ok(root_handle.expect("The root node is always created first"))
+    }
+
+    /// Replaces a node of a variable tree that will not be created
+    /// with a [`NodeTypeClass::Truncated`] node in its parent.
+    fn truncate_variable_tree(&mut self, requested_node: DeferredVariableTree) {
+        if let (Some(GdbStateNodeId::VarObject(parent)), Some(successor_id)) =
+            (requested_node.parent_node, requested_node.successor_id)
+        {
+            self.insert_truncation_node(parent, Some(successor_id));
+        }
+    }
+
+    /// Creates a single node of a variable tree and inserts it into its parent.
+    ///
+    /// ## Return Value
+    /// Handle to the new node, and the same handle again
+    /// if it is a container whose children should be constructed next.
+    fn create_variable_tree_segment(
         &mut self,
         requested_node: DeferredVariableTree,
-    ) -> Result<Vec<DeferredVariableTree>> {
+    ) -> (VariableHandle, Option<VariableHandle>) {
         if requested_node.node_data.dynamic {
             // TODO: Warn
             // Dynamic variable objects should never be returned by GDB unless explicitly enabled
@@ -774,17 +1547,15 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
             .value
             .as_deref()
             .is_none_or(Self::is_value_of_container);
-        let var_object_handle = requested_node.node_data.object.clone();
-        self.create_variable_node(requested_node.node_data, requested_node.parent_node.clone());
-        let mut deferred = Vec::new();
+        let var_object_handle =
+            self.create_variable_node(requested_node.node_data, requested_node.parent_node.clone());
+        let mut container = None;
         if has_children {
             if is_container {
-                // If there are children, now is the time to resolve them
-                deferred = self
-                    .after_create_container_variable_node(&var_object_handle)
-                    .await?;
+                // If there are children, they will be resolved with the next level
+                container = Some(var_object_handle);
             } else {
-                self.after_create_non_atom_variable_node(&var_object_handle);
+                self.after_create_non_atom_variable_node(var_object_handle);
             }
         }
         // Insert into parent if requested
@@ -795,15 +1566,21 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
             let parent_node = self.get_mut(&parent_id).expect("The node was just created");
             match successor_id {
                 ContainerChildId::Named(name) => parent_node.add_named_successor(name, node_id),
-                ContainerChildId::Index(index) => parent_node
-                    .successors
-                    .push((EdgeLabel::Index(index), node_id)),
+                ContainerChildId::Index(index) => {
+                    // Keep elements at the positions of their indices,
+                    // ahead of the length edge, so they can be looked up directly
+                    let position = index.min(parent_node.successors.len());
+                    parent_node
+                        .successors
+                        .insert(position, (EdgeLabel::Index(index), node_id));
+                }
             }
+            self.changed_nodes.insert(parent_id);
         }
-        Ok(deferred)
+        (var_object_handle, container)
     }
 
-    fn after_create_non_atom_variable_node(&mut self, var_object: &VariableObject) {
+    fn after_create_non_atom_variable_node(&mut self, var_object: VariableHandle) {
         let node = self
             .variables
             .get_mut(var_object)
@@ -813,42 +1590,103 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
             // the node is a pointer
             node.type_class = NodeTypeClass::Ref;
             // Resolve the dereference later
-            self.add_deferred_dereference(var_object.clone());
+            self.add_deferred_dereference(var_object);
         }
     }
 
+    /// Lists children of variable objects, replacing pseudo-children
+    /// with their own children.
+    ///
+    /// ## Parameters
+    /// - `var_objects` - handles to the variable nodes, along with the maximum
+    ///   number of children that should be listed for each.
     async fn list_children_with_resolved_pseudo_children(
         &mut self,
-        var_object: &VariableObject,
-    ) -> Result<Vec<ChildVariableObject>> {
+        var_objects: &[(VariableHandle, Option<usize>)],
+    ) -> Result<Vec<Vec<ChildVariableObject>>> {
+        let var_objects: Vec<_> = var_objects
+            .iter()
+            .map(|(handle, limit)| {
+                let object = self
+                    .variables
+                    .get(*handle)
+                    .expect("The node was just created")
+                    .object
+                    .clone();
+                (object, *limit)
+            })
+            .collect();
+        let var_objects: Vec<_> = var_objects
+            .iter()
+            .map(|(object, limit)| (object, *limit))
+            .collect();
         let primary_children = self
             .gdb
-            .var_list_children(var_object, PrintValues::SimpleValues)
+            .var_list_children_limited_batch(&var_objects, PrintValues::SimpleValues)
             .await?;
-        let mut children = Vec::new();
-        for child in primary_children.children {
-            if child.variable_object.type_name.is_some() {
-                // Proper children are returned directly
-                children.push(child);
-            } else {
-                // Pseudo-children are resolved first
-                let nested_children = self
-                    .gdb
-                    .var_list_children(&child.variable_object.object, PrintValues::SimpleValues)
-                    .await?;
-                children.extend(nested_children.children);
-            }
-        }
-        Ok(children)
+        // Pseudo-children of all objects are resolved at once,
+        // so the commands can be pipelined
+        let pseudo_children: Vec<_> = primary_children
+            .iter()
+            .flat_map(|child_list| &child_list.children)
+            .filter(|child| child.variable_object.type_name.is_none())
+            .map(|child| &child.variable_object.object)
+            .collect();
+        let mut nested_children = self
+            .gdb
+            .var_list_children_batch(&pseudo_children, PrintValues::SimpleValues)
+            .await?
+            .into_iter();
+        Ok(primary_children
+            .into_iter()
+            .map(|child_list| {
+                let mut children = Vec::new();
+                for child in child_list.children {
+                    if child.variable_object.type_name.is_some() {
+                        // Proper children are returned directly
+                        children.push(child);
+                    } else if let Some(nested_children) = nested_children.next() {
+                        // Pseudo-children are replaced with their children, in place
+                        children.extend(nested_children.children);
+                    }
+                }
+                children
+            })
+            .collect())
     }
 
-    async fn after_create_container_variable_node(
+    async fn after_create_container_variable_nodes(
         &mut self,
-        var_object: &VariableObject,
+        var_objects: &[VariableHandle],
     ) -> Result<Vec<DeferredVariableTree>> {
+        // Arrays of scalars may be constructed without listing their children
+        let mut listed_var_objects = Vec::new();
+        let mut truncations = Vec::new();
+        for var_object in var_objects {
+            if !self.try_create_bulk_scalar_array(*var_object).await? {
+                let truncation = self.array_truncation(*var_object);
+                listed_var_objects.push((*var_object, truncation.map(|t| t.listed_length)));
+                truncations.push(truncation);
+            }
+        }
         let children = self
-            .list_children_with_resolved_pseudo_children(var_object)
+            .list_children_with_resolved_pseudo_children(&listed_var_objects)
             .await?;
+        let mut deferred = Vec::new();
+        for (((var_object, _), truncation), children) in
+            listed_var_objects.iter().zip(truncations).zip(children)
+        {
+            deferred.extend(self.after_list_container_children(*var_object, children, truncation));
+        }
+        Ok(deferred)
+    }
+
+    fn after_list_container_children(
+        &mut self,
+        var_object: VariableHandle,
+        children: Vec<ChildVariableObject>,
+        truncation: Option<ArrayTruncation>,
+    ) -> Vec<DeferredVariableTree> {
         let container_kind = ContainerKind::deduce_from_children(&children)
             .expect("We have just verified that the node has children; type must be deducible");
         let node = self
@@ -857,14 +1695,14 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
             .expect("The node was just created");
         node.type_class = container_kind.into();
         match container_kind {
-            ContainerKind::Struct => Ok(children
+            ContainerKind::Struct => children
                 .into_iter()
                 .map(|child| DeferredVariableTree {
-                    parent_node: Some(GdbStateNodeId::VarObject(var_object.clone())),
+                    parent_node: Some(GdbStateNodeId::VarObject(var_object)),
                     node_data: child.variable_object,
-                    successor_id: Some(ContainerChildId::Named(child.exp)),
+                    successor_id: Some(ContainerChildId::Named(child.exp.into())),
                 })
-                .collect()),
+                .collect(),
             ContainerKind::Array => {
                 // Remove the node's type if it was given one, array nodes do not have types
                 node.type_name = None;
@@ -882,59 +1720,853 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
                     };
                     length = length.max(index + 1);
                     deferred.push(DeferredVariableTree {
-                        parent_node: Some(GdbStateNodeId::VarObject(var_object.clone())),
+                        parent_node: Some(GdbStateNodeId::VarObject(var_object)),
                         node_data: child.variable_object,
                         successor_id: Some(ContainerChildId::Index(index)),
                     });
                 }
-                // Insert the length node
-                let mut length_node = GdbStateNode::new(NodeTypeClass::Atom);
-                length_node.value = Some(NodeValue::Uint(length as u64));
-                self.length_nodes.insert(var_object.clone(), length_node);
-                self.variables
-                    .get_mut(var_object)
-                    .expect("The node was just created")
-                    .successors
-                    .push((
-                        EdgeLabel::Length,
-                        GdbStateNodeId::Length(var_object.clone()),
-                    ));
-                Ok(deferred)
+                // If not all elements have been listed,
+                // mark the first one that has not been
+                if let Some(truncation) = truncation {
+                    self.insert_truncation_node(
+                        var_object,
+                        Some(ContainerChildId::Index(truncation.listed_length)),
+                    );
+                    length = length.max(truncation.full_length);
+                }
+                self.insert_length_node(var_object, length);
+                // Each level of the tree is created in reverse,
+                // so this makes the elements end up in order of their indices
+                deferred.reverse();
+                deferred
             }
             ContainerKind::Pointer => unreachable!(),
         }
     }
 
+    fn insert_length_node(&mut self, var_object: VariableHandle, length: usize) {
+        let mut length_node = GdbStateNode::new(NodeTypeClass::Atom);
+        length_node.value = Some(NodeValue::Uint(length as u64));
+        self.changed_nodes
+            .insert(GdbStateNodeId::Length(var_object));
+        let node = self
+            .variables
+            .get_mut(var_object)
+            .expect("The node was just created");
+        node.length_node = Some(length_node);
+        node.successors
+            .push((EdgeLabel::Length, GdbStateNodeId::Length(var_object)));
+    }
+
+    /// Attempts to construct the elements of an array of scalars
+    /// from a single read of its memory, without creating
+    /// a variable object for each element.
+    ///
+    /// ## Return Value
+    /// True if the elements have been constructed, false if the array
+    /// should be constructed from its children instead.
+    async fn try_create_bulk_scalar_array(&mut self, var_object: VariableHandle) -> Result<bool> {
+        let Some(min_length) = self.bulk_read_min_length else {
+            return Ok(false);
+        };
+        let node = self
+            .variables
+            .get(var_object)
+            .expect("The node was just created");
+        let Some((element_type, length)) =
+            node.type_name.as_deref().and_then(Self::parse_array_type)
+        else {
+            return Ok(false);
+        };
+        if length < min_length {
+            return Ok(false);
+        }
+        let element_type = element_type.to_owned();
+        let var_object_name = node.object.clone();
+        let Some(element_layout) = self.scalar_layout(&element_type).await? else {
+            return Ok(false);
+        };
+        // Only read as many elements as the budget allows
+        let full_length = length;
+        let length = self
+            .budget
+            .max_array_elements
+            .map_or(length, |max| length.min(max));
+        let (address, values) = match self
+            .read_bulk_scalar_array(&var_object_name, length, element_layout)
+            .await
+        {
+            Ok(Some(array)) => array,
+            // GDB may refuse to read the memory, in which case
+            // we fall back to variable objects
+            Ok(None) | Err(Error::ErrorResponse(_)) => return Ok(false),
+            Err(err) => return Err(err),
+        };
+        let element_type = self.intern_type_name(element_type);
+        let mut elements = Vec::with_capacity(length);
+        let mut successors = Vec::with_capacity(length);
+        for (index, value) in values.into_iter().enumerate() {
+            let mut element = GdbStateNode::new(NodeTypeClass::Atom);
+            element.type_name = Some(element_type.clone());
+            element.value = Some(value);
+            elements.push(element);
+            let element_id = GdbStateNodeId::ArrayElement(var_object, index);
+            self.changed_nodes.insert(element_id.clone());
+            successors.push((EdgeLabel::Index(index), element_id));
+        }
+        let node = self
+            .variables
+            .get_mut(var_object)
+            .expect("The node was just created");
+        // Array nodes do not have types
+        node.type_class = NodeTypeClass::Array;
+        node.type_name = None;
+        node.successors.extend(successors);
+        node.bulk_array = Some(BulkScalarArray {
+            address,
+            element_layout,
+            elements,
+        });
+        if length < full_length {
+            self.insert_truncation_node(var_object, Some(ContainerChildId::Index(length)));
+        }
+        self.insert_length_node(var_object, full_length);
+        Ok(true)
+    }
+
+    /// Reads the contents of an array of scalars from memory.
+    ///
+    /// ## Return Value
+    /// Address of the array and the values of its elements,
+    /// or [`None`] if the array cannot be read in bulk.
+    async fn read_bulk_scalar_array(
+        &mut self,
+        var_object: &VariableObject,
+        length: usize,
+        layout: ScalarLayout,
+    ) -> Result<Option<(u64, Vec<NodeValue>)>> {
+        let path = self.gdb.var_info_path_expression(var_object).await?;
+        let blocks = self
+            .gdb
+            .data_read_memory_bytes(&format!("&({path})[0]"), length * layout.size)
+            .await?;
+        let Some((address, contents)) = Self::exact_memory_block(blocks, length * layout.size)
+        else {
+            return Ok(None);
+        };
+        let Some(endianness) = self.resolve_endianness(&path, layout, &contents).await? else {
+            return Ok(None);
+        };
+        let values = contents
+            .chunks_exact(layout.size)
+            .map(|bytes| Self::decode_scalar(bytes, layout, endianness))
+            .collect();
+        Ok(Some((address, values)))
+    }
+
+    /// Takes the contents of a block of memory read by GDB,
+    /// but only if all of it could be read.
+    ///
+    /// ## Parameters
+    /// - `blocks` - blocks reported by GDB for a single read.
+    /// - `count` - number of bytes that were requested.
+    ///
+    /// ## Return Value
+    /// Address of the block and its contents,
+    /// or [`None`] if any part of it could not be read.
+    fn exact_memory_block(mut blocks: Vec<MemoryBlock>, count: usize) -> Option<(u64, Vec<u8>)> {
+        // GDB splits the response into multiple blocks if it could not read
+        // some part of the memory, so we expect to get exactly one
+        match blocks.pop() {
+            Some(block)
+                if blocks.is_empty() && block.offset == 0 && block.contents.len() == count =>
+            {
+                Some((block.begin, block.contents))
+            }
+            _ => None,
+        }
+    }
+
+    /// Determines how the elements of arrays of a scalar type are read from memory.
+    ///
+    /// Layouts are cached by type name. The size and the interpretation
+    /// of the type are asked from GDB in a single batch, so typedefs
+    /// and the signedness of `char` are resolved the same way the debuggee sees them.
+    ///
+    /// ## Return Value
+    /// Layout of the type, or [`None`] if it is not an integral scalar
+    /// whose size is a power of two up to eight bytes.
+    async fn scalar_layout(&mut self, type_name: &str) -> Result<Option<ScalarLayout>> {
+        if let Some(layout) = self.scalar_layouts.get(type_name) {
+            return Ok(*layout);
+        }
+        let t = type_name;
+        let expressions = [
+            format!("sizeof({t})"),
+            // Only booleans convert two to one
+            format!("({t})2 == ({t})1"),
+            // Only integers truncate fractions to zero
+            format!("({t})0.5 == ({t})0"),
+            format!("({t})-1 < ({t})0"),
+            // Enumerations are reported by the names of their values
+            format!("({t})0"),
+        ];
+        // Types that cannot be cast (structures, pointers, ...) fail the evaluation
+        // and values that are not numbers are not parsed
+        let values: Option<Vec<_>> = self
+            .gdb
+            .data_evaluate_expression_batch(&expressions)
+            .await?
+            .into_iter()
+            .map(|value| match value {
+                Ok(value) => Ok(Self::parse_node_value(&value)),
+                Err(Error::ErrorResponse(_)) => Ok(None),
+                Err(err) => Err(err),
+            })
+            .collect::<Result<_>>()?;
+        let is_true =
+            |value: &NodeValue| matches!(value, NodeValue::Uint(1) | NodeValue::Bool(true));
+        let layout = values.and_then(|values| {
+            let [size, is_bool, is_integral, is_signed, zero] = &values[..] else {
+                return None;
+            };
+            if !matches!(zero, NodeValue::Uint(0) | NodeValue::Bool(false)) {
+                return None;
+            }
+            let size = match size {
+                NodeValue::Uint(size @ (1 | 2 | 4 | 8)) => *size as usize,
+                _ => return None,
+            };
+            let kind = if is_true(is_bool) {
+                ScalarKind::Bool
+            } else if !is_true(is_integral) {
+                return None;
+            } else if is_true(is_signed) {
+                ScalarKind::Signed
+            } else {
+                ScalarKind::Unsigned
+            };
+            Some(ScalarLayout { size, kind })
+        });
+        self.scalar_layouts.insert(Arc::from(type_name), layout);
+        Ok(layout)
+    }
+
+    /// Determines the byte order of the target, in which the contents
+    /// of arrays of scalars are decoded.
+    ///
+    /// The byte order is resolved once for the whole target.
+    /// If it has been set explicitly in GDB, that setting is used.
+    /// Otherwise, it is deduced by letting GDB evaluate an element
+    /// of the array that reads differently in each byte order.
+    ///
+    /// ## Return Value
+    /// The byte order, or [`None`] if it is not known yet and the contents
+    /// of the array cannot tell, in which case the array should not be
+    /// decoded at all.
+    async fn resolve_endianness(
+        &mut self,
+        path: &str,
+        layout: ScalarLayout,
+        contents: &[u8],
+    ) -> Result<Option<Endianness>> {
+        if let Some(endianness) = self.target_endianness {
+            return Ok(Some(endianness));
+        }
+        if layout.size == 1 {
+            // Single bytes read the same in both byte orders
+            return Ok(Some(Endianness::Little));
+        }
+        if !self.endianness_setting_read {
+            self.endianness_setting_read = true;
+            // The setting can also be "auto", which tells us nothing
+            self.target_endianness = match self.gdb.gdb_show("endian").await {
+                Ok(setting) if setting == "little" => Some(Endianness::Little),
+                Ok(setting) if setting == "big" => Some(Endianness::Big),
+                Ok(_) | Err(Error::ErrorResponse(_)) => None,
+                Err(err) => return Err(err),
+            };
+            if self.target_endianness.is_some() {
+                return Ok(self.target_endianness);
+            }
+        }
+        // Find an element whose value depends on the byte order
+        let Some(index) = contents
+            .chunks_exact(layout.size)
+            .position(|bytes| bytes.iter().ne(bytes.iter().rev()))
+        else {
+            // All elements read the same in both byte orders, but future
+            // contents might not, so do not guess
+            return Ok(None);
+        };
+        let value = self
+            .gdb
+            .data_evaluate_expression(&format!("({path})[{index}]"))
+            .await?;
+        let Some(expected_value) = Self::parse_node_value(&value) else {
+            return Ok(None);
+        };
+        let bytes = &contents[index * layout.size..(index + 1) * layout.size];
+        let endianness = [Endianness::Little, Endianness::Big]
+            .into_iter()
+            .find(|e| Self::decode_scalar(bytes, layout, *e) == expected_value);
+        self.target_endianness = endianness;
+        Ok(endianness)
+    }
+
+    /// Re-reads the contents of all arrays that have been read in bulk
+    /// and updates the values of their elements.
+    async fn update_bulk_scalar_arrays(&mut self) -> Result<()> {
+        // Memory of popped frames is no longer meaningful
+        let mut inactive_locals = self.popped_local_variables();
+        inactive_locals.extend(self.out_of_scope_locals.iter().copied());
+        let handles: Vec<_> = self
+            .variables
+            .iter()
+            .filter(|(_, node)| node.bulk_array.is_some())
+            .map(|(handle, _)| handle)
+            .filter(|handle| !inactive_locals.contains(&self.top_level_variable(*handle)))
+            .collect();
+        self.reread_bulk_scalar_arrays(&handles).await
+    }
+
+    /// Reads the elements of arrays that have been read from memory in bulk again.
+    ///
+    /// All arrays are read in a single batch.
+    async fn reread_bulk_scalar_arrays(&mut self, handles: &[VariableHandle]) -> Result<()> {
+        // Arrays are only read in bulk once the byte order is known,
+        // unless they consist of single bytes
+        let reads: Vec<_> = handles
+            .iter()
+            .filter_map(|&handle| {
+                let array = self.variables.get(handle)?.bulk_array.as_ref()?;
+                let layout = array.element_layout;
+                let endianness = self
+                    .target_endianness
+                    .or((layout.size == 1).then_some(Endianness::Little))?;
+                let count = array.elements.len() * layout.size;
+                Some((handle, array.address, count, endianness))
+            })
+            .collect();
+        if reads.is_empty() {
+            return Ok(());
+        }
+        let blocks: Vec<_> = reads
+            .iter()
+            .map(|(_, address, count, _)| (address.to_string(), *count))
+            .collect();
+        let responses = self.gdb.data_read_memory_bytes_batch(&blocks).await?;
+        for ((handle, _, count, endianness), response) in reads.into_iter().zip(responses) {
+            let contents = match response.map(|blocks| Self::exact_memory_block(blocks, count)) {
+                Ok(Some((_, contents))) => contents,
+                // If the memory cannot be read, keep the last known values
+                Ok(None) | Err(Error::ErrorResponse(_)) => continue,
+                Err(err) => return Err(err),
+            };
+            self.update_bulk_scalar_array_elements(handle, &contents, endianness);
+        }
+        Ok(())
+    }
+
+    /// Updates the values of the elements of an array
+    /// that has been read from memory in bulk.
+    fn update_bulk_scalar_array_elements(
+        &mut self,
+        handle: VariableHandle,
+        contents: &[u8],
+        endianness: Endianness,
+    ) {
+        let graph = &mut *self.graph;
+        let Some(array) = graph
+            .variables
+            .get_mut(handle)
+            .and_then(|n| n.bulk_array.as_mut())
+        else {
+            return;
+        };
+        let layout = array.element_layout;
+        for (index, (element, bytes)) in array
+            .elements
+            .iter_mut()
+            .zip(contents.chunks_exact(layout.size))
+            .enumerate()
+        {
+            let value = Some(Self::decode_scalar(bytes, layout, endianness));
+            if element.value != value {
+                element.value = value;
+                graph
+                    .changed_nodes
+                    .insert(GdbStateNodeId::ArrayElement(handle, index));
+            }
+        }
+    }
+
+    /// Decodes a scalar value from its representation in memory.
+    ///
+    /// Values are represented the same way as if they were
+    /// [parsed](GdbStateGraphWriter::parse_node_value) from their
+    /// values reported by GDB, that is, non-negative integers
+    /// are always [`NodeValue::Uint`] and booleans are [`NodeValue::Bool`].
+    fn decode_scalar(bytes: &[u8], layout: ScalarLayout, endianness: Endianness) -> NodeValue {
+        let mut buffer = [0; 8];
+        let value = match endianness {
+            Endianness::Little => {
+                buffer[..layout.size].copy_from_slice(bytes);
+                u64::from_le_bytes(buffer)
+            }
+            Endianness::Big => {
+                buffer[8 - layout.size..].copy_from_slice(bytes);
+                u64::from_be_bytes(buffer)
+            }
+        };
+        match layout.kind {
+            ScalarKind::Signed => {
+                // Sign-extend the value to full width
+                let shift = 64 - 8 * layout.size as u32;
+                let value = ((value << shift) as i64) >> shift;
+                if value < 0 {
+                    NodeValue::Int(value)
+                } else {
+                    NodeValue::Uint(value as u64)
+                }
+            }
+            ScalarKind::Unsigned => NodeValue::Uint(value),
+            ScalarKind::Bool => NodeValue::Bool(value != 0),
+        }
+    }
+
+    /// Recognizes type names of arrays.
+    ///
+    /// ## Return Value
+    /// Name of the element type and the length of the array.
+    fn parse_array_type(type_name: &str) -> Option<(&str, usize)> {
+        static ARRAY_TYPE_REGEX: LazyLock<Regex> =
+            LazyLock::new(|| Regex::new(r"^(.+?) ?\[(\d+)\]$").unwrap());
+        let caps = ARRAY_TYPE_REGEX.captures(type_name)?;
+        let element_type = caps.get(1).unwrap().as_str();
+        let length = caps.get(2).unwrap().as_str().parse().ok()?;
+        Some((element_type, length))
+    }
+
+    /// Checks whether the budget allows no more variable nodes to be created.
+    fn is_node_budget_exhausted(&self) -> bool {
+        self.budget
+            .max_nodes
+            .is_some_and(|max| self.variables.len() >= max)
+    }
+
+    /// Checks whether the budget allows a new object to be dereferenced.
+    ///
+    /// ## Parameters
+    /// - `depth` - depth of the pointer that would be dereferenced.
+    fn is_dereference_over_budget(&self, depth: usize) -> bool {
+        self.budget.max_depth.is_some_and(|max| depth >= max)
+            || self
+                .budget
+                .max_dereferences_per_update
+                .is_some_and(|max| self.dereference_count >= max)
+            || self.is_node_budget_exhausted()
+    }
+
+    /// Determines whether an array should only be listed in part
+    /// because it is longer than the budget allows.
+    fn array_truncation(&self, var_object: VariableHandle) -> Option<ArrayTruncation> {
+        static ARRAY_LENGTH_REGEX: LazyLock<Regex> =
+            LazyLock::new(|| Regex::new(r"^[^\[(]*\[(\d+)\]").unwrap());
+        let max = self.budget.max_array_elements?;
+        let type_name = self.variables.get(var_object)?.type_name.as_deref()?;
+        let caps = ARRAY_LENGTH_REGEX.captures(type_name)?;
+        let full_length = caps.get(1).unwrap().as_str().parse().ok()?;
+        (full_length > max).then_some(ArrayTruncation {
+            full_length,
+            listed_length: max,
+        })
+    }
+
+    /// Inserts a [`NodeTypeClass::Truncated`] node into a variable node
+    /// in place of the first successor that has been left out.
+    ///
+    /// Each node only has one truncation node, so this does nothing
+    /// if the node already has one.
+    ///
+    /// ## Parameters
+    /// - `successor_id` - name or index of the first successor that has been left out,
+    ///   or [`None`] if it is the target of [`EdgeLabel::Deref`].
+    fn insert_truncation_node(
+        &mut self,
+        var_object: VariableHandle,
+        successor_id: Option<ContainerChildId>,
+    ) {
+        let node = self
+            .variables
+            .get_mut(var_object)
+            .expect("Attempted to truncate nonexistent node");
+        if node.truncation_node.is_some() {
+            return;
+        }
+        node.truncation_node = Some(GdbStateNode::new(NodeTypeClass::Truncated));
+        let truncated_id = GdbStateNodeId::Truncated(var_object);
+        match successor_id {
+            Some(ContainerChildId::Named(name)) => node.add_named_successor(name, truncated_id),
+            Some(ContainerChildId::Index(index)) => {
+                // Keep the node at the position of its index, like the other elements
+                let position = index.min(node.successors.len());
+                node.successors
+                    .insert(position, (EdgeLabel::Index(index), truncated_id));
+            }
+            None => node.successors.push((EdgeLabel::Deref, truncated_id)),
+        }
+        self.changed_nodes
+            .insert(GdbStateNodeId::Truncated(var_object));
+        self.changed_nodes
+            .insert(GdbStateNodeId::VarObject(var_object));
+    }
+
+    /// Removes the [`NodeTypeClass::Truncated`] node of a variable node, if it has one.
+    fn remove_truncation_node(&mut self, var_object: VariableHandle) {
+        let Some(node) = self.variables.get_mut(var_object) else {
+            return;
+        };
+        if node.truncation_node.take().is_none() {
+            return;
+        }
+        let truncated_id = GdbStateNodeId::Truncated(var_object);
+        // Keep the order of the other successors, elements of arrays depend on it
+        node.successors.retain(|(_, n)| *n != truncated_id);
+        self.changed_nodes.insert(truncated_id);
+        self.changed_nodes
+            .insert(GdbStateNodeId::VarObject(var_object));
+    }
+
+    /// Links a pointer node to the node it points to.
+    ///
+    /// ## Parameters
+    /// - `referer_handle` - handle to the pointer node.
+    /// - `owner_handle` - handle to the [owner](GdbStateGraphWriter::dereference_owner)
+    ///   of the target, which keeps track of the pointer.
+    /// - `dereference_id` - ID of the node pointed to by the pointer.
     fn link_dereference_relation(
         &mut self,
-        referer_handle: &VariableObject,
-        dereference_handle: &VariableObject,
+        referer_handle: VariableHandle,
+        owner_handle: VariableHandle,
+        dereference_id: GdbStateNodeId,
     ) {
         self.variables
             .get_mut(referer_handle)
             .expect("Attempted to link dereference to nonexistent node")
             .successors
-            .push((
-                EdgeLabel::Deref,
-                GdbStateNodeId::VarObject(dereference_handle.clone()),
-            ));
+            .push((EdgeLabel::Deref, dereference_id));
+        self.changed_nodes
+            .insert(GdbStateNodeId::VarObject(referer_handle));
         self.variables
-            .get_mut(dereference_handle)
+            .get_mut(owner_handle)
             .expect("Attempted to link referer to nonexistent node")
             .referers
-            .push(referer_handle.clone());
+            .push(referer_handle);
     }
 
-    async fn get_or_create_dereference_variable_node(
+    /// Finds the topmost variable node that contains a dereference target.
+    ///
+    /// Pointers are tracked by the topmost node of the object they point into,
+    /// since that is the node whose lifetime they extend.
+    fn dereference_owner(&self, target: &GdbStateNodeId) -> Option<VariableHandle> {
+        let (GdbStateNodeId::VarObject(mut handle) | GdbStateNodeId::ArrayElement(mut handle, _)) =
+            target.clone()
+        else {
+            return None;
+        };
+        while let Some(GdbStateNodeId::VarObject(parent)) = self.variables.get(handle)?.parent {
+            handle = parent;
+        }
+        Some(handle)
+    }
+
+    /// Looks up an existing node that a pointer points to.
+    ///
+    /// A pointer to the start of an object is resolved to the object itself.
+    /// A pointer into the middle of an object is resolved to the member
+    /// or element at its address, provided that it has the type
+    /// the pointer points to.
+    ///
+    /// ## Parameters
+    /// - `has_length_hint` - whether the pointer points to an array.
+    ///   Parts of arrays are not nodes, so such pointers are only
+    ///   resolved if they point to the start of an object.
+    /// - `may_query` - whether commands may be sent to GDB to find the target.
+    ///   If not, only targets that can be found with what is already known
+    ///   are resolved.
+    ///
+    /// ## Return Value
+    /// The [owner](GdbStateGraphWriter::dereference_owner) of the target
+    /// and the target, or [`None`] if there is no existing node at the address.
+    async fn find_dereference_target(
         &mut self,
         address: u64,
         pointer_type_name: &str,
-        array_length: Option<u64>,
-    ) -> Result<VariableObject> {
-        // If the node already exists, return it right away
-        if let Some(var_object) = self.address_mapping.get(&address) {
-            return Ok(var_object.clone());
+        has_length_hint: bool,
+        may_query: bool,
+    ) -> Result<Option<(VariableHandle, GdbStateNodeId)>> {
+        let blocks = self.address_mapping.containing(address);
+        let Some(&(start, AddressRange { size, var_object })) = blocks.first() else {
+            return Ok(None);
+        };
+        let target_type = pointer_type_name
+            .strip_suffix('*')
+            .map(|t| Self::preprocess_type_name(t.trim_end().to_owned()));
+        if start == address {
+            // A structure and its first member start at the same address,
+            // so prefer the one that has the type the pointer points to
+            let var_object = blocks
+                .iter()
+                .take_while(|(start, _)| *start == address)
+                .map(|(_, range)| range.var_object)
+                .find(|handle| {
+                    self.variables
+                        .get(*handle)
+                        .and_then(|variable| variable.type_name.as_deref())
+                        .is_some_and(|type_name| Some(type_name) == target_type.as_deref())
+                })
+                .unwrap_or(var_object);
+            return Ok(Some((var_object, GdbStateNodeId::VarObject(var_object))));
+        }
+        if has_length_hint {
+            return Ok(None);
+        }
+        let offset = address - start;
+        let Some(target_type) = target_type else {
+            return Ok(None);
+        };
+        let target = self
+            .find_node_at_offset(
+                GdbStateNodeId::VarObject(var_object),
+                size,
+                offset,
+                &target_type,
+                may_query,
+            )
+            .await?;
+        Ok(target.map(|target| (var_object, target)))
+    }
+
+    /// Finds a descendant of a node at a given offset from the node's address.
+    ///
+    /// ## Parameters
+    /// - `size` - size of the node in bytes.
+    /// - `offset` - offset of the descendant from the start of the node, in bytes.
+    /// - `target_type` - type name of the descendant.
+    /// - `may_query` - whether layouts of structures that are not cached yet
+    ///   may be requested from GDB.
+    async fn find_node_at_offset(
+        &mut self,
+        mut id: GdbStateNodeId,
+        mut size: u64,
+        mut offset: u64,
+        target_type: &str,
+        may_query: bool,
+    ) -> Result<Option<GdbStateNodeId>> {
+        loop {
+            let Some(node) = self.graph.get(&id) else {
+                return Ok(None);
+            };
+            if offset == 0 && node.type_name.as_deref() == Some(target_type) {
+                return Ok(Some(id));
+            }
+            let next = match node.type_class {
+                NodeTypeClass::Array => {
+                    // All elements are the same size, so the element
+                    // at the offset can be computed directly
+                    let length = node
+                        .get_successor(&EdgeLabel::Length)
+                        .and_then(|length| self.graph.get(&length))
+                        .and_then(|length| length.value);
+                    let Some(NodeValue::Uint(length)) = length else {
+                        return Ok(None);
+                    };
+                    if length == 0 || size % length != 0 {
+                        return Ok(None);
+                    }
+                    let stride = size / length;
+                    let index = offset / stride;
+                    (EdgeLabel::Index(index as usize), index * stride, stride)
+                }
+                NodeTypeClass::Struct => {
+                    let GdbStateNodeId::VarObject(var_object) = id else {
+                        return Ok(None);
+                    };
+                    let Some(layout) = self.struct_layout(var_object, may_query).await? else {
+                        return Ok(None);
+                    };
+                    let Some(member) = layout
+                        .iter()
+                        .find(|m| m.offset <= offset && offset < m.offset + m.size)
+                    else {
+                        return Ok(None);
+                    };
+                    (member.edge_label.clone(), member.offset, member.size)
+                }
+                _ => return Ok(None),
+            };
+            let (edge_label, next_offset, next_size) = next;
+            let Some(next_id) = self
+                .graph
+                .get(&id)
+                .and_then(|node| node.get_successor(&edge_label))
+            else {
+                return Ok(None);
+            };
+            id = next_id;
+            offset -= next_offset;
+            size = next_size;
         }
+    }
+
+    /// Retrieves the positions of members of a structure node.
+    ///
+    /// Layouts are cached by type name, so GDB is only asked
+    /// about the first structure of each type.
+    ///
+    /// ## Parameters
+    /// - `may_query` - whether GDB may be asked if the layout is not cached.
+    async fn struct_layout(
+        &mut self,
+        var_object: VariableHandle,
+        may_query: bool,
+    ) -> Result<Option<Arc<[MemberLayout]>>> {
+        let Some(node) = self.variables.get(var_object) else {
+            return Ok(None);
+        };
+        let Some(type_name) = node.type_name.clone() else {
+            return Ok(None);
+        };
+        if let Some(layout) = self.struct_layouts.get(&type_name) {
+            return Ok(Some(layout.clone()));
+        }
+        if !may_query {
+            return Ok(None);
+        }
+        // Members that have been left out cannot be measured,
+        // so the layout would be incomplete
+        let is_complete = node.truncation_node.is_none();
+        let object = node.object.clone();
+        let members: Vec<_> = node
+            .successors
+            .iter()
+            .filter_map(|(edge_label, _)| match edge_label {
+                EdgeLabel::Named(name, _) => Some((edge_label.clone(), name.clone())),
+                _ => None,
+            })
+            .collect();
+        let path = self.gdb.var_info_path_expression(&object).await?;
+        // Measure all members in one batch
+        let expressions: Vec<_> = members
+            .iter()
+            .flat_map(|(_, name)| {
+                let name = name.as_str();
+                [
+                    format!("(char*)&({path}).{name} - (char*)&({path})"),
+                    format!("sizeof(({path}).{name})"),
+                ]
+            })
+            .collect();
+        let measurements = self.evaluate_unsigned_batch(&expressions).await?;
+        let layout: Vec<_> = members
+            .into_iter()
+            .zip(measurements.chunks_exact(2))
+            .filter_map(|((edge_label, _), measurement)| match *measurement {
+                [Some(offset), Some(size)] => Some(MemberLayout {
+                    edge_label,
+                    offset,
+                    size,
+                }),
+                _ => None,
+            })
+            .collect();
+        let layout = Arc::<[MemberLayout]>::from(layout);
+        if is_complete {
+            self.struct_layouts.insert(type_name, layout.clone());
+        }
+        Ok(Some(layout))
+    }
+
+    /// Evaluates an expression whose value is a non-negative integer.
+    ///
+    /// ## Return Value
+    /// The value, or [`None`] if GDB could not evaluate the expression
+    /// or its value is not a non-negative integer.
+    async fn evaluate_unsigned(&mut self, expression: &str) -> Result<Option<u64>> {
+        match self.gdb.data_evaluate_expression(expression).await {
+            Ok(value) => match Self::parse_node_value(&value) {
+                Some(NodeValue::Uint(value)) => Ok(Some(value)),
+                _ => Ok(None),
+            },
+            Err(Error::ErrorResponse(_)) => Ok(None),
+            Err(err) => Err(err),
+        }
+    }
+
+    /// Evaluates multiple expressions whose values are non-negative integers
+    /// in a single batch.
+    ///
+    /// ## Return Value
+    /// Values of the expressions in the same order as the expressions,
+    /// each the same as it would be from [`GdbStateGraphWriter::evaluate_unsigned`].
+    async fn evaluate_unsigned_batch(
+        &mut self,
+        expressions: &[String],
+    ) -> Result<Vec<Option<u64>>> {
+        self.gdb
+            .data_evaluate_expression_batch(expressions)
+            .await?
+            .into_iter()
+            .map(|value| match value {
+                Ok(value) => match Self::parse_node_value(&value) {
+                    Some(NodeValue::Uint(value)) => Ok(Some(value)),
+                    _ => Ok(None),
+                },
+                Err(Error::ErrorResponse(_)) => Ok(None),
+                Err(err) => Err(err),
+            })
+            .collect()
+    }
+
+    /// Retrieves the size of a variable in bytes.
+    ///
+    /// Sizes are cached by type name, so GDB is only asked
+    /// about the first variable of each type.
+    ///
+    /// ## Parameters
+    /// - `expression` - expression that evaluates to the variable.
+    ///
+    /// ## Return Value
+    /// Size of the variable, or zero if it could not be determined.
+    async fn variable_size(&mut self, var_object: VariableHandle, expression: &str) -> Result<u64> {
+        let type_name = self
+            .variables
+            .get(var_object)
+            .and_then(|variable| variable.type_name.clone());
+        if let Some(size) = type_name
+            .as_ref()
+            .and_then(|type_name| self.type_sizes.get(type_name))
+        {
+            return Ok(*size);
+        }
+        let size = self
+            .evaluate_unsigned(&format!("sizeof({expression})"))
+            .await?
+            .unwrap_or_default();
+        if let Some(type_name) = type_name {
+            self.type_sizes.insert(type_name, size);
+        }
+        Ok(size)
+    }
+
+    async fn create_dereference_variable_node(
+        &mut self,
+        address: u64,
+        pointer_type_name: &str,
+        array_length: Option<u64>,
+        depth: usize,
+    ) -> Result<VariableHandle> {
         let length_suffix = array_length.map(|l| format!("@{l}")).unwrap_or_default();
         let deref_var_object = self
             .gdb
@@ -943,10 +2575,20 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
                 &format!("*({pointer_type_name}){address}{length_suffix}"),
             )
             .await?;
-        let var_object = self.create_variable_tree(deref_var_object, None).await?;
-        self.address_mapping.insert(address, var_object.clone());
+        let var_object = self
+            .create_variable_tree(deref_var_object, None, depth)
+            .await?;
+        // The size lets pointers into the object be resolved to its members
+        let size = self
+            .variable_size(
+                var_object,
+                &format!("*({pointer_type_name}){address}{length_suffix}"),
+            )
+            .await?;
+        self.address_mapping
+            .insert(address, AddressRange { size, var_object });
         self.variables
-            .get_mut(&var_object)
+            .get_mut(var_object)
             .expect("The variable node was just created")
             .address = Some(address);
         Ok(var_object)
@@ -956,28 +2598,34 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
         &mut self,
         var_object: VariableObjectData,
         parent: Option<GdbStateNodeId>,
-    ) {
-        let node = self.new_variable_node(var_object.object, NodeTypeClass::Atom, parent);
-        node.type_name =
-            Some(Self::preprocess_type_name(var_object.type_name.expect(
-                "Pseudo-child variable object encountered in unexpected context",
-            )));
+    ) -> VariableHandle {
+        let type_name = Self::preprocess_type_name(
+            var_object
+                .type_name
+                .expect("Pseudo-child variable object encountered in unexpected context"),
+        );
+        let mut node = GdbStateNode::new(NodeTypeClass::Atom);
+        node.type_name = Some(self.intern_type_name(type_name));
         node.value = var_object.value.as_deref().and_then(Self::parse_node_value);
+        self.new_variable_node(node, var_object.object, parent)
     }
 
     fn new_variable_node(
         &mut self,
-        id: VariableObject,
-        type_class: NodeTypeClass,
+        node: GdbStateNode,
+        object: VariableObject,
         parent: Option<GdbStateNodeId>,
-    ) -> &mut GdbStateNode {
-        self.variables
-            .entry(id)
-            .insert_entry(GdbStateNodeForVariable::new(
-                GdbStateNode::new(type_class),
-                parent,
-            ))
-            .into_mut()
+    ) -> VariableHandle {
+        let depth = match &parent {
+            Some(GdbStateNodeId::VarObject(parent)) => self.variables.get(*parent).map(|p| p.depth),
+            _ => None,
+        };
+        let mut variable = GdbStateNodeForVariable::new(node, object, parent);
+        variable.depth = depth.unwrap_or_default();
+        let handle = self.variables.insert(variable);
+        self.statistics.variables_created += 1;
+        self.changed_nodes.insert(GdbStateNodeId::VarObject(handle));
+        handle
     }
 
     fn parse_node_value(mut s: &str) -> Option<NodeValue> {
@@ -989,7 +2637,10 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
         if let Some(caps) = CHAR_VALUE_REGEX.captures(s) {
             s = caps.get(1).unwrap().as_str()
         }
-        if let Ok(u) = s.parse() {
+        if s == "true" || s == "false" {
+            // Booleans are reported by name
+            Some(NodeValue::Bool(s == "true"))
+        } else if let Ok(u) = s.parse() {
             // Parse it as unsigned decimal
             Some(NodeValue::Uint(u))
         } else if let Ok(i) = s.parse() {
@@ -1031,7 +2682,7 @@ impl<'a, T: GdbMiSession> GdbStateGraphWriter<'a, T> {
 }
 
 impl GdbStateNode {
-    fn new(type_class: NodeTypeClass) -> Self {
+    pub(crate) fn new(type_class: NodeTypeClass) -> Self {
         Self {
             type_class,
             type_name: None,
@@ -1040,7 +2691,7 @@ impl GdbStateNode {
         }
     }
 
-    fn add_named_successor(&mut self, name: String, successor: GdbStateNodeId) {
+    fn add_named_successor(&mut self, name: symbol::Symbol, successor: GdbStateNodeId) {
         let existing_nodes_with_same_name = self
             .successors
             .iter()
@@ -1093,9 +2744,19 @@ struct DeferredVariableTree {
     successor_id: Option<ContainerChildId>,
 }
 
+/// Extent of an array that is only listed in part.
+#[derive(Clone, Copy)]
+struct ArrayTruncation {
+    /// Length of the whole array.
+    full_length: usize,
+
+    /// Number of elements that are listed.
+    listed_length: usize,
+}
+
 /// Name or index of a child of a container node.
 enum ContainerChildId {
-    Named(String),
+    Named(symbol::Symbol),
     Index(usize),
 }
 
@@ -4,6 +4,7 @@ use super::raw_output::*;
 use derive_more::{Debug, Display, Error};
 use logos::Logos;
 use pomelo::pomelo;
+use std::borrow::Cow;
 
 #[derive(Clone, Copy, PartialEq, Eq, Debug, Display, Error, Default)]
 #[display("input was not recognized as a GDB/MI record")]
@@ -14,7 +15,11 @@ pub struct ParseError;
 /// output.
 ///
 /// Result records (`^`) and asynchronous execution records (`*`) are supported.
-pub fn parse_gdbmi_record(input: &str) -> Result<Record, ParseError> {
+///
+/// The parsed record borrows from the input.
+/// See [`reader`](super::reader) for a parser that does not
+/// materialize the whole record at once.
+pub fn parse_gdbmi_record(input: &str) -> Result<Record<'_>, ParseError> {
     let lexer = parser::Token::lexer(input);
     let mut parser = parser::Parser::new();
     for token in lexer {
@@ -37,18 +42,18 @@ pomelo! {
     pub enum Token<'s> {};
 
     // Underlying types of nonterminal symbols
-    %type output         Record;
-    %type record         Record;
-    %type exec_record    AsyncExecRecord;
-    %type exec_record1   AsyncExecRecord;
+    %type output         Record<'s>;
+    %type record         Record<'s>;
+    %type exec_record    AsyncExecRecord<'s>;
+    %type exec_record1   AsyncExecRecord<'s>;
     %type exec_class     AsyncExecClass;
-    %type result_record  ResultRecord;
-    %type result_record1 ResultRecord;
+    %type result_record  ResultRecord<'s>;
+    %type result_record1 ResultRecord<'s>;
     %type result_class   ResultClass;
-    %type results        ResultTuple;
-    %type result         ResultEntry;
-    %type value          Value;
-    %type values         Vec<Value>;
+    %type results        ResultTuple<'s>;
+    %type result         ResultEntry<'s>;
+    %type value          Value<'s>;
+    %type values         Vec<Value<'s>>;
 
     // ========================================
     //            TERMINAL SYMBOLS
@@ -62,10 +67,10 @@ pomelo! {
     %type
     #[regex(r#""([^"\\]|\\.)*""#, |lex| {
         let string_contents = &lex.slice()[1..(lex.slice().len() - 1)];
-        double_quoted_escapes(string_contents).map_err(|_| ParseError)
+        unescape_c_string(string_contents).ok_or(ParseError)
     })]
     #[debug("{_0:?}")]
-    Quoted String;
+    Quoted Cow<'s, str>;
 
     %type
     #[regex(r"\d+")]
@@ -132,7 +137,7 @@ pomelo! {
     // Result record
     result_record ::= result_record1;
     result_record ::= result_record1(mut r) Comma results(e) { r.results = e; r }
-    result_record1 ::= Numeric?(n) Caret result_class(c)     { ResultRecord { token: n.map(str::to_owned), result_class: c, results: ResultTuple::default() } }
+    result_record1 ::= Numeric?(n) Caret result_class(c)     { ResultRecord { token: n, result_class: c, results: ResultTuple::default() } }
     result_class ::= Unquoted(s)                             { s.parse().map_err(|_| ParseError)? }
 
     // Async-exec record
@@ -144,80 +149,15 @@ pomelo! {
     // Parameters returned together with a successful result record
     results ::= result(e)                                    { ResultTuple(vec![e]) }
     results ::= results(mut r) Comma result(e)               { r.0.push(e); r }
-    result ::= Unquoted(k) Equals value(v)                   { ResultEntry { key: k.to_owned(), value: v } }
+    result ::= Unquoted(k) Equals value(v)                   { ResultEntry { key: k, value: v } }
     values ::= value(e)                                      { vec![e] }
     values ::= values(mut v) Comma value(e)                  { v.push(e); v }
-    value ::= Quoted(s)                                      { Value::Const(s.to_owned()) }
+    value ::= Quoted(s)                                      { Value::Const(s) }
     value ::= OpenBrace results?(r) CloseBrace               { Value::Tuple(r.unwrap_or_default()) }
     value ::= OpenBracket results(r) CloseBracket            { Value::TupleList(r) }
     value ::= OpenBracket values?(r) CloseBracket            { Value::List(r.unwrap_or_default()) }
 }
 
-/// Resolves escape sequences in a string literal.
-fn double_quoted_escapes(literal: &str) -> Result<String, ParseError> {
-    let mut output = String::with_capacity(literal.len());
-    let mut input = literal.chars().peekable();
-    while let Some(c) = input.next() {
-        if c != '\\' {
-            output.push(c);
-            continue;
-        }
-        match input.next() {
-            Some('a') => output.push('\x07'),
-            Some('b') => output.push('\x08'),
-            Some('t') => output.push('\t'),
-            Some('n') => output.push('\n'),
-            Some('v') => output.push('\x0b'),
-            Some('f') => output.push('\x0c'),
-            Some('r') => output.push('\r'),
-            Some('"') => output.push('"'),
-            Some('\'') => output.push('\''),
-            Some('\\') => output.push('\\'),
-            Some('x') => {
-                let mut code_point = input
-                    .next()
-                    .and_then(|c| c.to_digit(16))
-                    .ok_or(ParseError)?;
-                if let Some(c) = input.peek().and_then(|c| c.to_digit(16)) {
-                    // Eat the character if it is good
-                    input.next();
-                    // Add the extra character to the code point
-                    code_point = code_point * 16 + c;
-                }
-                if code_point > 0x7f {
-                    return Err(ParseError);
-                }
-                output.push(code_point as u8 as char);
-            }
-            Some(c) if c.is_digit(2) => {
-                // This is an octal literal, but only low octal literals
-                // (starting with 0 or 1) are valid characters
-                let mut code_point = c.to_digit(2).unwrap();
-                for _ in 0..=1 {
-                    if let Some(c) = input.peek().and_then(|c| c.to_digit(8)) {
-                        // Eat the character if it is good
-                        input.next();
-                        // Add the extra character to the code point
-                        code_point = code_point * 8 + c;
-                    }
-                }
-                output.push(code_point as u8 as char);
-            }
-            Some(c) if c.is_digit(4) => {
-                // This would normally be an error, but GDB does not escape
-                // the backslash on high octal literals (>= 0x82)
-                //
-                // The compromise solution is to interpret it as an escaped literal
-                // and leave it unchanged
-                output.push('\\');
-                output.push(c);
-            }
-            _ => return Err(ParseError),
-        }
-    }
-    Ok(output)
-}
-
 #[derive(Clone, Debug, Display, Error)]
 #[display("{_0:?} is not a valid result class")]
 #[error(ignore)]
@@ -288,7 +228,7 @@ mod test {
         let result =
             parse_gdbmi_record("123^done\r\n").expect("Input should have parsed successfully");
         let expected = ResultRecord {
-            token: Some("123".to_owned()),
+            token: Some("123"),
             result_class: ResultClass::Done,
             results: ResultTuple::default(),
         }
@@ -304,8 +244,8 @@ mod test {
             token: None,
             result_class: ResultClass::Done,
             results: ResultTuple(vec![ResultEntry {
-                key: "value".to_owned(),
-                value: Value::Const("1".to_owned()),
+                key: "value",
+                value: Value::Const("1".into()),
             }]),
         }
         .into();
@@ -321,19 +261,19 @@ mod test {
             result_class: ResultClass::Done,
             results: ResultTuple(vec![
                 ResultEntry {
-                    key: "a".to_owned(),
+                    key: "a",
                     value: Value::Tuple(ResultTuple::default()),
                 },
                 ResultEntry {
-                    key: "b".to_owned(),
+                    key: "b",
                     value: Value::Tuple(ResultTuple(vec![
                         ResultEntry {
-                            key: "a".to_owned(),
-                            value: Value::Const("1".to_owned()),
+                            key: "a",
+                            value: Value::Const("1".into()),
                         },
                         ResultEntry {
-                            key: "b".to_owned(),
-                            value: Value::Const("2".to_owned()),
+                            key: "b",
+                            value: Value::Const("2".into()),
                         },
                     ])),
                 },
@@ -352,26 +292,26 @@ mod test {
             result_class: ResultClass::Done,
             results: ResultTuple(vec![
                 ResultEntry {
-                    key: "a".to_owned(),
+                    key: "a",
                     value: Value::List(Vec::new()),
                 },
                 ResultEntry {
-                    key: "b".to_owned(),
+                    key: "b",
                     value: Value::List(vec![
-                        Value::Const("1".to_owned()),
-                        Value::Const("2".to_owned()),
+                        Value::Const("1".into()),
+                        Value::Const("2".into()),
                     ]),
                 },
                 ResultEntry {
-                    key: "c".to_owned(),
+                    key: "c",
                     value: Value::TupleList(ResultTuple(vec![
                         ResultEntry {
-                            key: "a".to_owned(),
-                            value: Value::Const("1".to_owned()),
+                            key: "a",
+                            value: Value::Const("1".into()),
                         },
                         ResultEntry {
-                            key: "b".to_owned(),
-                            value: Value::Const("2".to_owned()),
+                            key: "b",
+                            value: Value::Const("2".into()),
                         },
                     ])),
                 },
@@ -389,8 +329,8 @@ mod test {
             token: None,
             result_class: ResultClass::Done,
             results: ResultTuple(vec![ResultEntry {
-                key: "value".to_owned(),
-                value: Value::Const("\\\"\n\x0a\x53\0\x42\0\\".to_owned()),
+                key: "value",
+                value: Value::Const("\\\"\n\x0a\x53\0\x42\0\\".into()),
             }]),
         }
         .into();
@@ -404,8 +344,8 @@ mod test {
         let expected = AsyncExecRecord {
             async_exec_class: AsyncExecClass::Stopped,
             results: ResultTuple(vec![ResultEntry {
-                key: "reason".to_owned(),
-                value: Value::Const("breakpoint".to_owned()),
+                key: "reason",
+                value: Value::Const("breakpoint".into()),
             }]),
         }
         .into();
@@ -420,8 +360,8 @@ mod test {
             token: None,
             result_class: ResultClass::Done,
             results: ResultTuple(vec![ResultEntry {
-                key: "value".to_owned(),
-                value: Value::Const(r"-16 '\360'".to_owned()),
+                key: "value",
+                value: Value::Const(r"-16 '\360'".into()),
             }]),
         }
         .into();
@@ -4,7 +4,9 @@
 pub mod grammar;
 mod parsing;
 pub mod raw_output;
+pub mod reader;
 pub mod result;
 pub mod session;
 pub mod stream;
+pub mod transcript;
 pub mod types;
@@ -1,25 +1,37 @@
 //! Parsing [`raw_output`](super::raw_output) data as [`types`](super::types).
 //!
 //! This module provides extension methods for [`Value`] that allow
-//! one to easily parse payloads.
+//! one to easily parse payloads, as well as for the [`reader`](super::reader)
+//! types that allow one to parse large payloads without materializing them.
 
-use super::{raw_output::*, result::BadResponse, types::*};
+use super::{
+    raw_output::*,
+    reader::{TupleReader, ValueReader},
+    result::BadResponse,
+    types::*,
+};
+use std::borrow::Cow;
 
 /// Result type associated with parsing response payloads.
 pub type Result<T> = std::result::Result<T, BadResponse>;
 
 /// Extension methods for [`Value`] that allow parsing
 /// payloads as various formats defined in [`types`](super::types).
-impl Value {
-    pub fn tuple(self) -> Result<ResultTuple> {
+impl<'s> Value<'s> {
+    pub fn tuple(self) -> Result<ResultTuple<'s>> {
         self.into_tuple().ok_or(BadResponse::BadValueType)
     }
 
-    pub fn list(self) -> Result<Vec<Value>> {
+    pub fn list(self) -> Result<Vec<Value<'s>>> {
         self.into_list().ok_or(BadResponse::BadValueType)
     }
 
     pub fn string(self) -> Result<String> {
+        self.text().map(Cow::into_owned)
+    }
+
+    /// Extracts a string literal without copying it if possible.
+    pub fn text(self) -> Result<Cow<'s, str>> {
         self.into_const().ok_or(BadResponse::BadValueType)
     }
 
@@ -27,15 +39,39 @@ impl Value {
     where
         T: std::str::FromStr,
     {
-        let str = self.string()?;
-        str.parse().map_err(|_| BadResponse::BadValue(str))
+        let str = self.text()?;
+        str.parse()
+            .map_err(|_| BadResponse::BadValue(str.into_owned()))
     }
 
     pub fn hex(self) -> Result<u64> {
-        let str = self.string()?;
+        let str = self.text()?;
         str.strip_prefix("0x")
             .and_then(|s| u64::from_str_radix(s, 16).ok())
-            .ok_or(BadResponse::BadValue(str))
+            .ok_or_else(|| BadResponse::BadValue(str.into_owned()))
+    }
+
+    pub fn hex_bytes(self) -> Result<Vec<u8>> {
+        let str = self.text()?;
+        if str.len() % 2 != 0 {
+            return Err(BadResponse::BadValue(str.into_owned()));
+        }
+        (0..str.len())
+            .step_by(2)
+            .map(|i| {
+                str.get(i..i + 2)
+                    .and_then(|b| u8::from_str_radix(b, 16).ok())
+            })
+            .collect::<Option<_>>()
+            .ok_or_else(|| BadResponse::BadValue(str.into_owned()))
+    }
+
+    pub fn memory_block_list(self) -> Result<Vec<MemoryBlock>> {
+        self.list()?.into_iter().map(Self::memory_block).collect()
+    }
+
+    pub fn memory_block(self) -> Result<MemoryBlock> {
+        self.tuple()?.memory_block()
     }
 
     pub fn symbol_query_result(self) -> Result<Vec<SymbolFile>> {
@@ -76,11 +112,11 @@ impl Value {
     }
 
     pub fn zero_or_one(self) -> Result<bool> {
-        let str = self.string()?;
-        match str.as_str() {
+        let str = self.text()?;
+        match &*str {
             "0" => Ok(false),
             "1" => Ok(true),
-            _ => Err(BadResponse::BadValue(str)),
+            _ => Err(BadResponse::BadValue(str.into_owned())),
         }
     }
 
@@ -106,8 +142,8 @@ impl Value {
     }
 
     pub fn in_scope_flag(self) -> Result<InScope> {
-        let str = self.string()?;
-        match str.as_str() {
+        let str = self.text()?;
+        match &*str {
             "true" => Ok(InScope::True),
             "false" => Ok(InScope::False),
             "invalid" => Ok(InScope::Invalid),
@@ -118,16 +154,16 @@ impl Value {
 
 /// Extension methods for [`ResultTuple`] that allow parsing
 /// payloads as various formats defined in [`types`](super::types).
-impl ResultTuple {
+impl<'s> ResultTuple<'s> {
     /// Extracts a named field from a tuple if it is present,
     /// returning an error otherwise.
-    pub fn take(&mut self, key: &str) -> Result<Value> {
+    pub fn take(&mut self, key: &str) -> Result<Value<'s>> {
         self.take_optional(key)
             .ok_or_else(|| BadResponse::MissingKey(key.to_owned()))
     }
 
     /// Extracts a named field from a tuple if it is present.
-    pub fn take_optional(&mut self, key: &str) -> Option<Value> {
+    pub fn take_optional(&mut self, key: &str) -> Option<Value<'s>> {
         let index = self
             .0
             .iter()
@@ -254,4 +290,100 @@ impl ResultTuple {
             children: self.take("children")?.child_list_inner()?,
         })
     }
+
+    pub fn memory_block(mut self) -> Result<MemoryBlock> {
+        Ok(MemoryBlock {
+            begin: self.take("begin")?.hex()?,
+            offset: self.take("offset")?.hex()?,
+            end: self.take("end")?.hex()?,
+            contents: self.take("contents")?.hex_bytes()?,
+        })
+    }
+}
+
+/// Extension methods for [`ValueReader`] that allow parsing
+/// large payloads without materializing them as a whole.
+///
+/// Only the individual items of the large lists are materialized,
+/// one at a time.
+impl<'s> ValueReader<'_, 's> {
+    pub fn string(self) -> Result<String> {
+        self.text().map(Cow::into_owned)
+    }
+
+    pub fn symbol_query_result(self) -> Result<Vec<SymbolFile>> {
+        let mut list = self.list()?;
+        let mut files = Vec::new();
+        while let Some(file) = list.next_value()? {
+            files.push(file.tuple()?.symbol_file()?);
+        }
+        Ok(files)
+    }
+
+    pub fn symbol_list(self) -> Result<Vec<Symbol>> {
+        let mut list = self.list()?;
+        let mut symbols = Vec::new();
+        while let Some(symbol) = list.next_value()? {
+            symbols.push(symbol.value()?.symbol()?);
+        }
+        Ok(symbols)
+    }
+
+    pub fn child_list_inner(self) -> Result<Vec<ChildVariableObject>> {
+        let mut tuple = self.tuple()?;
+        let mut children = Vec::new();
+        while let Some((key, child)) = tuple.next_entry()? {
+            if key == "child" {
+                children.push(child.value()?.child_varobj()?);
+            }
+        }
+        Ok(children)
+    }
+}
+
+/// Extension methods for [`TupleReader`] that allow parsing
+/// large payloads without materializing them as a whole.
+impl<'s> TupleReader<'_, 's> {
+    pub fn symbol_file(mut self) -> Result<SymbolFile> {
+        let mut filename = None;
+        let mut fullname = None;
+        let mut symbols = None;
+        while let Some((key, value)) = self.next_entry()? {
+            match key {
+                "filename" => filename = Some(value.string()?),
+                "fullname" => fullname = Some(value.string()?),
+                "symbols" => symbols = Some(value.symbol_list()?),
+                _ => {}
+            }
+        }
+        Ok(SymbolFile {
+            filename: required(filename, "filename")?,
+            fullname: required(fullname, "fullname")?,
+            symbols: required(symbols, "symbols")?,
+        })
+    }
+
+    pub fn child_list(mut self) -> Result<ChildList> {
+        let mut numchild = None;
+        let mut has_more = None;
+        let mut children = None;
+        while let Some((key, value)) = self.next_entry()? {
+            match key {
+                "numchild" => numchild = Some(value.value()?.decimal()?),
+                "has_more" => has_more = Some(value.value()?.zero_or_one()?),
+                "children" => children = Some(value.child_list_inner()?),
+                _ => {}
+            }
+        }
+        Ok(ChildList {
+            numchild: required(numchild, "numchild")?,
+            has_more: has_more.unwrap_or_default(),
+            children: required(children, "children")?,
+        })
+    }
+}
+
+/// Fails with [`BadResponse::MissingKey`] if a field has not been read.
+fn required<T>(value: Option<T>, key: &str) -> Result<T> {
+    value.ok_or_else(|| BadResponse::MissingKey(key.to_owned()))
 }
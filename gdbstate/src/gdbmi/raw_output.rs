@@ -5,6 +5,7 @@
 //! - [Output records](https://sourceware.org/gdb/current/onlinedocs/gdb.html/GDB_002fMI-Output-Records.html)
 
 use derive_more::{Display, From};
+use std::borrow::Cow;
 
 /// Class of a [result record](https://sourceware.org/gdb/current/onlinedocs/gdb.html/GDB_002fMI-Result-Records.html).
 #[derive(Clone, Copy, PartialEq, Eq, Debug, Display)]
@@ -45,71 +46,76 @@ pub enum AsyncExecClass {
 /// A record in the output of GDB.
 ///
 /// Currently, only [`ResultRecord`] and [`AsyncExecRecord`] are supported.
+///
+/// Records borrow from the output they were parsed from.
 #[derive(Clone, PartialEq, Eq, Debug, From)]
-pub enum Record {
+pub enum Record<'s> {
     /// Result record.
-    Result(ResultRecord),
+    Result(ResultRecord<'s>),
 
     /// Async record.
-    AsyncExec(AsyncExecRecord),
+    AsyncExec(AsyncExecRecord<'s>),
 }
 
 /// Full [async record](https://sourceware.org/gdb/current/onlinedocs/gdb.html/GDB_002fMI-Async-Records.html).
 #[derive(Clone, PartialEq, Eq, Debug)]
-pub struct AsyncExecRecord {
+pub struct AsyncExecRecord<'s> {
     /// Class of the record.
     pub async_exec_class: AsyncExecClass,
 
     /// Payload data.
-    pub results: ResultTuple,
+    pub results: ResultTuple<'s>,
 }
 
 /// Full [result record](https://sourceware.org/gdb/current/onlinedocs/gdb.html/GDB_002fMI-Result-Records.html).
 #[derive(Clone, PartialEq, Eq, Debug)]
-pub struct ResultRecord {
+pub struct ResultRecord<'s> {
     /// Token that was passed to the associated command, if any.
-    pub token: Option<String>,
+    pub token: Option<&'s str>,
 
     /// Class of the record.
     pub result_class: ResultClass,
 
     /// Payload data.
-    pub results: ResultTuple,
+    pub results: ResultTuple<'s>,
 }
 
 /// Data payload that contains named fields.
 #[derive(Clone, PartialEq, Eq, Debug, Default)]
-pub struct ResultTuple(pub Vec<ResultEntry>);
+pub struct ResultTuple<'s>(pub Vec<ResultEntry<'s>>);
 
 /// Single entry of a [`ResultTuple`].
 #[derive(Clone, PartialEq, Eq, Debug)]
-pub struct ResultEntry {
-    pub key: String,
-    pub value: Value,
+pub struct ResultEntry<'s> {
+    pub key: &'s str,
+    pub value: Value<'s>,
 }
 
 /// Any value in a GDB/MI payload.
 #[derive(Clone, PartialEq, Eq, Debug)]
-pub enum Value {
+pub enum Value<'s> {
     /// String literal.
-    Const(String),
+    ///
+    /// The string is only copied out of the output
+    /// if it contains escape sequences.
+    Const(Cow<'s, str>),
 
     /// Structured data with named fields.
-    Tuple(ResultTuple),
+    Tuple(ResultTuple<'s>),
 
     /// List with named items.
     ///
     /// Names of the items are usualy all the same,
     /// so they may be ignored.
-    TupleList(ResultTuple),
+    TupleList(ResultTuple<'s>),
 
     /// List that contains a sequence of values.
-    List(Vec<Value>),
+    List(Vec<Value<'s>>),
 }
 
-impl Value {
+impl<'s> Value<'s> {
     /// Extracts a [`Value::Const`] from the value, if it is present.
-    pub fn into_const(self) -> Option<String> {
+    pub fn into_const(self) -> Option<Cow<'s, str>> {
         match self {
             Self::Const(s) => Some(s),
             _ => None,
@@ -117,7 +123,7 @@ impl Value {
     }
 
     /// Extracts a [`Value::Tuple`] or [`Value::TupleList`] from the value, if it is present.
-    pub fn into_tuple(self) -> Option<ResultTuple> {
+    pub fn into_tuple(self) -> Option<ResultTuple<'s>> {
         match self {
             Self::Tuple(t) => Some(t),
             Self::TupleList(t) => Some(t),
@@ -126,10 +132,79 @@ impl Value {
     }
 
     /// Extracts a [`Value::List`] from the value, if it is present.
-    pub fn into_list(self) -> Option<Vec<Value>> {
+    pub fn into_list(self) -> Option<Vec<Value<'s>>> {
         match self {
             Self::List(l) => Some(l),
             _ => None,
         }
     }
 }
+
+/// Resolves escape sequences in the contents of a C string literal.
+///
+/// The literal is only copied if it actually contains escape sequences.
+///
+/// Returns [`None`] if the literal contains an invalid escape sequence.
+pub fn unescape_c_string(literal: &str) -> Option<Cow<'_, str>> {
+    if !literal.contains('\\') {
+        return Some(Cow::Borrowed(literal));
+    }
+    let mut output = String::with_capacity(literal.len());
+    let mut input = literal.chars().peekable();
+    while let Some(c) = input.next() {
+        if c != '\\' {
+            output.push(c);
+            continue;
+        }
+        match input.next() {
+            Some('a') => output.push('\x07'),
+            Some('b') => output.push('\x08'),
+            Some('t') => output.push('\t'),
+            Some('n') => output.push('\n'),
+            Some('v') => output.push('\x0b'),
+            Some('f') => output.push('\x0c'),
+            Some('r') => output.push('\r'),
+            Some('"') => output.push('"'),
+            Some('\'') => output.push('\''),
+            Some('\\') => output.push('\\'),
+            Some('x') => {
+                let mut code_point = input.next().and_then(|c| c.to_digit(16))?;
+                if let Some(c) = input.peek().and_then(|c| c.to_digit(16)) {
+                    // Eat the character if it is good
+                    input.next();
+                    // Add the extra character to the code point
+                    code_point = code_point * 16 + c;
+                }
+                if code_point > 0x7f {
+                    return None;
+                }
+                output.push(code_point as u8 as char);
+            }
+            Some(c) if c.is_digit(2) => {
+                // This is an octal literal, but only low octal literals
+                // (starting with 0 or 1) are valid characters
+                let mut code_point = c.to_digit(2).unwrap();
+                for _ in 0..=1 {
+                    if let Some(c) = input.peek().and_then(|c| c.to_digit(8)) {
+                        // Eat the character if it is good
+                        input.next();
+                        // Add the extra character to the code point
+                        code_point = code_point * 8 + c;
+                    }
+                }
+                output.push(code_point as u8 as char);
+            }
+            Some(c) if c.is_digit(4) => {
+                // This would normally be an error, but GDB does not escape
+                // the backslash on high octal literals (>= 0x82)
+                //
+                // The compromise solution is to interpret it as an escaped literal
+                // and leave it unchanged
+                output.push('\\');
+                output.push(c);
+            }
+            _ => return None,
+        }
+    }
+    Some(Cow::Owned(output))
+}
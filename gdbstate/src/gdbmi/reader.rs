@@ -0,0 +1,531 @@
+//! Streaming parser of GDB/MI result records.
+//!
+//! Unlike [`parse_gdbmi_record`](super::grammar::parse_gdbmi_record),
+//! the reader does not build the whole record in memory.
+//! Values are read one by one as the caller walks through the record,
+//! and values that the caller is not interested in are skipped
+//! without being parsed. String literals are borrowed from the input
+//! unless they contain escape sequences.
+//!
+//! This is intended for large responses, such as lists of all global symbols,
+//! where only small parts of the record need to be materialized at a time.
+
+use super::{raw_output::*, result::BadResponse};
+use std::borrow::Cow;
+
+/// Result type associated with reading records.
+pub type Result<T> = std::result::Result<T, BadResponse>;
+
+/// Reader of a single [result record](https://sourceware.org/gdb/current/onlinedocs/gdb.html/GDB_002fMI-Result-Records.html).
+pub struct ResultRecordReader<'s> {
+    /// Token that was passed to the associated command, if any.
+    pub token: Option<&'s str>,
+
+    /// Class of the record.
+    pub result_class: ResultClass,
+
+    /// Position in the payload data.
+    cursor: Cursor<'s>,
+}
+
+impl<'s> ResultRecordReader<'s> {
+    /// Reads the header of a result record.
+    ///
+    /// The payload is only read on demand through [`ResultRecordReader::results`].
+    pub fn new(input: &'s str) -> Result<Self> {
+        let mut cursor = Cursor::new(input);
+        let token = cursor.digits();
+        cursor.expect(b'^')?;
+        let result_class = cursor
+            .identifier()?
+            .parse()
+            .map_err(|_| cursor.syntax_error())?;
+        Ok(Self {
+            token,
+            result_class,
+            cursor,
+        })
+    }
+
+    /// Reads the payload data of the record.
+    pub fn results(&mut self) -> TupleReader<'_, 's> {
+        TupleReader {
+            cursor: &mut self.cursor,
+            depth: 0,
+            close: None,
+            state: ReaderState::First,
+        }
+    }
+}
+
+/// Reader of a tuple or a list with named items,
+/// which reads the entries one by one.
+pub struct TupleReader<'c, 's> {
+    cursor: &'c mut Cursor<'s>,
+
+    /// Nesting depth of the tuple's entries.
+    depth: usize,
+
+    /// Closing bracket of the tuple,
+    /// or [`None`] if the tuple spans the rest of the record.
+    close: Option<u8>,
+
+    state: ReaderState,
+}
+
+impl<'s> TupleReader<'_, 's> {
+    /// Reads the next entry of the tuple.
+    ///
+    /// If the value of the previous entry has not been read completely,
+    /// the rest of it is skipped.
+    pub fn next_entry(&mut self) -> Result<Option<(&'s str, ValueReader<'_, 's>)>> {
+        let Some(key) = self.next_key()? else {
+            return Ok(None);
+        };
+        Ok(Some((key, ValueReader::new(self.cursor))))
+    }
+
+    /// Skips to the entry with a specified key and reads its value.
+    ///
+    /// Entries before the matching entry are skipped.
+    pub fn find(&mut self, key: &str) -> Result<ValueReader<'_, 's>> {
+        while let Some(entry_key) = self.next_key()? {
+            if entry_key == key {
+                return Ok(ValueReader::new(self.cursor));
+            }
+        }
+        Err(BadResponse::MissingKey(key.to_owned()))
+    }
+
+    /// Materializes the remaining entries of the tuple.
+    pub fn collect(mut self) -> Result<ResultTuple<'s>> {
+        let mut tuple = ResultTuple::default();
+        while let Some((key, value)) = self.next_entry()? {
+            let value = value.value()?;
+            tuple.0.push(ResultEntry { key, value });
+        }
+        Ok(tuple)
+    }
+
+    /// Advances the reader to the value of the next entry.
+    fn next_key(&mut self) -> Result<Option<&'s str>> {
+        if self.state == ReaderState::Done {
+            return Ok(None);
+        }
+        self.cursor.settle(self.depth)?;
+        if self.cursor.close(self.close)? {
+            self.state = ReaderState::Done;
+            return Ok(None);
+        }
+        // Top-level entries are all preceded by the separator,
+        // even the first one, because it separates them from the header
+        if self.state == ReaderState::Next || self.close.is_none() {
+            self.cursor.expect(b',')?;
+        }
+        self.state = ReaderState::Next;
+        let key = self.cursor.identifier()?;
+        self.cursor.expect(b'=')?;
+        self.cursor.value_pending = true;
+        Ok(Some(key))
+    }
+}
+
+/// Reader of a list that contains a sequence of values,
+/// which reads the values one by one.
+pub struct ListReader<'c, 's> {
+    cursor: &'c mut Cursor<'s>,
+
+    /// Nesting depth of the list's values.
+    depth: usize,
+
+    state: ReaderState,
+}
+
+impl<'s> ListReader<'_, 's> {
+    /// Reads the next value of the list.
+    ///
+    /// If the previous value has not been read completely,
+    /// the rest of it is skipped.
+    pub fn next_value(&mut self) -> Result<Option<ValueReader<'_, 's>>> {
+        if self.state == ReaderState::Done {
+            return Ok(None);
+        }
+        self.cursor.settle(self.depth)?;
+        if self.cursor.close(Some(b']'))? {
+            self.state = ReaderState::Done;
+            return Ok(None);
+        }
+        if self.state == ReaderState::Next {
+            self.cursor.expect(b',')?;
+        }
+        self.state = ReaderState::Next;
+        self.cursor.value_pending = true;
+        Ok(Some(ValueReader::new(self.cursor)))
+    }
+}
+
+/// Reader of a single value.
+///
+/// The value is skipped if the reader is dropped without reading it.
+pub struct ValueReader<'c, 's> {
+    cursor: &'c mut Cursor<'s>,
+}
+
+impl<'c, 's> ValueReader<'c, 's> {
+    fn new(cursor: &'c mut Cursor<'s>) -> Self {
+        Self { cursor }
+    }
+
+    /// Materializes the whole value.
+    pub fn value(self) -> Result<Value<'s>> {
+        self.cursor.value_pending = false;
+        self.cursor.value()
+    }
+
+    /// Reads a string literal.
+    pub fn text(self) -> Result<Cow<'s, str>> {
+        if self.cursor.peek() != Some(b'"') {
+            return Err(BadResponse::BadValueType);
+        }
+        self.cursor.value_pending = false;
+        self.cursor.string()
+    }
+
+    /// Starts reading a tuple or a list with named items.
+    pub fn tuple(self) -> Result<TupleReader<'c, 's>> {
+        let close = match self.cursor.peek() {
+            Some(b'{') => b'}',
+            Some(b'[') => b']',
+            _ => return Err(BadResponse::BadValueType),
+        };
+        self.cursor.open();
+        Ok(TupleReader {
+            depth: self.cursor.depth,
+            cursor: self.cursor,
+            close: Some(close),
+            state: ReaderState::First,
+        })
+    }
+
+    /// Starts reading a list that contains a sequence of values.
+    pub fn list(self) -> Result<ListReader<'c, 's>> {
+        if self.cursor.peek() != Some(b'[') {
+            return Err(BadResponse::BadValueType);
+        }
+        self.cursor.open();
+        Ok(ListReader {
+            depth: self.cursor.depth,
+            cursor: self.cursor,
+            state: ReaderState::First,
+        })
+    }
+}
+
+/// Progress of a [`TupleReader`] or [`ListReader`].
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+enum ReaderState {
+    /// No items have been read yet.
+    First,
+
+    /// At least one item has been read.
+    Next,
+
+    /// The closing bracket has been read.
+    Done,
+}
+
+/// Position of the readers in the input.
+///
+/// All readers of a record share a cursor.
+struct Cursor<'s> {
+    input: &'s str,
+
+    /// Offset of the next unread byte.
+    position: usize,
+
+    /// Number of containers that the cursor is nested in.
+    depth: usize,
+
+    /// Whether the cursor is at a value that has not been read yet.
+    value_pending: bool,
+}
+
+impl<'s> Cursor<'s> {
+    fn new(input: &'s str) -> Self {
+        Self {
+            input,
+            position: 0,
+            depth: 0,
+            value_pending: false,
+        }
+    }
+
+    fn syntax_error(&self) -> BadResponse {
+        BadResponse::SyntaxError(self.input.to_owned())
+    }
+
+    fn peek(&self) -> Option<u8> {
+        self.input.as_bytes().get(self.position).copied()
+    }
+
+    fn eat(&mut self, byte: u8) -> bool {
+        let matches = self.peek() == Some(byte);
+        if matches {
+            self.position += 1;
+        }
+        matches
+    }
+
+    fn expect(&mut self, byte: u8) -> Result<()> {
+        if self.eat(byte) {
+            Ok(())
+        } else {
+            Err(self.syntax_error())
+        }
+    }
+
+    /// Reads a sequence of digits, if present.
+    fn digits(&mut self) -> Option<&'s str> {
+        let start = self.position;
+        while self.peek().is_some_and(|c| c.is_ascii_digit()) {
+            self.position += 1;
+        }
+        Some(&self.input[start..self.position]).filter(|digits| !digits.is_empty())
+    }
+
+    /// Reads an unquoted identifier, such as a result class or a key.
+    fn identifier(&mut self) -> Result<&'s str> {
+        let start = self.position;
+        if !self.peek().is_some_and(|c| c.is_ascii_alphabetic()) {
+            return Err(self.syntax_error());
+        }
+        while self
+            .peek()
+            .is_some_and(|c| c.is_ascii_alphanumeric() || c == b'-' || c == b'_')
+        {
+            self.position += 1;
+        }
+        Ok(&self.input[start..self.position])
+    }
+
+    /// Reads the contents of a string literal without resolving escape sequences.
+    fn quoted(&mut self) -> Result<&'s str> {
+        self.expect(b'"')?;
+        let start = self.position;
+        loop {
+            match self.peek() {
+                Some(b'"') => break,
+                Some(b'\\') => self.position += 2,
+                Some(_) => self.position += 1,
+                None => return Err(self.syntax_error()),
+            }
+        }
+        let contents = &self.input[start..self.position];
+        self.position += 1;
+        Ok(contents)
+    }
+
+    /// Reads a string literal.
+    fn string(&mut self) -> Result<Cow<'s, str>> {
+        let contents = self.quoted()?;
+        unescape_c_string(contents).ok_or_else(|| self.syntax_error())
+    }
+
+    /// Enters a container.
+    fn open(&mut self) {
+        self.position += 1;
+        self.depth += 1;
+        self.value_pending = false;
+    }
+
+    /// Leaves a container if the cursor is at its end.
+    ///
+    /// If `close` is [`None`], checks for the end of the record instead.
+    fn close(&mut self, close: Option<u8>) -> Result<bool> {
+        match close {
+            Some(close) => {
+                let closed = self.eat(close);
+                if closed {
+                    self.depth -= 1;
+                }
+                Ok(closed)
+            }
+            None => Ok(self.input[self.position..]
+                .chars()
+                .all(|c| c == '\r' || c == '\n')),
+        }
+    }
+
+    /// Reads a whole value.
+    fn value(&mut self) -> Result<Value<'s>> {
+        match self.peek() {
+            Some(b'"') => Ok(Value::Const(self.string()?)),
+            Some(b'{') => {
+                self.open();
+                Ok(Value::Tuple(self.entries(b'}')?))
+            }
+            Some(b'[') => {
+                self.open();
+                match self.peek() {
+                    Some(b'"' | b'{' | b'[') => Ok(Value::List(self.values()?)),
+                    Some(b']') => {
+                        self.close(Some(b']'))?;
+                        Ok(Value::List(Vec::new()))
+                    }
+                    _ => Ok(Value::TupleList(self.entries(b']')?)),
+                }
+            }
+            _ => Err(self.syntax_error()),
+        }
+    }
+
+    /// Reads entries of a container up to and including its closing bracket.
+    fn entries(&mut self, close: u8) -> Result<ResultTuple<'s>> {
+        let mut tuple = ResultTuple::default();
+        if self.close(Some(close))? {
+            return Ok(tuple);
+        }
+        loop {
+            let key = self.identifier()?;
+            self.expect(b'=')?;
+            let value = self.value()?;
+            tuple.0.push(ResultEntry { key, value });
+            if self.close(Some(close))? {
+                return Ok(tuple);
+            }
+            self.expect(b',')?;
+        }
+    }
+
+    /// Reads values of a list up to and including its closing bracket.
+    fn values(&mut self) -> Result<Vec<Value<'s>>> {
+        let mut values = Vec::new();
+        loop {
+            values.push(self.value()?);
+            if self.close(Some(b']'))? {
+                return Ok(values);
+            }
+            self.expect(b',')?;
+        }
+    }
+
+    /// Moves the cursor past any items that a reader at a given depth
+    /// has left unread or only read partially.
+    ///
+    /// Skipped values are not validated beyond matching up the brackets.
+    fn settle(&mut self, depth: usize) -> Result<()> {
+        if self.depth == depth && self.value_pending {
+            match self.peek() {
+                Some(b'"') => {
+                    self.quoted()?;
+                }
+                Some(b'{' | b'[') => self.open(),
+                _ => return Err(self.syntax_error()),
+            }
+        }
+        self.value_pending = false;
+        while self.depth > depth {
+            match self.peek() {
+                Some(b'"') => {
+                    self.quoted()?;
+                }
+                Some(b'{' | b'[') => self.open(),
+                Some(b'}' | b']') => {
+                    self.position += 1;
+                    self.depth -= 1;
+                }
+                Some(_) => self.position += 1,
+                None => return Err(self.syntax_error()),
+            }
+        }
+        Ok(())
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    const RECORD: &str = concat!(
+        r#"12^done,skipped={a=["1",{b="2"}]},"#,
+        r#"list=["x","y\"z"],children=[child={name="a"},child={name="b"}]"#,
+        "\r\n",
+    );
+
+    #[test]
+    fn reads_header() {
+        let reader = ResultRecordReader::new(RECORD).expect("Header should have been read");
+        assert_eq!(reader.token, Some("12"));
+        assert_eq!(reader.result_class, ResultClass::Done);
+    }
+
+    #[test]
+    fn skips_unread_values() {
+        let mut reader = ResultRecordReader::new(RECORD).unwrap();
+        let mut results = reader.results();
+        let mut list = results.find("list").unwrap().list().unwrap();
+        let first = list.next_value().unwrap().unwrap().text().unwrap();
+        assert!(matches!(first, Cow::Borrowed("x")));
+        let second = list.next_value().unwrap().unwrap().text().unwrap();
+        assert!(matches!(second, Cow::Owned(_)));
+        assert_eq!(second, "y\"z");
+        assert!(list.next_value().unwrap().is_none());
+        let (key, _) = results.next_entry().unwrap().unwrap();
+        assert_eq!(key, "children");
+        assert!(results.next_entry().unwrap().is_none());
+    }
+
+    #[test]
+    fn skips_partially_read_values() {
+        let mut reader = ResultRecordReader::new(RECORD).unwrap();
+        let mut results = reader.results();
+        let mut skipped = results.find("skipped").unwrap().tuple().unwrap();
+        let mut a = skipped.find("a").unwrap().list().unwrap();
+        a.next_value().unwrap();
+        let mut children = results.find("children").unwrap().tuple().unwrap();
+        let (key, value) = children.next_entry().unwrap().unwrap();
+        assert_eq!(key, "child");
+        let expected = Value::Tuple(ResultTuple(vec![ResultEntry {
+            key: "name",
+            value: Value::Const("a".into()),
+        }]));
+        assert_eq!(value.value().unwrap(), expected);
+    }
+
+    #[test]
+    fn collects_values() {
+        let mut reader = ResultRecordReader::new(r#"^done,a=[],b=["1"],c=[d={}]"#).unwrap();
+        let expected = ResultTuple(vec![
+            ResultEntry {
+                key: "a",
+                value: Value::List(Vec::new()),
+            },
+            ResultEntry {
+                key: "b",
+                value: Value::List(vec![Value::Const("1".into())]),
+            },
+            ResultEntry {
+                key: "c",
+                value: Value::TupleList(ResultTuple(vec![ResultEntry {
+                    key: "d",
+                    value: Value::Tuple(ResultTuple::default()),
+                }])),
+            },
+        ]);
+        assert_eq!(reader.results().collect().unwrap(), expected);
+    }
+
+    #[test]
+    fn rejects_missing_keys() {
+        let mut reader = ResultRecordReader::new(RECORD).unwrap();
+        let error = reader.results().find("none").err().unwrap();
+        assert!(matches!(error, BadResponse::MissingKey(key) if key == "none"));
+    }
+
+    #[test]
+    fn rejects_malformed_records() {
+        ResultRecordReader::new("~\"text\"").err().unwrap();
+        let mut reader = ResultRecordReader::new(r#"^done,a={b="1""#).unwrap();
+        reader.results().find("none").err().unwrap();
+    }
+}
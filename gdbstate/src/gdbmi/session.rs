@@ -3,6 +3,7 @@
 
 use super::{
     raw_output::*,
+    reader::{ResultRecordReader, TupleReader, ValueReader},
     result::{BadResponse, ErrorResponse, Result},
     stream::GdbMiStream,
     types::*,
@@ -86,6 +87,42 @@ pub trait GdbMiSession {
         print_values: PrintValues,
     ) -> impl Future<Output = Result<ChildList>>;
 
+    /// Exposes the
+    /// [`-var-list-children`](https://sourceware.org/gdb/current/onlinedocs/gdb.html/GDB_002fMI-Variable-Objects.html#The-_002dvar_002dlist_002dchildren-Command)
+    /// command for multiple variable objects at once.
+    ///
+    /// All commands are sent as a [single batch](GdbMiStream::send_commands),
+    /// so streams that support pipelining do not wait for each response
+    /// before sending the next command.
+    ///
+    /// Children are returned in the same order as the objects.
+    fn var_list_children_batch(
+        &mut self,
+        objects: &[&VariableObject],
+        print_values: PrintValues,
+    ) -> impl Future<Output = Result<Vec<ChildList>>>;
+
+    /// Exposes the
+    /// [`-var-list-children`](https://sourceware.org/gdb/current/onlinedocs/gdb.html/GDB_002fMI-Variable-Objects.html#The-_002dvar_002dlist_002dchildren-Command)
+    /// command for multiple variable objects at once,
+    /// listing at most a given number of children of each.
+    ///
+    /// Objects without a limit have all their children listed.
+    /// Otherwise behaves the same as [`GdbMiSession::var_list_children_batch`].
+    fn var_list_children_limited_batch(
+        &mut self,
+        objects: &[(&VariableObject, Option<usize>)],
+        print_values: PrintValues,
+    ) -> impl Future<Output = Result<Vec<ChildList>>>;
+
+    /// Exposes the
+    /// [`-var-info-path-expression`](https://sourceware.org/gdb/current/onlinedocs/gdb.html/GDB_002fMI-Variable-Objects.html#The-_002dvar_002dinfo_002dpath_002dexpression-Command)
+    /// command.
+    fn var_info_path_expression(
+        &mut self,
+        object: &VariableObject,
+    ) -> impl Future<Output = Result<String>>;
+
     /// Exposes the
     /// [`-var-update`](https://sourceware.org/gdb/current/onlinedocs/gdb.html/GDB_002fMI-Variable-Objects.html#The-_002dvar_002dupdate-Command)
     /// command.
@@ -94,6 +131,13 @@ pub trait GdbMiSession {
         print_values: PrintValues,
     ) -> impl Future<Output = Result<Vec<VariableObjectUpdate>>>;
 
+    /// Exposes the
+    /// [`-gdb-show`](https://sourceware.org/gdb/current/onlinedocs/gdb.html/GDB_002fMI-Miscellaneous-Commands.html#The-_002dgdb_002dshow-Command)
+    /// command.
+    ///
+    /// Returns the value of the setting.
+    fn gdb_show(&mut self, setting: &str) -> impl Future<Output = Result<String>>;
+
     /// Exposes the
     /// [`-data-evaluate-expression`](https://sourceware.org/gdb/current/onlinedocs/gdb.html/GDB_002fMI-Data-Manipulation.html#The-_002ddata_002devaluate_002dexpression-Command)
     /// command.
@@ -101,35 +145,87 @@ pub trait GdbMiSession {
         &mut self,
         expression: &str,
     ) -> impl Future<Output = Result<String>>;
+
+    /// Exposes the
+    /// [`-data-evaluate-expression`](https://sourceware.org/gdb/current/onlinedocs/gdb.html/GDB_002fMI-Data-Manipulation.html#The-_002ddata_002devaluate_002dexpression-Command)
+    /// command for multiple expressions at once.
+    ///
+    /// All commands are sent as a [single batch](GdbMiStream::send_commands).
+    /// Values are returned in the same order as the expressions.
+    /// An expression that GDB fails to evaluate does not fail the whole batch,
+    /// its own result is an error instead.
+    fn data_evaluate_expression_batch(
+        &mut self,
+        expressions: &[String],
+    ) -> impl Future<Output = Result<Vec<Result<String>>>>;
+
+    /// Exposes the
+    /// [`-data-evaluate-expression`](https://sourceware.org/gdb/current/onlinedocs/gdb.html/GDB_002fMI-Data-Manipulation.html#The-_002ddata_002devaluate_002dexpression-Command)
+    /// command for one expression in multiple stack frames.
+    ///
+    /// Each frame is [selected](GdbMiSession::stack_select_frame)
+    /// right before the expression is evaluated in it, all as a
+    /// [single batch](GdbMiStream::send_commands), so the last frame
+    /// is left selected. Values are returned in the same order as the frames.
+    /// A frame that cannot be selected or where the expression cannot be evaluated
+    /// does not fail the whole batch, its own result is an error instead.
+    fn data_evaluate_expression_in_frames(
+        &mut self,
+        expression: &str,
+        frames: &[usize],
+    ) -> impl Future<Output = Result<Vec<Result<String>>>>;
+
+    /// Exposes the
+    /// [`-data-read-memory-bytes`](https://sourceware.org/gdb/current/onlinedocs/gdb.html/GDB_002fMI-Data-Manipulation.html#The-_002ddata_002dread_002dmemory_002dbytes-Command)
+    /// command.
+    fn data_read_memory_bytes(
+        &mut self,
+        address: &str,
+        count: usize,
+    ) -> impl Future<Output = Result<Vec<MemoryBlock>>>;
+
+    /// Exposes the
+    /// [`-data-read-memory-bytes`](https://sourceware.org/gdb/current/onlinedocs/gdb.html/GDB_002fMI-Data-Manipulation.html#The-_002ddata_002dread_002dmemory_002dbytes-Command)
+    /// command for multiple blocks of memory at once.
+    ///
+    /// All commands are sent as a [single batch](GdbMiStream::send_commands).
+    /// Blocks are returned in the same order as they are requested.
+    /// A block that GDB fails to read does not fail the whole batch,
+    /// its own result is an error instead.
+    fn data_read_memory_bytes_batch(
+        &mut self,
+        blocks: &[(String, usize)],
+    ) -> impl Future<Output = Result<Vec<Result<Vec<MemoryBlock>>>>>;
 }
 
 impl<T: GdbMiStream> GdbMiSession for T {
     async fn symbol_info_variables(&mut self) -> Result<Vec<SymbolFile>> {
-        Ok(self
-            .send_command("-symbol-info-variables")
-            .await?
+        // The response lists all global variables, so it may be huge
+        let response = self.send_command("-symbol-info-variables").await?;
+        Ok(response
+            .reader()?
             .must_be_done_or_running()?
-            .take("symbols")?
+            .find("symbols")?
             .tuple()?
-            .take("debug")?
+            .find("debug")?
             .symbol_query_result()?)
     }
 
     async fn symbol_info_functions(&mut self) -> Result<Vec<SymbolFile>> {
-        Ok(self
-            .send_command("-symbol-info-functions")
-            .await?
+        let response = self.send_command("-symbol-info-functions").await?;
+        Ok(response
+            .reader()?
             .must_be_done_or_running()?
-            .take("symbols")?
+            .find("symbols")?
             .tuple()?
-            .take("debug")?
+            .find("debug")?
             .symbol_query_result()?)
     }
 
     async fn stack_info_depth(&mut self) -> Result<usize> {
-        Ok(self
-            .send_command("-stack-info-depth")
-            .await?
+        let response = self.send_command("-stack-info-depth").await?;
+        Ok(response
+            .record()?
             .must_be_done_or_running()?
             .take("depth")?
             .decimal()?)
@@ -138,14 +234,15 @@ impl<T: GdbMiStream> GdbMiSession for T {
     async fn stack_select_frame(&mut self, target_frame: usize) -> Result<()> {
         self.send_command_fmt(format_args!("-stack-select-frame {target_frame}"))
             .await?
+            .record()?
             .must_be_done_or_running()?;
         Ok(())
     }
 
     async fn stack_list_frames(&mut self) -> Result<Vec<StackFrame>> {
-        Ok(self
-            .send_command("-stack-list-frames")
-            .await?
+        let response = self.send_command("-stack-list-frames").await?;
+        Ok(response
+            .record()?
             .must_be_done_or_running()?
             .take("stack")?
             .stack_trace()?)
@@ -155,12 +252,14 @@ impl<T: GdbMiStream> GdbMiSession for T {
         &mut self,
         bounds: std::ops::Range<usize>,
     ) -> Result<Vec<StackFrame>> {
-        Ok(self
+        let response = self
             .send_command_fmt(format_args!(
                 "-stack-list-frames {} {}",
                 bounds.start, bounds.end
             ))
-            .await?
+            .await?;
+        Ok(response
+            .record()?
             .must_be_done_or_running()?
             .take("stack")?
             .stack_trace()?)
@@ -176,11 +275,13 @@ impl<T: GdbMiStream> GdbMiSession for T {
         } else {
             ""
         };
-        Ok(self
+        let response = self
             .send_command_fmt(format_args!(
                 "-stack-list-variables {skip_arg} {print_values}"
             ))
-            .await?
+            .await?;
+        Ok(response
+            .record()?
             .must_be_done_or_running()?
             .take("variables")?
             .local_variable_list()?)
@@ -191,24 +292,26 @@ impl<T: GdbMiStream> GdbMiSession for T {
         frame: VariableObjectFrameContext,
         expression: &str,
     ) -> Result<VariableObjectData> {
-        Ok(self
+        let response = self
             .send_command_fmt(format_args!("-var-create - {frame} {expression:?}"))
-            .await?
-            .must_be_done_or_running()?
-            .var_object()?)
+            .await?;
+        Ok(response.record()?.must_be_done_or_running()?.var_object()?)
     }
 
     async fn var_delete(&mut self, object: &VariableObject) -> Result<()> {
         self.send_command_fmt(format_args!("-var-delete \"{}\"", object.0))
             .await?
+            .record()?
             .must_be_done_or_running()?;
         Ok(())
     }
 
     async fn var_evaluate_expression(&mut self, object: &VariableObject) -> Result<String> {
-        Ok(self
+        let response = self
             .send_command_fmt(format_args!("-var-evaluate-expression \"{}\"", object.0))
-            .await?
+            .await?;
+        Ok(response
+            .record()?
             .must_be_done_or_running()?
             .take("value")?
             .string()?)
@@ -219,37 +322,185 @@ impl<T: GdbMiStream> GdbMiSession for T {
         object: &VariableObject,
         print_values: PrintValues,
     ) -> Result<ChildList> {
-        Ok(self
+        // Large arrays may have many children, so read them one by one
+        let response = self
             .send_command_fmt(format_args!(
                 "-var-list-children {print_values} \"{}\"",
                 object.0
             ))
+            .await?;
+        Ok(response.reader()?.must_be_done_or_running()?.child_list()?)
+    }
+
+    async fn var_list_children_batch(
+        &mut self,
+        objects: &[&VariableObject],
+        print_values: PrintValues,
+    ) -> Result<Vec<ChildList>> {
+        let objects: Vec<_> = objects.iter().map(|object| (*object, None)).collect();
+        self.var_list_children_limited_batch(&objects, print_values)
+            .await
+    }
+
+    async fn var_list_children_limited_batch(
+        &mut self,
+        objects: &[(&VariableObject, Option<usize>)],
+        print_values: PrintValues,
+    ) -> Result<Vec<ChildList>> {
+        let commands: Vec<_> = objects
+            .iter()
+            .map(|(object, limit)| match limit {
+                Some(limit) => {
+                    format!(
+                        "-var-list-children {print_values} \"{}\" 0 {limit}",
+                        object.0
+                    )
+                }
+                None => format!("-var-list-children {print_values} \"{}\"", object.0),
+            })
+            .collect();
+        self.send_commands(&commands)
             .await?
+            .iter()
+            .map(|response| Ok(response.reader()?.must_be_done_or_running()?.child_list()?))
+            .collect()
+    }
+
+    async fn var_info_path_expression(&mut self, object: &VariableObject) -> Result<String> {
+        let response = self
+            .send_command_fmt(format_args!("-var-info-path-expression \"{}\"", object.0))
+            .await?;
+        Ok(response
+            .record()?
             .must_be_done_or_running()?
-            .child_list()?)
+            .take("path_expr")?
+            .string()?)
     }
 
     async fn var_update(&mut self, print_values: PrintValues) -> Result<Vec<VariableObjectUpdate>> {
-        Ok(self
+        let response = self
             .send_command_fmt(format_args!("-var-update {print_values} *"))
-            .await?
+            .await?;
+        Ok(response
+            .record()?
             .must_be_done_or_running()?
             .take("changelist")?
             .varobj_changelist()?)
     }
 
+    async fn gdb_show(&mut self, setting: &str) -> Result<String> {
+        let response = self
+            .send_command_fmt(format_args!("-gdb-show {setting}"))
+            .await?;
+        Ok(response
+            .record()?
+            .must_be_done_or_running()?
+            .take("value")?
+            .string()?)
+    }
+
     async fn data_evaluate_expression(&mut self, expression: &str) -> Result<String> {
-        Ok(self
+        let response = self
             .send_command_fmt(format_args!("-data-evaluate-expression {expression:?}"))
-            .await?
+            .await?;
+        Ok(response
+            .record()?
             .must_be_done_or_running()?
             .take("value")?
             .string()?)
     }
+
+    async fn data_evaluate_expression_batch(
+        &mut self,
+        expressions: &[String],
+    ) -> Result<Vec<Result<String>>> {
+        let commands: Vec<_> = expressions
+            .iter()
+            .map(|expression| format!("-data-evaluate-expression {expression:?}"))
+            .collect();
+        Ok(self
+            .send_commands(&commands)
+            .await?
+            .iter()
+            .map(|response| {
+                Ok(response
+                    .record()?
+                    .must_be_done_or_running()?
+                    .take("value")?
+                    .string()?)
+            })
+            .collect())
+    }
+
+    async fn data_evaluate_expression_in_frames(
+        &mut self,
+        expression: &str,
+        frames: &[usize],
+    ) -> Result<Vec<Result<String>>> {
+        let commands: Vec<_> = frames
+            .iter()
+            .flat_map(|frame| {
+                [
+                    format!("-stack-select-frame {frame}"),
+                    format!("-data-evaluate-expression {expression:?}"),
+                ]
+            })
+            .collect();
+        Ok(self
+            .send_commands(&commands)
+            .await?
+            .chunks(2)
+            .map(|responses| {
+                responses[0].record()?.must_be_done_or_running()?;
+                Ok(responses[1]
+                    .record()?
+                    .must_be_done_or_running()?
+                    .take("value")?
+                    .string()?)
+            })
+            .collect())
+    }
+
+    async fn data_read_memory_bytes(
+        &mut self,
+        address: &str,
+        count: usize,
+    ) -> Result<Vec<MemoryBlock>> {
+        let response = self
+            .send_command_fmt(format_args!("-data-read-memory-bytes {address:?} {count}"))
+            .await?;
+        Ok(response
+            .record()?
+            .must_be_done_or_running()?
+            .take("memory")?
+            .memory_block_list()?)
+    }
+
+    async fn data_read_memory_bytes_batch(
+        &mut self,
+        blocks: &[(String, usize)],
+    ) -> Result<Vec<Result<Vec<MemoryBlock>>>> {
+        let commands: Vec<_> = blocks
+            .iter()
+            .map(|(address, count)| format!("-data-read-memory-bytes {address:?} {count}"))
+            .collect();
+        Ok(self
+            .send_commands(&commands)
+            .await?
+            .iter()
+            .map(|response| {
+                Ok(response
+                    .record()?
+                    .must_be_done_or_running()?
+                    .take("memory")?
+                    .memory_block_list()?)
+            })
+            .collect())
+    }
 }
 
-impl ResultRecord {
-    pub fn must_be_done_or_running(mut self) -> Result<ResultTuple> {
+impl<'s> ResultRecord<'s> {
+    pub fn must_be_done_or_running(mut self) -> Result<ResultTuple<'s>> {
         if self.result_class == ResultClass::Error {
             let msg = self.results.take("msg").and_then(Value::string).ok();
             return Err(ErrorResponse { msg }.into());
@@ -260,3 +511,20 @@ impl ResultRecord {
         Ok(self.results)
     }
 }
+
+impl<'s> ResultRecordReader<'s> {
+    pub fn must_be_done_or_running(&mut self) -> Result<TupleReader<'_, 's>> {
+        if self.result_class == ResultClass::Error {
+            let msg = self
+                .results()
+                .find("msg")
+                .and_then(ValueReader::string)
+                .ok();
+            return Err(ErrorResponse { msg }.into());
+        }
+        if self.result_class != ResultClass::Done && self.result_class != ResultClass::Running {
+            return Err(BadResponse::UnexpectedResultClass(self.result_class.to_string()).into());
+        }
+        Ok(self.results())
+    }
+}
@@ -3,8 +3,10 @@
 use super::{
     grammar::parse_gdbmi_record,
     raw_output::{Record, ResultRecord},
+    reader::ResultRecordReader,
     result::{BadResponse, Result},
 };
+use std::collections::BTreeMap;
 
 /// Low level interface to GDB that communicates using literal strings.
 pub trait StringGdbMiStream {
@@ -26,18 +28,80 @@ pub trait StringGdbMiStream {
     ) -> impl Future<Output = std::io::Result<String>> {
         async move { self.send_command(&std::fmt::format(args)).await }
     }
+
+    /// Sends multiple MI commands to GDB at once.
+    ///
+    /// The returned strings are the result records that respond
+    /// to the passed commands, in the same order as the commands.
+    ///
+    /// The default implementation sends each command only after
+    /// the previous one has been responded to. Streams that can
+    /// have multiple commands in flight should override it.
+    fn send_commands(
+        &mut self,
+        commands: &[String],
+    ) -> impl Future<Output = std::io::Result<Vec<String>>> {
+        async move {
+            let mut outputs = Vec::with_capacity(commands.len());
+            for command in commands {
+                outputs.push(self.send_command(command).await?);
+            }
+            Ok(outputs)
+        }
+    }
+}
+
+/// Result record returned by GDB in response to a command.
+///
+/// The record is kept as text and only parsed when it is read,
+/// so that the parsed values can borrow from it.
+#[derive(Clone, PartialEq, Eq, Debug)]
+pub struct GdbMiResponse(String);
+
+impl GdbMiResponse {
+    /// Wraps the text of a result record.
+    pub fn new(output: String) -> Self {
+        Self(output)
+    }
+
+    /// Gets the text of the result record.
+    pub fn as_str(&self) -> &str {
+        &self.0
+    }
+
+    /// Parses the whole result record.
+    pub fn record(&self) -> Result<ResultRecord<'_>> {
+        match parse_gdbmi_record(&self.0) {
+            Ok(Record::Result(r)) => Ok(r),
+            _ => Err(BadResponse::SyntaxError(self.0.clone()).into()),
+        }
+    }
+
+    /// Starts reading the result record without materializing it.
+    ///
+    /// This should be preferred over [`GdbMiResponse::record`]
+    /// for responses that may be large.
+    pub fn reader(&self) -> Result<ResultRecordReader<'_>> {
+        Ok(ResultRecordReader::new(&self.0)?)
+    }
+}
+
+impl From<String> for GdbMiResponse {
+    fn from(output: String) -> Self {
+        Self::new(output)
+    }
 }
 
-/// Low level interface to GDB that responds with parsed result records.
+/// Low level interface to GDB that responds with result records.
 pub trait GdbMiStream {
     /// Sends an MI command to GDB.
     ///
     /// The command must be valid in the
     /// [GDB/MI input syntax](https://sourceware.org/gdb/current/onlinedocs/gdb.html/GDB_002fMI-Input-Syntax.html).
     ///
-    /// The returned string is the result record (starting with `^`)
+    /// The returned response is the result record (starting with `^`)
     /// that responds to the passed command.
-    fn send_command(&mut self, command: &str) -> impl Future<Output = Result<ResultRecord>>;
+    fn send_command(&mut self, command: &str) -> impl Future<Output = Result<GdbMiResponse>>;
 
     /// Shorthand for constructing a command with formatting.
     ///
@@ -45,25 +109,367 @@ pub trait GdbMiStream {
     fn send_command_fmt(
         &mut self,
         args: std::fmt::Arguments<'_>,
-    ) -> impl Future<Output = Result<ResultRecord>> {
+    ) -> impl Future<Output = Result<GdbMiResponse>> {
         async move { self.send_command(&std::fmt::format(args)).await }
     }
+
+    /// Sends multiple MI commands to GDB at once.
+    ///
+    /// The returned records respond to the passed commands,
+    /// in the same order as the commands.
+    ///
+    /// See [`StringGdbMiStream::send_commands`] for information about how this function should be used.
+    fn send_commands(
+        &mut self,
+        commands: &[String],
+    ) -> impl Future<Output = Result<Vec<GdbMiResponse>>> {
+        async move {
+            let mut outputs = Vec::with_capacity(commands.len());
+            for command in commands {
+                outputs.push(self.send_command(command).await?);
+            }
+            Ok(outputs)
+        }
+    }
 }
 
 impl<T: StringGdbMiStream> GdbMiStream for T {
-    async fn send_command(&mut self, command: &str) -> Result<ResultRecord> {
-        let output = StringGdbMiStream::send_command(self, command).await?;
-        match parse_gdbmi_record(&output) {
-            Ok(Record::Result(r)) => Ok(r),
-            _ => Err(BadResponse::SyntaxError(output).into()),
+    async fn send_command(&mut self, command: &str) -> Result<GdbMiResponse> {
+        Ok(StringGdbMiStream::send_command(self, command).await?.into())
+    }
+
+    async fn send_command_fmt(&mut self, args: std::fmt::Arguments<'_>) -> Result<GdbMiResponse> {
+        Ok(StringGdbMiStream::send_command_fmt(self, args)
+            .await?
+            .into())
+    }
+
+    async fn send_commands(&mut self, commands: &[String]) -> Result<Vec<GdbMiResponse>> {
+        Ok(StringGdbMiStream::send_commands(self, commands)
+            .await?
+            .into_iter()
+            .map(GdbMiResponse::new)
+            .collect())
+    }
+}
+
+/// [`StringGdbMiStream`] that forwards commands to another stream
+/// and counts the commands and the responses.
+///
+/// This can be used to find out how much an update of the state graph
+/// has talked to GDB.
+pub struct CountingGdbMiStream<S: StringGdbMiStream> {
+    /// The underlying stream.
+    stream: S,
+
+    /// Counters of the commands sent so far.
+    statistics: MiStatistics,
+}
+
+/// Counters of commands sent through a [`CountingGdbMiStream`].
+#[derive(Clone, PartialEq, Eq, Debug, Default)]
+pub struct MiStatistics {
+    /// Number of commands sent, by the name of the command.
+    pub commands: BTreeMap<String, usize>,
+
+    /// Total length of the responses, all of which are parsed.
+    pub response_bytes: usize,
+}
+
+impl MiStatistics {
+    /// Total number of commands sent.
+    pub fn command_count(&self) -> usize {
+        self.commands.values().sum()
+    }
+
+    /// Counts a command and the response to it.
+    fn record(&mut self, command: &str, response: &str) {
+        let name = command.split_whitespace().next().unwrap_or_default();
+        if let Some(count) = self.commands.get_mut(name) {
+            *count += 1;
+        } else {
+            self.commands.insert(name.to_owned(), 1);
         }
+        self.response_bytes += response.len();
     }
+}
 
-    async fn send_command_fmt(&mut self, args: std::fmt::Arguments<'_>) -> Result<ResultRecord> {
-        let output = StringGdbMiStream::send_command_fmt(self, args).await?;
-        match parse_gdbmi_record(&output) {
-            Ok(Record::Result(r)) => Ok(r),
-            _ => Err(BadResponse::SyntaxError(output).into()),
+impl<S: StringGdbMiStream> CountingGdbMiStream<S> {
+    /// Wraps a stream.
+    pub fn new(stream: S) -> Self {
+        Self {
+            stream,
+            statistics: MiStatistics::default(),
+        }
+    }
+
+    /// Counters of the commands sent so far.
+    pub fn statistics(&self) -> &MiStatistics {
+        &self.statistics
+    }
+
+    /// Unwraps the underlying stream and the counters.
+    pub fn into_inner(self) -> (S, MiStatistics) {
+        (self.stream, self.statistics)
+    }
+}
+
+impl<S: StringGdbMiStream> StringGdbMiStream for CountingGdbMiStream<S> {
+    async fn send_command(&mut self, command: &str) -> std::io::Result<String> {
+        let output = self.stream.send_command(command).await?;
+        self.statistics.record(command, &output);
+        Ok(output)
+    }
+
+    async fn send_commands(&mut self, commands: &[String]) -> std::io::Result<Vec<String>> {
+        let outputs = self.stream.send_commands(commands).await?;
+        for (command, output) in commands.iter().zip(&outputs) {
+            self.statistics.record(command, output);
+        }
+        Ok(outputs)
+    }
+}
+
+/// Raw connection to GDB where input is written
+/// independently of output being read.
+pub trait GdbMiPipe {
+    /// Writes a single line of input to GDB,
+    /// without waiting for the response.
+    fn write_line(&mut self, line: &str) -> impl Future<Output = std::io::Result<()>>;
+
+    /// Reads the next result record (the line that contains `^`) emitted by GDB.
+    ///
+    /// All other output, such as async records, stream records,
+    /// and prompts, should be skipped.
+    fn read_result_record(&mut self) -> impl Future<Output = std::io::Result<String>>;
+}
+
+/// [`StringGdbMiStream`] that tags each command with a
+/// [token](https://sourceware.org/gdb/current/onlinedocs/gdb.html/GDB_002fMI-Input-Syntax.html),
+/// which allows [multiple commands](StringGdbMiStream::send_commands)
+/// to be in flight at once.
+///
+/// Result records are matched to their commands by token,
+/// so responses to commands that have been abandoned
+/// (for example, because an earlier command in the batch
+/// failed to send) are safely ignored.
+pub struct PipelinedGdbMiStream<P: GdbMiPipe> {
+    /// The underlying connection.
+    pipe: P,
+
+    /// Token that will be assigned to the next command.
+    next_token: u64,
+
+    /// Maximum number of commands that may await a response at once.
+    max_in_flight: usize,
+}
+
+impl<P: GdbMiPipe> PipelinedGdbMiStream<P> {
+    /// Default limit on the number of commands that may await a response at once.
+    pub const DEFAULT_MAX_IN_FLIGHT: usize = 64;
+
+    /// Wraps a connection to GDB.
+    pub fn new(pipe: P) -> Self {
+        Self {
+            pipe,
+            next_token: 0,
+            max_in_flight: Self::DEFAULT_MAX_IN_FLIGHT,
+        }
+    }
+
+    /// Sets the maximum number of commands that may await a response at once.
+    ///
+    /// Values less than one are treated as one, which disables pipelining.
+    pub fn with_max_in_flight(mut self, max_in_flight: usize) -> Self {
+        self.max_in_flight = max_in_flight.max(1);
+        self
+    }
+
+    /// Gets the underlying connection.
+    ///
+    /// Lines written directly to the connection are not tagged,
+    /// so their result records are never mistaken for responses
+    /// to commands sent through this stream.
+    pub fn pipe_mut(&mut self) -> &mut P {
+        &mut self.pipe
+    }
+
+    /// Unwraps the underlying connection.
+    pub fn into_inner(self) -> P {
+        self.pipe
+    }
+}
+
+impl<P: GdbMiPipe> StringGdbMiStream for PipelinedGdbMiStream<P> {
+    async fn send_command(&mut self, command: &str) -> std::io::Result<String> {
+        let mut outputs = StringGdbMiStream::send_commands(self, &[command.to_owned()]).await?;
+        Ok(outputs
+            .pop()
+            .expect("One command was sent, so there should be one response"))
+    }
+
+    async fn send_commands(&mut self, commands: &[String]) -> std::io::Result<Vec<String>> {
+        let first_token = self.next_token;
+        let mut outputs = vec![None; commands.len()];
+        let mut sent = 0;
+        let mut received = 0;
+        while received < commands.len() {
+            // Keep as many commands in flight as we are allowed to
+            while sent < commands.len() && sent - received < self.max_in_flight {
+                self.pipe
+                    .write_line(&format!("{}{}", first_token + sent as u64, commands[sent]))
+                    .await?;
+                // Advance the token right away so that tokens
+                // are never reused, even if the batch fails midway
+                self.next_token += 1;
+                sent += 1;
+            }
+            let output = self.pipe.read_result_record().await?;
+            let Some(index) = record_token(&output)
+                .and_then(|token| token.checked_sub(first_token))
+                .map(|index| index as usize)
+                .filter(|index| *index < sent)
+            else {
+                // Response to a command that is not ours to handle
+                continue;
+            };
+            if outputs[index].is_none() {
+                received += 1;
+            }
+            outputs[index] = Some(output);
         }
+        Ok(outputs
+            .into_iter()
+            .map(|output| output.expect("Loop only ends when all commands have been responded to"))
+            .collect())
+    }
+}
+
+/// Extracts the numeric token from the start of a record, if present.
+fn record_token(record: &str) -> Option<u64> {
+    let token_length = record
+        .find(|c: char| !c.is_ascii_digit())
+        .unwrap_or(record.len());
+    record[..token_length].parse().ok()
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use std::{
+        collections::VecDeque,
+        task::{Context, Poll, Waker},
+    };
+
+    /// Pipe that answers pending commands in reverse order
+    /// and echoes each command back in its response.
+    #[derive(Default)]
+    struct ReversingPipe {
+        pending: Vec<String>,
+        stale: VecDeque<String>,
+        most_in_flight: usize,
+    }
+
+    impl GdbMiPipe for ReversingPipe {
+        async fn write_line(&mut self, line: &str) -> std::io::Result<()> {
+            self.pending.push(line.to_owned());
+            self.most_in_flight = self.most_in_flight.max(self.pending.len());
+            Ok(())
+        }
+
+        async fn read_result_record(&mut self) -> std::io::Result<String> {
+            if let Some(stale) = self.stale.pop_front() {
+                return Ok(stale);
+            }
+            let line = self
+                .pending
+                .pop()
+                .ok_or_else(|| std::io::Error::from(std::io::ErrorKind::UnexpectedEof))?;
+            let token_length = line.find('-').unwrap_or(line.len());
+            let (token, command) = line.split_at(token_length);
+            Ok(format!("{token}^done,command=\"{command}\""))
+        }
+    }
+
+    fn expect_ready<F: Future>(future: F) -> F::Output {
+        let mut context = Context::from_waker(Waker::noop());
+        match std::pin::pin!(future).poll(&mut context) {
+            Poll::Pending => panic!("Test pipe should never block"),
+            Poll::Ready(output) => output,
+        }
+    }
+
+    fn commands(count: usize) -> Vec<String> {
+        (0..count).map(|i| format!("-command-{i}")).collect()
+    }
+
+    fn expected_responses(first_token: u64, count: usize) -> Vec<String> {
+        (0..count)
+            .map(|i| format!("{}^done,command=\"-command-{i}\"", first_token + i as u64))
+            .collect()
+    }
+
+    #[test]
+    fn responses_are_matched_by_token() {
+        let mut stream = PipelinedGdbMiStream::new(ReversingPipe::default());
+        let responses = expect_ready(StringGdbMiStream::send_commands(&mut stream, &commands(5)))
+            .expect("Commands should have succeeded");
+        assert_eq!(responses, expected_responses(0, 5));
+        let responses = expect_ready(StringGdbMiStream::send_commands(&mut stream, &commands(3)))
+            .expect("Commands should have succeeded");
+        assert_eq!(responses, expected_responses(5, 3));
+    }
+
+    #[test]
+    fn in_flight_commands_are_limited() {
+        let mut stream = PipelinedGdbMiStream::new(ReversingPipe::default()).with_max_in_flight(4);
+        let responses = expect_ready(StringGdbMiStream::send_commands(&mut stream, &commands(10)))
+            .expect("Commands should have succeeded");
+        assert_eq!(responses, expected_responses(0, 10));
+        assert_eq!(stream.into_inner().most_in_flight, 4);
+    }
+
+    #[test]
+    fn foreign_responses_are_ignored() {
+        let mut pipe = ReversingPipe::default();
+        pipe.stale = [
+            "^done".to_owned(),
+            "0^error".to_owned(),
+            "999^done".to_owned(),
+        ]
+        .into();
+        let mut stream = PipelinedGdbMiStream::new(pipe);
+        stream.next_token = 1;
+        let responses = expect_ready(StringGdbMiStream::send_commands(&mut stream, &commands(2)))
+            .expect("Commands should have succeeded");
+        assert_eq!(responses, expected_responses(1, 2));
+    }
+
+    #[test]
+    fn commands_are_counted_by_name() {
+        let mut stream =
+            CountingGdbMiStream::new(PipelinedGdbMiStream::new(ReversingPipe::default()));
+        expect_ready(StringGdbMiStream::send_commands(&mut stream, &commands(2))).unwrap();
+        let response = expect_ready(StringGdbMiStream::send_command(
+            &mut stream,
+            "-command-0 --all",
+        ))
+        .unwrap();
+        let statistics = stream.statistics();
+        assert_eq!(
+            statistics.commands,
+            BTreeMap::from([("-command-0".to_owned(), 2), ("-command-1".to_owned(), 1)])
+        );
+        assert_eq!(statistics.command_count(), 3);
+        let expected_bytes: usize = expected_responses(0, 2).iter().map(String::len).sum();
+        assert_eq!(statistics.response_bytes, expected_bytes + response.len());
+    }
+
+    #[test]
+    fn single_command_is_tagged() {
+        let mut stream = PipelinedGdbMiStream::new(ReversingPipe::default());
+        let response =
+            expect_ready(StringGdbMiStream::send_command(&mut stream, "-command-0")).unwrap();
+        assert_eq!(response, expected_responses(0, 1)[0]);
     }
 }
@@ -0,0 +1,395 @@
+//! Recording and replaying of conversations with GDB.
+//!
+//! A [`GdbMiTranscript`] captured from a real debugging session
+//! by [`RecordingGdbMiStream`] can be played back by [`ReplayGdbMiStream`]
+//! without a debugger, so that the state graph can be constructed
+//! and updated deterministically, for example in benchmarks.
+
+use super::{
+    result::Result,
+    stream::{GdbMiResponse, GdbMiStream, StringGdbMiStream},
+};
+use derive_more::{Display, Error};
+use std::{
+    collections::{HashMap, VecDeque},
+    time::Duration,
+};
+
+/// Single command sent to GDB and the result record it was answered with.
+#[derive(Clone, PartialEq, Eq, Debug)]
+pub struct GdbMiExchange {
+    /// The command, without a token.
+    pub command: String,
+
+    /// The result record that responded to the command,
+    /// without the line terminator.
+    pub response: String,
+}
+
+/// Sequence of commands sent to GDB along with the responses to them.
+///
+/// ## Text Format
+/// Transcripts are stored as text where each command is written
+/// on a line that starts with `> `, followed by its response
+/// on a line that starts with `< `. Empty lines and lines that start
+/// with `#` are ignored.
+///
+/// ```text
+/// # Stopped at main
+/// > -stack-info-depth
+/// < ^done,depth="1"
+/// ```
+#[derive(Clone, PartialEq, Eq, Debug, Default)]
+pub struct GdbMiTranscript {
+    /// The recorded exchanges, in the order they were made.
+    pub exchanges: Vec<GdbMiExchange>,
+}
+
+impl GdbMiTranscript {
+    /// Reads a transcript from its [text format](GdbMiTranscript#text-format).
+    pub fn parse(source: &str) -> std::result::Result<Self, TranscriptSyntaxError> {
+        let mut exchanges = Vec::new();
+        let mut command = None;
+        for (index, line) in source.lines().enumerate() {
+            let line_number = index + 1;
+            if line.is_empty() || line.starts_with('#') {
+                continue;
+            }
+            match (line.split_at_checked(2), command.take()) {
+                (Some(("> ", text)), None) => command = Some(text.to_owned()),
+                (Some(("< ", text)), Some(command)) => exchanges.push(GdbMiExchange {
+                    command,
+                    response: text.to_owned(),
+                }),
+                _ => return Err(TranscriptSyntaxError { line_number }),
+            }
+        }
+        if command.is_some() {
+            // The last command has not been responded to
+            return Err(TranscriptSyntaxError {
+                line_number: source.lines().count(),
+            });
+        }
+        Ok(Self { exchanges })
+    }
+}
+
+impl std::fmt::Display for GdbMiTranscript {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        for exchange in &self.exchanges {
+            writeln!(f, "> {}", exchange.command)?;
+            writeln!(f, "< {}", exchange.response)?;
+        }
+        Ok(())
+    }
+}
+
+/// Indicates that a transcript could not be parsed.
+#[derive(Clone, Copy, PartialEq, Eq, Debug, Display, Error)]
+#[display("Malformed transcript on line {line_number}")]
+pub struct TranscriptSyntaxError {
+    /// One-based number of the offending line.
+    pub line_number: usize,
+}
+
+/// [`GdbMiStream`] that forwards commands to another stream
+/// and records them in a [`GdbMiTranscript`].
+pub struct RecordingGdbMiStream<S: GdbMiStream> {
+    /// The underlying stream.
+    stream: S,
+
+    /// Commands recorded so far.
+    transcript: GdbMiTranscript,
+}
+
+impl<S: GdbMiStream> RecordingGdbMiStream<S> {
+    /// Wraps a stream.
+    pub fn new(stream: S) -> Self {
+        Self {
+            stream,
+            transcript: GdbMiTranscript::default(),
+        }
+    }
+
+    /// Gets the underlying stream.
+    ///
+    /// Commands sent directly to the underlying stream are not recorded,
+    /// which can be used to control the debuggee between recordings.
+    pub fn inner_mut(&mut self) -> &mut S {
+        &mut self.stream
+    }
+
+    /// Takes the commands recorded so far and starts a new transcript.
+    pub fn take_transcript(&mut self) -> GdbMiTranscript {
+        std::mem::take(&mut self.transcript)
+    }
+
+    /// Unwraps the underlying stream and the recorded transcript.
+    pub fn into_inner(self) -> (S, GdbMiTranscript) {
+        (self.stream, self.transcript)
+    }
+
+    /// Records a command and the response to it.
+    fn record(&mut self, command: &str, response: &GdbMiResponse) {
+        self.transcript.exchanges.push(GdbMiExchange {
+            command: command.to_owned(),
+            response: response.as_str().trim_end_matches(['\r', '\n']).to_owned(),
+        });
+    }
+}
+
+impl<S: GdbMiStream> GdbMiStream for RecordingGdbMiStream<S> {
+    async fn send_command(&mut self, command: &str) -> Result<GdbMiResponse> {
+        let response = self.stream.send_command(command).await?;
+        self.record(command, &response);
+        Ok(response)
+    }
+
+    async fn send_commands(&mut self, commands: &[String]) -> Result<Vec<GdbMiResponse>> {
+        let responses = self.stream.send_commands(commands).await?;
+        for (command, response) in commands.iter().zip(&responses) {
+            self.record(command, response);
+        }
+        Ok(responses)
+    }
+}
+
+/// [`StringGdbMiStream`] that answers commands from a [`GdbMiTranscript`].
+///
+/// Commands are matched to the recorded ones by their text, so they
+/// may be sent in a different order than they were recorded in,
+/// as long as each of them has been recorded. Commands that have been
+/// recorded multiple times are answered in the order they were recorded in.
+///
+/// No time is actually spent waiting for responses. Instead, the stream
+/// counts the round trips it would have taken to talk to GDB, so that
+/// the [latency](ReplayGdbMiStream::simulated_latency) of a real session
+/// can be estimated deterministically.
+pub struct ReplayGdbMiStream {
+    /// Recorded responses that have not been replayed yet, by command.
+    responses: HashMap<String, VecDeque<String>>,
+
+    /// Simulated time GDB takes to respond to a command.
+    latency: Duration,
+
+    /// Maximum number of commands that may await a response at once.
+    max_in_flight: usize,
+
+    /// Number of times the stream has waited for responses.
+    round_trips: usize,
+
+    /// Number of commands that have been answered.
+    commands_replayed: usize,
+}
+
+impl ReplayGdbMiStream {
+    /// Constructs a stream that replays a transcript, with no latency
+    /// and with no limit on the number of commands in flight.
+    pub fn new(transcript: GdbMiTranscript) -> Self {
+        let mut responses = HashMap::<_, VecDeque<_>>::new();
+        for GdbMiExchange { command, response } in transcript.exchanges {
+            responses.entry(command).or_default().push_back(response);
+        }
+        Self {
+            responses,
+            latency: Duration::ZERO,
+            max_in_flight: usize::MAX,
+            round_trips: 0,
+            commands_replayed: 0,
+        }
+    }
+
+    /// Sets the simulated time it takes GDB to respond to a command.
+    pub fn with_latency(mut self, latency: Duration) -> Self {
+        self.latency = latency;
+        self
+    }
+
+    /// Sets the maximum number of commands that may await a response at once,
+    /// like [`PipelinedGdbMiStream::with_max_in_flight`](super::stream::PipelinedGdbMiStream::with_max_in_flight).
+    ///
+    /// Values less than one are treated as one, which simulates
+    /// a stream that sends each command only after the previous one
+    /// has been responded to.
+    pub fn with_max_in_flight(mut self, max_in_flight: usize) -> Self {
+        self.max_in_flight = max_in_flight.max(1);
+        self
+    }
+
+    /// Number of times the stream would have waited for GDB to respond.
+    pub fn round_trips(&self) -> usize {
+        self.round_trips
+    }
+
+    /// Number of commands that have been answered.
+    pub fn commands_replayed(&self) -> usize {
+        self.commands_replayed
+    }
+
+    /// Total time the stream would have waited for GDB to respond.
+    ///
+    /// Saturates at [`Duration::MAX`] instead of overflowing.
+    pub fn simulated_latency(&self) -> Duration {
+        u32::try_from(self.round_trips).map_or(Duration::MAX, |round_trips| {
+            self.latency.saturating_mul(round_trips)
+        })
+    }
+
+    /// Number of recorded commands that have not been replayed.
+    pub fn remaining(&self) -> usize {
+        self.responses.values().map(VecDeque::len).sum()
+    }
+
+    /// Looks up the next recorded response to a command.
+    fn replay(&mut self, command: &str) -> std::io::Result<String> {
+        let response = self
+            .responses
+            .get_mut(command)
+            .and_then(VecDeque::pop_front)
+            .ok_or_else(|| {
+                std::io::Error::new(
+                    std::io::ErrorKind::NotFound,
+                    format!("Command has not been recorded: {command}"),
+                )
+            })?;
+        self.commands_replayed += 1;
+        Ok(response)
+    }
+}
+
+impl StringGdbMiStream for ReplayGdbMiStream {
+    async fn send_command(&mut self, command: &str) -> std::io::Result<String> {
+        self.round_trips += 1;
+        self.replay(command)
+    }
+
+    async fn send_commands(&mut self, commands: &[String]) -> std::io::Result<Vec<String>> {
+        self.round_trips += commands.len().div_ceil(self.max_in_flight);
+        commands
+            .iter()
+            .map(|command| self.replay(command))
+            .collect()
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use std::task::{Context, Poll, Waker};
+
+    fn expect_ready<F: Future>(future: F) -> F::Output {
+        let mut context = Context::from_waker(Waker::noop());
+        match std::pin::pin!(future).poll(&mut context) {
+            Poll::Pending => panic!("Test stream should never block"),
+            Poll::Ready(output) => output,
+        }
+    }
+
+    fn test_transcript() -> GdbMiTranscript {
+        GdbMiTranscript {
+            exchanges: vec![
+                GdbMiExchange {
+                    command: "-stack-info-depth".to_owned(),
+                    response: "^done,depth=\"2\"".to_owned(),
+                },
+                GdbMiExchange {
+                    command: "-var-update --all-values *".to_owned(),
+                    response: "^done,changelist=[]".to_owned(),
+                },
+                GdbMiExchange {
+                    command: "-stack-info-depth".to_owned(),
+                    response: "^done,depth=\"1\"".to_owned(),
+                },
+            ],
+        }
+    }
+
+    #[test]
+    fn transcript_text_round_trip() {
+        let transcript = test_transcript();
+        let text = transcript.to_string();
+        assert!(text.starts_with("> -stack-info-depth\n< ^done,depth=\"2\"\n"));
+        assert_eq!(GdbMiTranscript::parse(&text), Ok(transcript));
+    }
+
+    #[test]
+    fn transcript_comments_are_ignored() {
+        let text = "# Stop 1\n\n> -stack-info-depth\n< ^done,depth=\"1\"\n";
+        let transcript = GdbMiTranscript::parse(text).unwrap();
+        assert_eq!(transcript.exchanges.len(), 1);
+    }
+
+    #[test]
+    fn malformed_transcript() {
+        let text = "> -stack-info-depth\n> -stack-info-depth\n";
+        assert_eq!(
+            GdbMiTranscript::parse(text),
+            Err(TranscriptSyntaxError { line_number: 2 })
+        );
+        assert_eq!(
+            GdbMiTranscript::parse("> -stack-info-depth\n"),
+            Err(TranscriptSyntaxError { line_number: 1 })
+        );
+    }
+
+    #[test]
+    fn replayed_commands_are_matched_by_text() {
+        let mut stream = ReplayGdbMiStream::new(test_transcript());
+        let response = expect_ready(StringGdbMiStream::send_command(
+            &mut stream,
+            "-var-update --all-values *",
+        ));
+        assert_eq!(response.unwrap(), "^done,changelist=[]");
+        let responses = expect_ready(StringGdbMiStream::send_commands(
+            &mut stream,
+            &[
+                "-stack-info-depth".to_owned(),
+                "-stack-info-depth".to_owned(),
+            ],
+        ));
+        assert_eq!(
+            responses.unwrap(),
+            ["^done,depth=\"2\"", "^done,depth=\"1\""]
+        );
+        assert_eq!(stream.remaining(), 0);
+        let error = expect_ready(StringGdbMiStream::send_command(
+            &mut stream,
+            "-stack-info-depth",
+        ));
+        assert_eq!(error.unwrap_err().kind(), std::io::ErrorKind::NotFound);
+    }
+
+    #[test]
+    fn round_trips_are_simulated() {
+        let commands = vec!["-stack-info-depth".to_owned(); 2];
+        let mut stream = ReplayGdbMiStream::new(test_transcript())
+            .with_latency(Duration::from_millis(5))
+            .with_max_in_flight(1);
+        expect_ready(StringGdbMiStream::send_commands(&mut stream, &commands)).unwrap();
+        assert_eq!(stream.round_trips(), 2);
+        let mut stream =
+            ReplayGdbMiStream::new(test_transcript()).with_latency(Duration::from_millis(5));
+        expect_ready(StringGdbMiStream::send_commands(&mut stream, &commands)).unwrap();
+        assert_eq!(stream.round_trips(), 1);
+        assert_eq!(stream.commands_replayed(), 2);
+        assert_eq!(stream.simulated_latency(), Duration::from_millis(5));
+    }
+
+    #[test]
+    fn recorded_transcript_can_be_replayed() {
+        let mut recorder = RecordingGdbMiStream::new(ReplayGdbMiStream::new(test_transcript()));
+        expect_ready(GdbMiStream::send_command(
+            &mut recorder,
+            "-stack-info-depth",
+        ))
+        .unwrap();
+        expect_ready(GdbMiStream::send_commands(
+            &mut recorder,
+            &["-var-update --all-values *".to_owned()],
+        ))
+        .unwrap();
+        let transcript = recorder.take_transcript();
+        assert_eq!(transcript.exchanges, test_transcript().exchanges[..2]);
+        assert!(recorder.take_transcript().exchanges.is_empty());
+    }
+}
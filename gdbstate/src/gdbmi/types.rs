@@ -229,6 +229,23 @@ pub struct ChildVariableObject {
     pub exp: String,
 }
 
+/// Contiguous block of memory in the response to
+/// [`-data-read-memory-bytes`](https://sourceware.org/gdb/current/onlinedocs/gdb.html/GDB_002fMI-Data-Manipulation.html#The-_002ddata_002dread_002dmemory_002dbytes-Command).
+#[derive(Clone, PartialEq, Eq, Debug)]
+pub struct MemoryBlock {
+    /// Address of the first byte of the block.
+    pub begin: u64,
+
+    /// Offset of the block relative to the requested start address.
+    pub offset: u64,
+
+    /// Address of the first byte after the block.
+    pub end: u64,
+
+    /// Contents of the block.
+    pub contents: Vec<u8>,
+}
+
 /// Specification of the stack frame where a variable object should live.
 #[derive(Display)]
 pub enum VariableObjectFrameContext {
@@ -0,0 +1,608 @@
+//! Resolution of length hint sheets that reuses the results
+//! of previous resolutions for parts of the graph that have not changed.
+
+use crate::{hints::PointerLengthHintKey, state::*};
+use aili_model::state::{EdgeLabel, NodeTypeClass, ProgramStateGraph};
+use aili_style::{
+    cascade::{
+        CascadeStyle, ResolverCheckpoint, SelectionCaret, SelectorResolver, SequencePointRecord,
+    },
+    eval::{context::EvaluationContext, evaluate, variable_pool::VariablePool},
+    stylesheet::StyleKey,
+    values::PropertyValue,
+};
+use derive_more::Debug;
+use std::{
+    cell::RefCell,
+    collections::{HashMap, HashSet},
+    ops::Range,
+};
+
+/// Snapshot of a length hint resolution past a [`NodeTypeClass::Ref`] node,
+/// from which the resolution continues once the pointer is dereferenced.
+pub(crate) type HintSnapshot<'a> = (
+    VariablePool<&'a str, GdbStateNodeId>,
+    SelectorResolver<'a, GdbStateNodeId>,
+);
+
+/// Results of the last resolution of a length hint sheet
+/// from the root of a [`GdbStateGraph`].
+///
+/// The resolution does not continue past dereferences,
+/// so it covers the stack frames and their variables.
+/// It is repeated on each update, but only the subtrees
+/// that access a changed node are evaluated again.
+#[derive(Debug, Default)]
+pub(crate) struct LengthHintCache {
+    /// Records of all node visits, in depth-first order.
+    visits: Vec<HintVisitRecord>,
+
+    /// All nodes that have been accessed during the resolution,
+    /// in order of access.
+    reads: Vec<GdbStateNodeId>,
+
+    /// All sequence point checks made by the selector resolver, in order.
+    sequence_points: Vec<SequencePointRecord<GdbStateNodeId>>,
+
+    /// All length hints that have been assigned, in order.
+    hints: Vec<(VariableHandle, PropertyValue<GdbStateNodeId>)>,
+
+    /// Nodes that have changed after the resolution,
+    /// while the rest of the update was completed.
+    changed_nodes: HashSet<GdbStateNodeId>,
+}
+
+impl LengthHintCache {
+    /// Discards all cached results.
+    pub fn clear(&mut self) {
+        *self = Self::default();
+    }
+
+    /// Length hints assigned by the last resolution, in order.
+    pub fn hints(&self) -> &[(VariableHandle, PropertyValue<GdbStateNodeId>)] {
+        &self.hints
+    }
+
+    /// Records nodes that have changed since the last resolution,
+    /// so they are evaluated again by the next one.
+    pub fn mark_changed(&mut self, changed_nodes: HashSet<GdbStateNodeId>) {
+        if self.changed_nodes.is_empty() {
+            self.changed_nodes = changed_nodes;
+        } else {
+            self.changed_nodes.extend(changed_nodes);
+        }
+    }
+
+    /// Resolves a length hint sheet from the root of a graph,
+    /// replacing the cached results with the new ones.
+    ///
+    /// ## Parameters
+    /// - `stylesheet` - The hint sheet. It must be the same one
+    ///   the cache has been populated with, if any.
+    /// - `changed_nodes` - All nodes that have been added, removed or modified
+    ///   since the previous resolution, save for those that have already been
+    ///   [marked](LengthHintCache::mark_changed). A superset is permitted.
+    /// - `needs_snapshot` - Pointers that will be dereferenced by the update,
+    ///   which need a [`HintSnapshot`] to continue the resolution past them.
+    ///
+    /// ## Return Value
+    /// Snapshots of the resolution past all pointers that have been visited
+    /// in subtrees that have been evaluated again. This includes all pointers
+    /// in `needs_snapshot` that the resolution visits.
+    pub fn resolve<'a>(
+        &mut self,
+        graph: &GdbStateGraph,
+        stylesheet: &'a CascadeStyle<PointerLengthHintKey>,
+        changed_nodes: &HashSet<GdbStateNodeId>,
+        needs_snapshot: impl IntoIterator<Item = VariableHandle>,
+    ) -> HashMap<VariableHandle, HintSnapshot<'a>> {
+        let mut previous = std::mem::take(self);
+        // Pointers that need a snapshot are always visited again,
+        // because the snapshot cannot be replayed
+        previous
+            .changed_nodes
+            .extend(needs_snapshot.into_iter().map(GdbStateNodeId::VarObject));
+        previous.changed_nodes.extend(changed_nodes.iter().cloned());
+        let mut resolution = IncrementalHintResolution::new(graph, stylesheet, previous);
+        resolution.run();
+        *self = Self {
+            visits: resolution.visits,
+            reads: resolution.graph.reads.take(),
+            sequence_points: resolution.resolver.take_sequence_point_log(),
+            hints: resolution.hints,
+            changed_nodes: HashSet::new(),
+        };
+        resolution.snapshots
+    }
+}
+
+/// Record of a single visit of a node during a length hint resolution.
+///
+/// All ranges refer to the logs of the owning [`LengthHintCache`]
+/// and cover the whole subtree of the visit.
+#[derive(Debug)]
+struct HintVisitRecord {
+    /// The node that has been visited.
+    node: GdbStateNodeId,
+
+    /// The edge along which the node was entered,
+    /// [`None`] for the root of the resolution.
+    edge: Option<EdgeLabel>,
+
+    /// Selectors awaiting the visited node.
+    entry: ResolverCheckpoint,
+
+    /// Variables assigned while resolving the node itself,
+    /// which are visible to all its successors.
+    /// Sorted by name.
+    variables: Vec<(String, PropertyValue<GdbStateNodeId>)>,
+
+    /// Index of the first visit after the subtree of this visit.
+    end: usize,
+
+    /// Range of [`LengthHintCache::reads`] made in the subtree.
+    reads: Range<usize>,
+
+    /// Range of [`LengthHintCache::sequence_points`] made in the subtree.
+    sequence_points: Range<usize>,
+
+    /// Range of [`LengthHintCache::hints`] assigned in the subtree.
+    hints: Range<usize>,
+}
+
+/// Evaluates the rules of a length hint sheet that match a node.
+///
+/// Variables assigned by the rules are inserted into the variable pool
+/// and length hints are passed to a callback, in order of assignment.
+pub(crate) fn resolve_hint_rules<'a>(
+    stylesheet: &'a CascadeStyle<PointerLengthHintKey>,
+    graph: &impl ProgramStateGraph<NodeId = GdbStateNodeId>,
+    origin: &GdbStateNodeId,
+    resolver: &mut SelectorResolver<'a, GdbStateNodeId>,
+    variable_pool: &mut VariablePool<&'a str, GdbStateNodeId>,
+    previous_edge: Option<&EdgeLabel>,
+    mut on_hint: impl FnMut(VariableHandle, PropertyValue<GdbStateNodeId>),
+) {
+    let context = EvaluationContext::from_graph(graph, origin.clone())
+        .with_variables(variable_pool)
+        .with_optional_preceding_edge(previous_edge);
+    let matched_rules = resolver.resolve_node(origin.clone(), &context);
+    for (rule_index, caret) in matched_rules {
+        let rule = stylesheet.rule_at(rule_index);
+        if caret == SelectionCaret::PrecedingEdge || rule.extra_label.is_some() {
+            // TODO: Warn, this kind of rules should not appear here
+            continue;
+        }
+        for property in &rule.properties {
+            let context = EvaluationContext::from_graph(graph, origin.clone())
+                .with_variables(variable_pool)
+                .with_optional_preceding_edge(previous_edge);
+            match &property.key {
+                StyleKey::Variable(name) => {
+                    let variable_value = evaluate(&property.value, &context);
+                    variable_pool.insert(name, variable_value);
+                }
+                StyleKey::Property(PointerLengthHintKey::Length) => {
+                    // If it is a variable node, resolve the
+                    if let GdbStateNodeId::VarObject(var_object) = origin {
+                        on_hint(*var_object, evaluate(&property.value, &context));
+                    } else {
+                        // TODO: Warn, only variables should be assigned lengths
+                    }
+                }
+            }
+        }
+    }
+}
+
+/// Helper for length hint resolutions from the root of a graph.
+struct IncrementalHintResolution<'a, 'g> {
+    /// The graph being traversed.
+    graph: TrackedGraph<'g>,
+
+    /// The hint sheet being evaluated.
+    stylesheet: &'a CascadeStyle<PointerLengthHintKey>,
+
+    /// Resolver that tracks the hint sheet's selectors.
+    resolver: SelectorResolver<'a, GdbStateNodeId>,
+
+    /// Variables that are active at the moment.
+    variable_pool: VariablePool<&'a str, GdbStateNodeId>,
+
+    /// Results of the previous resolution.
+    previous: LengthHintCache,
+
+    /// Number of changed nodes in [`LengthHintCache::reads`]
+    /// of the previous resolution before each index.
+    changed_reads_before: Vec<usize>,
+
+    /// Visits recorded in this resolution.
+    visits: Vec<HintVisitRecord>,
+
+    /// Length hints assigned in this resolution.
+    hints: Vec<(VariableHandle, PropertyValue<GdbStateNodeId>)>,
+
+    /// Snapshots saved past pointers in this resolution.
+    snapshots: HashMap<VariableHandle, HintSnapshot<'a>>,
+}
+
+impl<'a, 'g> IncrementalHintResolution<'a, 'g> {
+    fn new(
+        graph: &'g GdbStateGraph,
+        stylesheet: &'a CascadeStyle<PointerLengthHintKey>,
+        previous: LengthHintCache,
+    ) -> Self {
+        let mut changed_reads_before = Vec::with_capacity(previous.reads.len() + 1);
+        let mut count = 0;
+        changed_reads_before.push(count);
+        for read in &previous.reads {
+            if previous.changed_nodes.contains(read) {
+                count += 1;
+            }
+            changed_reads_before.push(count);
+        }
+        Self {
+            graph: TrackedGraph {
+                graph,
+                reads: RefCell::default(),
+            },
+            stylesheet,
+            resolver: SelectorResolver::new(stylesheet.selector_machine())
+                .with_sequence_point_log(),
+            variable_pool: VariablePool::new(),
+            previous,
+            changed_reads_before,
+            visits: Vec::new(),
+            hints: Vec::new(),
+            snapshots: HashMap::new(),
+        }
+    }
+
+    fn run(&mut self) {
+        let cached_root = self
+            .previous
+            .visits
+            .first()
+            .filter(|visit| visit.node == GdbStateNodeId::Root)
+            .map(|_| 0);
+        self.run_from(GdbStateNodeId::Root, None, cached_root);
+    }
+
+    /// Traverses depth-first from a specified node, stopping at dereferences,
+    /// and evaluates the hint sheet.
+    ///
+    /// If `cached_visit` is provided, it is the index of a cached visit
+    /// of the same node along the same edge with the same variables in scope.
+    fn run_from(
+        &mut self,
+        origin: GdbStateNodeId,
+        previous_edge: Option<&EdgeLabel>,
+        cached_visit: Option<usize>,
+    ) {
+        if let Some(cached_visit) = cached_visit
+            && self.try_replay_visit(cached_visit)
+        {
+            return;
+        }
+        let visit = self.begin_visit(&origin, previous_edge);
+        let hints = &mut self.hints;
+        resolve_hint_rules(
+            self.stylesheet,
+            &self.graph,
+            &origin,
+            &mut self.resolver,
+            &mut self.variable_pool,
+            previous_edge,
+            |var_object, length| hints.push((var_object, length)),
+        );
+        let cached_successors = self.record_visit_variables(visit, cached_visit);
+        // Nothing past this point can match if no selectors await an edge
+        if self.resolver.has_edges_to_resolve()
+            && let Some(node) = self.graph.get_detached(&origin)
+        {
+            // Save a snapshot so we can return to it later
+            if node.type_class == NodeTypeClass::Ref
+                && let GdbStateNodeId::VarObject(var_object) = origin
+            {
+                self.snapshots.insert(
+                    var_object,
+                    (self.variable_pool.snapshot(), self.resolver.snapshot()),
+                );
+            }
+            for (edge_label, successor) in &node.successors {
+                if *edge_label == EdgeLabel::Deref {
+                    // Do not resolve past a dereference edge,
+                    // each heap-allocated object will be the root of its own resolution
+                    continue;
+                }
+                let cached_visit = cached_successors
+                    .get(edge_label)
+                    .copied()
+                    .filter(|&i| self.previous.visits[i].node == *successor);
+                self.variable_pool.push();
+                self.resolver.push_edge(edge_label);
+                self.run_from(successor.clone(), Some(edge_label), cached_visit);
+                self.resolver.pop_edge();
+                self.variable_pool.pop();
+            }
+        }
+        self.end_visit(visit);
+    }
+
+    /// Starts recording a visit of a node.
+    ///
+    /// ## Return Value
+    /// Index of the new visit record.
+    fn begin_visit(&mut self, node: &GdbStateNodeId, previous_edge: Option<&EdgeLabel>) -> usize {
+        let index = self.visits.len();
+        let reads_start = self.graph.reads.borrow().len();
+        let sequence_points_start = self.resolver.sequence_point_log().len();
+        let hints_start = self.hints.len();
+        self.visits.push(HintVisitRecord {
+            node: node.clone(),
+            edge: previous_edge.cloned(),
+            entry: self.resolver.checkpoint(),
+            variables: Vec::new(),
+            end: index,
+            reads: reads_start..reads_start,
+            sequence_points: sequence_points_start..sequence_points_start,
+            hints: hints_start..hints_start,
+        });
+        index
+    }
+
+    /// Saves the variables assigned at a visited node before its successors are visited.
+    ///
+    /// ## Return Value
+    /// Cached visits of successors of the node that are eligible for reuse, by edge label.
+    /// They are eligible if the cached visit of the node has seen the same variables.
+    fn record_visit_variables(
+        &mut self,
+        visit: usize,
+        cached_visit: Option<usize>,
+    ) -> HashMap<EdgeLabel, usize> {
+        let mut variables = self
+            .variable_pool
+            .current_frame()
+            .map(|(name, value)| ((*name).to_owned(), value.clone()))
+            .collect::<Vec<_>>();
+        variables.sort_by(|(a, _), (b, _)| a.cmp(b));
+        let cached_successors = cached_visit
+            .filter(|&i| self.previous.visits[i].variables == variables)
+            .map(|i| self.previous.successors_of(i))
+            .unwrap_or_default();
+        self.visits[visit].variables = variables;
+        cached_successors
+    }
+
+    /// Finishes recording a visit of a node and its successors.
+    fn end_visit(&mut self, visit: usize) {
+        let end = self.visits.len();
+        let reads_end = self.graph.reads.borrow().len();
+        let sequence_points_end = self.resolver.sequence_point_log().len();
+        let hints_end = self.hints.len();
+        let record = &mut self.visits[visit];
+        record.end = end;
+        record.reads.end = reads_end;
+        record.sequence_points.end = sequence_points_end;
+        record.hints.end = hints_end;
+    }
+
+    /// Replays a cached visit if it is still valid.
+    ///
+    /// ## Return Value
+    /// True if the visit has been replayed, false if it must be evaluated again.
+    fn try_replay_visit(&mut self, cached_visit: usize) -> bool {
+        let previous = &self.previous;
+        let record = &previous.visits[cached_visit];
+        // The visit must not have accessed anything that has changed
+        if self.changed_reads_before[record.reads.start]
+            != self.changed_reads_before[record.reads.end]
+        {
+            return false;
+        }
+        // The visit must have started from the same state
+        if record.entry != self.resolver.checkpoint() {
+            return false;
+        }
+        let sequence_points = &previous.sequence_points[record.sequence_points.clone()];
+        if !self.resolver.can_replay_sequence_points(sequence_points) {
+            return false;
+        }
+        // Replay effects of the subtree
+        let reads_start = self.graph.reads.borrow().len();
+        let sequence_points_start = self.resolver.sequence_point_log().len();
+        let hints_start = self.hints.len();
+        let visits_start = self.visits.len();
+        self.resolver.replay_sequence_points(sequence_points);
+        self.graph
+            .reads
+            .borrow_mut()
+            .extend_from_slice(&previous.reads[record.reads.clone()]);
+        self.hints
+            .extend_from_slice(&previous.hints[record.hints.clone()]);
+        // Carry the records over to the new cache
+        for cached in &previous.visits[cached_visit..record.end] {
+            self.visits.push(HintVisitRecord {
+                node: cached.node.clone(),
+                edge: cached.edge.clone(),
+                entry: cached.entry.clone(),
+                variables: cached.variables.clone(),
+                end: cached.end - cached_visit + visits_start,
+                reads: rebase(&cached.reads, record.reads.start, reads_start),
+                sequence_points: rebase(
+                    &cached.sequence_points,
+                    record.sequence_points.start,
+                    sequence_points_start,
+                ),
+                hints: rebase(&cached.hints, record.hints.start, hints_start),
+            });
+        }
+        true
+    }
+}
+
+impl LengthHintCache {
+    /// Lists the direct successors of a visit by the edges they were entered through.
+    fn successors_of(&self, visit: usize) -> HashMap<EdgeLabel, usize> {
+        let mut successors = HashMap::new();
+        let mut next = visit + 1;
+        while next < self.visits[visit].end {
+            let successor = &self.visits[next];
+            if let Some(edge) = &successor.edge {
+                successors.insert(edge.clone(), next);
+            }
+            next = successor.end;
+        }
+        successors
+    }
+}
+
+/// Moves a range that is relative to one position so it is relative to another.
+fn rebase(range: &Range<usize>, old_start: usize, new_start: usize) -> Range<usize> {
+    (range.start - old_start + new_start)..(range.end - old_start + new_start)
+}
+
+/// Wrapper over a [`GdbStateGraph`] that logs which nodes have been accessed.
+struct TrackedGraph<'g> {
+    /// The underlying graph.
+    graph: &'g GdbStateGraph,
+
+    /// Log of accessed nodes.
+    reads: RefCell<Vec<GdbStateNodeId>>,
+}
+
+impl<'g> TrackedGraph<'g> {
+    /// Accesses a node by its ID, like [`ProgramStateGraph::get`],
+    /// without borrowing the wrapper.
+    fn get_detached(&self, id: &GdbStateNodeId) -> Option<&'g GdbStateNode> {
+        self.reads.borrow_mut().push(id.clone());
+        self.graph.get(id)
+    }
+}
+
+impl ProgramStateGraph for TrackedGraph<'_> {
+    type NodeId = GdbStateNodeId;
+    type NodeRef<'a>
+        = &'a GdbStateNode
+    where
+        Self: 'a;
+    fn get(&self, id: &Self::NodeId) -> Option<Self::NodeRef<'_>> {
+        self.get_detached(id)
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use crate::gdbmi::types::VariableObject;
+    use aili_model::state::NodeValue;
+    use aili_style::stylesheet::{expression::*, selector::*, *};
+
+    /// Hint sheet that assigns the value of each variable named `p` as its length.
+    fn hint_sheet() -> CascadeStyle<PointerLengthHintKey> {
+        // .many(*) "p" {
+        //   length: @ + 0;
+        // }
+        CascadeStyle::from(Stylesheet(vec![StyleRule {
+            selector: Selector::from_path(
+                [
+                    SelectorSegment::anything_any_number_of_times(),
+                    SelectorSegment::Match(EdgeMatcher::Named("p".into())),
+                ]
+                .into(),
+            ),
+            properties: vec![StyleClause {
+                key: StyleKey::Property(PointerLengthHintKey::Length),
+                value: Expression::BinaryOperator(
+                    Expression::Select(LimitedSelector::default().into()).into(),
+                    BinaryOperator::Plus,
+                    Expression::Int(0).into(),
+                ),
+            }],
+        }]))
+    }
+
+    /// Constructs a graph with one stack frame and two pointer variables,
+    /// `p` and `q`, with the provided values.
+    fn test_graph(p: u64, q: u64) -> (GdbStateGraph, VariableHandle, VariableHandle) {
+        let mut graph = GdbStateGraph::empty();
+        let mut insert_pointer = |name: &str, value: u64| {
+            let node = GdbStateNode {
+                type_class: NodeTypeClass::Ref,
+                type_name: None,
+                successors: Vec::new(),
+                value: Some(NodeValue::Uint(value)),
+            };
+            let variable =
+                GdbStateNodeForVariable::new(node, VariableObject(name.to_owned()), None);
+            graph.variables.insert(variable)
+        };
+        let p_handle = insert_pointer("p", p);
+        let q_handle = insert_pointer("q", q);
+        let frame = GdbStateNode {
+            type_class: NodeTypeClass::Frame,
+            type_name: None,
+            successors: vec![
+                (
+                    EdgeLabel::Named("p".into(), 0),
+                    GdbStateNodeId::VarObject(p_handle),
+                ),
+                (
+                    EdgeLabel::Named("q".into(), 0),
+                    GdbStateNodeId::VarObject(q_handle),
+                ),
+            ],
+            value: None,
+        };
+        graph.stack_trace.push(frame);
+        graph
+            .root_node
+            .successors
+            .push((EdgeLabel::Main, GdbStateNodeId::Frame(0)));
+        (graph, p_handle, q_handle)
+    }
+
+    #[test]
+    fn unchanged_subtrees_are_replayed() {
+        let stylesheet = hint_sheet();
+        let (mut graph, p, _) = test_graph(5, 7);
+        let mut cache = LengthHintCache::default();
+        let snapshots = cache.resolve(&graph, &stylesheet, &HashSet::new(), []);
+        assert_eq!(cache.hints(), [(p, NodeValue::Uint(5).into())]);
+        assert!(snapshots.contains_key(&p));
+        // The change is not reported, so the cached hint should be replayed
+        graph.variables.get_mut(p).unwrap().value = Some(NodeValue::Uint(6));
+        let snapshots = cache.resolve(&graph, &stylesheet, &HashSet::new(), []);
+        assert_eq!(cache.hints(), [(p, NodeValue::Uint(5).into())]);
+        assert!(snapshots.is_empty());
+        // Once it is reported, the hint should be evaluated again
+        let changed_nodes = HashSet::from([GdbStateNodeId::VarObject(p)]);
+        let snapshots = cache.resolve(&graph, &stylesheet, &changed_nodes, []);
+        assert_eq!(cache.hints(), [(p, NodeValue::Uint(6).into())]);
+        assert!(snapshots.contains_key(&p));
+    }
+
+    #[test]
+    fn changes_after_resolution_are_evaluated_again() {
+        let stylesheet = hint_sheet();
+        let (mut graph, p, _) = test_graph(5, 7);
+        let mut cache = LengthHintCache::default();
+        cache.resolve(&graph, &stylesheet, &HashSet::new(), []);
+        graph.variables.get_mut(p).unwrap().value = Some(NodeValue::Uint(6));
+        cache.mark_changed(HashSet::from([GdbStateNodeId::VarObject(p)]));
+        cache.resolve(&graph, &stylesheet, &HashSet::new(), []);
+        assert_eq!(cache.hints(), [(p, NodeValue::Uint(6).into())]);
+    }
+
+    #[test]
+    fn pointers_that_need_snapshots_are_visited_again() {
+        let stylesheet = hint_sheet();
+        let (graph, p, q) = test_graph(5, 7);
+        let mut cache = LengthHintCache::default();
+        cache.resolve(&graph, &stylesheet, &HashSet::new(), []);
+        let snapshots = cache.resolve(&graph, &stylesheet, &HashSet::new(), [q]);
+        assert!(snapshots.contains_key(&q));
+        assert_eq!(cache.hints(), [(p, NodeValue::Uint(5).into())]);
+    }
+}
@@ -1,7 +1,10 @@
 //! User-provided hints to help deduce whether each pointer
 //! points to an array or a single object.
 
-use aili_style::stylesheet::RawPropertyKey;
+use aili_style::{
+    cascade::{BinaryFormat, BinaryFormatError, BinaryReader, BinaryWriter},
+    stylesheet::RawPropertyKey,
+};
 use derive_more::{Debug, Display, Error};
 
 /// [`aili_style::stylesheet::PropertyKey`] to a length hint sheet.
@@ -12,6 +15,20 @@ pub enum PointerLengthHintKey {
     Length,
 }
 
+impl BinaryFormat for PointerLengthHintKey {
+    fn write(&self, writer: &mut BinaryWriter) {
+        match self {
+            Self::Length => writer.write_tag(0),
+        }
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        match reader.read_tag()? {
+            0 => Ok(Self::Length),
+            tag => Err(BinaryFormatError::InvalidTag(tag)),
+        }
+    }
+}
+
 /// Error type emited when an unrecognized key is passed
 /// to [`PointerLengthHintKey`].
 #[derive(Clone, PartialEq, Eq, Debug, Display, Error)]
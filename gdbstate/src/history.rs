@@ -0,0 +1,461 @@
+//! Bounded history of the states of a [`GdbStateGraph`].
+//!
+//! Each version of the graph is kept as a read-only [`StateSnapshot`]
+//! that shares all unchanged nodes with the previous version,
+//! so keeping a version costs memory proportional to the changes
+//! made by the update that produced it, rather than to the size of the graph.
+
+use crate::state::{GdbStateGraph, GdbStateNode, GdbStateNodeId, VariableHandle};
+use aili_model::state::{ProgramStateGraph, RootedProgramStateGraph};
+use std::{
+    collections::{HashSet, VecDeque},
+    sync::Arc,
+};
+
+/// Bounded sequence of past states of a [`GdbStateGraph`],
+/// obtained from [`GdbStateGraph::history`].
+///
+/// A new version is recorded by every update of the graph.
+/// Once the history is full, the oldest version is forgotten.
+#[derive(Clone, Debug)]
+pub struct StateHistory {
+    /// Recorded versions, from the oldest to the newest.
+    versions: VecDeque<StateSnapshot>,
+
+    /// Maximum number of versions that are kept.
+    capacity: usize,
+
+    /// Nodes changed by updates that have not been recorded as versions,
+    /// which the next recorded version must not share with the previous one.
+    unrecorded_changes: HashSet<GdbStateNodeId>,
+}
+
+impl StateHistory {
+    /// Constructs a history whose first version is the current state of a graph.
+    pub(crate) fn new(graph: &GdbStateGraph, capacity: usize) -> Self {
+        let mut versions = VecDeque::new();
+        versions.push_back(StateSnapshot::capture(graph, 0));
+        Self {
+            versions,
+            capacity: capacity.max(1),
+            unrecorded_changes: HashSet::new(),
+        }
+    }
+
+    /// Records a new version of a graph, given the nodes that have changed
+    /// since the previous version.
+    pub(crate) fn record(
+        &mut self,
+        graph: &GdbStateGraph,
+        changed_nodes: &HashSet<GdbStateNodeId>,
+    ) {
+        let snapshot = if self.unrecorded_changes.is_empty() {
+            self.latest().advance(graph, changed_nodes)
+        } else {
+            let mut all_changes = std::mem::take(&mut self.unrecorded_changes);
+            all_changes.extend(changed_nodes.iter().cloned());
+            self.latest().advance(graph, &all_changes)
+        };
+        if self.versions.len() >= self.capacity {
+            self.versions.pop_front();
+        }
+        self.versions.push_back(snapshot);
+    }
+
+    /// Records nodes changed by an update that does not produce a new version.
+    ///
+    /// They are treated as changed by the next recorded version.
+    pub(crate) fn skip(&mut self, changed_nodes: &HashSet<GdbStateNodeId>) {
+        self.unrecorded_changes
+            .extend(changed_nodes.iter().cloned());
+    }
+
+    /// Maximum number of versions that are kept.
+    pub fn capacity(&self) -> usize {
+        self.capacity
+    }
+
+    /// Number of versions that are kept.
+    pub fn len(&self) -> usize {
+        self.versions.len()
+    }
+
+    /// Checks whether there are no versions.
+    ///
+    /// The current state is always recorded, so this is never true.
+    pub fn is_empty(&self) -> bool {
+        self.versions.is_empty()
+    }
+
+    /// Gets the most recent version, which reflects the current state of the graph.
+    pub fn latest(&self) -> &StateSnapshot {
+        self.versions
+            .back()
+            .expect("History always contains the current version")
+    }
+
+    /// Gets the oldest version that is still kept.
+    pub fn oldest(&self) -> &StateSnapshot {
+        self.versions
+            .front()
+            .expect("History always contains the current version")
+    }
+
+    /// Gets a version by its [number](StateSnapshot::version),
+    /// if it is still kept.
+    pub fn get(&self, version: usize) -> Option<&StateSnapshot> {
+        self.versions
+            .get(version.checked_sub(self.oldest().version)?)
+    }
+
+    /// Iterates over all versions that are kept, from the oldest to the newest.
+    pub fn iter(&self) -> impl DoubleEndedIterator<Item = &StateSnapshot> {
+        self.versions.iter()
+    }
+
+    /// Collects the nodes that differ between two versions.
+    ///
+    /// The result can be used to update a stylesheet application
+    /// incrementally from one version to the other, in either direction.
+    ///
+    /// ## Return Value
+    /// The nodes that have been added, removed or modified by the updates
+    /// between the versions, or [`None`] if either of them is no longer kept.
+    pub fn changes_between(&self, from: usize, to: usize) -> Option<HashSet<GdbStateNodeId>> {
+        let (first, last) = (from.min(to), from.max(to));
+        self.get(first)?;
+        self.get(last)?;
+        Some(
+            ((first + 1)..=last)
+                .filter_map(|version| self.get(version))
+                .flat_map(|snapshot| snapshot.changes.iter().cloned())
+                .collect(),
+        )
+    }
+}
+
+/// Read-only state of a [`GdbStateGraph`] at one point of its [`StateHistory`].
+///
+/// Snapshots share their nodes with other versions,
+/// so they are cheap to clone.
+#[derive(Clone, Debug)]
+pub struct StateSnapshot {
+    /// Sequential number of the version.
+    version: usize,
+
+    /// The root node.
+    root_node: Arc<GdbStateNode>,
+
+    /// Stack frame nodes.
+    stack_trace: Arc<[GdbStateNode]>,
+
+    /// Variable nodes, indexed by their handles.
+    variables: SharedVariables,
+
+    /// Nodes that changed between the previous version and this one.
+    changes: Arc<HashSet<GdbStateNodeId>>,
+}
+
+impl StateSnapshot {
+    /// Sequential number of the version within its history.
+    ///
+    /// Numbers keep increasing as versions are recorded,
+    /// even after older versions have been forgotten.
+    pub fn version(&self) -> usize {
+        self.version
+    }
+
+    /// Nodes that have been added, removed or modified
+    /// between the previous version and this one.
+    pub fn changes(&self) -> &HashSet<GdbStateNodeId> {
+        &self.changes
+    }
+
+    /// Copies the whole state of a graph.
+    fn capture(graph: &GdbStateGraph, version: usize) -> Self {
+        let mut variables = SharedVariables::default();
+        for (handle, variable) in graph.variables.iter() {
+            variables.set(handle, Some(VariableSnapshot::new(variable)));
+        }
+        Self {
+            version,
+            root_node: Arc::new(graph.root_node.clone()),
+            stack_trace: graph.stack_trace.as_slice().into(),
+            variables,
+            changes: Default::default(),
+        }
+    }
+
+    /// Derives the next version from this one,
+    /// only copying the nodes that have changed.
+    fn advance(&self, graph: &GdbStateGraph, changed_nodes: &HashSet<GdbStateNodeId>) -> Self {
+        let mut variables = self.variables.clone();
+        let changed_variables = HashSet::<VariableHandle>::from_iter(
+            changed_nodes
+                .iter()
+                .filter_map(GdbStateNodeId::variable_handle),
+        );
+        for handle in changed_variables {
+            variables.set(
+                handle,
+                graph.variables.get(handle).map(VariableSnapshot::new),
+            );
+        }
+        // There are few frames, so they are copied together
+        let frames_changed = graph.stack_trace.len() != self.stack_trace.len()
+            || changed_nodes
+                .iter()
+                .any(|id| matches!(id, GdbStateNodeId::Root | GdbStateNodeId::Frame(_)));
+        let (root_node, stack_trace) = if frames_changed {
+            (
+                Arc::new(graph.root_node.clone()),
+                graph.stack_trace.as_slice().into(),
+            )
+        } else {
+            (self.root_node.clone(), self.stack_trace.clone())
+        };
+        Self {
+            version: self.version + 1,
+            root_node,
+            stack_trace,
+            variables,
+            changes: Arc::new(changed_nodes.clone()),
+        }
+    }
+}
+
+impl ProgramStateGraph for StateSnapshot {
+    type NodeId = GdbStateNodeId;
+    type NodeRef<'a>
+        = &'a GdbStateNode
+    where
+        Self: 'a;
+    fn get(&self, id: &Self::NodeId) -> Option<Self::NodeRef<'_>> {
+        match id {
+            GdbStateNodeId::Root => Some(&self.root_node),
+            GdbStateNodeId::Frame(i) => self.stack_trace.get(*i),
+            GdbStateNodeId::VarObject(v) => self.variables.get(*v).map(|v| &v.node),
+            GdbStateNodeId::Length(v) => self.variables.get(*v)?.length_node.as_ref(),
+            GdbStateNodeId::ArrayElement(v, i) => self.variables.get(*v)?.elements.get(*i),
+            GdbStateNodeId::Truncated(v) => self.variables.get(*v)?.truncation_node.as_ref(),
+        }
+    }
+}
+
+impl RootedProgramStateGraph for StateSnapshot {
+    fn root(&self) -> Self::NodeId {
+        GdbStateNodeId::Root
+    }
+}
+
+/// Nodes of a single variable, as they are kept in a [`StateSnapshot`].
+#[derive(Debug)]
+struct VariableSnapshot {
+    /// The variable node itself.
+    node: GdbStateNode,
+
+    /// The [`EdgeLabel::Length`](aili_model::state::EdgeLabel::Length)
+    /// pseudo-node of an array, if present.
+    length_node: Option<GdbStateNode>,
+
+    /// Elements of an array that has been read from memory in bulk.
+    elements: Vec<GdbStateNode>,
+
+    /// The [`NodeTypeClass::Truncated`](aili_model::state::NodeTypeClass::Truncated)
+    /// pseudo-node, if present.
+    truncation_node: Option<GdbStateNode>,
+}
+
+impl VariableSnapshot {
+    /// Copies the nodes of a variable.
+    fn new(variable: &crate::state::GdbStateNodeForVariable) -> Self {
+        Self {
+            node: variable.node.clone(),
+            length_node: variable.length_node.clone(),
+            elements: variable
+                .bulk_array
+                .as_ref()
+                .map(|array| array.elements.clone())
+                .unwrap_or_default(),
+            truncation_node: variable.truncation_node.clone(),
+        }
+    }
+}
+
+/// Persistent vector of variable nodes, indexed by their handles.
+///
+/// Variables are stored in fixed-size chunks that are shared between
+/// clones of the vector. Modifying a variable only copies the chunk
+/// that contains it, so a version that differs from the previous one
+/// in a few variables only costs a few chunks.
+#[derive(Clone, Debug, Default)]
+struct SharedVariables(Vec<Arc<Vec<Option<Arc<VariableSnapshot>>>>>);
+
+impl SharedVariables {
+    /// Number of variables in a chunk.
+    const CHUNK_SIZE: usize = 64;
+
+    /// Accesses a variable by its handle.
+    fn get(&self, handle: VariableHandle) -> Option<&VariableSnapshot> {
+        let index = handle.index();
+        self.0
+            .get(index / Self::CHUNK_SIZE)?
+            .get(index % Self::CHUNK_SIZE)?
+            .as_deref()
+    }
+
+    /// Replaces or removes a variable.
+    fn set(&mut self, handle: VariableHandle, variable: Option<VariableSnapshot>) {
+        let index = handle.index();
+        let chunk = index / Self::CHUNK_SIZE;
+        if chunk >= self.0.len() {
+            if variable.is_none() {
+                return;
+            }
+            self.0
+                .resize_with(chunk + 1, || Arc::new(vec![None; Self::CHUNK_SIZE]));
+        }
+        Arc::make_mut(&mut self.0[chunk])[index % Self::CHUNK_SIZE] = variable.map(Arc::new);
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use crate::{gdbmi::types::VariableObject, state::GdbStateNodeForVariable};
+    use aili_model::state::{EdgeLabel, NodeTypeClass, NodeValue, ProgramStateNode};
+
+    fn atom(value: i64) -> GdbStateNode {
+        let mut node = GdbStateNode::new(NodeTypeClass::Atom);
+        node.value = Some(NodeValue::Int(value));
+        node
+    }
+
+    /// Graph with a frame of `main` that has a number of local variables.
+    fn test_graph(values: &[i64]) -> GdbStateGraph {
+        let mut graph = GdbStateGraph::empty();
+        let mut frame = GdbStateNode::new(NodeTypeClass::Frame);
+        for (i, value) in values.iter().enumerate() {
+            let variable = GdbStateNodeForVariable::new(
+                atom(*value),
+                VariableObject(format!("var{i}")),
+                Some(GdbStateNodeId::Frame(0)),
+            );
+            let handle = graph.variables.insert(variable);
+            frame.successors.push((
+                EdgeLabel::Named(format!("x{i}").into(), 0),
+                GdbStateNodeId::VarObject(handle),
+            ));
+        }
+        graph
+            .root_node
+            .successors
+            .push((EdgeLabel::Main, GdbStateNodeId::Frame(0)));
+        graph.stack_trace.push(frame);
+        graph
+    }
+
+    fn value_at(graph: &impl ProgramStateGraph<NodeId = GdbStateNodeId>, i: usize) -> i64 {
+        let frame = graph.get(&GdbStateNodeId::Frame(0)).unwrap();
+        let id = frame
+            .get_successor(&EdgeLabel::Named(format!("x{i}").into(), 0))
+            .unwrap();
+        match graph.get(&id).unwrap().value() {
+            Some(NodeValue::Int(value)) => value,
+            value => panic!("Unexpected value {value:?}"),
+        }
+    }
+
+    fn set_value(graph: &mut GdbStateGraph, i: usize, value: i64) -> GdbStateNodeId {
+        let id = GdbStateNodeId::VarObject(graph.variables.iter().nth(i).unwrap().0);
+        graph.get_mut(&id).unwrap().value = Some(NodeValue::Int(value));
+        id
+    }
+
+    #[test]
+    fn past_versions_are_kept() {
+        let mut graph = test_graph(&[1, 2, 3]);
+        let mut history = StateHistory::new(&graph, 8);
+        let changed = set_value(&mut graph, 1, 20);
+        history.record(&graph, &HashSet::from([changed.clone()]));
+        assert_eq!(history.len(), 2);
+        let old = history.get(0).unwrap();
+        let new = history.latest();
+        assert_eq!(value_at(old, 1), 2);
+        assert_eq!(value_at(new, 1), 20);
+        assert_eq!(value_at(new, 2), 3);
+        assert_eq!(new.changes(), &HashSet::from([changed.clone()]));
+        assert_eq!(
+            history.changes_between(1, 0),
+            Some(HashSet::from([changed]))
+        );
+    }
+
+    #[test]
+    fn unchanged_nodes_are_shared() {
+        let values = Vec::from_iter(0..200);
+        let mut graph = test_graph(&values);
+        let mut history = StateHistory::new(&graph, 8);
+        let changed = set_value(&mut graph, 150, -1);
+        history.record(&graph, &HashSet::from([changed]));
+        let (old, new) = (history.oldest(), history.latest());
+        assert!(Arc::ptr_eq(&old.stack_trace, &new.stack_trace));
+        let shared_chunks = old
+            .variables
+            .0
+            .iter()
+            .zip(&new.variables.0)
+            .filter(|(a, b)| Arc::ptr_eq(a, b))
+            .count();
+        assert_eq!(shared_chunks, old.variables.0.len() - 1);
+    }
+
+    #[test]
+    fn skipped_changes_are_not_shared() {
+        let mut graph = test_graph(&[1, 2]);
+        let mut history = StateHistory::new(&graph, 8);
+        let skipped = set_value(&mut graph, 0, 10);
+        history.skip(&HashSet::from([skipped]));
+        assert_eq!(history.len(), 1);
+        let changed = set_value(&mut graph, 1, 20);
+        history.record(&graph, &HashSet::from([changed]));
+        let new = history.latest();
+        assert_eq!(value_at(new, 0), 10);
+        assert_eq!(value_at(new, 1), 20);
+        assert_eq!(value_at(history.oldest(), 0), 1);
+    }
+
+    #[test]
+    fn oldest_versions_are_forgotten() {
+        let mut graph = test_graph(&[0]);
+        let mut history = StateHistory::new(&graph, 3);
+        for value in 1..=4 {
+            let changed = set_value(&mut graph, 0, value);
+            history.record(&graph, &HashSet::from([changed]));
+        }
+        assert_eq!(history.len(), 3);
+        assert_eq!(history.oldest().version(), 2);
+        assert_eq!(history.latest().version(), 4);
+        assert!(history.get(1).is_none());
+        assert_eq!(value_at(history.get(3).unwrap(), 0), 3);
+        assert!(history.changes_between(1, 4).is_none());
+        assert_eq!(history.changes_between(2, 4).map(|c| c.len()), Some(1));
+    }
+
+    #[test]
+    fn removed_variables_are_missing_from_new_versions() {
+        let mut graph = test_graph(&[1, 2]);
+        let mut history = StateHistory::new(&graph, 8);
+        let handle = graph.variables.iter().nth(1).unwrap().0;
+        graph.variables.remove(handle);
+        graph.stack_trace[0].successors.pop();
+        history.record(
+            &graph,
+            &HashSet::from([GdbStateNodeId::VarObject(handle), GdbStateNodeId::Frame(0)]),
+        );
+        let id = GdbStateNodeId::VarObject(handle);
+        assert!(history.oldest().get(&id).is_some());
+        assert!(history.latest().get(&id).is_none());
+        assert_eq!(value_at(history.oldest(), 1), 2);
+    }
+}
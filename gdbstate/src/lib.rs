@@ -1,6 +1,11 @@
 #![doc = include_str!("../README.md")]
 
+mod address_map;
+pub mod changes;
 mod construct;
 pub mod gdbmi;
+mod hint_cache;
 pub mod hints;
+pub mod history;
+pub mod reachability;
 pub mod state;
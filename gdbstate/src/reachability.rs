@@ -0,0 +1,70 @@
+//! Stylesheets that limit which parts of the program's memory
+//! need to be explored.
+
+use aili_style::{
+    cascade::{CascadeSelector, CascadeStyle},
+    stylesheet::{PropertyKey, StyleKey, expression::Expression},
+};
+use derive_more::Debug;
+
+/// Key-independent view of a stylesheet that determines which pointers
+/// of a [`GdbStateGraph`](crate::state::GdbStateGraph) are worth dereferencing.
+///
+/// A pointer is only dereferenced if some selector of the stylesheet
+/// may still match something past the pointer's [`Deref`](aili_model::state::EdgeLabel::Deref)
+/// edge. This is usually the stylesheet that will be applied to the graph,
+/// so that only the memory that ends up being visualized is read.
+#[derive(Debug)]
+pub struct ReachabilitySheet<'a> {
+    /// Compiled selectors of the stylesheet.
+    #[debug(skip)]
+    selectors: &'a CascadeSelector,
+
+    /// Variables assigned by each rule of the stylesheet
+    /// along with the expressions of their values.
+    ///
+    /// Selectors may refer to variables in their conditions,
+    /// so these must be resolved to evaluate the selectors.
+    variables: Vec<Vec<(&'a str, &'a Expression)>>,
+}
+
+impl<'a> ReachabilitySheet<'a> {
+    /// Constructs a reachability sheet from a stylesheet.
+    pub fn new<K: PropertyKey>(stylesheet: &'a CascadeStyle<K>) -> Self {
+        let variables = stylesheet
+            .rules()
+            .iter()
+            .map(|rule| {
+                if rule.extra_label.is_some() {
+                    // Extra entities get their own variable scope,
+                    // so their variables can never affect the selectors
+                    return Vec::new();
+                }
+                rule.properties
+                    .iter()
+                    .filter_map(|property| match &property.key {
+                        StyleKey::Variable(name) => Some((name.as_str(), &*property.value)),
+                        StyleKey::Property(_) => None,
+                    })
+                    .collect()
+            })
+            .collect();
+        Self {
+            selectors: stylesheet.selector_machine(),
+            variables,
+        }
+    }
+
+    /// Gets the compiled selectors of the stylesheet.
+    pub(crate) fn selector_machine(&self) -> &'a CascadeSelector {
+        self.selectors
+    }
+
+    /// Gets the variables assigned by a rule at a specified index.
+    ///
+    /// All indices exposed by [`ReachabilitySheet::selector_machine`]
+    /// are valid.
+    pub(crate) fn variables_at(&self, rule_index: usize) -> &[(&'a str, &'a Expression)] {
+        &self.variables[rule_index]
+    }
+}
@@ -1,10 +1,17 @@
 //! Implementation of [`ProgramStateGraph`] backed by a GDB session.
 
-use crate::gdbmi::types::VariableObject;
+pub(crate) use crate::address_map::{AddressMap, AddressRange};
+use crate::{
+    changes::ChangeLog, gdbmi::types::VariableObject, hint_cache::LengthHintCache,
+    history::StateHistory,
+};
 use aili_model::state::*;
 use aili_style::values::PropertyValue;
 use derive_more::{Debug, Deref, DerefMut};
-use std::collections::{BTreeMap, HashMap};
+use std::{
+    collections::{HashMap, HashSet, VecDeque},
+    sync::Arc,
+};
 
 /// Identifiers of state nodes used by [`GdbStateGraph`].
 #[derive(Clone, PartialEq, Eq, PartialOrd, Ord, Debug, Hash)]
@@ -19,13 +26,53 @@ pub enum GdbStateNodeId {
 
     /// Identifier of a node backed by a
     /// [GDB/MI variable object](https://sourceware.org/gdb/current/onlinedocs/gdb.html/GDB_002fMI-Variable-Objects.html).
-    #[debug("var({:?})", _0.0)]
-    VarObject(VariableObject),
+    #[debug("var({_0:?})")]
+    VarObject(VariableHandle),
 
     /// Identifier of the [`EdgeLabel::Length`] pseudo-node
     /// associated with a [`GdbStateNodeId::VarObject`] node.
-    #[debug("var({:?}) len", _0.0)]
-    Length(VariableObject),
+    #[debug("var({_0:?}) len")]
+    Length(VariableHandle),
+
+    /// Identifier of an element of a [`GdbStateNodeId::VarObject`] array
+    /// that has been read from memory in bulk and has no variable object.
+    #[debug("var({_0:?})[{_1}]")]
+    ArrayElement(VariableHandle, usize),
+
+    /// Identifier of the [`NodeTypeClass::Truncated`] pseudo-node
+    /// that stands in for the omitted successors
+    /// of a [`GdbStateNodeId::VarObject`] node.
+    #[debug("var({_0:?}) trunc")]
+    Truncated(VariableHandle),
+}
+
+/// Dense handle to a variable node of a [`GdbStateGraph`].
+///
+/// Handles are only meaningful within the graph that issued them.
+/// The handle of a removed variable may be reused by a variable
+/// that is created later.
+#[derive(Clone, Copy, PartialEq, Eq, PartialOrd, Ord, Debug, Hash)]
+#[debug("{_0}")]
+pub struct VariableHandle(u32);
+
+impl VariableHandle {
+    /// Position of the variable in dense storage.
+    pub(crate) fn index(self) -> usize {
+        self.0 as usize
+    }
+}
+
+impl GdbStateNodeId {
+    /// Gets the handle of the variable that owns the node, if any.
+    pub fn variable_handle(&self) -> Option<VariableHandle> {
+        match self {
+            Self::Root | Self::Frame(_) => None,
+            Self::VarObject(v)
+            | Self::Length(v)
+            | Self::ArrayElement(v, _)
+            | Self::Truncated(v) => Some(*v),
+        }
+    }
 }
 
 /// Implementation of a [`ProgramStateGraph`] backed by a GDB session.
@@ -33,10 +80,27 @@ pub enum GdbStateNodeId {
 pub struct GdbStateGraph {
     pub(crate) root_node: GdbStateNode,
     pub(crate) stack_trace: Vec<GdbStateNode>,
-    pub(crate) variables: HashMap<VariableObject, GdbStateNodeForVariable>,
-    pub(crate) length_nodes: HashMap<VariableObject, GdbStateNode>,
-    pub(crate) address_mapping: BTreeMap<u64, VariableObject>,
-    pub(crate) resolved_length_hints: HashMap<VariableObject, PropertyValue<GdbStateNodeId>>,
+    pub(crate) stack_frame_addresses: Vec<Option<u64>>,
+    pub(crate) popped_frames: VecDeque<PoppedStackFrame>,
+    pub(crate) popped_frame_cache_size: usize,
+    pub(crate) variables: VariableArena,
+    pub(crate) type_names: HashSet<Arc<str>>,
+    pub(crate) address_mapping: AddressMap,
+    pub(crate) struct_layouts: HashMap<Arc<str>, Arc<[MemberLayout]>>,
+    pub(crate) type_sizes: HashMap<Arc<str>, u64>,
+    pub(crate) scalar_layouts: HashMap<Arc<str>, Option<ScalarLayout>>,
+    pub(crate) resolved_length_hints: HashMap<VariableHandle, PropertyValue<GdbStateNodeId>>,
+    pub(crate) length_hint_cache: LengthHintCache,
+    pub(crate) pending_dereferences: HashSet<VariableHandle>,
+    pub(crate) changed_nodes: HashSet<GdbStateNodeId>,
+    pub(crate) change_log: ChangeLog,
+    pub(crate) expansion_batch_size: usize,
+    pub(crate) bulk_read_min_length: Option<usize>,
+    pub(crate) budget: ConstructionBudget,
+    pub(crate) target_endianness: Option<Endianness>,
+    pub(crate) endianness_setting_read: bool,
+    pub(crate) statistics: UpdateStatistics,
+    pub(crate) history: Option<StateHistory>,
 }
 
 impl ProgramStateGraph for GdbStateGraph {
@@ -49,8 +113,16 @@ impl ProgramStateGraph for GdbStateGraph {
         match id {
             GdbStateNodeId::Root => Some(&self.root_node),
             GdbStateNodeId::Frame(i) => self.stack_trace.get(*i),
-            GdbStateNodeId::VarObject(v) => self.variables.get(v).map(|v| &v.node),
-            GdbStateNodeId::Length(v) => self.length_nodes.get(v),
+            GdbStateNodeId::VarObject(v) => self.variables.get(*v).map(|v| &v.node),
+            GdbStateNodeId::Length(v) => self.variables.get(*v)?.length_node.as_ref(),
+            GdbStateNodeId::ArrayElement(v, i) => self
+                .variables
+                .get(*v)?
+                .bulk_array
+                .as_ref()?
+                .elements
+                .get(*i),
+            GdbStateNodeId::Truncated(v) => self.variables.get(*v)?.truncation_node.as_ref(),
         }
     }
 }
@@ -62,22 +134,168 @@ impl RootedProgramStateGraph for GdbStateGraph {
 }
 
 impl GdbStateGraph {
+    /// Default value of [`GdbStateGraph::set_expansion_batch_size`].
+    pub const DEFAULT_EXPANSION_BATCH_SIZE: usize = 32;
+
+    /// Sets the maximum number of variables whose children
+    /// are requested from GDB in a single batch.
+    ///
+    /// Variable trees are constructed one level at a time,
+    /// and the children of all variables on a level are requested
+    /// in batches of this size. With a stream that supports pipelining,
+    /// this is the number of commands that GDB may be processing at once.
+    ///
+    /// The size does not affect the resulting graph.
+    /// Values less than one are treated as one.
+    ///
+    /// To configure the initial construction of a graph, set the size
+    /// on an [empty](GdbStateGraph::empty) graph and then
+    /// [update](GdbStateGraph::update_with_hints) it.
+    pub fn set_expansion_batch_size(&mut self, batch_size: usize) {
+        self.expansion_batch_size = batch_size.max(1);
+    }
+
+    /// Default value of [`GdbStateGraph::set_bulk_read_min_length`].
+    pub const DEFAULT_BULK_READ_MIN_LENGTH: Option<usize> = Some(16);
+
+    /// Sets the minimum length of arrays of scalars
+    /// whose contents are read from memory in bulk.
+    ///
+    /// Elements of such arrays are not backed by variable objects.
+    /// Instead, the whole array is read with a single command,
+    /// and its elements are decoded directly, which makes large arrays
+    /// much cheaper to construct and update. Arrays of other types,
+    /// and arrays whose memory cannot be read, are always constructed
+    /// from variable objects.
+    ///
+    /// [`None`] disables bulk reads altogether.
+    ///
+    /// To configure the initial construction of a graph, set the length
+    /// on an [empty](GdbStateGraph::empty) graph and then
+    /// [update](GdbStateGraph::update_with_hints) it.
+    pub fn set_bulk_read_min_length(&mut self, min_length: Option<usize>) {
+        self.bulk_read_min_length = min_length;
+    }
+
+    /// Sets the limits on how much of the program's state
+    /// is read when the graph is constructed or updated.
+    ///
+    /// Values that are left out because of the limits are replaced
+    /// with [`NodeTypeClass::Truncated`] nodes. Dereferences that have been
+    /// left out are attempted again on each update, so they may
+    /// be filled in once there is room for them.
+    ///
+    /// To configure the initial construction of a graph, set the budget
+    /// on an [empty](GdbStateGraph::empty) graph and then
+    /// [update](GdbStateGraph::update_with_hints) it.
+    pub fn set_construction_budget(&mut self, budget: ConstructionBudget) {
+        self.budget = budget;
+    }
+
+    /// Default value of [`GdbStateGraph::set_popped_frame_cache_size`].
+    pub const DEFAULT_POPPED_FRAME_CACHE_SIZE: usize = 8;
+
+    /// Sets the maximum number of recently popped stack frames
+    /// whose local variables are kept.
+    ///
+    /// When a function returns, the variable objects of its locals are set aside
+    /// instead of being deleted. If the same function is called again
+    /// with the same frame address, which is common with recursion,
+    /// the locals are restored and only updated, rather than being
+    /// constructed again from scratch.
+    ///
+    /// The size does not affect the resulting graph.
+    /// Zero disables the cache. If the size is reduced, the frames that
+    /// no longer fit are discarded on the next update.
+    pub fn set_popped_frame_cache_size(&mut self, cache_size: usize) {
+        self.popped_frame_cache_size = cache_size;
+    }
+
+    /// Takes the set of nodes that have been added, removed or modified
+    /// since the graph was constructed or since the last call to this function.
+    ///
+    /// The set can be used to update a stylesheet application incrementally.
+    /// If the graph has more than one consumer, each of them should use
+    /// [`GdbStateGraph::changed_nodes_since`] instead, since this takes
+    /// the changes away from everyone.
+    pub fn take_changed_nodes(&mut self) -> HashSet<GdbStateNodeId> {
+        std::mem::take(&mut self.changed_nodes)
+    }
+
+    /// Discards the results of length hint resolution
+    /// that are kept between updates.
+    ///
+    /// Updates only resolve the hint sheet again in the parts of the graph
+    /// that have changed, which is only valid if it is the same hint sheet.
+    /// This must be called before the graph is updated with a different one.
+    pub fn discard_length_hint_cache(&mut self) {
+        self.length_hint_cache.clear();
+    }
+
+    /// Counters of the work done by the last construction or update of the graph.
+    pub fn update_statistics(&self) -> &UpdateStatistics {
+        &self.statistics
+    }
+
+    /// Starts keeping past states of the graph.
+    ///
+    /// The current state becomes the first version of the history
+    /// and every update records a new one. At most `capacity` versions
+    /// are kept, older ones are forgotten.
+    ///
+    /// If the history is already enabled, it is discarded and started anew.
+    pub fn enable_history(&mut self, capacity: usize) {
+        self.history = Some(StateHistory::new(self, capacity));
+    }
+
+    /// Stops keeping past states of the graph and discards them.
+    pub fn disable_history(&mut self) {
+        self.history = None;
+    }
+
+    /// Past states of the graph, if [enabled](GdbStateGraph::enable_history).
+    pub fn history(&self) -> Option<&StateHistory> {
+        self.history.as_ref()
+    }
+
     /// Get a mutable reference to a state node by its ID.
     pub(crate) fn get_mut(&mut self, id: &GdbStateNodeId) -> Option<&mut GdbStateNode> {
         match id {
             GdbStateNodeId::Root => Some(&mut self.root_node),
             GdbStateNodeId::Frame(i) => self.stack_trace.get_mut(*i),
-            GdbStateNodeId::VarObject(v) => self.variables.get_mut(v).map(|v| &mut v.node),
-            GdbStateNodeId::Length(v) => self.length_nodes.get_mut(v),
+            GdbStateNodeId::VarObject(v) => self.variables.get_mut(*v).map(|v| &mut v.node),
+            GdbStateNodeId::Length(v) => self.variables.get_mut(*v)?.length_node.as_mut(),
+            GdbStateNodeId::ArrayElement(v, i) => self
+                .variables
+                .get_mut(*v)?
+                .bulk_array
+                .as_mut()?
+                .elements
+                .get_mut(*i),
+            GdbStateNodeId::Truncated(v) => self.variables.get_mut(*v)?.truncation_node.as_mut(),
+        }
+    }
+
+    /// Retrieves a shared copy of a type name.
+    ///
+    /// Type names repeat a lot across nodes, so each distinct name
+    /// is only stored once.
+    pub(crate) fn intern_type_name(&mut self, type_name: String) -> Arc<str> {
+        if let Some(interned) = self.type_names.get(type_name.as_str()) {
+            interned.clone()
+        } else {
+            let interned = Arc::<str>::from(type_name);
+            self.type_names.insert(interned.clone());
+            interned
         }
     }
 }
 
 /// Node of a [`GdbStateGraph`].
-#[derive(Debug)]
+#[derive(Clone, Debug)]
 pub struct GdbStateNode {
     pub(crate) type_class: NodeTypeClass,
-    pub(crate) type_name: Option<String>,
+    pub(crate) type_name: Option<Arc<str>>,
     pub(crate) successors: Vec<(EdgeLabel, GdbStateNodeId)>,
     pub(crate) value: Option<NodeValue>,
 }
@@ -89,6 +307,14 @@ impl ProgramStateNode for &GdbStateNode {
     where
         Self: 'a;
     fn get_successor(&self, edge: &EdgeLabel) -> Option<Self::NodeId> {
+        // Elements of arrays are stored in order of their indices,
+        // so they can be looked up directly
+        if let EdgeLabel::Index(index) = edge
+            && let Some((e, n)) = self.successors.get(*index)
+            && e == edge
+        {
+            return Some(n.clone());
+        }
         self.successors
             .iter()
             .find(|(e, _)| *e == *edge)
@@ -103,7 +329,10 @@ impl ProgramStateNode for &GdbStateNode {
             NodeTypeClass::Atom | NodeTypeClass::Struct | NodeTypeClass::Frame => {
                 self.type_name.as_deref()
             }
-            NodeTypeClass::Ref | NodeTypeClass::Root | NodeTypeClass::Array => None,
+            NodeTypeClass::Ref
+            | NodeTypeClass::Root
+            | NodeTypeClass::Array
+            | NodeTypeClass::Truncated => None,
         }
     }
     fn successors(&self) -> impl Iterator<Item = (&EdgeLabel, Self::NodeId)> {
@@ -114,6 +343,245 @@ impl ProgramStateNode for &GdbStateNode {
     }
 }
 
+/// Limits on how much of the program's state is read
+/// by a [`GdbStateGraph`].
+///
+/// [`None`] means that the respective quantity is not limited.
+/// The default budget does not limit anything.
+#[derive(Clone, Copy, PartialEq, Eq, Debug, Default)]
+pub struct ConstructionBudget {
+    /// Maximum number of variable nodes in the graph.
+    ///
+    /// Variables in scope are always included, but once the limit is reached,
+    /// their members, elements, and dereferences are left out.
+    pub max_nodes: Option<usize>,
+
+    /// Maximum number of dereferences between a variable in scope
+    /// and any node reachable from it.
+    pub max_depth: Option<usize>,
+
+    /// Maximum number of elements that are read from each array.
+    ///
+    /// The length of the array is still reported in full.
+    pub max_array_elements: Option<usize>,
+
+    /// Maximum number of new objects that are dereferenced
+    /// in a single construction or update.
+    ///
+    /// This bounds the number of commands sent to GDB by each update,
+    /// and with it, the time it takes. Dereferences that did not fit
+    /// are made by the following updates.
+    pub max_dereferences_per_update: Option<usize>,
+}
+
+/// Counters of the work done by a construction or update of a [`GdbStateGraph`],
+/// obtained from [`GdbStateGraph::update_statistics`].
+///
+/// Commands sent to GDB are not counted here, since they depend
+/// on the session. See [`CountingGdbMiStream`](crate::gdbmi::stream::CountingGdbMiStream).
+#[derive(Clone, Copy, PartialEq, Eq, Debug, Default)]
+pub struct UpdateStatistics {
+    /// Number of variable nodes that have been created,
+    /// each of which is backed by a variable object.
+    pub variables_created: usize,
+
+    /// Number of variable nodes that have been removed.
+    pub variables_removed: usize,
+
+    /// Number of local variables of popped stack frames
+    /// that have been restored instead of being created again.
+    pub variables_restored: usize,
+
+    /// Number of new objects that have been dereferenced.
+    pub dereferences: usize,
+}
+
+/// Stack frame that has been popped from [`GdbStateGraph::stack_trace`],
+/// along with the local variables that can be restored
+/// if the same frame is pushed again.
+///
+/// The variable nodes remain in [`GdbStateGraph::variables`],
+/// but they are not linked to the rest of the graph.
+#[derive(Debug)]
+pub(crate) struct PoppedStackFrame {
+    /// Name of the function that created the frame.
+    pub function: Arc<str>,
+
+    /// Base address of the frame on the stack, if it could be determined.
+    ///
+    /// Frames without an address are never restored.
+    pub frame_address: Option<u64>,
+
+    /// Local variables of the frame.
+    pub locals: Vec<PoppedLocalVariable>,
+}
+
+/// Local variable of a [`PoppedStackFrame`].
+#[derive(Debug)]
+pub(crate) struct PoppedLocalVariable {
+    /// Edge that led from the frame to the variable.
+    pub edge_label: EdgeLabel,
+
+    /// Handle to the variable node.
+    pub handle: VariableHandle,
+
+    /// Entry of the variable in [`GdbStateGraph::address_mapping`], if it had one.
+    pub address_range: Option<AddressRange>,
+
+    /// Pointers into the variable, whose dereferences
+    /// have been unlinked when the frame was popped.
+    ///
+    /// Variable objects are kept to tell whether the handles
+    /// still refer to the same pointers.
+    pub referers: Vec<(VariableHandle, VariableObject)>,
+}
+
+/// Position of a member within a structure type.
+#[derive(Clone, Debug)]
+pub(crate) struct MemberLayout {
+    /// Edge that leads from the structure to the member.
+    pub edge_label: EdgeLabel,
+
+    /// Offset of the member from the start of the structure, in bytes.
+    pub offset: u64,
+
+    /// Size of the member in bytes.
+    pub size: u64,
+}
+
+/// Array of scalars whose elements are read from memory in bulk.
+#[derive(Debug)]
+pub(crate) struct BulkScalarArray {
+    /// Address of the first element.
+    pub address: u64,
+
+    /// Memory layout of each element.
+    pub element_layout: ScalarLayout,
+
+    /// Nodes that represent the elements, in order of their indices.
+    pub elements: Vec<GdbStateNode>,
+}
+
+/// Memory layout of a scalar value.
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+pub(crate) struct ScalarLayout {
+    /// Size of the value in bytes.
+    pub size: usize,
+
+    /// How the bits of the value are interpreted.
+    pub kind: ScalarKind,
+}
+
+/// Interpretation of the bits of a scalar value.
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+pub(crate) enum ScalarKind {
+    Unsigned,
+    Signed,
+    Bool,
+}
+
+/// Byte order of values in the memory of the debuggee.
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+pub(crate) enum Endianness {
+    Little,
+    Big,
+}
+
+/// Storage of variable nodes, addressed by [`VariableHandle`]s.
+///
+/// Nodes are stored in a dense vector, so accessing a node by its handle
+/// does not require hashing. Handles of removed nodes are reused,
+/// but only after they have been [recycled](VariableArena::recycle),
+/// so that a handle never changes meaning within a single update.
+#[derive(Debug, Default)]
+pub(crate) struct VariableArena {
+    /// Variable nodes indexed by their handles, [`None`] for vacant slots.
+    slots: Vec<Option<GdbStateNodeForVariable>>,
+
+    /// Handles of all variable nodes, by their variable objects.
+    handles: HashMap<VariableObject, VariableHandle>,
+
+    /// Vacant slots that will be filled before the storage grows.
+    vacant: Vec<VariableHandle>,
+
+    /// Slots that have been vacated since the last recycling.
+    released: Vec<VariableHandle>,
+}
+
+impl VariableArena {
+    /// Inserts a variable node.
+    ///
+    /// If a node with the same variable object already exists, it is replaced
+    /// and the new node keeps its handle.
+    pub fn insert(&mut self, node: GdbStateNodeForVariable) -> VariableHandle {
+        if let Some(handle) = self.handles.get(&node.object) {
+            self.slots[handle.0 as usize] = Some(node);
+            return *handle;
+        }
+        let handle = if let Some(handle) = self.vacant.pop() {
+            self.slots[handle.0 as usize] = Some(node);
+            handle
+        } else {
+            let handle = VariableHandle(
+                self.slots
+                    .len()
+                    .try_into()
+                    .expect("Number of variables should fit into a handle"),
+            );
+            self.slots.push(Some(node));
+            handle
+        };
+        let object = self.slots[handle.0 as usize]
+            .as_ref()
+            .expect("The node was just inserted")
+            .object
+            .clone();
+        self.handles.insert(object, handle);
+        handle
+    }
+
+    /// Removes a variable node and vacates its handle.
+    pub fn remove(&mut self, handle: VariableHandle) -> Option<GdbStateNodeForVariable> {
+        let node = self.slots.get_mut(handle.0 as usize)?.take()?;
+        self.handles.remove(&node.object);
+        self.released.push(handle);
+        Some(node)
+    }
+
+    /// Makes handles of removed nodes available for reuse.
+    pub fn recycle(&mut self) {
+        self.vacant.append(&mut self.released);
+    }
+
+    /// Accesses a variable node by its handle.
+    pub fn get(&self, handle: VariableHandle) -> Option<&GdbStateNodeForVariable> {
+        self.slots.get(handle.0 as usize)?.as_ref()
+    }
+
+    /// Accesses a variable node by its handle.
+    pub fn get_mut(&mut self, handle: VariableHandle) -> Option<&mut GdbStateNodeForVariable> {
+        self.slots.get_mut(handle.0 as usize)?.as_mut()
+    }
+
+    /// Gets the number of variable nodes.
+    pub fn len(&self) -> usize {
+        self.handles.len()
+    }
+
+    /// Finds the handle of the node that represents a variable object.
+    pub fn handle(&self, object: &VariableObject) -> Option<VariableHandle> {
+        self.handles.get(object).copied()
+    }
+
+    /// Iterates over all variable nodes in order of their handles.
+    pub fn iter(&self) -> impl Iterator<Item = (VariableHandle, &GdbStateNodeForVariable)> {
+        self.slots
+            .iter()
+            .enumerate()
+            .filter_map(|(i, slot)| Some((VariableHandle(i as u32), slot.as_ref()?)))
+    }
+}
+
 /// [`GdbStateNode`] with additional information related to variable objects.
 #[derive(Debug, Deref, DerefMut)]
 pub(crate) struct GdbStateNodeForVariable {
@@ -122,6 +590,23 @@ pub(crate) struct GdbStateNodeForVariable {
     #[deref_mut]
     pub node: GdbStateNode,
 
+    /// The variable object that backs the node.
+    pub object: VariableObject,
+
+    /// The [`EdgeLabel::Length`] pseudo-node of an array, if present.
+    pub length_node: Option<GdbStateNode>,
+
+    /// Elements of an array that has been read from memory in bulk, if it has.
+    pub bulk_array: Option<BulkScalarArray>,
+
+    /// The [`NodeTypeClass::Truncated`] pseudo-node that stands in
+    /// for omitted successors, if any have been omitted.
+    pub truncation_node: Option<GdbStateNode>,
+
+    /// Number of dereferences between the nearest variable in scope
+    /// and this node.
+    pub depth: usize,
+
     /// Address of the variable, if available
     pub address: Option<u64>,
 
@@ -132,15 +617,20 @@ pub(crate) struct GdbStateNodeForVariable {
 
     /// References to [`NodeTypeClass::Ref`] nodes whose
     /// [`EdgeLabel::Deref`] points to this node.
-    pub referers: Vec<VariableObject>,
+    pub referers: Vec<VariableHandle>,
 }
 
 /// [`GdbStateNode`] with additional data for a node that
 /// represents a [`VariableObject`].
 impl GdbStateNodeForVariable {
-    pub fn new(node: GdbStateNode, parent: Option<GdbStateNodeId>) -> Self {
+    pub fn new(node: GdbStateNode, object: VariableObject, parent: Option<GdbStateNodeId>) -> Self {
         Self {
             node,
+            object,
+            length_node: None,
+            bulk_array: None,
+            truncation_node: None,
+            depth: 0,
             parent,
             address: None,
             referers: Vec::new(),
@@ -153,3 +643,47 @@ impl GdbStateNodeForVariable {
         !matches!(self.parent, Some(GdbStateNodeId::VarObject(_)))
     }
 }
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    fn variable_node(name: &str) -> GdbStateNodeForVariable {
+        let node = GdbStateNode {
+            type_class: NodeTypeClass::Atom,
+            type_name: None,
+            successors: Vec::new(),
+            value: None,
+        };
+        GdbStateNodeForVariable::new(node, VariableObject(name.to_owned()), None)
+    }
+
+    #[test]
+    fn arena_reuses_handles_after_recycling() {
+        let mut arena = VariableArena::default();
+        let a = arena.insert(variable_node("var1"));
+        let b = arena.insert(variable_node("var2"));
+        assert_ne!(a, b);
+        assert_eq!(arena.handle(&VariableObject("var2".to_owned())), Some(b));
+        assert!(arena.remove(a).is_some());
+        assert!(arena.get(a).is_none());
+        assert_eq!(arena.handle(&VariableObject("var1".to_owned())), None);
+        // Removed handles are not reused until they are recycled
+        let c = arena.insert(variable_node("var3"));
+        assert_ne!(c, a);
+        arena.recycle();
+        let d = arena.insert(variable_node("var4"));
+        assert_eq!(d, a);
+        assert_eq!(arena.get(d).unwrap().object.0, "var4");
+        assert_eq!(arena.iter().count(), 3);
+    }
+
+    #[test]
+    fn arena_keeps_handle_of_replaced_node() {
+        let mut arena = VariableArena::default();
+        let a = arena.insert(variable_node("var1"));
+        let b = arena.insert(variable_node("var1"));
+        assert_eq!(a, b);
+        assert_eq!(arena.iter().count(), 1);
+    }
+}
@@ -1,6 +1,11 @@
 mod utils;
 
-use aili_gdbstate::{hints::PointerLengthHintKey, state::GdbStateGraph};
+use aili_gdbstate::{
+    gdbmi::transcript::{GdbMiTranscript, RecordingGdbMiStream, ReplayGdbMiStream},
+    hints::PointerLengthHintKey,
+    reachability::ReachabilitySheet,
+    state::{ConstructionBudget, GdbStateGraph},
+};
 use aili_model::state::*;
 use aili_style::{
     cascade::CascadeStyle,
@@ -31,7 +36,7 @@ fn basic_function_argument() {
     let mut gdb = gdb_from_source("int main(int argc) {}");
     let state_graph = GdbStateGraph::new(&mut gdb).expect_ready().unwrap();
     let argc = state_graph
-        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("argc".to_owned(), 0)])
+        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("argc".into(), 0)])
         .unwrap();
     assert_eq!(argc.node_type_class(), NodeTypeClass::Atom);
     assert_eq!(argc.node_type_id(), Some("int"));
@@ -50,7 +55,7 @@ fn basic_local_variable() {
     gdb.run_to_line(4).unwrap();
     let state_graph = GdbStateGraph::new(&mut gdb).expect_ready().unwrap();
     let local = state_graph
-        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("local".to_owned(), 0)])
+        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("local".into(), 0)])
         .unwrap();
     assert_eq!(local.node_type_class(), NodeTypeClass::Atom);
     assert_eq!(local.node_type_id(), Some("int"));
@@ -67,10 +72,9 @@ fn no_op_update() {
     );
     let mut state_graph = GdbStateGraph::new(&mut gdb).expect_ready().unwrap();
     state_graph.update(&mut gdb).expect_ready().unwrap();
-    let local =
-        state_graph.get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("local".to_owned(), 0)]);
+    let local = state_graph.get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("local".into(), 0)]);
     let another_local_id =
-        state_graph.get_id_at_root(&[EdgeLabel::Main, EdgeLabel::Named("local".to_owned(), 1)]);
+        state_graph.get_id_at_root(&[EdgeLabel::Main, EdgeLabel::Named("local".into(), 1)]);
     assert!(local.is_some());
     assert!(another_local_id.is_none());
 }
@@ -107,9 +111,9 @@ fn variable_shadowing() {
     );
     gdb.run_to_line(6).unwrap();
     let state_graph = GdbStateGraph::new(&mut gdb).expect_ready().unwrap();
-    let a0_id = state_graph.get_id_at_root(&[EdgeLabel::Main, EdgeLabel::Named("a".to_owned(), 0)]);
+    let a0_id = state_graph.get_id_at_root(&[EdgeLabel::Main, EdgeLabel::Named("a".into(), 0)]);
     let a1 = state_graph
-        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("a".to_owned(), 1)])
+        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("a".into(), 1)])
         .unwrap();
     assert_eq!(a1.node_type_class(), NodeTypeClass::Atom);
     assert_eq!(a1.node_type_id(), Some("unsigned int"));
@@ -133,10 +137,10 @@ fn multiple_variables_with_same_name() {
     gdb.run_to_line(6).unwrap();
     state_graph.update(&mut gdb).expect_ready().unwrap();
     let a0 = state_graph
-        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("a".to_owned(), 0)])
+        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("a".into(), 0)])
         .unwrap();
     let a1 = state_graph
-        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("a".to_owned(), 1)])
+        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("a".into(), 1)])
         .unwrap();
     assert_eq!(a0.node_type_class(), NodeTypeClass::Atom);
     assert_eq!(a0.node_type_id(), Some("int"));
@@ -168,9 +172,9 @@ fn variable_out_of_scope() {
     // Variable a#0 should be loaded now, and a#1 should go out of scope
     state_graph.update(&mut gdb).expect_ready().unwrap();
     let a0 = state_graph
-        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("a".to_owned(), 0)])
+        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("a".into(), 0)])
         .unwrap();
-    let a1_id = state_graph.get_id_at_root(&[EdgeLabel::Main, EdgeLabel::Named("a".to_owned(), 1)]);
+    let a1_id = state_graph.get_id_at_root(&[EdgeLabel::Main, EdgeLabel::Named("a".into(), 1)]);
     assert_eq!(a0.node_type_class(), NodeTypeClass::Atom);
     assert_eq!(a0.node_type_id(), Some("int"));
     assert_eq!(a0.value(), Some(NodeValue::Int(-42)));
@@ -193,14 +197,14 @@ fn structure_variables() {
     gdb.run_to_line(8).unwrap();
     let state_graph = GdbStateGraph::new(&mut gdb).expect_ready().unwrap();
     let pair_id = state_graph
-        .get_id_at_root(&[EdgeLabel::Main, EdgeLabel::Named("p".to_owned(), 0)])
+        .get_id_at_root(&[EdgeLabel::Main, EdgeLabel::Named("p".into(), 0)])
         .unwrap();
     let pair = state_graph.get(&pair_id).unwrap();
     let first = state_graph
-        .get_at(&pair_id, &[EdgeLabel::Named("first".to_owned(), 0)])
+        .get_at(&pair_id, &[EdgeLabel::Named("first".into(), 0)])
         .unwrap();
     let second = state_graph
-        .get_at(&pair_id, &[EdgeLabel::Named("second".to_owned(), 0)])
+        .get_at(&pair_id, &[EdgeLabel::Named("second".into(), 0)])
         .unwrap();
     assert_eq!(pair.node_type_class(), NodeTypeClass::Struct);
     assert_eq!(pair.node_type_id(), Some("pair"));
@@ -225,7 +229,7 @@ fn static_array_variables() {
     gdb.run_to_line(4).unwrap();
     let state_graph = GdbStateGraph::new(&mut gdb).expect_ready().unwrap();
     let array_id = state_graph
-        .get_id_at_root(&[EdgeLabel::Main, EdgeLabel::Named("array".to_owned(), 0)])
+        .get_id_at_root(&[EdgeLabel::Main, EdgeLabel::Named("array".into(), 0)])
         .unwrap();
     let array = state_graph.get(&array_id).unwrap();
     let first = state_graph
@@ -249,6 +253,109 @@ fn static_array_variables() {
     assert_eq!(length.value(), Some(NodeValue::Uint(2)));
 }
 
+#[test]
+fn bulk_read_scalar_array() {
+    let mut gdb = gdb_from_source(
+        r"
+        int main(void) {
+            short array[64];
+            for (int i = 0; i < 64; ++i) array[i] = i * 100 - 1000;
+            /* breakpoint */;
+            array[7] = 12345;
+            /* breakpoint */;
+        }",
+    );
+    gdb.run_to_line(5).unwrap();
+    let mut state_graph = GdbStateGraph::new(&mut gdb).expect_ready().unwrap();
+    let array_id = state_graph
+        .get_id_at_root(&[EdgeLabel::Main, EdgeLabel::Named("array".into(), 0)])
+        .unwrap();
+    let array = state_graph.get(&array_id).unwrap();
+    assert_eq!(array.node_type_class(), NodeTypeClass::Array);
+    assert_eq!(array.node_type_id(), None);
+    let length = state_graph.get_at(&array_id, &[EdgeLabel::Length]).unwrap();
+    assert_eq!(length.value(), Some(NodeValue::Uint(64)));
+    for i in 0..64 {
+        let element = state_graph
+            .get_at(&array_id, &[EdgeLabel::Index(i)])
+            .unwrap();
+        assert_eq!(element.node_type_class(), NodeTypeClass::Atom);
+        assert_eq!(element.node_type_id(), Some("short"));
+        assert_eq!(element.value(), Some(NodeValue::Int(i as i64 * 100 - 1000)));
+    }
+    gdb.run_to_line(7).unwrap();
+    state_graph.take_changed_nodes();
+    let cursor = state_graph.change_cursor();
+    state_graph.update(&mut gdb).expect_ready().unwrap();
+    let element = state_graph
+        .get_at(&array_id, &[EdgeLabel::Index(7)])
+        .unwrap();
+    assert_eq!(element.value(), Some(NodeValue::Int(12345)));
+    let element_id = state_graph
+        .get_id_at(&array_id, &[EdgeLabel::Index(7)])
+        .unwrap();
+    assert!(
+        state_graph
+            .changed_nodes_since(cursor)
+            .unwrap()
+            .contains(&element_id)
+    );
+    assert!(state_graph.take_changed_nodes().contains(&element_id));
+}
+
+#[test]
+fn bulk_read_bool_array() {
+    let mut gdb = gdb_from_source(
+        r"
+        int main(void) {
+            _Bool flag = 1;
+            _Bool flags[64] = { 0, 1 };
+            /* breakpoint */;
+        }",
+    );
+    gdb.run_to_line(5).unwrap();
+    let state_graph = GdbStateGraph::new(&mut gdb).expect_ready().unwrap();
+    let flag = state_graph
+        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("flag".into(), 0)])
+        .unwrap();
+    assert_eq!(flag.value(), Some(NodeValue::Bool(true)));
+    // Elements read from memory have the same values as variable objects
+    for (i, expected) in [(0, false), (1, true)] {
+        let element = state_graph
+            .get_at_root(&[
+                EdgeLabel::Main,
+                EdgeLabel::Named("flags".into(), 0),
+                EdgeLabel::Index(i),
+            ])
+            .unwrap();
+        assert_eq!(element.value(), Some(NodeValue::Bool(expected)));
+    }
+}
+
+#[test]
+fn bulk_read_array_of_typedef_uses_its_signedness() {
+    let mut gdb = gdb_from_source(
+        r"
+        typedef unsigned char byte;
+        int main(void) {
+            byte bytes[64] = { 200, 1 };
+            /* breakpoint */;
+        }",
+    );
+    gdb.run_to_line(5).unwrap();
+    let state_graph = GdbStateGraph::new(&mut gdb).expect_ready().unwrap();
+    for (i, expected) in [(0, 200), (1, 1), (2, 0)] {
+        let element = state_graph
+            .get_at_root(&[
+                EdgeLabel::Main,
+                EdgeLabel::Named("bytes".into(), 0),
+                EdgeLabel::Index(i),
+            ])
+            .unwrap();
+        assert_eq!(element.value(), Some(NodeValue::Uint(expected)));
+    }
+}
+
 #[test]
 fn update_after_pushing_stack() {
     let mut gdb = gdb_from_source(
@@ -312,24 +419,127 @@ fn update_in_function_call() {
     assert!(function_frame.successors().next().is_none());
 }
 
+#[test]
+fn locals_restored_after_calling_function_again() {
+    let mut gdb = gdb_from_source(
+        r"
+        int f(int n) {
+            int local = n * 2;
+            /* breakpoint 1 */ return local;
+        }
+        int main(void) {
+            f(1);
+            /* breakpoint 2 */ f(2);
+        }",
+    );
+    gdb.run_to_line(4).unwrap();
+    let mut state_graph = GdbStateGraph::new(&mut gdb).expect_ready().unwrap();
+    // Return from the function, its frame is set aside
+    gdb.run_to_line(8).unwrap();
+    state_graph.update(&mut gdb).expect_ready().unwrap();
+    let main = state_graph.get_at_root(&[EdgeLabel::Main]).unwrap();
+    assert!(main.get_successor(&EdgeLabel::Next).is_none());
+    // Call it again at the same stack depth
+    gdb.run_to_line(4).unwrap();
+    state_graph.update(&mut gdb).expect_ready().unwrap();
+    let statistics = state_graph.update_statistics();
+    assert_eq!(statistics.variables_restored, 2);
+    assert_eq!(statistics.variables_created, 0);
+    let local = state_graph
+        .get_at_root(&[
+            EdgeLabel::Main,
+            EdgeLabel::Next,
+            EdgeLabel::Named("local".into(), 0),
+        ])
+        .unwrap();
+    assert_eq!(local.value(), Some(NodeValue::Int(4)));
+}
+
+#[test]
+fn stepping_between_calls_keeps_caller_frame() {
+    let mut gdb = gdb_from_source(
+        r"
+        int f(void) { /* breakpoint 1 */ return 1; }
+        int g(void) { /* breakpoint 2 */ return 2; }
+        int main(void) {
+            int a = 0;
+            f();
+            g();
+        }",
+    );
+    gdb.run_to_line(2).unwrap();
+    let mut state_graph = GdbStateGraph::new(&mut gdb).expect_ready().unwrap();
+    // The caller keeps its frame while a different function is called from it
+    gdb.run_to_line(3).unwrap();
+    state_graph.update(&mut gdb).expect_ready().unwrap();
+    let statistics = state_graph.update_statistics();
+    assert_eq!(statistics.variables_created, 0);
+    assert_eq!(statistics.variables_restored, 0);
+    let top = state_graph
+        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Next])
+        .unwrap();
+    assert_eq!(top.node_type_id(), Some("g"));
+    assert!(
+        state_graph
+            .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("a".into(), 0)])
+            .is_some()
+    );
+}
+
+#[test]
+fn calling_function_again_at_another_address_creates_new_frame() {
+    let mut gdb = gdb_from_source(
+        r"
+        int f(int n) {
+            int local = n * 2;
+            /* breakpoint */ return local;
+        }
+        int main(int argc, char **argv) {
+            f(1);
+            {
+                volatile char buffer[argc * 64];
+                buffer[0] = 0;
+                f(2);
+            }
+        }",
+    );
+    gdb.run_to_line(4).unwrap();
+    let mut state_graph = GdbStateGraph::new(&mut gdb).expect_ready().unwrap();
+    // The buffer moves the second call to a different frame address,
+    // so its frame must not inherit the locals of the first call
+    gdb.run_to_line(4).unwrap();
+    state_graph.update(&mut gdb).expect_ready().unwrap();
+    let statistics = state_graph.update_statistics();
+    assert_eq!(statistics.variables_restored, 0);
+    assert_eq!(statistics.variables_created, 2);
+    let local = state_graph
+        .get_at_root(&[
+            EdgeLabel::Main,
+            EdgeLabel::Next,
+            EdgeLabel::Named("local".into(), 0),
+        ])
+        .unwrap();
+    assert_eq!(local.value(), Some(NodeValue::Int(4)));
+}
+
 #[test]
 fn pointer_argument() {
     let mut gdb = gdb_from_source("int main (int argc, const char* const * argv) {}");
     let state_graph = GdbStateGraph::new(&mut gdb).expect_ready().unwrap();
     let argv = state_graph
-        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("argv".to_owned(), 0)])
+        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("argv".into(), 0)])
         .unwrap();
     let argv0 = state_graph
         .get_at_root(&[
             EdgeLabel::Main,
-            EdgeLabel::Named("argv".to_owned(), 0),
+            EdgeLabel::Named("argv".into(), 0),
             EdgeLabel::Deref,
         ])
         .unwrap();
     let argv00 = state_graph
         .get_at_root(&[
             EdgeLabel::Main,
-            EdgeLabel::Named("argv".to_owned(), 0),
+            EdgeLabel::Named("argv".into(), 0),
             EdgeLabel::Deref,
             EdgeLabel::Deref,
         ])
@@ -358,7 +568,7 @@ fn pointer_copying() {
     let argv00_id = state_graph
         .get_id_at_root(&[
             EdgeLabel::Main,
-            EdgeLabel::Named("argv".to_owned(), 0),
+            EdgeLabel::Named("argv".into(), 0),
             EdgeLabel::Deref,
             EdgeLabel::Deref,
         ])
@@ -366,7 +576,7 @@ fn pointer_copying() {
     let deref_p_id = state_graph
         .get_id_at_root(&[
             EdgeLabel::Main,
-            EdgeLabel::Named("p".to_owned(), 0),
+            EdgeLabel::Named("p".into(), 0),
             EdgeLabel::Deref,
         ])
         .unwrap();
@@ -390,10 +600,10 @@ fn pointer_update() {
     gdb.run_to_line(6).unwrap();
     state_graph.update(&mut gdb).expect_ready().unwrap();
     let p = state_graph
-        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("p".to_owned(), 0)])
+        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("p".into(), 0)])
         .unwrap();
     let q = state_graph
-        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("q".to_owned(), 0)])
+        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("q".into(), 0)])
         .unwrap();
     // The pointers should be offset by one byte
     match (p.value(), q.value()) {
@@ -427,22 +637,22 @@ fn pointer_to_local() {
     gdb.run_to_line(11).unwrap();
     let state_graph = GdbStateGraph::new(&mut gdb).expect_ready().unwrap();
     let a_id = state_graph
-        .get_id_at_root(&[EdgeLabel::Main, EdgeLabel::Named("a".to_owned(), 0)])
+        .get_id_at_root(&[EdgeLabel::Main, EdgeLabel::Named("a".into(), 0)])
         .unwrap();
     let z_id = state_graph
-        .get_id_at_root(&[EdgeLabel::Main, EdgeLabel::Named("z".to_owned(), 0)])
+        .get_id_at_root(&[EdgeLabel::Main, EdgeLabel::Named("z".into(), 0)])
         .unwrap();
     let p_deref_id = state_graph
         .get_id_at_root(&[
             EdgeLabel::Main,
-            EdgeLabel::Named("p".to_owned(), 0),
+            EdgeLabel::Named("p".into(), 0),
             EdgeLabel::Deref,
         ])
         .unwrap();
     let q_deref_id = state_graph
         .get_id_at_root(&[
             EdgeLabel::Main,
-            EdgeLabel::Named("q".to_owned(), 0),
+            EdgeLabel::Named("q".into(), 0),
             EdgeLabel::Deref,
         ])
         .unwrap();
@@ -450,6 +660,58 @@ fn pointer_to_local() {
     assert_eq!(z_id, q_deref_id);
 }
 
+#[test]
+fn pointer_into_object() {
+    let mut gdb = gdb_from_source(
+        r"
+        typedef struct pair {
+            int x;
+            int y;
+        } pair;
+
+        int main(void) {
+            int a[8] = { 0 };
+            pair s = { 1, 2 };
+            int* p = &a[3];
+            int* q = &s.y;
+            /* breakpoint */;
+        }",
+    );
+    gdb.run_to_line(12).unwrap();
+    let state_graph = GdbStateGraph::new(&mut gdb).expect_ready().unwrap();
+    let a3_id = state_graph
+        .get_id_at_root(&[
+            EdgeLabel::Main,
+            EdgeLabel::Named("a".into(), 0),
+            EdgeLabel::Index(3),
+        ])
+        .unwrap();
+    let y_id = state_graph
+        .get_id_at_root(&[
+            EdgeLabel::Main,
+            EdgeLabel::Named("s".into(), 0),
+            EdgeLabel::Named("y".into(), 0),
+        ])
+        .unwrap();
+    let p_deref_id = state_graph
+        .get_id_at_root(&[
+            EdgeLabel::Main,
+            EdgeLabel::Named("p".into(), 0),
+            EdgeLabel::Deref,
+        ])
+        .unwrap();
+    let q_deref_id = state_graph
+        .get_id_at_root(&[
+            EdgeLabel::Main,
+            EdgeLabel::Named("q".into(), 0),
+            EdgeLabel::Deref,
+        ])
+        .unwrap();
+    // Pointers into existing objects must not create duplicate nodes
+    assert_eq!(a3_id, p_deref_id);
+    assert_eq!(y_id, q_deref_id);
+}
+
 #[test]
 fn dangling_reference_detachment() {
     let mut gdb = gdb_from_source(
@@ -469,7 +731,7 @@ fn dangling_reference_detachment() {
     gdb.run_to_line(9).unwrap();
     state_graph.update(&mut gdb).expect_ready().unwrap();
     let pointer = state_graph
-        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("p".to_owned(), 0)])
+        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("p".into(), 0)])
         .unwrap();
     assert!(pointer.get_successor(&EdgeLabel::Deref).is_none());
 }
@@ -501,31 +763,31 @@ fn linked_list() {
     let first = state_graph
         .get_at_root(&[
             EdgeLabel::Main,
-            EdgeLabel::Named("head".to_owned(), 0),
+            EdgeLabel::Named("head".into(), 0),
             EdgeLabel::Deref,
-            EdgeLabel::Named("value".to_owned(), 0),
+            EdgeLabel::Named("value".into(), 0),
         ])
         .unwrap();
     let second = state_graph
         .get_at_root(&[
             EdgeLabel::Main,
-            EdgeLabel::Named("head".to_owned(), 0),
+            EdgeLabel::Named("head".into(), 0),
             EdgeLabel::Deref,
-            EdgeLabel::Named("next".to_owned(), 0),
+            EdgeLabel::Named("next".into(), 0),
             EdgeLabel::Deref,
-            EdgeLabel::Named("value".to_owned(), 0),
+            EdgeLabel::Named("value".into(), 0),
         ])
         .unwrap();
     let third = state_graph
         .get_at_root(&[
             EdgeLabel::Main,
-            EdgeLabel::Named("head".to_owned(), 0),
+            EdgeLabel::Named("head".into(), 0),
             EdgeLabel::Deref,
-            EdgeLabel::Named("next".to_owned(), 0),
+            EdgeLabel::Named("next".into(), 0),
             EdgeLabel::Deref,
-            EdgeLabel::Named("next".to_owned(), 0),
+            EdgeLabel::Named("next".into(), 0),
             EdgeLabel::Deref,
-            EdgeLabel::Named("value".to_owned(), 0),
+            EdgeLabel::Named("value".into(), 0),
         ])
         .unwrap();
     assert_eq!(first.value(), Some(NodeValue::Int(41)));
@@ -565,7 +827,7 @@ fn constant_length_hint() {
         selector: Selector::from_path(
             [
                 SelectorSegment::Match(EdgeLabel::Main.into()),
-                SelectorSegment::Match(EdgeMatcher::Named("argv".to_owned())),
+                SelectorSegment::Match(EdgeMatcher::Named("argv".into())),
             ]
             .into(),
         ),
@@ -581,32 +843,32 @@ fn constant_length_hint() {
     let argv_length = state_graph
         .get_at_root(&[
             EdgeLabel::Main,
-            EdgeLabel::Named("argv".to_owned(), 0),
+            EdgeLabel::Named("argv".into(), 0),
             EdgeLabel::Deref,
             EdgeLabel::Length,
         ])
         .unwrap();
     let argv_0 = state_graph.get_at_root(&[
         EdgeLabel::Main,
-        EdgeLabel::Named("argv".to_owned(), 0),
+        EdgeLabel::Named("argv".into(), 0),
         EdgeLabel::Deref,
         EdgeLabel::Index(0),
     ]);
     let argv_1 = state_graph.get_at_root(&[
         EdgeLabel::Main,
-        EdgeLabel::Named("argv".to_owned(), 0),
+        EdgeLabel::Named("argv".into(), 0),
         EdgeLabel::Deref,
         EdgeLabel::Index(1),
     ]);
     let argv_2 = state_graph.get_at_root(&[
         EdgeLabel::Main,
-        EdgeLabel::Named("argv".to_owned(), 0),
+        EdgeLabel::Named("argv".into(), 0),
         EdgeLabel::Deref,
         EdgeLabel::Index(2),
     ]);
     let argv_3 = state_graph.get_at_root(&[
         EdgeLabel::Main,
-        EdgeLabel::Named("argv".to_owned(), 0),
+        EdgeLabel::Named("argv".into(), 0),
         EdgeLabel::Deref,
         EdgeLabel::Index(3),
     ]);
@@ -623,7 +885,7 @@ fn length_hint_from_variable() {
         selector: Selector::from_path(
             [
                 SelectorSegment::Match(EdgeLabel::Main.into()),
-                SelectorSegment::Match(EdgeMatcher::Named("argv".to_owned())),
+                SelectorSegment::Match(EdgeMatcher::Named("argv".into())),
             ]
             .into(),
         ),
@@ -645,32 +907,32 @@ fn length_hint_from_variable() {
     let argv_length = state_graph
         .get_at_root(&[
             EdgeLabel::Main,
-            EdgeLabel::Named("argv".to_owned(), 0),
+            EdgeLabel::Named("argv".into(), 0),
             EdgeLabel::Deref,
             EdgeLabel::Length,
         ])
         .unwrap();
     let argv_0 = state_graph.get_at_root(&[
         EdgeLabel::Main,
-        EdgeLabel::Named("argv".to_owned(), 0),
+        EdgeLabel::Named("argv".into(), 0),
         EdgeLabel::Deref,
         EdgeLabel::Index(0),
     ]);
     let argv_1 = state_graph.get_at_root(&[
         EdgeLabel::Main,
-        EdgeLabel::Named("argv".to_owned(), 0),
+        EdgeLabel::Named("argv".into(), 0),
         EdgeLabel::Deref,
         EdgeLabel::Index(1),
     ]);
     let argv_2 = state_graph.get_at_root(&[
         EdgeLabel::Main,
-        EdgeLabel::Named("argv".to_owned(), 0),
+        EdgeLabel::Named("argv".into(), 0),
         EdgeLabel::Deref,
         EdgeLabel::Index(2),
     ]);
     let argv_3 = state_graph.get_at_root(&[
         EdgeLabel::Main,
-        EdgeLabel::Named("argv".to_owned(), 0),
+        EdgeLabel::Named("argv".into(), 0),
         EdgeLabel::Deref,
         EdgeLabel::Index(3),
     ]);
@@ -689,8 +951,7 @@ fn variable_length_hint() {
             properties: vec![StyleClause {
                 key: StyleKey::Variable("--argc".to_owned()),
                 value: Expression::Select(
-                    LimitedSelector::from_path([EdgeLabel::Named("argc".to_owned(), 0).into()])
-                        .into(),
+                    LimitedSelector::from_path([EdgeLabel::Named("argc".into(), 0).into()]).into(),
                 ),
             }],
         },
@@ -698,7 +959,7 @@ fn variable_length_hint() {
             selector: Selector::from_path(
                 [
                     SelectorSegment::Match(EdgeLabel::Main.into()),
-                    SelectorSegment::Match(EdgeMatcher::Named("argv".to_owned())),
+                    SelectorSegment::Match(EdgeMatcher::Named("argv".into())),
                 ]
                 .into(),
             ),
@@ -713,12 +974,12 @@ fn variable_length_hint() {
         .expect_ready()
         .unwrap();
     let argc = state_graph
-        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("argc".to_owned(), 0)])
+        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("argc".into(), 0)])
         .unwrap();
     let argv_length = state_graph
         .get_at_root(&[
             EdgeLabel::Main,
-            EdgeLabel::Named("argv".to_owned(), 0),
+            EdgeLabel::Named("argv".into(), 0),
             EdgeLabel::Deref,
             EdgeLabel::Length,
         ])
@@ -734,8 +995,7 @@ fn resize_array_with_length_hint() {
             properties: vec![StyleClause {
                 key: StyleKey::Variable("--len".to_owned()),
                 value: Expression::Select(
-                    LimitedSelector::from_path([EdgeLabel::Named("len".to_owned(), 0).into()])
-                        .into(),
+                    LimitedSelector::from_path([EdgeLabel::Named("len".into(), 0).into()]).into(),
                 ),
             }],
         },
@@ -743,7 +1003,7 @@ fn resize_array_with_length_hint() {
             selector: Selector::from_path(
                 [
                     SelectorSegment::Match(EdgeLabel::Main.into()),
-                    SelectorSegment::Match(EdgeMatcher::Named("p".to_owned())),
+                    SelectorSegment::Match(EdgeMatcher::Named("p".into())),
                 ]
                 .into(),
             ),
@@ -778,14 +1038,14 @@ fn resize_array_with_length_hint() {
     let p_length = state_graph
         .get_at_root(&[
             EdgeLabel::Main,
-            EdgeLabel::Named("p".to_owned(), 0),
+            EdgeLabel::Named("p".into(), 0),
             EdgeLabel::Deref,
             EdgeLabel::Length,
         ])
         .unwrap();
     let p_3 = state_graph.get_at_root(&[
         EdgeLabel::Main,
-        EdgeLabel::Named("p".to_owned(), 0),
+        EdgeLabel::Named("p".into(), 0),
         EdgeLabel::Deref,
         EdgeLabel::Index(3),
     ]);
@@ -815,19 +1075,15 @@ fn variable_shadowing_in_length_hints() {
                 StyleClause {
                     key: StyleKey::Variable("--a".to_owned()),
                     value: Expression::Select(
-                        LimitedSelector::from_path([
-                            EdgeLabel::Named("defaultA".to_owned(), 0).into()
-                        ])
-                        .into(),
+                        LimitedSelector::from_path([EdgeLabel::Named("defaultA".into(), 0).into()])
+                            .into(),
                     ),
                 },
                 StyleClause {
                     key: StyleKey::Variable("--b".to_owned()),
                     value: Expression::Select(
-                        LimitedSelector::from_path([
-                            EdgeLabel::Named("defaultB".to_owned(), 0).into()
-                        ])
-                        .into(),
+                        LimitedSelector::from_path([EdgeLabel::Named("defaultB".into(), 0).into()])
+                            .into(),
                     ),
                 },
             ],
@@ -836,15 +1092,14 @@ fn variable_shadowing_in_length_hints() {
             selector: Selector::from_path(
                 [
                     SelectorSegment::Match(EdgeLabel::Main.into()),
-                    SelectorSegment::Match(EdgeMatcher::Named("sA".to_owned())),
+                    SelectorSegment::Match(EdgeMatcher::Named("sA".into())),
                 ]
                 .into(),
             ),
             properties: vec![StyleClause {
                 key: StyleKey::Variable("--a".to_owned()),
                 value: Expression::Select(
-                    LimitedSelector::from_path([EdgeLabel::Named("extra".to_owned(), 0).into()])
-                        .into(),
+                    LimitedSelector::from_path([EdgeLabel::Named("extra".into(), 0).into()]).into(),
                 ),
             }],
         },
@@ -852,15 +1107,14 @@ fn variable_shadowing_in_length_hints() {
             selector: Selector::from_path(
                 [
                     SelectorSegment::Match(EdgeLabel::Main.into()),
-                    SelectorSegment::Match(EdgeMatcher::Named("sB".to_owned())),
+                    SelectorSegment::Match(EdgeMatcher::Named("sB".into())),
                 ]
                 .into(),
             ),
             properties: vec![StyleClause {
                 key: StyleKey::Variable("--b".to_owned()),
                 value: Expression::Select(
-                    LimitedSelector::from_path([EdgeLabel::Named("extra".to_owned(), 0).into()])
-                        .into(),
+                    LimitedSelector::from_path([EdgeLabel::Named("extra".into(), 0).into()]).into(),
                 ),
             }],
         },
@@ -878,7 +1132,7 @@ fn variable_shadowing_in_length_hints() {
                         BinaryOperator::Eq,
                         Expression::String("s".to_owned()).into(),
                     )),
-                    SelectorSegment::Match(EdgeMatcher::Named("p".to_owned())),
+                    SelectorSegment::Match(EdgeMatcher::Named("p".into())),
                 ]
                 .into(),
             ),
@@ -918,8 +1172,8 @@ fn variable_shadowing_in_length_hints() {
     let sa_p_length = state_graph
         .get_at_root(&[
             EdgeLabel::Main,
-            EdgeLabel::Named("sA".to_owned(), 0),
-            EdgeLabel::Named("p".to_owned(), 0),
+            EdgeLabel::Named("sA".into(), 0),
+            EdgeLabel::Named("p".into(), 0),
             EdgeLabel::Deref,
             EdgeLabel::Length,
         ])
@@ -927,8 +1181,8 @@ fn variable_shadowing_in_length_hints() {
     let sb_p_length = state_graph
         .get_at_root(&[
             EdgeLabel::Main,
-            EdgeLabel::Named("sB".to_owned(), 0),
-            EdgeLabel::Named("p".to_owned(), 0),
+            EdgeLabel::Named("sB".into(), 0),
+            EdgeLabel::Named("p".into(), 0),
             EdgeLabel::Deref,
             EdgeLabel::Length,
         ])
@@ -943,7 +1197,7 @@ fn triangle_array_length_hints() {
         selector: Selector::from_path(
             [
                 SelectorSegment::Match(EdgeLabel::Main.into()),
-                SelectorSegment::Match(EdgeMatcher::Named("arr".to_owned())),
+                SelectorSegment::Match(EdgeMatcher::Named("arr".into())),
                 SelectorSegment::Match(EdgeMatcher::AnyIndex),
             ]
             .into(),
@@ -977,7 +1231,7 @@ fn triangle_array_length_hints() {
         let length = state_graph
             .get_at_root(&[
                 EdgeLabel::Main,
-                EdgeLabel::Named("arr".to_owned(), 0),
+                EdgeLabel::Named("arr".into(), 0),
                 EdgeLabel::Index(i),
                 EdgeLabel::Deref,
                 EdgeLabel::Length,
@@ -992,12 +1246,12 @@ fn char_array() {
     let mut gdb = gdb_from_source(r#"int main(void) { const char s[] = "abc"; }"#);
     let state_graph = GdbStateGraph::new(&mut gdb).expect_ready().unwrap();
     let array = state_graph
-        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("s".to_owned(), 0)])
+        .get_at_root(&[EdgeLabel::Main, EdgeLabel::Named("s".into(), 0)])
         .unwrap();
     let length = state_graph
         .get_at_root(&[
             EdgeLabel::Main,
-            EdgeLabel::Named("s".to_owned(), 0),
+            EdgeLabel::Named("s".into(), 0),
             EdgeLabel::Length,
         ])
         .unwrap();
@@ -1021,14 +1275,14 @@ fn pointer_to_array() {
     let array = state_graph
         .get_at_root(&[
             EdgeLabel::Main,
-            EdgeLabel::Named("arr".to_owned(), 0),
+            EdgeLabel::Named("arr".into(), 0),
             EdgeLabel::Deref,
         ])
         .unwrap();
     let length = state_graph
         .get_at_root(&[
             EdgeLabel::Main,
-            EdgeLabel::Named("arr".to_owned(), 0),
+            EdgeLabel::Named("arr".into(), 0),
             EdgeLabel::Deref,
             EdgeLabel::Length,
         ])
@@ -1065,8 +1319,7 @@ fn length_hint_on_heap() {
             properties: vec![StyleClause {
                 key: StyleKey::Variable("--len".to_owned()),
                 value: Expression::Select(
-                    LimitedSelector::from_path([EdgeLabel::Named("len".to_owned(), 0).into()])
-                        .into(),
+                    LimitedSelector::from_path([EdgeLabel::Named("len".into(), 0).into()]).into(),
                 ),
             }],
         },
@@ -1083,7 +1336,7 @@ fn length_hint_on_heap() {
                         BinaryOperator::Eq,
                         Expression::String("array".to_owned()).into(),
                     )),
-                    SelectorSegment::Match(EdgeMatcher::Named("ptr".to_owned())),
+                    SelectorSegment::Match(EdgeMatcher::Named("ptr".into())),
                 ]
                 .into(),
             ),
@@ -1116,18 +1369,18 @@ fn length_hint_on_heap() {
     let array = state_graph
         .get_at_root(&[
             EdgeLabel::Main,
-            EdgeLabel::Named("a".to_owned(), 0),
+            EdgeLabel::Named("a".into(), 0),
             EdgeLabel::Deref,
-            EdgeLabel::Named("ptr".to_owned(), 0),
+            EdgeLabel::Named("ptr".into(), 0),
             EdgeLabel::Deref,
         ])
         .unwrap();
     let length = state_graph
         .get_at_root(&[
             EdgeLabel::Main,
-            EdgeLabel::Named("a".to_owned(), 0),
+            EdgeLabel::Named("a".into(), 0),
             EdgeLabel::Deref,
-            EdgeLabel::Named("ptr".to_owned(), 0),
+            EdgeLabel::Named("ptr".into(), 0),
             EdgeLabel::Deref,
             EdgeLabel::Length,
         ])
@@ -1150,8 +1403,7 @@ fn length_hint_across_heap_boundary() {
             properties: vec![StyleClause {
                 key: StyleKey::Variable("--size".to_owned()),
                 value: Expression::Select(
-                    LimitedSelector::from_path([EdgeLabel::Named("size".to_owned(), 0).into()])
-                        .into(),
+                    LimitedSelector::from_path([EdgeLabel::Named("size".into(), 0).into()]).into(),
                 ),
             }],
         },
@@ -1159,7 +1411,7 @@ fn length_hint_across_heap_boundary() {
             selector: Selector::from_path(
                 [
                     SelectorSegment::Match(EdgeLabel::Main.into()),
-                    SelectorSegment::Match(EdgeMatcher::Named("a".to_owned())),
+                    SelectorSegment::Match(EdgeMatcher::Named("a".into())),
                     SelectorSegment::Branch(vec![
                         [].into(),
                         [
@@ -1196,7 +1448,7 @@ fn length_hint_across_heap_boundary() {
     let array_id = state_graph
         .get_id_at_root(&[
             EdgeLabel::Main,
-            EdgeLabel::Named("a".to_owned(), 0),
+            EdgeLabel::Named("a".into(), 0),
             EdgeLabel::Deref,
         ])
         .unwrap();
@@ -1218,3 +1470,177 @@ fn length_hint_across_heap_boundary() {
         assert!(inner_length.value() == Some(NodeValue::Uint(3)));
     }
 }
+
+#[test]
+fn only_reachable_pointers_are_dereferenced() {
+    // main "a" ref {}
+    let stylesheet = CascadeStyle::<PointerLengthHintKey>::from(Stylesheet(vec![StyleRule {
+        selector: Selector::from_path(
+            [
+                SelectorSegment::Match(EdgeLabel::Main.into()),
+                SelectorSegment::Match(EdgeMatcher::Named("a".into())),
+                SelectorSegment::Match(EdgeLabel::Deref.into()),
+            ]
+            .into(),
+        ),
+        properties: Vec::new(),
+    }]));
+    let reachability = ReachabilitySheet::new(&stylesheet);
+    let hints = CascadeStyle::empty();
+    let mut gdb = gdb_from_source(
+        r"
+        #include <stdlib.h>
+
+        int main(void) {
+            int* a = (int*)malloc(sizeof(*a));
+            int* b = (int*)malloc(sizeof(*b));
+            /* breakpoint */;
+        }",
+    );
+    gdb.run_to_line(7).unwrap();
+    let mut state_graph = GdbStateGraph::new_with_reachability(&mut gdb, &hints, &reachability)
+        .expect_ready()
+        .unwrap();
+    let a_path = [
+        EdgeLabel::Main,
+        EdgeLabel::Named("a".into(), 0),
+        EdgeLabel::Deref,
+    ];
+    let b_path = [
+        EdgeLabel::Main,
+        EdgeLabel::Named("b".into(), 0),
+        EdgeLabel::Deref,
+    ];
+    assert!(state_graph.get_at_root(&a_path).is_some());
+    assert!(state_graph.get_at_root(&b_path).is_none());
+    // The pointer is still left pending after an update
+    state_graph
+        .update_with_reachability(&mut gdb, &hints, &reachability)
+        .expect_ready()
+        .unwrap();
+    assert!(state_graph.get_at_root(&a_path).is_some());
+    assert!(state_graph.get_at_root(&b_path).is_none());
+    // Pending pointers are dereferenced once reachability is not limited
+    state_graph
+        .update_with_hints(&mut gdb, &hints)
+        .expect_ready()
+        .unwrap();
+    assert!(state_graph.get_at_root(&a_path).is_some());
+    assert!(state_graph.get_at_root(&b_path).is_some());
+}
+
+#[test]
+fn arrays_are_truncated_by_budget() {
+    let mut gdb = gdb_from_source(
+        r"
+        typedef struct item {
+            int x;
+        } item;
+
+        int main(void) {
+            int scalars[32] = {0};
+            item items[8] = {0};
+            /* breakpoint */;
+        }",
+    );
+    gdb.run_to_line(9).unwrap();
+    let mut state_graph = GdbStateGraph::empty();
+    state_graph.set_construction_budget(ConstructionBudget {
+        max_array_elements: Some(4),
+        ..Default::default()
+    });
+    state_graph.update(&mut gdb).expect_ready().unwrap();
+    for (name, full_length) in [("scalars", 32), ("items", 8)] {
+        let array_id = state_graph
+            .get_id_at_root(&[EdgeLabel::Main, EdgeLabel::Named(name.into(), 0)])
+            .unwrap();
+        let length = state_graph.get_at(&array_id, &[EdgeLabel::Length]).unwrap();
+        let last_element = state_graph
+            .get_at(&array_id, &[EdgeLabel::Index(3)])
+            .unwrap();
+        let truncated = state_graph
+            .get_at(&array_id, &[EdgeLabel::Index(4)])
+            .unwrap();
+        let omitted = state_graph.get_at(&array_id, &[EdgeLabel::Index(5)]);
+        assert_eq!(length.value(), Some(NodeValue::Uint(full_length)));
+        assert_ne!(last_element.node_type_class(), NodeTypeClass::Truncated);
+        assert_eq!(truncated.node_type_class(), NodeTypeClass::Truncated);
+        assert!(omitted.is_none());
+    }
+}
+
+#[test]
+fn dereferences_are_truncated_by_depth() {
+    let mut gdb = gdb_from_source(
+        r"
+        #include <stdlib.h>
+
+        typedef struct node {
+            struct node* next;
+        } node;
+
+        int main(void) {
+            node* head = (node*)calloc(1, sizeof(*head));
+            head->next = (node*)calloc(1, sizeof(*head));
+            /* breakpoint */;
+        }",
+    );
+    gdb.run_to_line(11).unwrap();
+    let mut state_graph = GdbStateGraph::empty();
+    state_graph.set_construction_budget(ConstructionBudget {
+        max_depth: Some(1),
+        ..Default::default()
+    });
+    state_graph.update(&mut gdb).expect_ready().unwrap();
+    let head_path = [
+        EdgeLabel::Main,
+        EdgeLabel::Named("head".into(), 0),
+        EdgeLabel::Deref,
+    ];
+    let next_path = [
+        EdgeLabel::Main,
+        EdgeLabel::Named("head".into(), 0),
+        EdgeLabel::Deref,
+        EdgeLabel::Named("next".into(), 0),
+        EdgeLabel::Deref,
+    ];
+    let head = state_graph.get_at_root(&head_path).unwrap();
+    let next = state_graph.get_at_root(&next_path).unwrap();
+    assert_eq!(head.node_type_class(), NodeTypeClass::Struct);
+    assert_eq!(next.node_type_class(), NodeTypeClass::Truncated);
+    // Truncated dereferences are filled in once the budget allows them
+    state_graph.set_construction_budget(ConstructionBudget::default());
+    state_graph.update(&mut gdb).expect_ready().unwrap();
+    let next = state_graph.get_at_root(&next_path).unwrap();
+    assert_eq!(next.node_type_class(), NodeTypeClass::Struct);
+}
+
+#[test]
+fn replayed_session_matches_recording() {
+    let mut gdb = RecordingGdbMiStream::new(gdb_from_source(
+        r"
+        int main(void) {
+            int local = 1;
+            local = 2;
+        }",
+    ));
+    let mut state_graph = GdbStateGraph::new(&mut gdb).expect_ready().unwrap();
+    let construction = gdb.take_transcript();
+    gdb.inner_mut().step().unwrap();
+    state_graph.update(&mut gdb).expect_ready().unwrap();
+    // Transcripts should survive being stored as text
+    let update = GdbMiTranscript::parse(&gdb.take_transcript().to_string()).unwrap();
+    let local_path = [EdgeLabel::Main, EdgeLabel::Named("local".into(), 0)];
+    let mut replay = ReplayGdbMiStream::new(construction);
+    let mut replayed_graph = GdbStateGraph::new(&mut replay).expect_ready().unwrap();
+    assert_eq!(replay.remaining(), 0);
+    let mut replay = ReplayGdbMiStream::new(update);
+    replayed_graph.update(&mut replay).expect_ready().unwrap();
+    assert_eq!(replay.remaining(), 0);
+    let local = replayed_graph.get_at_root(&local_path).unwrap();
+    assert_eq!(local.value(), Some(NodeValue::Int(1)));
+    assert_eq!(
+        local.value(),
+        state_graph.get_at_root(&local_path).unwrap().value()
+    );
+}
@@ -1,35 +1,83 @@
 //! Testing implementation of [`GdbMiStream`] that communicates
-//! with the debugger synchronously.
+//! with the debugger through a pipeline of tagged commands.
+//!
+//! [`GdbMiStream`]: aili_gdbstate::gdbmi::stream::GdbMiStream
 
 use super::externals::gdb_path;
 use aili_gdbstate::gdbmi::{
-    grammar::parse_gdbmi_record,
-    raw_output::{Record, ResultRecord},
     result::{BadResponse, Result},
-    stream::GdbMiStream,
+    stream::{GdbMiPipe, GdbMiResponse, PipelinedGdbMiStream, StringGdbMiStream},
 };
 use std::{
     io::{BufRead, BufReader, Write},
     process::{Child, ChildStdin, ChildStdout, Command, Stdio},
 };
 
-pub struct TestGdbMi {
-    stdin: ChildStdin,
-    stdout: BufReader<ChildStdout>,
-}
+/// GDB session whose commands are sent through a [`PipelinedGdbMiStream`],
+/// so batches of commands are in flight at once
+/// the same way they are when talking to a live debugger.
+pub struct TestGdbMi(PipelinedGdbMiStream<TestGdbMiPipe>);
 
 impl TestGdbMi {
     pub fn new(executable_path: impl AsRef<std::ffi::OsStr>) -> Result<Self> {
-        let mut instance = Self::construct_new(executable_path)?;
-        instance.read_output_section()?; // GDB prints a banner first
-        instance.send_command("-exec-run --start")?;
-        instance
-            .read_output_section_with_result()?
+        let mut pipe = TestGdbMiPipe::construct_new(executable_path)?;
+        pipe.read_output_section()?; // GDB prints a banner first
+        pipe.send_command("-exec-run --start")?;
+        pipe.read_output_section_with_result()?
+            .record()?
+            .must_be_done_or_running()?;
+        pipe.read_output_section()?; // Wait for it to pause
+        Ok(Self(PipelinedGdbMiStream::new(pipe)))
+    }
+
+    pub fn run_to_line(&mut self, line: usize) -> Result<()> {
+        let pipe = self.0.pipe_mut();
+        pipe.send_command_fmt(format_args!("-break-insert -t {line}"))?;
+        pipe.read_output_section_with_result()?
+            .record()?
+            .must_be_done_or_running()?;
+        pipe.send_command("-exec-continue")?;
+        pipe.read_output_section_with_result()?
+            .record()?
+            .must_be_done_or_running()?; // GDB will tell us it ran
+        pipe.read_output_section()?; // This output should be generated when it stops
+        Ok(())
+    }
+
+    pub fn step(&mut self) -> Result<()> {
+        let pipe = self.0.pipe_mut();
+        pipe.send_command("-exec-step")?;
+        pipe.read_output_section_with_result()?
+            .record()?
             .must_be_done_or_running()?;
-        instance.read_output_section()?; // Wait for it to pause
-        Ok(instance)
+        pipe.read_output_section()?; // This output should be generated when it stops
+        Ok(())
+    }
+}
+
+impl StringGdbMiStream for TestGdbMi {
+    async fn send_command(&mut self, command: &str) -> std::io::Result<String> {
+        self.0.send_command(command).await
+    }
+
+    async fn send_commands(&mut self, commands: &[String]) -> std::io::Result<Vec<String>> {
+        self.0.send_commands(commands).await
+    }
+}
+
+impl Drop for TestGdbMi {
+    fn drop(&mut self) {
+        let _ = self.0.pipe_mut().send_command("-gdb-exit");
     }
+}
+
+/// Connection to a GDB process that communicates synchronously.
+pub struct TestGdbMiPipe {
+    stdin: ChildStdin,
+    stdout: BufReader<ChildStdout>,
+}
 
+impl TestGdbMiPipe {
     fn construct_new(executable_path: impl AsRef<std::ffi::OsStr>) -> Result<Self> {
         let mut gdb = Self::spawn_gdb(executable_path)?;
         let stdin = gdb
@@ -68,7 +116,9 @@ impl TestGdbMi {
 
     fn read_output_line(&mut self) -> std::io::Result<String> {
         let mut line = String::new();
-        self.stdout.read_line(&mut line)?;
+        if self.stdout.read_line(&mut line)? == 0 {
+            return Err(std::io::ErrorKind::UnexpectedEof.into());
+        }
         Ok(line)
     }
 
@@ -85,44 +135,29 @@ impl TestGdbMi {
         Ok(result_record)
     }
 
-    fn read_output_section_with_result(&mut self) -> Result<ResultRecord> {
+    fn read_output_section_with_result(&mut self) -> Result<GdbMiResponse> {
         let Some(result_record_line) = self.read_output_section()? else {
             return Err(BadResponse::MissingResultRecord.into());
         };
-        let Ok(Record::Result(result_record)) = parse_gdbmi_record(&result_record_line) else {
-            return Err(BadResponse::SyntaxError(result_record_line).into());
-        };
-        Ok(result_record)
-    }
-
-    pub fn run_to_line(&mut self, line: usize) -> Result<()> {
-        self.send_command_fmt(format_args!("-break-insert -t {line}"))?;
-        self.read_output_section_with_result()?
-            .must_be_done_or_running()?;
-        self.send_command("-exec-continue")?;
-        self.read_output_section_with_result()?
-            .must_be_done_or_running()?; // GDB will tell us it ran
-        self.read_output_section()?; // This output should be generated when it stops
-        Ok(())
+        Ok(GdbMiResponse::new(result_record_line))
     }
 
     const OUTPUT_SECTION_END: &str = "(gdb)";
 }
 
-impl GdbMiStream for TestGdbMi {
-    async fn send_command(&mut self, command: &str) -> Result<ResultRecord> {
-        TestGdbMi::send_command(self, command)?;
-        self.read_output_section_with_result()
-    }
-    async fn send_command_fmt(&mut self, args: std::fmt::Arguments<'_>) -> Result<ResultRecord> {
-        TestGdbMi::send_command_fmt(self, args)?;
-        self.read_output_section_with_result()
+impl GdbMiPipe for TestGdbMiPipe {
+    async fn write_line(&mut self, line: &str) -> std::io::Result<()> {
+        self.send_command(line)
     }
-}
 
-impl Drop for TestGdbMi {
-    fn drop(&mut self) {
-        let _ = self.send_command("-gdb-exit");
+    async fn read_result_record(&mut self) -> std::io::Result<String> {
+        // Consume the whole section, so that the prompt that ends it
+        // is not mistaken for the end of the output of a later command
+        loop {
+            if let Some(result_record) = self.read_output_section()? {
+                return Ok(result_record);
+            }
+        }
     }
 }
 
@@ -37,7 +37,7 @@ fn result_tuple_to_js(tuple: &ResultTuple) -> Object {
     for entry in &tuple.0 {
         Reflect::set(
             &jsvalue,
-            &JsString::from(entry.key.as_str()),
+            &JsString::from(entry.key),
             &value_to_js(&entry.value),
         )
         .expect("Types of all objects are verified, this should never fail");
@@ -53,7 +53,7 @@ fn result_list_to_js<'a>(list: impl IntoIterator<Item = &'a Value>) -> Array {
 /// Converts a GDB/MI value to JS object.
 fn value_to_js(value: &Value) -> JsValue {
     match value {
-        Value::Const(s) => JsString::from(s.as_str()).into(),
+        Value::Const(s) => JsString::from(s.as_ref()).into(),
         Value::Tuple(t) => result_tuple_to_js(t).into(),
         Value::List(l) => result_list_to_js(l).into(),
         // We use list here as well, since tuple lists typically have list semantics
@@ -2,13 +2,18 @@
 
 #![cfg(feature = "gdbstate")]
 
-use crate::stylesheet::LengthHintSheet;
+use crate::{
+    perf::{GdbUpdateStatistics, performance_now},
+    stylesheet::{LengthHintSheet, Stylesheet, StylesheetId},
+};
 use aili_gdbstate::{
-    gdbmi::stream::StringGdbMiStream,
+    gdbmi::stream::{CountingGdbMiStream, StringGdbMiStream},
+    history::StateSnapshot,
+    reachability::ReachabilitySheet,
     state::{GdbStateGraph as GdbStateGraphImpl, GdbStateNode, GdbStateNodeId},
 };
 use aili_model::state::{ProgramStateGraph, RootedProgramStateGraph};
-use js_sys::Reflect;
+use js_sys::{Array, Reflect};
 use wasm_bindgen::prelude::*;
 
 #[wasm_bindgen(typescript_custom_section)]
@@ -25,6 +30,16 @@ const TYPESCRIPT_INTERFACES: &str = r"
          * @throws The command is invalid or the session could not execute it.
          */
         sendMiCommand(command: string): Promise<string>;
+        /**
+         * Executes multiple GDB/MI commands without waiting
+         * for each to complete before sending the next.
+         * 
+         * Returns the result records corresponding to the passed commands,
+         * in the same order as the commands.
+         * 
+         * @throws Any of the commands is invalid or the session could not execute it.
+         */
+        sendMiCommands(commands: string[]): Promise<string[]>;
     }
 ";
 
@@ -37,6 +52,10 @@ extern "C" {
     /// Sends a GDB/MI command to the session.
     #[wasm_bindgen(method, js_name = "sendMiCommand", catch)]
     pub async fn send_mi_command(this: &GdbMi, command: &str) -> Result<JsValue, JsValue>;
+
+    /// Sends multiple GDB/MI commands to the session at once.
+    #[wasm_bindgen(method, js_name = "sendMiCommands", catch)]
+    pub async fn send_mi_commands(this: &GdbMi, commands: Vec<String>) -> Result<JsValue, JsValue>;
 }
 
 // Implement the trait for reference so that we can use it mutably
@@ -53,6 +72,23 @@ impl StringGdbMiStream for &GdbMi {
             Err(err) => Err(std::io::Error::other(js_error_description(&err))),
         }
     }
+
+    async fn send_commands(&mut self, commands: &[String]) -> std::io::Result<Vec<String>> {
+        match self.send_mi_commands(commands.to_vec()).await {
+            Ok(outputs) => Array::from(&outputs)
+                .iter()
+                .map(|output| output.as_string())
+                .collect::<Option<Vec<_>>>()
+                .filter(|outputs| outputs.len() == commands.len())
+                .ok_or_else(|| {
+                    std::io::Error::new(
+                        std::io::ErrorKind::InvalidData,
+                        "Commands did not return an array of strings",
+                    )
+                }),
+            Err(err) => Err(std::io::Error::other(js_error_description(&err))),
+        }
+    }
 }
 
 /// Extracts an error description from a JS object that was thrown as an error
@@ -73,33 +109,135 @@ fn js_error_description(value: &JsValue) -> String {
 }
 
 /// [`ProgramStateGraph`] constructed using a GDB/MI session.
+///
+/// Also remembers the hint sheet that was last used,
+/// so results cached by the graph are discarded when it changes,
+/// and the counters of the last update.
 #[wasm_bindgen]
-pub struct GdbStateGraph(pub(crate) GdbStateGraphImpl);
+pub struct GdbStateGraph(
+    pub(crate) GdbStateGraphImpl,
+    StylesheetId,
+    GdbUpdateStatistics,
+);
 
 #[wasm_bindgen]
 impl GdbStateGraph {
     /// Constructs a new state graph from a GDB/MI session.
     #[wasm_bindgen(js_name = "fromSession")]
     pub async fn from_session(
-        mut gdb_mi: &GdbMi,
+        gdb_mi: &GdbMi,
         hint_sheet: &LengthHintSheet,
     ) -> Result<Self, JsError> {
-        aili_gdbstate::state::GdbStateGraph::new_with_hints(&mut gdb_mi, &hint_sheet.0)
+        let start = performance_now();
+        let mut gdb = CountingGdbMiStream::new(gdb_mi);
+        let graph = aili_gdbstate::state::GdbStateGraph::new_with_hints(&mut gdb, &hint_sheet.0)
             .await
-            .map(Self)
-            .map_err(|e| JsError::new(&format!("{e}")))
+            .map_err(|e| JsError::new(&format!("{e}")))?;
+        let statistics = Self::collect_statistics(&graph, gdb, start);
+        Ok(Self(graph, hint_sheet.1, statistics))
+    }
+
+    /// Constructs a new state graph from a GDB/MI session,
+    /// only dereferencing pointers that a visualization stylesheet
+    /// may select something past.
+    #[wasm_bindgen(js_name = "fromSessionWithReachability")]
+    pub async fn from_session_with_reachability(
+        gdb_mi: &GdbMi,
+        hint_sheet: &LengthHintSheet,
+        stylesheet: &Stylesheet,
+    ) -> Result<Self, JsError> {
+        let start = performance_now();
+        let reachability = ReachabilitySheet::new(&stylesheet.0);
+        let mut gdb = CountingGdbMiStream::new(gdb_mi);
+        let graph = aili_gdbstate::state::GdbStateGraph::new_with_reachability(
+            &mut gdb,
+            &hint_sheet.0,
+            &reachability,
+        )
+        .await
+        .map_err(|e| JsError::new(&format!("{e}")))?;
+        let statistics = Self::collect_statistics(&graph, gdb, start);
+        Ok(Self(graph, hint_sheet.1, statistics))
     }
 
     /// Updates the state graph using the provided GDB/MI session.
     pub async fn update(
         &mut self,
-        mut gdb_mi: &GdbMi,
+        gdb_mi: &GdbMi,
         hint_sheet: &LengthHintSheet,
     ) -> Result<(), JsError> {
-        self.0
-            .update_with_hints(&mut gdb_mi, &hint_sheet.0)
-            .await
-            .map_err(|e| JsError::new(&format!("{e}")))
+        let start = performance_now();
+        self.use_hint_sheet(hint_sheet);
+        let mut gdb = CountingGdbMiStream::new(gdb_mi);
+        let result = self.0.update_with_hints(&mut gdb, &hint_sheet.0).await;
+        self.2 = Self::collect_statistics(&self.0, gdb, start);
+        self.discard_taken_changes();
+        result.map_err(|e| JsError::new(&format!("{e}")))
+    }
+
+    /// Updates the state graph using the provided GDB/MI session,
+    /// only dereferencing pointers that a visualization stylesheet
+    /// may select something past.
+    #[wasm_bindgen(js_name = "updateWithReachability")]
+    pub async fn update_with_reachability(
+        &mut self,
+        gdb_mi: &GdbMi,
+        hint_sheet: &LengthHintSheet,
+        stylesheet: &Stylesheet,
+    ) -> Result<(), JsError> {
+        let start = performance_now();
+        let reachability = ReachabilitySheet::new(&stylesheet.0);
+        self.use_hint_sheet(hint_sheet);
+        let mut gdb = CountingGdbMiStream::new(gdb_mi);
+        let result = self
+            .0
+            .update_with_reachability(&mut gdb, &hint_sheet.0, &reachability)
+            .await;
+        self.2 = Self::collect_statistics(&self.0, gdb, start);
+        self.discard_taken_changes();
+        result.map_err(|e| JsError::new(&format!("{e}")))
+    }
+
+    /// Counters of the work done by the last construction or update of the graph.
+    #[wasm_bindgen(getter, js_name = "lastUpdateStatistics")]
+    pub fn last_update_statistics(&self) -> GdbUpdateStatistics {
+        self.2.clone()
+    }
+
+    /// Starts keeping up to `capacity` past states of the graph,
+    /// beginning with the current one.
+    ///
+    /// Past states share unchanged nodes with each other,
+    /// so each of them only takes up memory for what has changed.
+    #[wasm_bindgen(js_name = "enableHistory")]
+    pub fn enable_history(&mut self, capacity: usize) {
+        self.0.enable_history(capacity);
+    }
+
+    /// Stops keeping past states of the graph and discards them.
+    #[wasm_bindgen(js_name = "disableHistory")]
+    pub fn disable_history(&mut self) {
+        self.0.disable_history();
+    }
+
+    /// Number of the oldest past state that is still kept,
+    /// or `undefined` if history is not enabled.
+    #[wasm_bindgen(getter, js_name = "oldestVersion")]
+    pub fn oldest_version(&self) -> Option<usize> {
+        Some(self.0.history()?.oldest().version())
+    }
+
+    /// Number of the current state,
+    /// or `undefined` if history is not enabled.
+    #[wasm_bindgen(getter, js_name = "latestVersion")]
+    pub fn latest_version(&self) -> Option<usize> {
+        Some(self.0.history()?.latest().version())
+    }
+
+    /// Retrieves a past state of the graph by its number,
+    /// or `undefined` if it is no longer kept.
+    pub fn snapshot(&self, version: usize) -> Option<GdbStateSnapshot> {
+        Some(GdbStateSnapshot(self.0.history()?.get(version)?.clone()))
     }
 
     /// Cleans up state that was required by the state graph from the provided GDB/MI session.
@@ -112,6 +250,40 @@ impl GdbStateGraph {
     }
 }
 
+impl GdbStateGraph {
+    /// Collects the counters of an update that started at a given time.
+    fn collect_statistics(
+        graph: &GdbStateGraphImpl,
+        gdb: CountingGdbMiStream<&GdbMi>,
+        start: f64,
+    ) -> GdbUpdateStatistics {
+        let (_, commands) = gdb.into_inner();
+        GdbUpdateStatistics::new(
+            commands,
+            *graph.update_statistics(),
+            performance_now() - start,
+        )
+    }
+
+    /// Drops the changes that the graph accumulates for
+    /// [`GdbStateGraphImpl::take_changed_nodes`].
+    ///
+    /// Renderers follow the changes with their own cursors instead,
+    /// so nobody would ever take them.
+    fn discard_taken_changes(&mut self) {
+        self.0.take_changed_nodes();
+    }
+
+    /// Discards results cached for the previous hint sheet
+    /// if a different one is used now.
+    fn use_hint_sheet(&mut self, hint_sheet: &LengthHintSheet) {
+        if self.1 != hint_sheet.1 {
+            self.0.discard_length_hint_cache();
+            self.1 = hint_sheet.1;
+        }
+    }
+}
+
 impl ProgramStateGraph for GdbStateGraph {
     type NodeId = GdbStateNodeId;
     type NodeRef<'a> = &'a GdbStateNode;
@@ -125,3 +297,33 @@ impl RootedProgramStateGraph for GdbStateGraph {
         self.0.root()
     }
 }
+
+/// Read-only past state of a [`GdbStateGraph`],
+/// obtained from [`GdbStateGraph::snapshot`].
+///
+/// Snapshots remain valid after the graph has been updated or freed.
+#[wasm_bindgen]
+pub struct GdbStateSnapshot(StateSnapshot);
+
+#[wasm_bindgen]
+impl GdbStateSnapshot {
+    /// Number of the state within the history of its graph.
+    #[wasm_bindgen(getter)]
+    pub fn version(&self) -> usize {
+        self.0.version()
+    }
+}
+
+impl ProgramStateGraph for GdbStateSnapshot {
+    type NodeId = GdbStateNodeId;
+    type NodeRef<'a> = &'a GdbStateNode;
+    fn get(&self, id: &Self::NodeId) -> Option<Self::NodeRef<'_>> {
+        self.0.get(id)
+    }
+}
+
+impl RootedProgramStateGraph for GdbStateSnapshot {
+    fn root(&self) -> Self::NodeId {
+        self.0.root()
+    }
+}
@@ -3,8 +3,10 @@
 mod gdbmi;
 mod gdbstate;
 mod log;
+mod perf;
 mod state;
 mod state_description;
+mod state_table;
 mod stylesheet;
 mod translate;
 mod vis;
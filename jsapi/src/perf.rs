@@ -0,0 +1,183 @@
+//! Performance counters of the pipeline, reported to Javascript
+//! so that slow steps can be told apart.
+
+use aili_translate::{cascade::ApplyStatistics, forward::VisTreeWriterStatistics};
+use wasm_bindgen::prelude::*;
+
+#[wasm_bindgen]
+extern "C" {
+    /// High-resolution timestamp in milliseconds.
+    ///
+    /// Standard library clocks are not available on the web,
+    /// so the one provided by the host is used instead.
+    #[wasm_bindgen(js_namespace = performance, js_name = "now")]
+    pub fn performance_now() -> f64;
+}
+
+/// Measures how long an operation takes.
+///
+/// ## Return Value
+/// Output of the operation and the time it took in milliseconds.
+pub fn timed<T>(operation: impl FnOnce() -> T) -> (T, f64) {
+    let start = performance_now();
+    let output = operation();
+    (output, performance_now() - start)
+}
+
+/// Counters of the work done by a single rendering
+/// of a state graph by a renderer.
+#[wasm_bindgen]
+#[derive(Clone, Copy, Default, Debug)]
+pub struct RenderStatistics {
+    /// Time spent applying the stylesheet to the state graph, in milliseconds.
+    #[wasm_bindgen(js_name = "cascadeTime")]
+    pub cascade_time: f64,
+
+    /// Time spent forwarding the resolved style
+    /// to the visualization tree, in milliseconds.
+    #[wasm_bindgen(js_name = "writeTime")]
+    pub write_time: f64,
+
+    /// Number of state nodes the stylesheet has been evaluated at.
+    #[wasm_bindgen(js_name = "nodesVisited")]
+    pub nodes_visited: usize,
+
+    /// Number of state node visits reused from the previous rendering.
+    #[wasm_bindgen(js_name = "visitsReplayed")]
+    pub visits_replayed: usize,
+
+    /// Number of selector states advanced over a node.
+    #[wasm_bindgen(js_name = "selectorStatesEvaluated")]
+    pub selector_states_evaluated: usize,
+
+    /// Number of property values and selector conditions evaluated.
+    #[wasm_bindgen(js_name = "expressionsEvaluated")]
+    pub expressions_evaluated: usize,
+
+    /// Number of operations issued to the visualization tree.
+    #[wasm_bindgen(js_name = "visOperations")]
+    pub vis_operations: usize,
+
+    /// Number of elements and connectors created in the visualization tree.
+    #[wasm_bindgen(js_name = "visEntitiesCreated")]
+    pub vis_entities_created: usize,
+}
+
+impl RenderStatistics {
+    /// Collects the counters of a rendering.
+    pub fn new(
+        cascade: &ApplyStatistics,
+        writer: &VisTreeWriterStatistics,
+        cascade_time: f64,
+        write_time: f64,
+    ) -> Self {
+        Self {
+            cascade_time,
+            write_time,
+            nodes_visited: cascade.nodes_visited,
+            visits_replayed: cascade.visits_replayed,
+            selector_states_evaluated: cascade.selectors.states_evaluated,
+            expressions_evaluated: cascade.expressions_evaluated
+                + cascade.selectors.conditions_evaluated,
+            vis_operations: writer.operations(),
+            vis_entities_created: writer.elements_created + writer.connectors_created,
+        }
+    }
+}
+
+#[cfg(feature = "gdbstate")]
+pub use gdb::GdbUpdateStatistics;
+
+#[cfg(feature = "gdbstate")]
+mod gdb {
+    use aili_gdbstate::{gdbmi::stream::MiStatistics, state::UpdateStatistics};
+    use js_sys::Object;
+    use wasm_bindgen::prelude::*;
+
+    /// Counters of the work done by a single construction
+    /// or update of a state graph.
+    #[wasm_bindgen]
+    #[derive(Clone, Default, Debug)]
+    pub struct GdbUpdateStatistics {
+        /// Counters of the commands sent to GDB.
+        commands: MiStatistics,
+
+        /// Counters of the changes made to the graph.
+        graph: UpdateStatistics,
+
+        /// Time the update took, in milliseconds.
+        update_time: f64,
+    }
+
+    impl GdbUpdateStatistics {
+        /// Collects the counters of an update.
+        pub fn new(commands: MiStatistics, graph: UpdateStatistics, update_time: f64) -> Self {
+            Self {
+                commands,
+                graph,
+                update_time,
+            }
+        }
+    }
+
+    #[wasm_bindgen]
+    impl GdbUpdateStatistics {
+        /// Time the update took, including the time spent waiting for GDB,
+        /// in milliseconds.
+        #[wasm_bindgen(getter, js_name = "updateTime")]
+        pub fn update_time(&self) -> f64 {
+            self.update_time
+        }
+
+        /// Total number of GDB/MI commands sent.
+        #[wasm_bindgen(getter, js_name = "commandCount")]
+        pub fn command_count(&self) -> usize {
+            self.commands.command_count()
+        }
+
+        /// Numbers of GDB/MI commands sent, by the name of the command.
+        ///
+        /// The keys of the object are names of the commands
+        /// and the values are numbers.
+        #[wasm_bindgen(getter, js_name = "commandsByKind")]
+        pub fn commands_by_kind(&self) -> Object {
+            let counts = Object::new();
+            for (name, count) in &self.commands.commands {
+                js_sys::Reflect::set(&counts, &name.into(), &(*count as f64).into())
+                    .expect("Assignment to a fresh object should never fail");
+            }
+            counts
+        }
+
+        /// Total length of the GDB/MI responses that have been parsed.
+        #[wasm_bindgen(getter, js_name = "bytesParsed")]
+        pub fn bytes_parsed(&self) -> usize {
+            self.commands.response_bytes
+        }
+
+        /// Number of variable objects created.
+        #[wasm_bindgen(getter, js_name = "varObjectsCreated")]
+        pub fn var_objects_created(&self) -> usize {
+            self.graph.variables_created
+        }
+
+        /// Number of variable objects deleted.
+        #[wasm_bindgen(getter, js_name = "varObjectsDeleted")]
+        pub fn var_objects_deleted(&self) -> usize {
+            self.graph.variables_removed
+        }
+
+        /// Number of variable objects of returned functions
+        /// that have been reused by a new call instead of being created again.
+        #[wasm_bindgen(getter, js_name = "varObjectsRestored")]
+        pub fn var_objects_restored(&self) -> usize {
+            self.graph.variables_restored
+        }
+
+        /// Number of new objects that have been dereferenced.
+        #[wasm_bindgen(getter)]
+        pub fn dereferences(&self) -> usize {
+            self.graph.dereferences
+        }
+    }
+}
@@ -75,6 +75,10 @@ pub enum NodeTypeClass {
     ///
     /// See [`aili_model::state::NodeTypeClass::Ref`].
     Ref,
+    /// Placeholder of omitted values.
+    ///
+    /// See [`aili_model::state::NodeTypeClass::Truncated`].
+    Truncated,
 }
 
 impl From<NodeTypeClass> for state::NodeTypeClass {
@@ -87,6 +91,7 @@ impl From<NodeTypeClass> for state::NodeTypeClass {
             Struct => Self::Struct,
             Array => Self::Array,
             Ref => Self::Ref,
+            Truncated => Self::Truncated,
         }
     }
 }
@@ -144,7 +149,7 @@ impl EdgeLabel {
     /// See [`aili_model::state::EdgeLabel::Named`].
     pub fn named(name: &str, discriminator: Option<usize>) -> Self {
         Self(state::EdgeLabel::Named(
-            name.to_owned(),
+            name.into(),
             discriminator.unwrap_or_default(),
         ))
     }
@@ -0,0 +1,314 @@
+//! Bulk construction of [`StateGraph`] from typed arrays.
+//!
+//! Building a graph from a [`StateNodeDescription`](crate::state_description::StateNodeDescription)
+//! calls into Javascript several times for every node and edge.
+//! Graphs produced by other tools can instead be encoded
+//! into flat tables and handed over in a single call.
+
+use crate::{
+    state::{StateGraph, StateNode},
+    state_description::NodeTypeClass,
+};
+use aili_model::state;
+use std::collections::{HashMap, hash_map::Entry};
+use wasm_bindgen::prelude::*;
+
+/// Number of integers in a node record.
+const NODE_RECORD_LENGTH: usize = 4;
+
+/// Number of integers in an edge record.
+const EDGE_RECORD_LENGTH: usize = 4;
+
+/// Encoding of a missing string.
+const NONE: u32 = u32::MAX;
+
+/// Kinds of node values in node records.
+mod value_kind {
+    pub const NONE: u32 = 0;
+    pub const INT: u32 = 1;
+    pub const UINT: u32 = 2;
+    pub const BOOL: u32 = 3;
+}
+
+/// Kinds of edge labels in edge records.
+mod label_kind {
+    pub const MAIN: u32 = 0;
+    pub const NEXT: u32 = 1;
+    pub const RESULT: u32 = 2;
+    pub const DEREF: u32 = 3;
+    pub const LENGTH: u32 = 4;
+    pub const NAMED: u32 = 5;
+    pub const INDEX: u32 = 6;
+}
+
+#[wasm_bindgen]
+impl StateGraph {
+    /// Constructs a state graph from its encoding in flat tables.
+    ///
+    /// Nodes are encoded as records of four integers.
+    /// Node at index 0 is the root of the graph and must be of the root type.
+    ///
+    /// | Field      | Meaning                                                     |
+    /// |------------|-------------------------------------------------------------|
+    /// | type kind  | Discriminant of [`NodeTypeClass`]                           |
+    /// | type name  | Index into the string table, or `0xffffffff` if none        |
+    /// | edge count | Number of records in the edge table that lead from the node |
+    /// | value kind | None (0), signed (1), unsigned (2), or boolean (3)          |
+    ///
+    /// Values of the nodes that have them are taken from the value table
+    /// in order of the nodes. Unsigned values are stored as their
+    /// two's complement bit pattern, boolean values as zero or one.
+    ///
+    /// Edges are encoded as records of four integers: the label kind,
+    /// two operands of the label (zero if unused), and the index
+    /// of the target node. Records are grouped by the node they lead from,
+    /// in order of the nodes. No two edges from the same node may have the same label.
+    ///
+    /// | Label kind | Label                    | Operand 1            | Operand 2     |
+    /// |------------|--------------------------|----------------------|---------------|
+    /// | 0          | `EdgeLabel.MAIN`         |                      |               |
+    /// | 1          | `EdgeLabel.NEXT`         |                      |               |
+    /// | 2          | `EdgeLabel.RESULT`       |                      |               |
+    /// | 3          | `EdgeLabel.DEREF`        |                      |               |
+    /// | 4          | `EdgeLabel.LENGTH`       |                      |               |
+    /// | 5          | `EdgeLabel.named`        | name in string table | discriminator |
+    /// | 6          | `EdgeLabel.index`        | index                |               |
+    ///
+    /// Fails if the tables are malformed.
+    #[wasm_bindgen(js_name = "fromTables")]
+    pub fn from_tables(
+        nodes: &[u32],
+        edges: &[u32],
+        values: &[i64],
+        strings: Vec<String>,
+    ) -> Result<StateGraph, JsError> {
+        let nodes = TableReader::new(edges, values, &strings).read_nodes(nodes)?;
+        if nodes.is_empty() {
+            return Err(JsError::new("State graph cannot be empty"));
+        }
+        check_root(nodes.iter().take(1))?;
+        check_edge_targets(&nodes, nodes.len())?;
+        Ok(Self(nodes))
+    }
+
+    /// Replaces nodes of the state graph and adds new ones,
+    /// based on their encoding in flat tables.
+    ///
+    /// Tables are encoded the same way as in [`StateGraph::from_tables`].
+    /// Each node record replaces the node at the corresponding index
+    /// in `nodeIds`, including all of its outgoing edges.
+    /// Nodes are added by using the index that follows the last node,
+    /// so they must be added in order. Nodes that are not replaced
+    /// are kept as they are, even if they are no longer reachable.
+    ///
+    /// The graph is only modified if all the tables are valid.
+    ///
+    /// Fails if the tables are malformed.
+    #[wasm_bindgen(js_name = "updateFromTables")]
+    pub fn update_from_tables(
+        &mut self,
+        node_ids: &[u32],
+        nodes: &[u32],
+        edges: &[u32],
+        values: &[i64],
+        strings: Vec<String>,
+    ) -> Result<(), JsError> {
+        let nodes = TableReader::new(edges, values, &strings).read_nodes(nodes)?;
+        if node_ids.len() != nodes.len() {
+            return Err(JsError::new("Each node record must have an index"));
+        }
+        let mut node_count = self.0.len();
+        for &id in node_ids {
+            match (id as usize).cmp(&node_count) {
+                std::cmp::Ordering::Less => {}
+                std::cmp::Ordering::Equal => node_count += 1,
+                std::cmp::Ordering::Greater => {
+                    return Err(JsError::new(&format!(
+                        "Node {id} cannot be added before node {node_count}"
+                    )));
+                }
+            }
+        }
+        check_root(
+            node_ids
+                .iter()
+                .zip(&nodes)
+                .filter(|(id, _)| **id == 0)
+                .map(|(_, node)| node),
+        )?;
+        check_edge_targets(&nodes, node_count)?;
+        for (id, node) in node_ids.iter().zip(nodes) {
+            let id = *id as usize;
+            if id < self.0.len() {
+                self.0[id] = node;
+            } else {
+                self.0.push(node);
+            }
+        }
+        Ok(())
+    }
+}
+
+/// Verifies that the records of node 0 describe the root node.
+fn check_root<'a>(root_records: impl IntoIterator<Item = &'a StateNode>) -> Result<(), JsError> {
+    if root_records
+        .into_iter()
+        .any(|node| node.type_class != state::NodeTypeClass::Root)
+    {
+        return Err(JsError::new("Node 0 must be the root node"));
+    }
+    Ok(())
+}
+
+/// Verifies that all edges of the nodes lead to existing nodes.
+fn check_edge_targets(nodes: &[StateNode], node_count: usize) -> Result<(), JsError> {
+    let invalid_target = nodes
+        .iter()
+        .flat_map(|node| node.successors.values())
+        .find(|target| **target >= node_count);
+    match invalid_target {
+        Some(target) => Err(JsError::new(&format!(
+            "Edge leads to node {target}, but there are only {node_count} nodes"
+        ))),
+        None => Ok(()),
+    }
+}
+
+/// Decoder of the tables that describe a state graph.
+struct TableReader<'a> {
+    /// Edge records that have not been read yet.
+    edges: std::slice::ChunksExact<'a, u32>,
+
+    /// Node values that have not been read yet.
+    values: std::slice::Iter<'a, i64>,
+
+    /// String table referenced by the records.
+    strings: &'a [String],
+}
+
+impl<'a> TableReader<'a> {
+    /// Starts reading the edge and value tables.
+    fn new(edges: &'a [u32], values: &'a [i64], strings: &'a [String]) -> Self {
+        Self {
+            edges: edges.chunks_exact(EDGE_RECORD_LENGTH),
+            values: values.iter(),
+            strings,
+        }
+    }
+
+    /// Decodes all node records along with their edges.
+    fn read_nodes(mut self, nodes: &[u32]) -> Result<Vec<StateNode>, JsError> {
+        if nodes.len() % NODE_RECORD_LENGTH != 0 {
+            return Err(JsError::new("Node table must consist of whole records"));
+        }
+        let nodes = nodes
+            .chunks_exact(NODE_RECORD_LENGTH)
+            .map(|record| self.read_node(record))
+            .collect::<Result<Vec<_>, _>>()?;
+        // Leftover data most likely means the tables are not aligned
+        if self.edges.len() != 0 || !self.edges.remainder().is_empty() {
+            return Err(JsError::new("Edge table has more records than the nodes"));
+        }
+        if self.values.len() != 0 {
+            return Err(JsError::new("Value table has more values than the nodes"));
+        }
+        Ok(nodes)
+    }
+
+    /// Decodes a single node record, consuming its edges and value.
+    fn read_node(&mut self, record: &[u32]) -> Result<StateNode, JsError> {
+        let &[type_kind, type_name, edge_count, value_kind] = record else {
+            unreachable!("Node records are split into chunks of the right length")
+        };
+        let type_class = node_type_class(type_kind)
+            .ok_or_else(|| JsError::new(&format!("Invalid node type kind {type_kind}")))?;
+        let type_name = match type_name {
+            NONE => None,
+            index => Some(self.string(index)?.to_owned()),
+        };
+        let value = match value_kind {
+            value_kind::NONE => None,
+            value_kind::INT => Some(state::NodeValue::Int(self.value()?)),
+            value_kind::UINT => Some(state::NodeValue::Uint(self.value()? as u64)),
+            value_kind::BOOL => Some(state::NodeValue::Bool(self.value()? != 0)),
+            _ => return Err(JsError::new(&format!("Invalid value kind {value_kind}"))),
+        };
+        // Do not trust the count with the allocation
+        if edge_count as usize > self.edges.len() {
+            return Err(JsError::new("Edge table has fewer records than the nodes"));
+        }
+        let mut successors = HashMap::with_capacity(edge_count as usize);
+        for _ in 0..edge_count {
+            let edge = self
+                .edges
+                .next()
+                .expect("Edge count has been checked against the remaining records");
+            let &[kind, operand, discriminator, target] = edge else {
+                unreachable!("Edge records are split into chunks of the right length")
+            };
+            match successors.entry(self.edge_label(kind, operand, discriminator)?) {
+                Entry::Occupied(entry) => {
+                    return Err(JsError::new(&format!(
+                        "Node has more than one edge labeled {:?}",
+                        entry.key()
+                    )));
+                }
+                Entry::Vacant(entry) => {
+                    entry.insert(target as usize);
+                }
+            }
+        }
+        Ok(StateNode {
+            type_class,
+            type_name,
+            value,
+            successors,
+        })
+    }
+
+    /// Decodes the label of an edge record.
+    fn edge_label(
+        &self,
+        kind: u32,
+        operand: u32,
+        discriminator: u32,
+    ) -> Result<state::EdgeLabel, JsError> {
+        Ok(match kind {
+            label_kind::MAIN => state::EdgeLabel::Main,
+            label_kind::NEXT => state::EdgeLabel::Next,
+            label_kind::RESULT => state::EdgeLabel::Result,
+            label_kind::DEREF => state::EdgeLabel::Deref,
+            label_kind::LENGTH => state::EdgeLabel::Length,
+            label_kind::NAMED => {
+                state::EdgeLabel::Named(self.string(operand)?.into(), discriminator as usize)
+            }
+            label_kind::INDEX => state::EdgeLabel::Index(operand as usize),
+            _ => return Err(JsError::new(&format!("Invalid edge label kind {kind}"))),
+        })
+    }
+
+    /// Looks up a string in the string table.
+    fn string(&self, index: u32) -> Result<&'a str, JsError> {
+        self.strings
+            .get(index as usize)
+            .map(String::as_str)
+            .ok_or_else(|| JsError::new(&format!("String {index} is not in the string table")))
+    }
+
+    /// Reads the next node value.
+    fn value(&mut self) -> Result<i64, JsError> {
+        self.values
+            .next()
+            .copied()
+            .ok_or_else(|| JsError::new("Value table has fewer values than the nodes"))
+    }
+}
+
+/// Decodes the type kind of a node record.
+fn node_type_class(kind: u32) -> Option<state::NodeTypeClass> {
+    use NodeTypeClass::*;
+    [Root, Frame, Atom, Struct, Array, Ref, Truncated]
+        .into_iter()
+        .find(|class| *class as u32 == kind)
+        .map(Into::into)
+}
@@ -4,8 +4,25 @@ use aili_parser::{ParseError, parse_stylesheet};
 use aili_style::{cascade::CascadeStyle, stylesheet};
 use aili_translate::property::PropertyKey;
 use js_sys::Function;
+use std::sync::atomic::{AtomicUsize, Ordering};
 use wasm_bindgen::prelude::*;
 
+/// Unique identifier of a compiled stylesheet.
+///
+/// Results of stylesheet applications can only be reused
+/// with the same stylesheet, so this allows them to tell
+/// stylesheets apart.
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+pub(crate) struct StylesheetId(usize);
+
+impl StylesheetId {
+    /// Generates an identifier that has not been used yet.
+    fn next() -> Self {
+        static NEXT_ID: AtomicUsize = AtomicUsize::new(0);
+        Self(NEXT_ID.fetch_add(1, Ordering::Relaxed))
+    }
+}
+
 /// Declares a stylesheet type for a given target.
 ///
 /// Stylesheets are not dyn-polymorphic,
@@ -14,13 +31,13 @@ macro_rules! declare_stylesheet {
     ( $( #[ $attr:meta ] )* $name:ident ( $key:ty )) => {
         $( #[ $attr ] )*
         #[wasm_bindgen]
-        pub struct $name(pub(crate) CascadeStyle<$key>);
+        pub struct $name(pub(crate) CascadeStyle<$key>, pub(crate) StylesheetId);
 
         #[wasm_bindgen]
         impl $name {
             /// Constructs an empty stylesheet.
             pub fn empty() -> Self {
-                Self(CascadeStyle::empty())
+                Self(CascadeStyle::empty(), StylesheetId::next())
             }
 
             /// Parses and compiles a stylesheet source using [`aili_parser`].
@@ -34,9 +51,36 @@ macro_rules! declare_stylesheet {
                 parse_stylesheet(source, on_error)
                     .map(stylesheet::Stylesheet::map_key)
                     .map(CascadeStyle::from)
-                    .map(Self)
+                    .map(|style| Self(style, StylesheetId::next()))
+                    .map_err(JsError::from)
+            }
+
+            /// Restores a stylesheet serialized by [`Self::to_bytes`].
+            ///
+            /// Fails if the data has been written by a different version
+            /// of the library. Callers should fall back to [`Self::parse`].
+            #[wasm_bindgen(js_name = "fromBytes")]
+            pub fn from_bytes(bytes: &[u8]) -> Result<Self, JsError> {
+                CascadeStyle::from_bytes(bytes)
+                    .map(|style| Self(style, StylesheetId::next()))
                     .map_err(JsError::from)
             }
+
+            /// Serializes the compiled stylesheet, so it can be cached
+            /// and loaded later without parsing.
+            #[wasm_bindgen(js_name = "toBytes")]
+            pub fn to_bytes(&self) -> Vec<u8> {
+                self.0.to_bytes()
+            }
+
+            /// Calculates a hash of a stylesheet source that identifies
+            /// its compiled form in a cache.
+            ///
+            /// See [`CascadeStyle::source_hash`].
+            #[wasm_bindgen(js_name = "sourceHash")]
+            pub fn source_hash(source: &str) -> String {
+                format!("{:016x}", CascadeStyle::<$key>::source_hash(source))
+            }
         }
     };
 }
@@ -4,13 +4,18 @@ mod property_map;
 
 use crate::{
     log::{Logger, Severity},
+    perf::{RenderStatistics, timed},
     state::StateGraph,
-    stylesheet::Stylesheet,
-    vis::VisTree,
+    stylesheet::{Stylesheet, StylesheetId},
+    vis::{BatchedVisTree, FlushVisTree, VisTree, VisTreeCommandSink},
 };
 use aili_model::state::{ProgramStateGraph, RootedProgramStateGraph};
 use aili_style::selectable::Selectable;
-use aili_translate::forward::{VisTreeWriter, VisTreeWriterWarning};
+use aili_translate::{
+    cascade::{ApplyStatistics, ApplyStylesheetCache},
+    forward::{VisTreeWriter, VisTreeWriterWarning},
+    property::EntityPropertyMapping,
+};
 use property_map::PropertyMapSnapshot;
 use wasm_bindgen::prelude::*;
 
@@ -19,23 +24,48 @@ use wasm_bindgen::prelude::*;
 /// State graphs are not dyn-polymorphic,
 /// so the bindings need to distinguish different types.
 macro_rules! declare_renderer {
-    ( $name:ident ( $state:ty ) ) => {
-        /// Program state renderer that renders into a given [`VisTree`].
+    ( $(#[$meta:meta])* $name:ident ( $state:ty, $tree:ty, $target:ty ) ) => {
+        $(#[$meta])*
         #[wasm_bindgen]
-        pub struct $name(VisTreeWriter<'static, <$state as ProgramStateGraph>::NodeId, VisTree>);
+        pub struct $name {
+            /// Writer that updates the visualization tree.
+            writer: VisTreeWriter<'static, <$state as ProgramStateGraph>::NodeId, $tree>,
+
+            /// Results of the last stylesheet application,
+            /// for incremental updates.
+            cache: ApplyStylesheetCache<<$state as ProgramStateGraph>::NodeId>,
+
+            /// Stylesheet with which [`cache`](Self::cache) has been populated.
+            cached_stylesheet: Option<StylesheetId>,
+
+            /// Position in the changes of the graph with which
+            /// [`cache`](Self::cache) has been populated.
+            #[cfg(feature = "gdbstate")]
+            cached_changes: Option<aili_gdbstate::changes::ChangeCursor>,
+
+            /// Counters of the last rendering.
+            statistics: RenderStatistics,
+        }
 
         #[wasm_bindgen]
         impl $name {
-            /// Constructs a new renderer that renders into the provided [`VisTree`].
+            /// Constructs a new renderer that renders into the provided target.
             #[wasm_bindgen(constructor)]
-            pub fn new(tree: VisTree) -> Self {
-                Self(VisTreeWriter::new(tree))
+            pub fn new(target: $target) -> Self {
+                Self {
+                    writer: VisTreeWriter::new(target.into()),
+                    cache: ApplyStylesheetCache::new(),
+                    cached_stylesheet: None,
+                    #[cfg(feature = "gdbstate")]
+                    cached_changes: None,
+                    statistics: RenderStatistics::default(),
+                }
             }
 
             /// Sets the logger to which log messages from the renderer should be sent.
             #[wasm_bindgen(setter, js_name = "logger")]
             pub fn set_logger(&mut self, logger: Option<Logger>) {
-                self.0.set_warning_handler(logger.map(|logger| {
+                self.writer.set_warning_handler(logger.map(|logger| {
                     let handler = move |w| logger.log(Severity::Warning, &format!("{w}"));
                     let boxed: Box<
                         dyn FnMut(VisTreeWriterWarning<<$state as ProgramStateGraph>::NodeId>),
@@ -45,17 +75,17 @@ macro_rules! declare_renderer {
             }
 
             /// Returns a human-readable representation of the current
-            /// resolved style that the renderer has applied to the [`VisTree`].
+            /// resolved style that the renderer has applied to the visualization tree.
             #[wasm_bindgen(js_name = "prettyPrint")]
             pub fn pretty_print(&self) -> String {
-                format!("{:#?}", self.0)
+                format!("{:#?}", self.writer)
             }
 
             /// Retrieves the full property mapping for all tracked nodes.
             #[wasm_bindgen(js_name = "getPropertyMaps")]
             pub fn get_property_maps(&self) -> Vec<PropertyMapSnapshot> {
                 let mut mappings = self
-                    .0
+                    .writer
                     .get_property_maps()
                     .map(|(s, p)| PropertyMapSnapshot::from_property_map(s, p))
                     .collect::<Vec<_>>();
@@ -63,20 +93,148 @@ macro_rules! declare_renderer {
                 mappings
             }
 
+            /// Counters of the work done by the last rendering.
+            #[wasm_bindgen(getter, js_name = "lastRenderStatistics")]
+            pub fn last_render_statistics(&self) -> RenderStatistics {
+                self.statistics
+            }
+
             /// Resolves a [`Stylesheet`] over a state graph and renders the result.
             #[wasm_bindgen(js_name = "applyStylesheet")]
             pub fn apply_stylesheet(&mut self, stylesheet: &Stylesheet, graph: &$state) {
-                let mapping = aili_translate::cascade::apply_stylesheet(&stylesheet.0, graph);
-                self.0.update_root(Some(Selectable::node(graph.root())));
-                self.0.update(mapping);
+                let ((mapping, cascade_statistics), cascade_time) = timed(|| {
+                    aili_translate::cascade::apply_stylesheet_with_statistics(&stylesheet.0, graph)
+                });
+                // The graph may have changed in ways the cache does not know about
+                self.cache.clear();
+                self.cached_stylesheet = None;
+                #[cfg(feature = "gdbstate")]
+                {
+                    self.cached_changes = None;
+                }
+                self.write_mapping(mapping, graph, &cascade_statistics, cascade_time);
+            }
+        }
+
+        impl $name {
+            /// Forwards a resolved stylesheet to the visualization tree
+            /// and records the counters of the rendering.
+            fn write_mapping(
+                &mut self,
+                mapping: EntityPropertyMapping<<$state as ProgramStateGraph>::NodeId>,
+                graph: &$state,
+                cascade_statistics: &ApplyStatistics,
+                cascade_time: f64,
+            ) {
+                let ((), write_time) = timed(|| {
+                    self.writer
+                        .update_root(Some(Selectable::node(graph.root())));
+                    self.writer.update(mapping);
+                    self.writer.vis_tree_mut().flush();
+                });
+                self.statistics = RenderStatistics::new(
+                    cascade_statistics,
+                    &self.writer.take_statistics(),
+                    cascade_time,
+                    write_time,
+                );
             }
         }
     };
 }
 
-declare_renderer!(VisTreeRenderer(StateGraph));
+/// Declares incremental rendering for a renderer type
+/// that renders a [`GdbStateGraph`](crate::gdbstate::GdbStateGraph).
+#[cfg(feature = "gdbstate")]
+macro_rules! declare_incremental_renderer {
+    ( $name:ident ) => {
+        #[wasm_bindgen]
+        impl $name {
+            /// Resolves a [`Stylesheet`] over a state graph and renders the result,
+            /// only re-evaluating the stylesheet over the parts of the graph
+            /// that have changed since the previous call.
+            ///
+            /// Falls back to a full resolution if the stylesheet or the graph
+            /// is not the same as in the previous call.
+            ///
+            /// Each renderer keeps track of the changes it has seen on its own,
+            /// so any number of renderers can render the same graph.
+            #[wasm_bindgen(js_name = "applyStylesheetIncremental")]
+            pub fn apply_stylesheet_incremental(
+                &mut self,
+                stylesheet: &Stylesheet,
+                graph: &crate::gdbstate::GdbStateGraph,
+            ) {
+                let changed_nodes = self
+                    .cached_changes
+                    .and_then(|cursor| graph.0.changed_nodes_since(cursor));
+                if self.cached_stylesheet != Some(stylesheet.1) || changed_nodes.is_none() {
+                    self.cache.clear();
+                    self.cached_stylesheet = Some(stylesheet.1);
+                }
+                self.cached_changes = Some(graph.0.change_cursor());
+                let changed_nodes = changed_nodes.unwrap_or_default();
+                let (mapping, cascade_time) = timed(|| {
+                    aili_translate::cascade::apply_stylesheet_incremental(
+                        &stylesheet.0,
+                        graph,
+                        &mut self.cache,
+                        &changed_nodes,
+                    )
+                });
+                let cascade_statistics = *self.cache.statistics();
+                self.write_mapping(mapping, graph, &cascade_statistics, cascade_time);
+            }
+        }
+    };
+}
+
+declare_renderer!(
+    /// Program state renderer that renders into a given [`VisTree`].
+    VisTreeRenderer(StateGraph, VisTree, VisTree)
+);
+declare_renderer!(
+    /// Program state renderer that records modifications of the visualization
+    /// tree and forwards them to a [`VisTreeCommandSink`] in one batch per update.
+    BatchedVisTreeRenderer(StateGraph, BatchedVisTree, VisTreeCommandSink)
+);
+#[cfg(feature = "gdbstate")]
+declare_renderer!(
+    /// Program state renderer that renders into a given [`VisTree`].
+    GdbVisTreeRenderer(crate::gdbstate::GdbStateGraph, VisTree, VisTree)
+);
+#[cfg(feature = "gdbstate")]
+declare_renderer!(
+    /// Program state renderer that records modifications of the visualization
+    /// tree and forwards them to a [`VisTreeCommandSink`] in one batch per update.
+    BatchedGdbVisTreeRenderer(
+        crate::gdbstate::GdbStateGraph,
+        BatchedVisTree,
+        VisTreeCommandSink
+    )
+);
+#[cfg(feature = "gdbstate")]
+declare_renderer!(
+    /// Program state renderer that renders past states of a
+    /// [`GdbStateGraph`](crate::gdbstate::GdbStateGraph) into a given [`VisTree`].
+    GdbSnapshotVisTreeRenderer(crate::gdbstate::GdbStateSnapshot, VisTree, VisTree)
+);
+#[cfg(feature = "gdbstate")]
+declare_renderer!(
+    /// Program state renderer that renders past states of a
+    /// [`GdbStateGraph`](crate::gdbstate::GdbStateGraph)
+    /// and forwards modifications of the visualization tree
+    /// to a [`VisTreeCommandSink`] in one batch per update.
+    BatchedGdbSnapshotVisTreeRenderer(
+        crate::gdbstate::GdbStateSnapshot,
+        BatchedVisTree,
+        VisTreeCommandSink
+    )
+);
+#[cfg(feature = "gdbstate")]
+declare_incremental_renderer!(GdbVisTreeRenderer);
 #[cfg(feature = "gdbstate")]
-declare_renderer!(GdbVisTreeRenderer(crate::gdbstate::GdbStateGraph));
+declare_incremental_renderer!(BatchedGdbVisTreeRenderer);
 
 /// Resolves a [`Stylesheet`] over a [`StateGraph`] and renders
 /// the result into a [`VisTreeRenderer`].
@@ -0,0 +1,543 @@
+//! Batched bindings for a Javascript-side visualization tree.
+//!
+//! Instead of calling into Javascript on every modification,
+//! [`BatchedVisTree`] records modifications into a command buffer
+//! and hands the whole buffer over in a single call.
+
+use aili_model::vis;
+use std::{cell::RefCell, collections::HashMap, rc::Rc};
+use wasm_bindgen::prelude::*;
+
+#[wasm_bindgen(typescript_custom_section)]
+const TYPESCRIPT_INTERFACES: &str = r"
+    /**
+     * Receiver of batched visualization tree modifications.
+     *
+     * Commands are encoded as sequences of unsigned integers.
+     * The first integer of each command is its opcode,
+     * the rest are its operands. Entities are identified by integer
+     * identifiers assigned by the command that creates them.
+     * Strings are encoded as indices into the string table
+     * that is passed along with the commands.
+     * Missing operands (such as a removed attribute value
+     * or a detached parent) are encoded as `0xffffffff`.
+     *
+     * | Opcode | Command            | Operands                              |
+     * |--------|--------------------|---------------------------------------|
+     * | 0      | Create element     | id, tag name                          |
+     * | 1      | Create connector   | id                                    |
+     * | 2      | Set attribute      | id, part, attribute name, value       |
+     * | 3      | Set parent         | id, parent id                         |
+     * | 4      | Attach pin         | connector id, part, target id         |
+     * | 5      | Set root           | id                                    |
+     * | 6      | Release            | id                                    |
+     *
+     * Part selects the entity itself (0), the start pin (1),
+     * or the end pin (2) of a connector.
+     */
+    interface VisTreeCommandSink {
+        /**
+         * Replays a batch of modifications.
+         *
+         * @param commands Encoded commands.
+         * @param strings String table referenced by the commands.
+         */
+        applyCommands(commands: Uint32Array, strings: string[]): void;
+    }
+";
+
+#[wasm_bindgen]
+extern "C" {
+    /// Receiver of batched modifications made to a [`BatchedVisTree`].
+    #[wasm_bindgen(typescript_type = "VisTreeCommandSink")]
+    pub type VisTreeCommandSink;
+
+    /// Replays a batch of modifications.
+    #[wasm_bindgen(method, js_name = "applyCommands")]
+    pub fn apply_commands(this: &VisTreeCommandSink, commands: &[u32], strings: Vec<String>);
+}
+
+/// Receiver of the command buffers of a [`BatchedVisTree`].
+///
+/// This is implemented by [`VisTreeCommandSink`], other implementations
+/// let the encoding be tested without Javascript.
+pub trait CommandSink {
+    /// Replays a batch of modifications.
+    fn apply_commands(&self, commands: &[u32], strings: Vec<String>);
+}
+
+impl CommandSink for VisTreeCommandSink {
+    fn apply_commands(&self, commands: &[u32], strings: Vec<String>) {
+        VisTreeCommandSink::apply_commands(self, commands, strings);
+    }
+}
+
+/// Opcodes of the commands in the command buffer.
+mod opcode {
+    pub const CREATE_ELEMENT: u32 = 0;
+    pub const CREATE_CONNECTOR: u32 = 1;
+    pub const SET_ATTRIBUTE: u32 = 2;
+    pub const SET_PARENT: u32 = 3;
+    pub const ATTACH_PIN: u32 = 4;
+    pub const SET_ROOT: u32 = 5;
+    pub const RELEASE: u32 = 6;
+}
+
+/// Identifiers of the parts of a visual entity that have their own attributes.
+mod part {
+    pub const SELF: u32 = 0;
+    pub const START: u32 = 1;
+    pub const END: u32 = 2;
+}
+
+/// Encoding of a missing operand.
+const NONE: u32 = u32::MAX;
+
+/// Owner of an entity identifier.
+///
+/// When the last handle to an entity is dropped, its identifier
+/// is queued for release so the Javascript side can let go of the entity.
+#[derive(Debug)]
+struct HandleSlot {
+    id: u32,
+    released: Rc<RefCell<Vec<u32>>>,
+}
+
+impl Drop for HandleSlot {
+    fn drop(&mut self) {
+        self.released.borrow_mut().push(self.id);
+    }
+}
+
+/// Handle to an element or connector of a [`BatchedVisTree`].
+#[derive(Clone, Debug)]
+pub struct BatchedVisHandle(Rc<HandleSlot>);
+
+impl BatchedVisHandle {
+    /// Identifier of the entity in the command buffer.
+    fn id(&self) -> u32 {
+        self.0.id
+    }
+}
+
+/// Visualization tree that records modifications into a command buffer
+/// that is replayed by a [`VisTreeCommandSink`].
+///
+/// Modifications are only forwarded to Javascript when
+/// [`BatchedVisTree::flush`] is called.
+///
+/// Attributes are only written through the batch, they cannot be read back.
+/// [`vis::AttributeMap::get_attribute`] always returns [`None`]
+/// for elements, connectors, and pins of this tree.
+pub struct BatchedVisTree<S: CommandSink = VisTreeCommandSink> {
+    /// Receiver of the recorded commands.
+    sink: S,
+
+    /// Commands that have been recorded since the last flush.
+    commands: Vec<u32>,
+
+    /// String table referenced by [`BatchedVisTree::commands`].
+    strings: Vec<String>,
+
+    /// Indices of strings in [`BatchedVisTree::strings`],
+    /// so each string is only sent once per batch.
+    string_indices: HashMap<String, u32>,
+
+    /// Identifier that will be assigned to the next entity.
+    next_id: u32,
+
+    /// Parents of all live elements.
+    ///
+    /// The structure is tracked on this side of the boundary
+    /// so cycles can be rejected without asking Javascript.
+    parents: HashMap<u32, Option<u32>>,
+
+    /// Identifiers of entities whose handles have all been dropped.
+    released: Rc<RefCell<Vec<u32>>>,
+}
+
+impl<S: CommandSink> BatchedVisTree<S> {
+    /// Constructs an empty tree that sends its modifications to a sink.
+    pub fn new(sink: S) -> Self {
+        Self {
+            sink,
+            commands: Vec::new(),
+            strings: Vec::new(),
+            string_indices: HashMap::new(),
+            next_id: 0,
+            parents: HashMap::new(),
+            released: Rc::default(),
+        }
+    }
+
+    /// Sends all recorded modifications to the sink in a single call.
+    ///
+    /// Does nothing if there are no modifications to send.
+    pub fn flush(&mut self) {
+        // Releases go last, after all commands that may still
+        // reference the released entities
+        for id in self.released.take() {
+            self.parents.remove(&id);
+            self.commands.extend([opcode::RELEASE, id]);
+        }
+        if self.commands.is_empty() {
+            return;
+        }
+        self.string_indices.clear();
+        self.sink
+            .apply_commands(&self.commands, std::mem::take(&mut self.strings));
+        self.commands.clear();
+    }
+
+    /// Adds a string to the string table, unless it is already there,
+    /// and returns its index.
+    fn intern(&mut self, s: &str) -> u32 {
+        if let Some(&index) = self.string_indices.get(s) {
+            return index;
+        }
+        let index = self.strings.len() as u32;
+        self.strings.push(s.to_owned());
+        self.string_indices.insert(s.to_owned(), index);
+        index
+    }
+
+    /// Records an attribute update.
+    fn set_attribute(&mut self, id: u32, part: u32, name: &str, value: Option<&str>) {
+        let name = self.intern(name);
+        let value = value.map(|value| self.intern(value)).unwrap_or(NONE);
+        self.commands
+            .extend([opcode::SET_ATTRIBUTE, id, part, name, value]);
+    }
+
+    /// Creates a new handle with a fresh identifier.
+    fn new_handle(&mut self) -> BatchedVisHandle {
+        let id = self.next_id;
+        self.next_id += 1;
+        BatchedVisHandle(Rc::new(HandleSlot {
+            id,
+            released: self.released.clone(),
+        }))
+    }
+
+    /// Checks whether an element is the same as another element or its ancestor.
+    fn is_same_or_ancestor_of(&self, id: u32, mut other: Option<u32>) -> bool {
+        while let Some(other_id) = other {
+            if other_id == id {
+                return true;
+            }
+            other = self.parents.get(&other_id).copied().flatten();
+        }
+        false
+    }
+}
+
+impl<S: CommandSink> vis::VisTree for BatchedVisTree<S> {
+    type ElementRef<'a>
+        = BatchedVisElement<'a, S>
+    where
+        S: 'a;
+    type ConnectorRef<'a>
+        = BatchedVisConnector<'a, S>
+    where
+        S: 'a;
+    type ElementHandle = BatchedVisHandle;
+    type ConnectorHandle = BatchedVisHandle;
+
+    fn get_connector(
+        &mut self,
+        handle: &Self::ConnectorHandle,
+    ) -> Result<Self::ConnectorRef<'_>, vis::InvalidHandle> {
+        Ok(BatchedVisConnector {
+            id: handle.id(),
+            tree: self,
+        })
+    }
+
+    fn get_element(
+        &mut self,
+        handle: &Self::ElementHandle,
+    ) -> Result<Self::ElementRef<'_>, vis::InvalidHandle> {
+        Ok(BatchedVisElement {
+            id: handle.id(),
+            tree: self,
+        })
+    }
+
+    fn set_root(&mut self, handle: Option<&Self::ElementHandle>) -> Result<(), vis::InvalidHandle> {
+        let id = handle.map(BatchedVisHandle::id).unwrap_or(NONE);
+        self.commands.extend([opcode::SET_ROOT, id]);
+        Ok(())
+    }
+
+    fn add_connector(&mut self) -> Self::ConnectorHandle {
+        let handle = self.new_handle();
+        self.commands
+            .extend([opcode::CREATE_CONNECTOR, handle.id()]);
+        handle
+    }
+
+    fn add_element(&mut self, tag_name: &str) -> Self::ElementHandle {
+        let handle = self.new_handle();
+        let tag_name = self.intern(tag_name);
+        self.commands
+            .extend([opcode::CREATE_ELEMENT, handle.id(), tag_name]);
+        self.parents.insert(handle.id(), None);
+        handle
+    }
+}
+
+/// Element of a [`BatchedVisTree`].
+pub struct BatchedVisElement<'a, S: CommandSink = VisTreeCommandSink> {
+    id: u32,
+    tree: &'a mut BatchedVisTree<S>,
+}
+
+impl<S: CommandSink> vis::AttributeMap for BatchedVisElement<'_, S> {
+    /// Attributes cannot be read through the batch, so this always returns [`None`].
+    fn get_attribute(&self, _: &str) -> Option<&str> {
+        None
+    }
+
+    fn set_attribute(&mut self, name: &str, value: Option<&str>) {
+        self.tree.set_attribute(self.id, part::SELF, name, value);
+    }
+}
+
+impl<S: CommandSink> vis::VisElement for BatchedVisElement<'_, S> {
+    type Handle = BatchedVisHandle;
+
+    fn insert_into(
+        &mut self,
+        parent: Option<&Self::Handle>,
+    ) -> Result<(), vis::ParentAssignmentError> {
+        let parent = parent.map(BatchedVisHandle::id);
+        if self.tree.is_same_or_ancestor_of(self.id, parent) {
+            return Err(vis::ParentAssignmentError::StructureViolation);
+        }
+        self.tree.parents.insert(self.id, parent);
+        self.tree
+            .commands
+            .extend([opcode::SET_PARENT, self.id, parent.unwrap_or(NONE)]);
+        Ok(())
+    }
+}
+
+/// Connector of a [`BatchedVisTree`].
+pub struct BatchedVisConnector<'a, S: CommandSink = VisTreeCommandSink> {
+    id: u32,
+    tree: &'a mut BatchedVisTree<S>,
+}
+
+impl<S: CommandSink> vis::AttributeMap for BatchedVisConnector<'_, S> {
+    /// Attributes cannot be read through the batch, so this always returns [`None`].
+    fn get_attribute(&self, _: &str) -> Option<&str> {
+        None
+    }
+
+    fn set_attribute(&mut self, name: &str, value: Option<&str>) {
+        self.tree.set_attribute(self.id, part::SELF, name, value);
+    }
+}
+
+impl<S: CommandSink> vis::VisConnector for BatchedVisConnector<'_, S> {
+    type Handle = BatchedVisHandle;
+    type PinRef<'a>
+        = BatchedVisPin<'a, S>
+    where
+        Self: 'a;
+
+    fn start_mut(&mut self) -> Self::PinRef<'_> {
+        BatchedVisPin {
+            connector_id: self.id,
+            part: part::START,
+            tree: self.tree,
+        }
+    }
+
+    fn end_mut(&mut self) -> Self::PinRef<'_> {
+        BatchedVisPin {
+            connector_id: self.id,
+            part: part::END,
+            tree: self.tree,
+        }
+    }
+}
+
+/// Either endpoint of a [`BatchedVisConnector`].
+pub struct BatchedVisPin<'a, S: CommandSink = VisTreeCommandSink> {
+    connector_id: u32,
+    part: u32,
+    tree: &'a mut BatchedVisTree<S>,
+}
+
+impl<S: CommandSink> vis::AttributeMap for BatchedVisPin<'_, S> {
+    /// Attributes cannot be read through the batch, so this always returns [`None`].
+    fn get_attribute(&self, _: &str) -> Option<&str> {
+        None
+    }
+
+    fn set_attribute(&mut self, name: &str, value: Option<&str>) {
+        self.tree
+            .set_attribute(self.connector_id, self.part, name, value);
+    }
+}
+
+impl<S: CommandSink> vis::VisPin for BatchedVisPin<'_, S> {
+    type Handle = BatchedVisHandle;
+
+    fn attach_to(&mut self, target: Option<&Self::Handle>) -> Result<(), vis::InvalidHandle> {
+        let target = target.map(BatchedVisHandle::id).unwrap_or(NONE);
+        self.tree
+            .commands
+            .extend([opcode::ATTACH_PIN, self.connector_id, self.part, target]);
+        Ok(())
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use aili_model::vis::{AttributeMap, VisConnector, VisElement, VisPin, VisTree};
+
+    /// Sink that keeps the batches it receives.
+    #[derive(Default)]
+    struct RecordingSink(RefCell<Vec<(Vec<u32>, Vec<String>)>>);
+
+    impl CommandSink for RecordingSink {
+        fn apply_commands(&self, commands: &[u32], strings: Vec<String>) {
+            self.0.borrow_mut().push((commands.to_vec(), strings));
+        }
+    }
+
+    impl BatchedVisTree<RecordingSink> {
+        fn take_batches(&self) -> Vec<(Vec<u32>, Vec<String>)> {
+            self.sink.0.take()
+        }
+    }
+
+    #[test]
+    fn commands_are_encoded_in_order() {
+        let mut tree = BatchedVisTree::new(RecordingSink::default());
+        let parent = tree.add_element("div");
+        let child = tree.add_element("span");
+        let connector = tree.add_connector();
+        tree.get_element(&child)
+            .unwrap()
+            .insert_into(Some(&parent))
+            .unwrap();
+        tree.get_element(&child)
+            .unwrap()
+            .set_attribute("class", Some("div"));
+        tree.get_element(&child)
+            .unwrap()
+            .set_attribute("class", None);
+        let mut connector_ref = tree.get_connector(&connector).unwrap();
+        connector_ref.end_mut().attach_to(Some(&child)).unwrap();
+        connector_ref.start_mut().set_attribute("label", Some("x"));
+        tree.set_root(Some(&parent)).unwrap();
+        tree.flush();
+        assert_eq!(
+            tree.take_batches(),
+            [(
+                [
+                    &[opcode::CREATE_ELEMENT, 0, 0][..],
+                    &[opcode::CREATE_ELEMENT, 1, 1],
+                    &[opcode::CREATE_CONNECTOR, 2],
+                    &[opcode::SET_PARENT, 1, 0],
+                    &[opcode::SET_ATTRIBUTE, 1, part::SELF, 2, 0],
+                    &[opcode::SET_ATTRIBUTE, 1, part::SELF, 2, NONE],
+                    &[opcode::ATTACH_PIN, 2, part::END, 1],
+                    &[opcode::SET_ATTRIBUTE, 2, part::START, 3, 4],
+                    &[opcode::SET_ROOT, 0],
+                ]
+                .concat(),
+                vec![
+                    "div".to_owned(),
+                    "span".to_owned(),
+                    "class".to_owned(),
+                    "label".to_owned(),
+                    "x".to_owned(),
+                ],
+            )]
+        );
+    }
+
+    #[test]
+    fn flush_starts_a_new_batch() {
+        let mut tree = BatchedVisTree::new(RecordingSink::default());
+        let element = tree.add_element("div");
+        tree.flush();
+        // Nothing to send
+        tree.flush();
+        // Strings are interned again in each batch
+        tree.get_element(&element)
+            .unwrap()
+            .set_attribute("class", Some("div"));
+        tree.flush();
+        assert_eq!(
+            tree.take_batches(),
+            [
+                (vec![opcode::CREATE_ELEMENT, 0, 0], vec!["div".to_owned()]),
+                (
+                    vec![opcode::SET_ATTRIBUTE, 0, part::SELF, 0, 1],
+                    vec!["class".to_owned(), "div".to_owned()]
+                ),
+            ]
+        );
+    }
+
+    #[test]
+    fn releases_follow_the_last_use_of_an_entity() {
+        let mut tree = BatchedVisTree::new(RecordingSink::default());
+        let element = tree.add_element("div");
+        let copy = element.clone();
+        drop(element);
+        tree.set_root(Some(&copy)).unwrap();
+        drop(copy);
+        tree.flush();
+        assert_eq!(
+            tree.take_batches(),
+            [(
+                vec![
+                    opcode::CREATE_ELEMENT,
+                    0,
+                    0,
+                    opcode::SET_ROOT,
+                    0,
+                    opcode::RELEASE,
+                    0
+                ],
+                vec!["div".to_owned()]
+            )]
+        );
+    }
+
+    #[test]
+    fn cycles_are_rejected_without_commands() {
+        let mut tree = BatchedVisTree::new(RecordingSink::default());
+        let parent = tree.add_element("div");
+        let child = tree.add_element("div");
+        tree.get_element(&child)
+            .unwrap()
+            .insert_into(Some(&parent))
+            .unwrap();
+        tree.flush();
+        tree.take_batches();
+        for new_parent in [&child, &parent] {
+            let result = tree
+                .get_element(&parent)
+                .unwrap()
+                .insert_into(Some(new_parent));
+            assert!(matches!(
+                result,
+                Err(vis::ParentAssignmentError::StructureViolation)
+            ));
+        }
+        tree.flush();
+        assert!(tree.take_batches().is_empty());
+        assert_eq!(
+            tree.get_element(&child).unwrap().get_attribute("class"),
+            None
+        );
+    }
+}
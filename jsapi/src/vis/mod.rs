@@ -1,8 +1,12 @@
 //! Bindings for a Javascript-side implementation of [`aili_model::vis::VisTree`].
 
+mod batch;
+
 use aili_model::vis;
 use wasm_bindgen::prelude::*;
 
+pub use batch::{BatchedVisTree, VisTreeCommandSink};
+
 #[wasm_bindgen(typescript_custom_section)]
 const TYPESCRIPT_INTERFACES: &str = r"
     /**
@@ -150,6 +154,27 @@ fn set_attribute(attributes: &WithAttributeMap, name: &str, value: Option<&str>)
     }
 }
 
+/// Visualization tree that may hold back modifications
+/// until they are explicitly flushed.
+pub trait FlushVisTree: vis::VisTree {
+    /// Forwards all held back modifications to the tree.
+    fn flush(&mut self) {}
+}
+
+impl FlushVisTree for VisTree {}
+
+impl FlushVisTree for BatchedVisTree {
+    fn flush(&mut self) {
+        BatchedVisTree::flush(self);
+    }
+}
+
+impl From<VisTreeCommandSink> for BatchedVisTree {
+    fn from(value: VisTreeCommandSink) -> Self {
+        Self::new(value)
+    }
+}
+
 impl vis::VisTree for VisTree {
     type ElementRef<'a> = VisElement;
     type ConnectorRef<'a> = VisConnector;
@@ -2,4 +2,5 @@
 //! the main modules of Aili.
 
 pub mod state;
+pub mod symbol;
 pub mod vis;
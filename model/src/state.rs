@@ -3,6 +3,7 @@
 //! Represents the internal state of a debuggee
 //! with a language-independent graph structure.
 
+use crate::symbol::Symbol;
 use derive_more::{Debug, From};
 
 /// Unique identifier of a program state node.
@@ -133,7 +134,8 @@ pub enum EdgeLabel {
     /// [`NodeTypeClass::Ref`]
     ///
     /// ## Permitted Targets
-    /// [`NodeTypeClass::Atom`], [`NodeTypeClass::Struct`], [`NodeTypeClass::Array`], [`NodeTypeClass::Ref`]
+    /// [`NodeTypeClass::Atom`], [`NodeTypeClass::Struct`], [`NodeTypeClass::Array`], [`NodeTypeClass::Ref`],
+    /// [`NodeTypeClass::Truncated`]
     #[debug("ref")]
     Deref,
 
@@ -143,7 +145,8 @@ pub enum EdgeLabel {
     /// [`NodeTypeClass::Array`]
     ///
     /// ## Permitted Targets
-    /// [`NodeTypeClass::Atom`], [`NodeTypeClass::Struct`], [`NodeTypeClass::Array`], [`NodeTypeClass::Ref`]
+    /// [`NodeTypeClass::Atom`], [`NodeTypeClass::Struct`], [`NodeTypeClass::Array`], [`NodeTypeClass::Ref`],
+    /// [`NodeTypeClass::Truncated`]
     #[debug("[{_0}]")]
     Index(usize),
 
@@ -155,13 +158,16 @@ pub enum EdgeLabel {
     /// (edge labels must be unique within their starting node).
     /// Indices should always be sequential.
     ///
+    /// Names are [interned](Symbol), so they compare as cheaply as indices.
+    ///
     /// ## Permitted Sources
     /// [`NodeTypeClass::Root`], [`NodeTypeClass::Frame`], [`NodeTypeClass::Struct`]
     ///
     /// ## Permitted Targets
-    /// [`NodeTypeClass::Atom`], [`NodeTypeClass::Struct`], [`NodeTypeClass::Array`], [`NodeTypeClass::Ref`]
+    /// [`NodeTypeClass::Atom`], [`NodeTypeClass::Struct`], [`NodeTypeClass::Array`], [`NodeTypeClass::Ref`],
+    /// [`NodeTypeClass::Truncated`]
     #[debug("{_0:?}#{_1}")]
-    Named(String, usize),
+    Named(Symbol, usize),
 
     /// Indicates a variable that stores the length of a sequence.
     ///
@@ -185,7 +191,7 @@ pub enum EdgeLabel {
 ///
 /// Nodes of some types may be characterized with a [`NodeValue`],
 /// usualy a numeric one.
-#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+#[derive(Clone, Copy, PartialEq, Eq, Hash, Debug)]
 pub enum NodeTypeClass {
     /// Type of the node that represents the program's global scope.
     ///
@@ -317,6 +323,28 @@ pub enum NodeTypeClass {
     /// | [`EdgeLabel::Deref`] | 1            | The value being referenced |
     #[debug("ref")]
     Ref,
+
+    /// Type of nodes that stand in for parts of the program state
+    /// that have been left out, usually because they are too large.
+    ///
+    /// A truncated node takes the place of the first value that has been
+    /// left out, so the values before it are still complete.
+    ///
+    /// ## Properties
+    /// | Property | Usage |
+    /// |----------|-------|
+    /// | Value    | No    |
+    /// | Type ID  | No    |
+    ///
+    /// ## Permitted Incoming Edges
+    /// | Edge label                                                           | Multiplicity |
+    /// |----------------------------------------------------------------------|--------------|
+    /// | [`EdgeLabel::Named`] or [`EdgeLabel::Index`] or [`EdgeLabel::Deref`] | 1            |
+    ///
+    /// ## Permitted Outgoing Edges
+    /// None.
+    #[debug("trunc")]
+    Truncated,
 }
 
 /// Node in the program state graph.
@@ -0,0 +1,195 @@
+//! Interned strings.
+//!
+//! Names that identify edges of a program state graph are repeated
+//! many times across the graph and across stylesheets that match against it.
+//! Interning them makes comparison of two names as cheap
+//! as comparing two integers.
+
+use derive_more::{Debug, Display};
+use std::{
+    collections::HashSet,
+    hash::{Hash, Hasher},
+    sync::{Arc, LazyLock, Mutex},
+};
+
+/// Interned string.
+///
+/// Two symbols are equal if and only if they have been constructed
+/// from equal strings. Interned symbols are compared by identity,
+/// without comparing their contents.
+///
+/// Interned strings live until the end of the program, so only
+/// [`Symbol::MAX_INTERNED_BYTES`] worth of strings are interned.
+/// Once the limit is reached, symbols of strings that have not
+/// been interned yet own their strings and are compared by contents.
+#[derive(Clone, Debug, Display)]
+#[debug("{:?}", self.as_str())]
+#[display("{}", self.as_str())]
+pub struct Symbol(SymbolRepr);
+
+/// Storage of the string of a [`Symbol`].
+#[derive(Clone)]
+enum SymbolRepr {
+    /// String stored by the interner, which is unique to its contents.
+    Interned(&'static str),
+
+    /// String that has not fit in the interner.
+    ///
+    /// The interner never frees space, so a string that has not fit
+    /// is never interned later. Equal strings therefore
+    /// always have the same representation.
+    Owned(Arc<str>),
+}
+
+/// Strings interned by [`Symbol::new`].
+struct Interner {
+    /// The interned strings.
+    strings: HashSet<&'static str>,
+
+    /// Total length of the interned strings in bytes.
+    bytes: usize,
+}
+
+impl Symbol {
+    /// Maximum total length of strings that are interned, in bytes.
+    pub const MAX_INTERNED_BYTES: usize = 1 << 20;
+
+    /// Interns a string, unless the interner is full.
+    pub fn new(s: &str) -> Self {
+        static INTERNED: LazyLock<Mutex<Interner>> = LazyLock::new(|| {
+            Mutex::new(Interner {
+                strings: HashSet::new(),
+                bytes: 0,
+            })
+        });
+        let mut interned = INTERNED
+            .lock()
+            .expect("Interner should never be poisoned, it does not panic while locked");
+        if let Some(existing) = interned.strings.get(s) {
+            Self(SymbolRepr::Interned(existing))
+        } else if interned.bytes + s.len() <= Self::MAX_INTERNED_BYTES {
+            let leaked: &'static str = Box::leak(s.into());
+            interned.strings.insert(leaked);
+            interned.bytes += leaked.len();
+            Self(SymbolRepr::Interned(leaked))
+        } else {
+            Self(SymbolRepr::Owned(s.into()))
+        }
+    }
+
+    /// Retrieves the string of the symbol.
+    pub fn as_str(&self) -> &str {
+        match &self.0 {
+            SymbolRepr::Interned(s) => s,
+            SymbolRepr::Owned(s) => s,
+        }
+    }
+}
+
+impl PartialEq for Symbol {
+    fn eq(&self, other: &Self) -> bool {
+        match (&self.0, &other.0) {
+            // Each string is only interned once, so identity is equality
+            (SymbolRepr::Interned(a), SymbolRepr::Interned(b)) => std::ptr::eq(*a, *b),
+            (SymbolRepr::Owned(a), SymbolRepr::Owned(b)) => a == b,
+            // Equal strings always have the same representation
+            _ => false,
+        }
+    }
+}
+
+impl Eq for Symbol {}
+
+impl Hash for Symbol {
+    fn hash<H: Hasher>(&self, state: &mut H) {
+        match &self.0 {
+            SymbolRepr::Interned(s) => std::ptr::hash(*s, state),
+            SymbolRepr::Owned(s) => s.hash(state),
+        }
+    }
+}
+
+impl PartialEq<str> for Symbol {
+    fn eq(&self, other: &str) -> bool {
+        self.as_str() == other
+    }
+}
+
+impl PartialEq<&str> for Symbol {
+    fn eq(&self, other: &&str) -> bool {
+        self.as_str() == *other
+    }
+}
+
+impl std::ops::Deref for Symbol {
+    type Target = str;
+    fn deref(&self) -> &Self::Target {
+        self.as_str()
+    }
+}
+
+impl AsRef<str> for Symbol {
+    fn as_ref(&self) -> &str {
+        self.as_str()
+    }
+}
+
+impl From<&str> for Symbol {
+    fn from(value: &str) -> Self {
+        Self::new(value)
+    }
+}
+
+impl From<String> for Symbol {
+    fn from(value: String) -> Self {
+        Self::new(&value)
+    }
+}
+
+impl From<&String> for Symbol {
+    fn from(value: &String) -> Self {
+        Self::new(value)
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    #[test]
+    fn equal_strings_intern_to_same_symbol() {
+        let a = Symbol::new("hello");
+        let b = Symbol::from("hello".to_owned());
+        assert_eq!(a, b);
+        assert!(std::ptr::eq(a.as_str(), b.as_str()));
+        assert_eq!(a, "hello");
+    }
+
+    #[test]
+    fn different_strings_intern_to_different_symbols() {
+        let a = Symbol::new("hello");
+        let b = Symbol::new("world");
+        assert_ne!(a, b);
+        assert_eq!(&*b, "world");
+    }
+
+    #[test]
+    fn symbols_that_do_not_fit_compare_by_contents() {
+        use std::hash::{BuildHasher, RandomState};
+        let a = Symbol(SymbolRepr::Owned("hello".into()));
+        let b = Symbol(SymbolRepr::Owned("hello".into()));
+        assert_eq!(a, b);
+        assert_ne!(a, Symbol(SymbolRepr::Owned("world".into())));
+        assert_eq!(a, "hello");
+        let hasher = RandomState::new();
+        assert_eq!(hasher.hash_one(&a), hasher.hash_one(&b));
+        assert_eq!(format!("{a:?}"), "\"hello\"");
+    }
+
+    #[test]
+    fn symbol_formatting() {
+        let a = Symbol::new("hello");
+        assert_eq!(format!("{a}"), "hello");
+        assert_eq!(format!("{a:?}"), "\"hello\"");
+    }
+}
@@ -0,0 +1,57 @@
+//! Benchmarks of parsing and compiling the stylesheets
+//! of the debugger examples.
+
+use aili_bench::Harness;
+use aili_parser::parse_stylesheet;
+use aili_style::cascade::CascadeStyle;
+
+/// Stylesheets of the debugger examples.
+const EXAMPLES: &[(&str, &str)] = &[
+    ("avl", include_str!("../../debugger/examples/avl/style.txt")),
+    ("bfs", include_str!("../../debugger/examples/bfs/style.txt")),
+    (
+        "binsearch",
+        include_str!("../../debugger/examples/binsearch/style.txt"),
+    ),
+    (
+        "borderarray",
+        include_str!("../../debugger/examples/borderarray/style.txt"),
+    ),
+    (
+        "bubblesort",
+        include_str!("../../debugger/examples/bubblesort/style.txt"),
+    ),
+    ("dfs", include_str!("../../debugger/examples/dfs/style.txt")),
+    (
+        "duval",
+        include_str!("../../debugger/examples/duval/style.txt"),
+    ),
+    (
+        "list",
+        include_str!("../../debugger/examples/list/style.txt"),
+    ),
+    (
+        "vector",
+        include_str!("../../debugger/examples/vector/style.txt"),
+    ),
+];
+
+fn main() {
+    let harness = Harness::from_env();
+    for (name, source) in EXAMPLES {
+        harness.bench(
+            &format!("parse/{name}"),
+            source.len(),
+            "B",
+            || (),
+            |()| parse_stylesheet(source, |_| {}).expect("Example stylesheets should parse"),
+        );
+        harness.bench(
+            &format!("compile/{name}"),
+            source.len(),
+            "B",
+            || parse_stylesheet(source, |_| {}).expect("Example stylesheets should parse"),
+            CascadeStyle::from,
+        );
+    }
+}
@@ -308,15 +308,15 @@ pomelo! {
     limpath ::= limpath(mut p) limseg(s)               { p.push(s); p }
     limseg ::= exact(e)                                { e.into() }
     limseg ::= index(e)                                { if let Expression::Int(i) = e { EdgeLabel::Index(i as usize).into() } else { LimitedEdgeMatcher::DynIndex(e) } }
-    limseg ::= Quoted(s)                               { EdgeLabel::Named(s.to_owned(), 0).into() }
+    limseg ::= Quoted(s)                               { EdgeLabel::Named(s.into(), 0).into() }
 
     // Matchers in selectors (both full and limited)
     matcher ::= Asterisk                               { EdgeMatcher::Any }
     matcher ::= OpenBracket CloseBracket               { EdgeMatcher::AnyIndex }
-    matcher ::= Quoted(s)                              { EdgeMatcher::Named(s.to_owned()) }
+    matcher ::= Quoted(s)                              { EdgeMatcher::Named(s.into()) }
     matcher ::= Percent                                { EdgeMatcher::AnyNamed }
     matcher ::= exact(e)                               { EdgeMatcher::Exact(e) }
-    exact ::= Quoted(s) Hash Int(i)                    { EdgeLabel::Named(s.to_owned(), i as usize) }
+    exact ::= Quoted(s) Hash Int(i)                    { EdgeLabel::Named(s.into(), i as usize) }
     exact ::= Unquoted(s)                              { extra.try_or(edge_label_from_name(s).map_err(SyntaxError::InvalidEdgeLabel), EdgeLabel::Main) }
     extra ::= Extra                                    { String::new() }
     extra ::= Extra OpenParen Unquoted(s) CloseParen   { s.to_owned() }
@@ -277,7 +277,7 @@ mod test {
                 key: StyleKey::Property(RawPropertyKey::Property("value".to_owned())),
                 value: Expression::Select(
                     LimitedSelector::from_path([
-                        EdgeLabel::Named("a".to_owned(), 0).into(),
+                        EdgeLabel::Named("a".into(), 0).into(),
                         EdgeLabel::Index(42).into(),
                     ])
                     .into(),
@@ -333,8 +333,8 @@ mod test {
                             EdgeLabel::Length.into(),
                             EdgeMatcher::AnyIndex,
                             EdgeLabel::Index(42).into(),
-                            EdgeMatcher::Named("a".to_owned()),
-                            EdgeLabel::Named("b".to_owned(), 1).into(),
+                            EdgeMatcher::Named("a".into()),
+                            EdgeLabel::Named("b".into(), 1).into(),
                             EdgeMatcher::Any,
                             EdgeMatcher::AnyNamed,
                         ]
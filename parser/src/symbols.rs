@@ -70,14 +70,15 @@ pub fn unary_function_by_name(name: &str) -> Result<UnaryOperator, InvalidSymbol
 /// Maps [`NodeTypeClass`]es to their names.
 ///
 /// ## Symbol Names
-/// | Symbol name | Associated type class             |
-/// |-------------|-----------------------------------|
-/// | `root`      | [`Root`](NodeTypeClass::Root)     |
-/// | `frame`     | [`Frame`](NodeTypeClass::Frame)   |
-/// | `val`       | [`Atom`](NodeTypeClass::Atom)     |
-/// | `struct`    | [`Struct`](NodeTypeClass::Struct) |
-/// | `arr`       | [`Array`](NodeTypeClass::Array)   |
-/// | `ref`       | [`Ref`](NodeTypeClass::Ref)       |
+/// | Symbol name | Associated type class                   |
+/// |-------------|-----------------------------------------|
+/// | `root`      | [`Root`](NodeTypeClass::Root)           |
+/// | `frame`     | [`Frame`](NodeTypeClass::Frame)         |
+/// | `val`       | [`Atom`](NodeTypeClass::Atom)           |
+/// | `struct`    | [`Struct`](NodeTypeClass::Struct)       |
+/// | `arr`       | [`Array`](NodeTypeClass::Array)         |
+/// | `ref`       | [`Ref`](NodeTypeClass::Ref)             |
+/// | `trunc`     | [`Truncated`](NodeTypeClass::Truncated) |
 pub fn node_type_class_by_name(name: &str) -> Result<NodeTypeClass, InvalidSymbol> {
     match name {
         "root" => Ok(NodeTypeClass::Root),
@@ -86,6 +87,7 @@ pub fn node_type_class_by_name(name: &str) -> Result<NodeTypeClass, InvalidSymbo
         "struct" => Ok(NodeTypeClass::Struct),
         "arr" => Ok(NodeTypeClass::Array),
         "ref" => Ok(NodeTypeClass::Ref),
+        "trunc" => Ok(NodeTypeClass::Truncated),
         _ => Err(InvalidSymbol(name.to_owned())),
     }
 }
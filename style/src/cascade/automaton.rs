@@ -0,0 +1,634 @@
+//! Lazily determinized form of a [`CascadeSelector`].
+//!
+//! The selectors of a stylesheet form a nondeterministic state machine.
+//! [`SelectorResolver`](super::SelectorResolver) tracks sets of its states,
+//! and this module caches transitions between those sets, so that
+//! traversing an edge or a node that has been seen before
+//! in the same situation is a table lookup.
+//!
+//! Most selectors test the type of the node they select.
+//! Transitions over nodes are therefore also cached by the classes
+//! of the nodes' types, so that selectors of other types
+//! are not evaluated at each node.
+
+use super::{
+    selector_resolver::{SelectionCaret, SelectorState},
+    style::{CascadeSelector, CompiledExpression, FlatSelector, FlatSelectorSegment},
+};
+use crate::{
+    eval::{
+        context::{EvaluationContext, StatelessEvaluation},
+        evaluate,
+    },
+    stylesheet::{
+        expression::{BinaryOperator, Expression, ExpressionDependency, UnaryOperator},
+        selector::EdgeMatcher,
+    },
+};
+use aili_model::{
+    state::{EdgeLabel, NodeTypeClass, NodeTypeId, ProgramStateGraph, ProgramStateNode},
+    symbol::Symbol,
+};
+use std::{
+    collections::{BTreeSet, HashMap, HashSet},
+    sync::Arc,
+};
+
+/// Partition of [`EdgeLabel`]s by the matchers in a stylesheet.
+///
+/// Two labels that fall into the same class are matched
+/// by exactly the same [`EdgeMatcher`]s of the stylesheet.
+#[derive(Clone, PartialEq, Eq, Hash, Debug)]
+pub(super) enum EdgeClass {
+    /// A label that is matched exactly by some selector,
+    /// or a label that takes no parameters.
+    Label(EdgeLabel),
+
+    /// [`EdgeLabel::Index`] that no selector matches exactly.
+    OtherIndex,
+
+    /// [`EdgeLabel::Named`] with a name that some selector matches,
+    /// but a discriminator that no selector matches exactly.
+    Named(Symbol),
+
+    /// [`EdgeLabel::Named`] with a name that no selector matches.
+    OtherNamed,
+}
+
+/// Assigns [`EdgeClass`]es to [`EdgeLabel`]s.
+#[derive(Debug, Default)]
+pub(super) struct EdgeClassifier {
+    /// Edge labels that are matched by [`EdgeMatcher::Exact`].
+    exact_labels: HashSet<EdgeLabel>,
+
+    /// Names that are matched by [`EdgeMatcher::Named`].
+    names: HashSet<Symbol>,
+}
+
+impl EdgeClassifier {
+    /// Collects all edge matchers of the selectors.
+    pub fn new<'a>(selectors: impl IntoIterator<Item = &'a FlatSelector>) -> Self {
+        let mut classifier = Self::default();
+        for segment in selectors.into_iter().flat_map(|s| &s.path) {
+            match segment {
+                FlatSelectorSegment::MatchEdge(EdgeMatcher::Exact(label)) => {
+                    classifier.exact_labels.insert(label.clone());
+                }
+                FlatSelectorSegment::MatchEdge(EdgeMatcher::Named(name)) => {
+                    classifier.names.insert(name.clone());
+                }
+                _ => {}
+            }
+        }
+        classifier
+    }
+
+    /// Finds the class of an edge label.
+    pub fn classify(&self, label: &EdgeLabel) -> EdgeClass {
+        if self.exact_labels.contains(label) {
+            return EdgeClass::Label(label.clone());
+        }
+        match label {
+            EdgeLabel::Index(_) => EdgeClass::OtherIndex,
+            EdgeLabel::Named(name, _) if self.names.contains(name) => EdgeClass::Named(name.clone()),
+            EdgeLabel::Named(_, _) => EdgeClass::OtherNamed,
+            _ => EdgeClass::Label(label.clone()),
+        }
+    }
+}
+
+/// Partition of program state nodes by the type conditions in a stylesheet.
+///
+/// Two nodes that fall into the same class pass exactly the same
+/// [type conditions](NodeClassifier::evaluate_type_condition) of the stylesheet.
+#[derive(Clone, Copy, PartialEq, Eq, Hash, Debug)]
+pub(super) struct NodeClass {
+    /// Type class of the node, [`None`] if there is no node.
+    type_class: Option<NodeTypeClass>,
+
+    /// Type name of the node.
+    type_name: TypeNameClass,
+}
+
+/// Partition of type names by the conditions in a stylesheet.
+#[derive(Clone, Copy, PartialEq, Eq, Hash, Debug)]
+enum TypeNameClass {
+    /// The node has no type name, or there is no node.
+    None,
+
+    /// A type name that some condition compares against,
+    /// identified by its index in [`NodeClassifier::type_names`].
+    Listed(usize),
+
+    /// A type name that no condition compares against.
+    Other,
+}
+
+/// Assigns [`NodeClass`]es to program state nodes.
+#[derive(Debug, Default)]
+pub(super) struct NodeClassifier {
+    /// Type names that conditions compare against, with their indices.
+    type_names: HashMap<String, usize>,
+}
+
+impl NodeClassifier {
+    /// Collects all type names tested by conditions of the selectors.
+    pub fn new<'a>(selectors: impl IntoIterator<Item = &'a FlatSelector>) -> Self {
+        let mut classifier = Self::default();
+        for segment in selectors.into_iter().flat_map(|s| &s.path) {
+            if let FlatSelectorSegment::Restrict(condition) = segment {
+                classifier.collect_type_names(condition);
+            }
+        }
+        classifier
+    }
+
+    /// Finds the class of the node from which expressions are evaluated.
+    pub fn classify<T: ProgramStateGraph>(&self, context: &EvaluationContext<T>) -> NodeClass {
+        let node = context
+            .graph
+            .zip(context.select_origin.as_ref())
+            .and_then(|(graph, node_id)| graph.get(node_id));
+        let Some(node) = node else {
+            return NodeClass {
+                type_class: None,
+                type_name: TypeNameClass::None,
+            };
+        };
+        let type_name = match node.node_type_id() {
+            Some(type_id) => match self.type_names.get(type_id.type_name()) {
+                Some(index) => TypeNameClass::Listed(*index),
+                None => TypeNameClass::Other,
+            },
+            None => TypeNameClass::None,
+        };
+        NodeClass {
+            type_class: Some(node.node_type_class()),
+            type_name,
+        }
+    }
+
+    /// Evaluates a condition that only depends on the type of the node
+    /// from which it is evaluated, for any node of a given class.
+    ///
+    /// Type conditions are composed of tests like `is-struct(@)` and
+    /// `typename(@) == "name"`, negations, conjunctions, disjunctions,
+    /// and constants.
+    ///
+    /// ## Return Value
+    /// Truthiness of the condition, or [`None`] if it is not a type condition.
+    pub fn evaluate_type_condition(
+        &self,
+        condition: &Expression,
+        class: NodeClass,
+    ) -> Option<bool> {
+        if condition.dependency() == ExpressionDependency::Constant {
+            return Some(evaluate(condition, &StatelessEvaluation::new()).is_truthy());
+        }
+        match condition {
+            Expression::UnaryOperator(UnaryOperator::Not, operand) => self
+                .evaluate_type_condition(operand, class)
+                .map(std::ops::Not::not),
+            Expression::UnaryOperator(UnaryOperator::NodeIsA(type_class), operand)
+                if is_origin(operand) =>
+            {
+                Some(class.type_class == Some(*type_class))
+            }
+            Expression::BinaryOperator(left, BinaryOperator::And, right) => {
+                // Neither side has side effects, so the condition
+                // can be short-circuited
+                Some(
+                    self.evaluate_type_condition(left, class)?
+                        && self.evaluate_type_condition(right, class)?,
+                )
+            }
+            Expression::BinaryOperator(left, BinaryOperator::Or, right) => Some(
+                self.evaluate_type_condition(left, class)?
+                    || self.evaluate_type_condition(right, class)?,
+            ),
+            Expression::BinaryOperator(
+                left,
+                operator @ (BinaryOperator::Eq | BinaryOperator::Ne),
+                right,
+            ) => {
+                let name = compared_type_name(left, right)?;
+                let is_equal = matches!(
+                    class.type_name,
+                    TypeNameClass::Listed(index) if self.type_names.get(name) == Some(&index)
+                );
+                Some(is_equal == (*operator == BinaryOperator::Eq))
+            }
+            _ => None,
+        }
+    }
+
+    /// Collects type names compared against in an expression.
+    fn collect_type_names(&mut self, expression: &Expression) {
+        match expression {
+            Expression::UnaryOperator(_, operand) => self.collect_type_names(operand),
+            Expression::BinaryOperator(left, _, right) => {
+                if let Some(name) = compared_type_name(left, right) {
+                    let next_index = self.type_names.len();
+                    self.type_names.entry(name.to_owned()).or_insert(next_index);
+                }
+                self.collect_type_names(left);
+                self.collect_type_names(right);
+            }
+            Expression::Conditional(condition, if_true, if_false) => {
+                self.collect_type_names(condition);
+                self.collect_type_names(if_true);
+                self.collect_type_names(if_false);
+            }
+            _ => {}
+        }
+    }
+}
+
+/// Checks whether an expression selects the node from which it is evaluated.
+fn is_origin(expression: &Expression) -> bool {
+    matches!(
+        expression,
+        Expression::Select(selector)
+            if selector.path.is_empty() && selector.origin.is_none() && selector.extra_label.is_none()
+    )
+}
+
+/// If the operands of a binary operator are `typename(@)`
+/// and a string literal, in either order, retrieves the literal.
+fn compared_type_name<'a>(left: &'a Expression, right: &'a Expression) -> Option<&'a str> {
+    let is_type_name_of_origin = |expression: &Expression| {
+        matches!(
+            expression,
+            Expression::UnaryOperator(UnaryOperator::NodeTypeName, operand) if is_origin(operand)
+        )
+    };
+    match (left, right) {
+        (type_name, Expression::String(name)) | (Expression::String(name), type_name)
+            if is_type_name_of_origin(type_name) =>
+        {
+            Some(name)
+        }
+        _ => None,
+    }
+}
+
+/// Identifier of a set of selector states interned by [`AutomatonCache`].
+pub(super) type StateSetId = usize;
+
+/// Outcome of resolving a node whose resolution does not depend
+/// on the node itself, as long as the node has not been matched
+/// by any of the sequence points before.
+#[derive(Debug)]
+pub(super) struct NodeTransition {
+    /// States that await an outgoing edge of the node.
+    pub output: StateSetId,
+
+    /// Rules that match the node or its preceding edge.
+    pub matched_rules: Vec<(usize, SelectionCaret)>,
+
+    /// Sequence points that commit to the node, in order.
+    pub sequence_points: Vec<SelectorState>,
+}
+
+/// Cached transitions of the determinized selector state machine.
+#[derive(Debug, Default)]
+pub(super) struct AutomatonCache {
+    /// Interned sets of states, indexed by their identifiers.
+    sets: Vec<Arc<[SelectorState]>>,
+
+    /// Identifiers of interned sets of states.
+    set_ids: HashMap<Arc<[SelectorState]>, StateSetId>,
+
+    /// Transitions along edges.
+    edge_transitions: HashMap<(StateSetId, EdgeClass), StateSetId>,
+
+    /// Transitions over nodes, [`None`] if the transition
+    /// depends on the node and cannot be cached.
+    node_transitions: HashMap<StateSetId, Option<Arc<NodeTransition>>>,
+
+    /// Transitions over nodes that only depend on the classes of the nodes,
+    /// [`None`] if the transition depends on more than that.
+    typed_node_transitions: HashMap<(StateSetId, NodeClass), Option<Arc<NodeTransition>>>,
+}
+
+impl AutomatonCache {
+    /// Identifier of the empty set, which is always interned first.
+    pub const EMPTY_SET: StateSetId = 0;
+
+    /// Constructs a cache for a stylesheet.
+    pub fn new() -> Self {
+        let mut cache = Self::default();
+        cache.intern(Vec::new());
+        cache
+    }
+
+    /// Retrieves an interned set of states.
+    pub fn set(&self, id: StateSetId) -> &Arc<[SelectorState]> {
+        &self.sets[id]
+    }
+
+    /// Interns a set of states.
+    ///
+    /// The order of the states is significant, it decides the order
+    /// in which they will be resolved.
+    pub fn intern(&mut self, states: Vec<SelectorState>) -> StateSetId {
+        if let Some(id) = self.set_ids.get(states.as_slice()) {
+            return *id;
+        }
+        let id = self.sets.len();
+        let states = Arc::<[SelectorState]>::from(states);
+        self.sets.push(states.clone());
+        self.set_ids.insert(states, id);
+        id
+    }
+
+    /// Finds the set of states the machine moves to after traversing an edge.
+    pub fn edge_transition(
+        &mut self,
+        selectors: &CascadeSelector,
+        from: StateSetId,
+        edge_label: &EdgeLabel,
+    ) -> StateSetId {
+        if from == Self::EMPTY_SET {
+            return Self::EMPTY_SET;
+        }
+        let key = (from, selectors.edge_classifier.classify(edge_label));
+        if let Some(to) = self.edge_transitions.get(&key) {
+            return *to;
+        }
+        let states = self.sets[from]
+            .iter()
+            .filter(|state| {
+                matches!(
+                    selectors.instruction(**state),
+                    Some(FlatSelectorSegment::MatchEdge(matcher)) if matcher.matches(edge_label)
+                )
+            })
+            .copied()
+            .map(SelectorState::advance)
+            .collect();
+        let to = self.intern(states);
+        self.edge_transitions.insert(key, to);
+        to
+    }
+
+    /// Finds the outcome of resolving a node, if it can be determined
+    /// without looking at the node.
+    pub fn node_transition(
+        &mut self,
+        selectors: &CascadeSelector,
+        from: StateSetId,
+    ) -> Option<Arc<NodeTransition>> {
+        if let Some(transition) = self.node_transitions.get(&from) {
+            return transition.clone();
+        }
+        // Give up once a condition that depends on the node comes up
+        let transition = self.close_over_any_node(selectors, from, |condition| {
+            (condition.dependency == ExpressionDependency::Constant)
+                .then(|| evaluate(condition, &StatelessEvaluation::new()).is_truthy())
+        });
+        self.node_transitions.insert(from, transition.clone());
+        transition
+    }
+
+    /// Finds the outcome of resolving a node, if it can be determined
+    /// from the [class](NodeClassifier::classify) of the node.
+    pub fn typed_node_transition(
+        &mut self,
+        selectors: &CascadeSelector,
+        from: StateSetId,
+        class: NodeClass,
+    ) -> Option<Arc<NodeTransition>> {
+        if let Some(transition) = self.typed_node_transitions.get(&(from, class)) {
+            return transition.clone();
+        }
+        // Give up once a condition that depends on more than the type comes up
+        let transition = self.close_over_any_node(selectors, from, |condition| {
+            selectors
+                .node_classifier
+                .evaluate_type_condition(condition, class)
+        });
+        self.typed_node_transitions
+            .insert((from, class), transition.clone());
+        transition
+    }
+
+    /// Resolves a node as if it has never been matched before.
+    fn close_over_any_node(
+        &mut self,
+        selectors: &CascadeSelector,
+        from: StateSetId,
+        evaluate_condition: impl FnMut(&CompiledExpression) -> Option<bool>,
+    ) -> Option<Arc<NodeTransition>> {
+        let mut sequence_points = Vec::new();
+        let closure = close_over_node(selectors, &self.sets[from], evaluate_condition, |state| {
+            sequence_points.push(state);
+            true
+        });
+        closure.map(|(output, matched_rules)| {
+            Arc::new(NodeTransition {
+                output: self.intern(output),
+                matched_rules,
+                sequence_points,
+            })
+        })
+    }
+}
+
+/// States that await an outgoing edge of a node
+/// and rules that match the node, as found by [`close_over_node`].
+pub(super) type NodeClosure = (Vec<SelectorState>, Vec<(usize, SelectionCaret)>);
+
+/// Makes a transitive closure of selector states reachable at a node.
+///
+/// ## Parameters
+/// - `states` - States that are awaiting the node.
+/// - `evaluate_condition` - Evaluates a [`FlatSelectorSegment::Restrict`]
+///   condition, or returns [`None`] to abort the resolution.
+/// - `commit_sequence_point` - Checks whether a [`FlatSelectorSegment::MatchNode`]
+///   may commit to the node and records that it did.
+///
+/// ## Return Value
+/// States that await an outgoing edge of the node and rules that match the node,
+/// or [`None`] if the resolution has been aborted.
+pub(super) fn close_over_node(
+    selectors: &CascadeSelector,
+    states: &[SelectorState],
+    mut evaluate_condition: impl FnMut(&CompiledExpression) -> Option<bool>,
+    mut commit_sequence_point: impl FnMut(SelectorState) -> bool,
+) -> Option<NodeClosure> {
+    // States of the selector state machine that have been visited
+    // while evaluating this node
+    let mut visited_states = BTreeSet::new();
+    // States that are yet to be visited and whether the node has already
+    // been committed when we reach them
+    let mut open_states =
+        Vec::from_iter(states.iter().map(|s| (*s, SelectionCaret::PrecedingEdge)));
+    // States that are blocked by an edge matcher
+    // and must be resolved by traversing further down the graph
+    let mut output_states = Vec::new();
+    // Rules whose selector selected this element or a related entity
+    let mut matched_rules = Vec::new();
+
+    while let Some((state, target)) = open_states.pop() {
+        let Some(instruction) = selectors.instruction(state) else {
+            // We made it to the end of the selector
+            // That means it has matched the node
+            matched_rules.push((state.rule_index, target));
+            continue;
+        };
+        // Proceed, unless we have been here already
+        // This prevents infinite loops caused by poorly written selectors
+        if !visited_states.insert(state) {
+            continue;
+        }
+        match instruction {
+            FlatSelectorSegment::MatchEdge(_) => {
+                // Traversing an edge is only permitted if the node has already been committed
+                // This ensures the resolver halts by only allowing each edge to be traversed once
+                if target == SelectionCaret::Node {
+                    // This is where we must halt and send the selector
+                    // along the edge later on, after we are done with
+                    // all partial matches on this node
+                    output_states.push(state);
+                }
+                // TODO: Emit a warning if we fail this check?
+                // This can never happen when using flattened regular selectors
+                // but it is possible to manually construct a flat selector
+                // that does not uphold this invariant
+            }
+            FlatSelectorSegment::MatchNode => {
+                // Proceed only if the selector has never partially matched
+                // this node in this way
+                if commit_sequence_point(state) {
+                    // Continue traversing the state machine linearly
+                    // and commit to the node
+                    open_states.push((state.advance(), SelectionCaret::Node));
+                }
+            }
+            FlatSelectorSegment::Restrict(condition) => {
+                // Proceed only if the condition holds
+                if evaluate_condition(condition)? {
+                    // continue traversing the state machine linearly
+                    open_states.push((state.advance(), target));
+                }
+            }
+            FlatSelectorSegment::Branch(next_state) => {
+                // Continue both linearly and from the indicated state
+                open_states.push((state.jump(*next_state), target));
+                open_states.push((state.advance(), target));
+            }
+            FlatSelectorSegment::Jump(next_state) => {
+                // Continue only from the indicated state
+                open_states.push((state.jump(*next_state), target));
+            }
+        }
+    }
+    Some((output_states, matched_rules))
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use crate::stylesheet::selector::{Selector, SelectorPath, SelectorSegment};
+
+    fn flat_selector(matchers: impl IntoIterator<Item = EdgeMatcher>) -> FlatSelector {
+        Selector::from_path(SelectorPath(
+            matchers.into_iter().map(SelectorSegment::Match).collect(),
+        ))
+        .into()
+    }
+
+    #[test]
+    fn classify_edges_by_matchers() {
+        let selectors = [
+            flat_selector([EdgeMatcher::Named("a".into()), EdgeMatcher::AnyIndex]),
+            flat_selector([
+                EdgeMatcher::Exact(EdgeLabel::Index(3)),
+                EdgeMatcher::Exact(EdgeLabel::Named("b".into(), 1)),
+            ]),
+        ];
+        let classifier = EdgeClassifier::new(&selectors);
+        let classify = |label| classifier.classify(&label);
+        assert_eq!(classify(EdgeLabel::Index(0)), classify(EdgeLabel::Index(1)));
+        assert_eq!(
+            classify(EdgeLabel::Index(3)),
+            EdgeClass::Label(EdgeLabel::Index(3))
+        );
+        assert_eq!(
+            classify(EdgeLabel::Named("a".into(), 0)),
+            classify(EdgeLabel::Named("a".into(), 1))
+        );
+        assert_ne!(
+            classify(EdgeLabel::Named("a".into(), 0)),
+            classify(EdgeLabel::Named("c".into(), 0))
+        );
+        assert_eq!(
+            classify(EdgeLabel::Named("b".into(), 0)),
+            classify(EdgeLabel::Named("c".into(), 0))
+        );
+        assert_ne!(
+            classify(EdgeLabel::Named("b".into(), 1)),
+            classify(EdgeLabel::Named("b".into(), 0))
+        );
+        assert_eq!(
+            classify(EdgeLabel::Deref),
+            EdgeClass::Label(EdgeLabel::Deref)
+        );
+    }
+    #[test]
+    fn evaluate_type_conditions_by_class() {
+        let origin = || Box::new(Expression::Select(Box::default()));
+        let is_struct =
+            Expression::UnaryOperator(UnaryOperator::NodeIsA(NodeTypeClass::Struct), origin());
+        let is_named = |name: &str| {
+            Expression::BinaryOperator(
+                Box::new(Expression::UnaryOperator(
+                    UnaryOperator::NodeTypeName,
+                    origin(),
+                )),
+                BinaryOperator::Eq,
+                Box::new(Expression::String(name.to_owned())),
+            )
+        };
+        let struct_node = Expression::BinaryOperator(
+            Box::new(is_struct.clone()),
+            BinaryOperator::And,
+            Box::new(is_named("node")),
+        );
+        let not_tree = Expression::UnaryOperator(UnaryOperator::Not, Box::new(is_named("tree")));
+        let selectors: Vec<FlatSelector> = [struct_node.clone(), not_tree.clone()]
+            .into_iter()
+            .map(|condition| {
+                Selector::from_path(SelectorPath(vec![SelectorSegment::Condition(condition)]))
+                    .into()
+            })
+            .collect();
+        let classifier = NodeClassifier::new(&selectors);
+        let class = |type_class, type_name| NodeClass {
+            type_class: Some(type_class),
+            type_name: match type_name {
+                Some(name) => classifier
+                    .type_names
+                    .get(name)
+                    .map_or(TypeNameClass::Other, |i| TypeNameClass::Listed(*i)),
+                None => TypeNameClass::None,
+            },
+        };
+        let node = class(NodeTypeClass::Struct, Some("node"));
+        let tree = class(NodeTypeClass::Struct, Some("tree"));
+        let other = class(NodeTypeClass::Struct, Some("other"));
+        let atom = class(NodeTypeClass::Atom, None);
+        let evaluate = |condition, class| classifier.evaluate_type_condition(condition, class);
+        assert_eq!(evaluate(&struct_node, node), Some(true));
+        assert_eq!(evaluate(&struct_node, tree), Some(false));
+        assert_eq!(evaluate(&struct_node, other), Some(false));
+        assert_eq!(evaluate(&struct_node, atom), Some(false));
+        assert_eq!(evaluate(&not_tree, tree), Some(false));
+        assert_eq!(evaluate(&not_tree, other), Some(true));
+        assert_eq!(evaluate(&not_tree, atom), Some(true));
+        // Conditions that depend on more than the type cannot be evaluated
+        let has_value = Expression::UnaryOperator(UnaryOperator::NodeValue, origin());
+        assert_eq!(evaluate(&has_value, node), None);
+    }
+}
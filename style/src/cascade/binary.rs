@@ -0,0 +1,907 @@
+//! Binary serialization of compiled [`CascadeStyle`]s.
+//!
+//! Parsing and compiling a large stylesheet takes a noticeable
+//! amount of time, so compiled stylesheets can be stored
+//! in a compact binary form and loaded without parsing.
+//!
+//! The format is only meant to be read by the same version
+//! of the library that wrote it. It starts with a header
+//! that identifies the format version and the library version,
+//! and blobs written by a different version are rejected.
+//!
+//! Blobs may come from untrusted storage, so nothing that the library
+//! relies on for correctness is read from them. Cache slots of expressions
+//! are assigned again when a stylesheet is loaded.
+
+use super::style::{
+    CascadeStyle, CascadeStyleClause, CascadeStyleRule, CompiledExpression, FlatSelector,
+    FlatSelectorSegment,
+};
+use crate::stylesheet::{
+    PropertyKey, RawPropertyKey, StyleKey,
+    expression::{
+        BinaryOperator, Expression, LimitedEdgeMatcher, LimitedSelector, MagicVariableKey,
+        UnaryOperator,
+    },
+    selector::EdgeMatcher,
+};
+use aili_model::{
+    state::{EdgeLabel, NodeTypeClass},
+    symbol::Symbol,
+};
+use derive_more::{Debug, Display, Error};
+
+/// Bytes that start every serialized stylesheet.
+const MAGIC: &[u8; 4] = b"AILS";
+
+/// Version of the format.
+///
+/// Must be incremented whenever the encoding
+/// of any type in this module changes.
+const FORMAT_VERSION: u64 = 2;
+
+/// Version of the library that writes the format.
+const LIBRARY_VERSION: &str = env!("CARGO_PKG_VERSION");
+
+/// Error type emited when a serialized stylesheet cannot be read.
+#[derive(Clone, PartialEq, Eq, Debug, Display, Error)]
+pub enum BinaryFormatError {
+    /// The data does not start with the expected header.
+    #[display("data is not a compiled stylesheet")]
+    BadMagic,
+
+    /// The data has been written by a different version of the format.
+    #[display("unsupported format version: {_0}")]
+    #[error(ignore)]
+    UnsupportedVersion(u64),
+
+    /// The data has been written by a different version of the library.
+    #[display("stylesheet compiled by a different library version: {_0}")]
+    #[error(ignore)]
+    UnsupportedLibraryVersion(String),
+
+    /// The data ended in the middle of a value.
+    #[display("unexpected end of data")]
+    UnexpectedEnd,
+
+    /// The data continues after the end of the stylesheet.
+    #[display("unexpected data after the end of the stylesheet")]
+    TrailingData,
+
+    /// A variant tag does not identify any variant of its type.
+    #[display("invalid variant tag: {_0}")]
+    #[error(ignore)]
+    InvalidTag(u8),
+
+    /// A value does not fit into its type.
+    #[display("value out of range")]
+    OutOfRange,
+
+    /// A string is not valid UTF-8.
+    #[display("invalid string")]
+    InvalidString,
+}
+
+/// Types that can be written in the binary form of a [`CascadeStyle`].
+///
+/// [`PropertyKey`]s must implement this trait
+/// in order for their stylesheets to be serializable.
+pub trait BinaryFormat: Sized {
+    /// Writes the value to a writer.
+    fn write(&self, writer: &mut BinaryWriter);
+
+    /// Reads a value previously written by [`BinaryFormat::write`].
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError>;
+}
+
+/// Output buffer of [`BinaryFormat::write`].
+#[derive(Debug, Default)]
+pub struct BinaryWriter {
+    bytes: Vec<u8>,
+}
+
+impl BinaryWriter {
+    /// Constructs an empty writer.
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Writes a tag that identifies a variant of an enum.
+    pub fn write_tag(&mut self, tag: u8) {
+        self.bytes.push(tag);
+    }
+
+    /// Writes an unsigned integer.
+    ///
+    /// Integers are written in a variable-length encoding,
+    /// so small values, which are the most common, take a single byte.
+    pub fn write_uint(&mut self, mut value: u64) {
+        while value >= 0x80 {
+            self.bytes.push((value as u8) | 0x80);
+            value >>= 7;
+        }
+        self.bytes.push(value as u8);
+    }
+
+    /// Writes a string.
+    pub fn write_str(&mut self, value: &str) {
+        self.write_uint(value.len() as u64);
+        self.bytes.extend_from_slice(value.as_bytes());
+    }
+
+    /// Gets the bytes that have been written.
+    pub fn into_bytes(self) -> Vec<u8> {
+        self.bytes
+    }
+}
+
+/// Input buffer of [`BinaryFormat::read`].
+#[derive(Debug)]
+pub struct BinaryReader<'a> {
+    bytes: &'a [u8],
+}
+
+impl<'a> BinaryReader<'a> {
+    /// Constructs a reader that reads from the start of a buffer.
+    pub fn new(bytes: &'a [u8]) -> Self {
+        Self { bytes }
+    }
+
+    /// Reads a tag written by [`BinaryWriter::write_tag`].
+    pub fn read_tag(&mut self) -> Result<u8, BinaryFormatError> {
+        let (&tag, rest) = self
+            .bytes
+            .split_first()
+            .ok_or(BinaryFormatError::UnexpectedEnd)?;
+        self.bytes = rest;
+        Ok(tag)
+    }
+
+    /// Reads an integer written by [`BinaryWriter::write_uint`].
+    pub fn read_uint(&mut self) -> Result<u64, BinaryFormatError> {
+        let mut value = 0u64;
+        for shift in (0..64).step_by(7) {
+            let byte = self.read_tag()?;
+            let bits = u64::from(byte & 0x7f);
+            if bits << shift >> shift != bits {
+                return Err(BinaryFormatError::OutOfRange);
+            }
+            value |= bits << shift;
+            if byte & 0x80 == 0 {
+                return Ok(value);
+            }
+        }
+        Err(BinaryFormatError::OutOfRange)
+    }
+
+    /// Reads a string written by [`BinaryWriter::write_str`].
+    pub fn read_str(&mut self) -> Result<&'a str, BinaryFormatError> {
+        let length: usize = self
+            .read_uint()?
+            .try_into()
+            .map_err(|_| BinaryFormatError::OutOfRange)?;
+        if length > self.bytes.len() {
+            return Err(BinaryFormatError::UnexpectedEnd);
+        }
+        let (string, rest) = self.bytes.split_at(length);
+        self.bytes = rest;
+        std::str::from_utf8(string).map_err(|_| BinaryFormatError::InvalidString)
+    }
+
+    /// Checks whether all data has been read.
+    pub fn is_at_end(&self) -> bool {
+        self.bytes.is_empty()
+    }
+}
+
+impl<K: PropertyKey + BinaryFormat> CascadeStyle<K> {
+    /// Serializes the compiled stylesheet.
+    ///
+    /// The stylesheet can be restored with [`CascadeStyle::from_bytes`].
+    pub fn to_bytes(&self) -> Vec<u8> {
+        let mut writer = BinaryWriter::new();
+        writer.bytes.extend_from_slice(MAGIC);
+        writer.write_uint(FORMAT_VERSION);
+        writer.write_str(LIBRARY_VERSION);
+        let rules = self.selector_machine().selectors.iter().zip(self.rules());
+        writer.write_uint(self.rules().len() as u64);
+        for (selector, rule) in rules {
+            selector.path.write(&mut writer);
+            rule.write(&mut writer);
+        }
+        writer.into_bytes()
+    }
+
+    /// Restores a stylesheet serialized by [`CascadeStyle::to_bytes`].
+    pub fn from_bytes(bytes: &[u8]) -> Result<Self, BinaryFormatError> {
+        let mut reader = BinaryReader::new(
+            bytes
+                .strip_prefix(MAGIC)
+                .ok_or(BinaryFormatError::BadMagic)?,
+        );
+        let version = reader.read_uint()?;
+        if version != FORMAT_VERSION {
+            return Err(BinaryFormatError::UnsupportedVersion(version));
+        }
+        let library_version = reader.read_str()?;
+        if library_version != LIBRARY_VERSION {
+            return Err(BinaryFormatError::UnsupportedLibraryVersion(
+                library_version.to_owned(),
+            ));
+        }
+        let rule_count = usize::read(&mut reader)?;
+        // Do not trust the count with the allocation,
+        // each rule takes at least a byte
+        let mut selectors = Vec::with_capacity(rule_count.min(bytes.len()));
+        let mut rules = Vec::with_capacity(rule_count.min(bytes.len()));
+        for _ in 0..rule_count {
+            selectors.push(FlatSelector {
+                path: Vec::read(&mut reader)?,
+            });
+            rules.push(CascadeStyleRule::read(&mut reader)?);
+        }
+        if !reader.is_at_end() {
+            return Err(BinaryFormatError::TrailingData);
+        }
+        Ok(Self::from_parts(selectors, rules))
+    }
+
+    /// Calculates a hash of a stylesheet source
+    /// that identifies its compiled form in a cache.
+    ///
+    /// Unlike [`std::hash::Hash`], the hash is stable
+    /// across builds and platforms, so it can be stored.
+    pub fn source_hash(source: &str) -> u64 {
+        // 64-bit FNV-1a
+        source.bytes().fold(0xcbf29ce484222325, |hash, byte| {
+            (hash ^ u64::from(byte)).wrapping_mul(0x100000001b3)
+        })
+    }
+}
+
+impl<K: PropertyKey + BinaryFormat> BinaryFormat for CascadeStyleRule<K> {
+    fn write(&self, writer: &mut BinaryWriter) {
+        self.extra_label.write(writer);
+        self.properties.write(writer);
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        Ok(Self {
+            extra_label: BinaryFormat::read(reader)?,
+            properties: BinaryFormat::read(reader)?,
+        })
+    }
+}
+
+impl<K: PropertyKey + BinaryFormat> BinaryFormat for CascadeStyleClause<K> {
+    fn write(&self, writer: &mut BinaryWriter) {
+        self.key.write(writer);
+        self.value.write(writer);
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        Ok(Self {
+            key: BinaryFormat::read(reader)?,
+            value: BinaryFormat::read(reader)?,
+        })
+    }
+}
+
+impl<K: PropertyKey + BinaryFormat> BinaryFormat for StyleKey<K> {
+    fn write(&self, writer: &mut BinaryWriter) {
+        match self {
+            Self::Property(key) => {
+                writer.write_tag(0);
+                key.write(writer);
+            }
+            Self::Variable(name) => {
+                writer.write_tag(1);
+                writer.write_str(name);
+            }
+        }
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        match reader.read_tag()? {
+            0 => Ok(Self::Property(K::read(reader)?)),
+            1 => Ok(Self::Variable(String::read(reader)?)),
+            tag => Err(BinaryFormatError::InvalidTag(tag)),
+        }
+    }
+}
+
+impl BinaryFormat for RawPropertyKey {
+    fn write(&self, writer: &mut BinaryWriter) {
+        match self {
+            Self::Property(name) => {
+                writer.write_tag(0);
+                writer.write_str(name);
+            }
+            Self::QuotedProperty(name) => {
+                writer.write_tag(1);
+                writer.write_str(name);
+            }
+            Self::FragmentProperty(fragment, name) => {
+                writer.write_tag(2);
+                writer.write_str(fragment);
+                writer.write_str(name);
+            }
+        }
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        match reader.read_tag()? {
+            0 => Ok(Self::Property(String::read(reader)?)),
+            1 => Ok(Self::QuotedProperty(String::read(reader)?)),
+            2 => Ok(Self::FragmentProperty(
+                String::read(reader)?,
+                String::read(reader)?,
+            )),
+            tag => Err(BinaryFormatError::InvalidTag(tag)),
+        }
+    }
+}
+
+impl BinaryFormat for CompiledExpression {
+    fn write(&self, writer: &mut BinaryWriter) {
+        self.expression.write(writer);
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        // Constants have been folded before the expression was written,
+        // and the dependency is cheap to recalculate
+        let expression = Expression::read(reader)?;
+        Ok(Self {
+            dependency: expression.dependency(),
+            expression,
+            // The slot is assigned when the whole stylesheet is assembled
+            slot: None,
+        })
+    }
+}
+
+impl BinaryFormat for FlatSelectorSegment {
+    fn write(&self, writer: &mut BinaryWriter) {
+        match self {
+            Self::MatchEdge(matcher) => {
+                writer.write_tag(0);
+                matcher.write(writer);
+            }
+            Self::MatchNode => writer.write_tag(1),
+            Self::Restrict(condition) => {
+                writer.write_tag(2);
+                condition.write(writer);
+            }
+            Self::Jump(target) => {
+                writer.write_tag(3);
+                target.write(writer);
+            }
+            Self::Branch(target) => {
+                writer.write_tag(4);
+                target.write(writer);
+            }
+        }
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        match reader.read_tag()? {
+            0 => Ok(Self::MatchEdge(BinaryFormat::read(reader)?)),
+            1 => Ok(Self::MatchNode),
+            2 => Ok(Self::Restrict(BinaryFormat::read(reader)?)),
+            3 => Ok(Self::Jump(BinaryFormat::read(reader)?)),
+            4 => Ok(Self::Branch(BinaryFormat::read(reader)?)),
+            tag => Err(BinaryFormatError::InvalidTag(tag)),
+        }
+    }
+}
+
+impl BinaryFormat for EdgeMatcher {
+    fn write(&self, writer: &mut BinaryWriter) {
+        match self {
+            Self::Any => writer.write_tag(0),
+            Self::Exact(label) => {
+                writer.write_tag(1);
+                label.write(writer);
+            }
+            Self::AnyIndex => writer.write_tag(2),
+            Self::AnyNamed => writer.write_tag(3),
+            Self::Named(name) => {
+                writer.write_tag(4);
+                name.write(writer);
+            }
+        }
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        match reader.read_tag()? {
+            0 => Ok(Self::Any),
+            1 => Ok(Self::Exact(BinaryFormat::read(reader)?)),
+            2 => Ok(Self::AnyIndex),
+            3 => Ok(Self::AnyNamed),
+            4 => Ok(Self::Named(BinaryFormat::read(reader)?)),
+            tag => Err(BinaryFormatError::InvalidTag(tag)),
+        }
+    }
+}
+
+impl BinaryFormat for Expression {
+    fn write(&self, writer: &mut BinaryWriter) {
+        match self {
+            Self::Variable(name) => {
+                writer.write_tag(0);
+                writer.write_str(name);
+            }
+            Self::MagicVariable(key) => {
+                writer.write_tag(1);
+                key.write(writer);
+            }
+            Self::Unset => writer.write_tag(2),
+            Self::Bool(value) => {
+                writer.write_tag(3);
+                value.write(writer);
+            }
+            Self::String(value) => {
+                writer.write_tag(4);
+                writer.write_str(value);
+            }
+            Self::Int(value) => {
+                writer.write_tag(5);
+                writer.write_uint(*value);
+            }
+            Self::Select(selector) => {
+                writer.write_tag(6);
+                selector.write(writer);
+            }
+            Self::UnaryOperator(operator, operand) => {
+                writer.write_tag(7);
+                operator.write(writer);
+                operand.write(writer);
+            }
+            Self::BinaryOperator(left, operator, right) => {
+                writer.write_tag(8);
+                left.write(writer);
+                operator.write(writer);
+                right.write(writer);
+            }
+            Self::Conditional(condition, if_true, if_false) => {
+                writer.write_tag(9);
+                condition.write(writer);
+                if_true.write(writer);
+                if_false.write(writer);
+            }
+        }
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        match reader.read_tag()? {
+            0 => Ok(Self::Variable(BinaryFormat::read(reader)?)),
+            1 => Ok(Self::MagicVariable(BinaryFormat::read(reader)?)),
+            2 => Ok(Self::Unset),
+            3 => Ok(Self::Bool(BinaryFormat::read(reader)?)),
+            4 => Ok(Self::String(BinaryFormat::read(reader)?)),
+            5 => Ok(Self::Int(reader.read_uint()?)),
+            6 => Ok(Self::Select(BinaryFormat::read(reader)?)),
+            7 => Ok(Self::UnaryOperator(
+                BinaryFormat::read(reader)?,
+                BinaryFormat::read(reader)?,
+            )),
+            8 => Ok(Self::BinaryOperator(
+                BinaryFormat::read(reader)?,
+                BinaryFormat::read(reader)?,
+                BinaryFormat::read(reader)?,
+            )),
+            9 => Ok(Self::Conditional(
+                BinaryFormat::read(reader)?,
+                BinaryFormat::read(reader)?,
+                BinaryFormat::read(reader)?,
+            )),
+            tag => Err(BinaryFormatError::InvalidTag(tag)),
+        }
+    }
+}
+
+impl BinaryFormat for LimitedSelector {
+    fn write(&self, writer: &mut BinaryWriter) {
+        self.path.write(writer);
+        self.origin.write(writer);
+        self.extra_label.write(writer);
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        Ok(Self {
+            path: BinaryFormat::read(reader)?,
+            origin: BinaryFormat::read(reader)?,
+            extra_label: BinaryFormat::read(reader)?,
+        })
+    }
+}
+
+impl BinaryFormat for LimitedEdgeMatcher {
+    fn write(&self, writer: &mut BinaryWriter) {
+        match self {
+            Self::Exact(label) => {
+                writer.write_tag(0);
+                label.write(writer);
+            }
+            Self::DynIndex(index) => {
+                writer.write_tag(1);
+                index.write(writer);
+            }
+        }
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        match reader.read_tag()? {
+            0 => Ok(Self::Exact(BinaryFormat::read(reader)?)),
+            1 => Ok(Self::DynIndex(BinaryFormat::read(reader)?)),
+            tag => Err(BinaryFormatError::InvalidTag(tag)),
+        }
+    }
+}
+
+impl BinaryFormat for UnaryOperator {
+    fn write(&self, writer: &mut BinaryWriter) {
+        match self {
+            Self::Plus => writer.write_tag(0),
+            Self::Minus => writer.write_tag(1),
+            Self::Not => writer.write_tag(2),
+            Self::NodeValue => writer.write_tag(3),
+            Self::NodeIsA(type_class) => {
+                writer.write_tag(4);
+                type_class.write(writer);
+            }
+            Self::NodeTypeName => writer.write_tag(5),
+            Self::IsSet => writer.write_tag(6),
+        }
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        match reader.read_tag()? {
+            0 => Ok(Self::Plus),
+            1 => Ok(Self::Minus),
+            2 => Ok(Self::Not),
+            3 => Ok(Self::NodeValue),
+            4 => Ok(Self::NodeIsA(BinaryFormat::read(reader)?)),
+            5 => Ok(Self::NodeTypeName),
+            6 => Ok(Self::IsSet),
+            tag => Err(BinaryFormatError::InvalidTag(tag)),
+        }
+    }
+}
+
+/// Implements [`BinaryFormat`] for enums whose variants carry no data.
+///
+/// Each variant is written as its position in the list.
+macro_rules! impl_binary_format_for_unit_enum {
+    ( $name:ty { $( $variant:ident ),* $(,)? } ) => {
+        impl BinaryFormat for $name {
+            fn write(&self, writer: &mut BinaryWriter) {
+                const VARIANTS: &[$name] = &[ $( <$name>::$variant ),* ];
+                let tag = VARIANTS
+                    .iter()
+                    .position(|variant| variant == self)
+                    .expect("All variants are listed");
+                writer.write_tag(tag as u8);
+            }
+            fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+                const VARIANTS: &[$name] = &[ $( <$name>::$variant ),* ];
+                let tag = reader.read_tag()?;
+                VARIANTS
+                    .get(usize::from(tag))
+                    .copied()
+                    .ok_or(BinaryFormatError::InvalidTag(tag))
+            }
+        }
+    };
+}
+
+impl_binary_format_for_unit_enum!(BinaryOperator {
+    Plus,
+    Minus,
+    Mul,
+    Div,
+    Mod,
+    Eq,
+    Ne,
+    Lt,
+    Le,
+    Gt,
+    Ge,
+    And,
+    Or,
+});
+
+impl_binary_format_for_unit_enum!(MagicVariableKey {
+    EdgeIndex,
+    EdgeName,
+    EdgeDiscriminator,
+});
+
+impl_binary_format_for_unit_enum!(NodeTypeClass {
+    Root,
+    Frame,
+    Atom,
+    Struct,
+    Array,
+    Ref,
+    Truncated,
+});
+
+impl BinaryFormat for EdgeLabel {
+    fn write(&self, writer: &mut BinaryWriter) {
+        match self {
+            Self::Main => writer.write_tag(0),
+            Self::Next => writer.write_tag(1),
+            Self::Result => writer.write_tag(2),
+            Self::Deref => writer.write_tag(3),
+            Self::Index(index) => {
+                writer.write_tag(4);
+                index.write(writer);
+            }
+            Self::Named(name, discriminator) => {
+                writer.write_tag(5);
+                name.write(writer);
+                discriminator.write(writer);
+            }
+            Self::Length => writer.write_tag(6),
+        }
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        match reader.read_tag()? {
+            0 => Ok(Self::Main),
+            1 => Ok(Self::Next),
+            2 => Ok(Self::Result),
+            3 => Ok(Self::Deref),
+            4 => Ok(Self::Index(BinaryFormat::read(reader)?)),
+            5 => Ok(Self::Named(
+                BinaryFormat::read(reader)?,
+                BinaryFormat::read(reader)?,
+            )),
+            6 => Ok(Self::Length),
+            tag => Err(BinaryFormatError::InvalidTag(tag)),
+        }
+    }
+}
+
+impl BinaryFormat for Symbol {
+    fn write(&self, writer: &mut BinaryWriter) {
+        writer.write_str(self.as_str());
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        reader.read_str().map(Symbol::new)
+    }
+}
+
+impl BinaryFormat for String {
+    fn write(&self, writer: &mut BinaryWriter) {
+        writer.write_str(self);
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        reader.read_str().map(str::to_owned)
+    }
+}
+
+impl BinaryFormat for bool {
+    fn write(&self, writer: &mut BinaryWriter) {
+        writer.write_tag(u8::from(*self));
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        match reader.read_tag()? {
+            0 => Ok(false),
+            1 => Ok(true),
+            tag => Err(BinaryFormatError::InvalidTag(tag)),
+        }
+    }
+}
+
+impl BinaryFormat for usize {
+    fn write(&self, writer: &mut BinaryWriter) {
+        writer.write_uint(*self as u64);
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        reader
+            .read_uint()?
+            .try_into()
+            .map_err(|_| BinaryFormatError::OutOfRange)
+    }
+}
+
+impl<T: BinaryFormat> BinaryFormat for Option<T> {
+    fn write(&self, writer: &mut BinaryWriter) {
+        match self {
+            None => writer.write_tag(0),
+            Some(value) => {
+                writer.write_tag(1);
+                value.write(writer);
+            }
+        }
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        match reader.read_tag()? {
+            0 => Ok(None),
+            1 => Ok(Some(T::read(reader)?)),
+            tag => Err(BinaryFormatError::InvalidTag(tag)),
+        }
+    }
+}
+
+impl<T: BinaryFormat> BinaryFormat for Box<T> {
+    fn write(&self, writer: &mut BinaryWriter) {
+        self.as_ref().write(writer);
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        T::read(reader).map(Box::new)
+    }
+}
+
+impl<T: BinaryFormat> BinaryFormat for Vec<T> {
+    fn write(&self, writer: &mut BinaryWriter) {
+        self.len().write(writer);
+        for item in self {
+            item.write(writer);
+        }
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        let length = usize::read(reader)?;
+        // Do not trust the length with the allocation,
+        // each item takes at least a byte
+        let mut items = Vec::with_capacity(length.min(reader.bytes.len()));
+        for _ in 0..length {
+            items.push(T::read(reader)?);
+        }
+        Ok(items)
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use crate::stylesheet::{
+        StyleClause, StyleRule, Stylesheet,
+        selector::{Selector, SelectorPath, SelectorSegment},
+    };
+
+    fn sample_stylesheet() -> CascadeStyle {
+        let condition = Expression::BinaryOperator(
+            Box::new(Expression::UnaryOperator(
+                UnaryOperator::NodeValue,
+                Box::new(Expression::Select(Box::default())),
+            )),
+            BinaryOperator::Gt,
+            Box::new(Expression::Int(300)),
+        );
+        let value = Expression::Conditional(
+            Box::new(Expression::Variable("flag".into())),
+            Box::new(Expression::Select(Box::new(
+                LimitedSelector::from_path([
+                    LimitedEdgeMatcher::Exact(EdgeLabel::Named("next".into(), 1)),
+                    LimitedEdgeMatcher::DynIndex(Expression::MagicVariable(
+                        MagicVariableKey::EdgeIndex,
+                    )),
+                ])
+                .with_extra("label".into()),
+            ))),
+            Box::new(Expression::String("ünïcödé".into())),
+        );
+        Stylesheet(vec![
+            StyleRule {
+                selector: Selector::from_path(SelectorPath(vec![
+                    SelectorSegment::Match(EdgeLabel::Main.into()),
+                    SelectorSegment::anything_any_number_of_times(),
+                    SelectorSegment::Branch(vec![
+                        SelectorPath(vec![SelectorSegment::Match(EdgeMatcher::AnyIndex)]),
+                        SelectorPath(vec![SelectorSegment::Match(EdgeMatcher::Named(
+                            "item".into(),
+                        ))]),
+                    ]),
+                    SelectorSegment::Condition(condition.clone()),
+                ])),
+                properties: vec![
+                    StyleClause {
+                        key: StyleKey::Variable("flag".into()),
+                        value: Expression::UnaryOperator(
+                            UnaryOperator::NodeIsA(NodeTypeClass::Truncated),
+                            Box::new(Expression::Select(Box::default())),
+                        ),
+                    },
+                    StyleClause {
+                        key: StyleKey::Property(RawPropertyKey::FragmentProperty(
+                            "start".into(),
+                            "color".into(),
+                        )),
+                        value,
+                    },
+                ],
+            },
+            StyleRule {
+                selector: Selector::from_path(SelectorPath(vec![SelectorSegment::Match(
+                    EdgeLabel::Deref.into(),
+                )]))
+                .selecting_edge()
+                .with_extra(String::new()),
+                properties: vec![StyleClause {
+                    key: StyleKey::Property(RawPropertyKey::QuotedProperty("value".into())),
+                    value: condition,
+                }],
+            },
+        ])
+        .into()
+    }
+
+    #[test]
+    fn stylesheet_round_trip() {
+        let stylesheet = sample_stylesheet();
+        let bytes = stylesheet.to_bytes();
+        let restored = CascadeStyle::<RawPropertyKey>::from_bytes(&bytes).unwrap();
+        assert_eq!(
+            format!("{:?}", restored.selector_machine().selectors),
+            format!("{:?}", stylesheet.selector_machine().selectors)
+        );
+        assert_eq!(
+            format!("{:?}", restored.rules()),
+            format!("{:?}", stylesheet.rules())
+        );
+        for (restored, original) in restored
+            .rules()
+            .iter()
+            .flat_map(|rule| &rule.properties)
+            .zip(stylesheet.rules().iter().flat_map(|rule| &rule.properties))
+        {
+            assert_eq!(restored.value, original.value);
+        }
+        assert_eq!(restored.to_bytes(), bytes);
+    }
+
+    #[test]
+    fn large_integers_round_trip() {
+        for value in [0, 1, 0x7f, 0x80, 0x3fff, 0x4000, u64::MAX] {
+            let mut writer = BinaryWriter::new();
+            writer.write_uint(value);
+            let bytes = writer.into_bytes();
+            let mut reader = BinaryReader::new(&bytes);
+            assert_eq!(reader.read_uint(), Ok(value));
+            assert!(reader.is_at_end());
+        }
+    }
+
+    #[test]
+    fn malformed_data_is_rejected() {
+        let bytes = sample_stylesheet().to_bytes();
+        let from_bytes = CascadeStyle::<RawPropertyKey>::from_bytes;
+        assert_eq!(
+            from_bytes(b"not a stylesheet").unwrap_err(),
+            BinaryFormatError::BadMagic
+        );
+        assert_eq!(
+            from_bytes(&bytes[..bytes.len() - 1]).unwrap_err(),
+            BinaryFormatError::UnexpectedEnd
+        );
+        let mut trailing = bytes.clone();
+        trailing.push(0);
+        assert_eq!(
+            from_bytes(&trailing).unwrap_err(),
+            BinaryFormatError::TrailingData
+        );
+        let mut newer = bytes.clone();
+        newer[MAGIC.len()] = FORMAT_VERSION as u8 + 1;
+        assert_eq!(
+            from_bytes(&newer).unwrap_err(),
+            BinaryFormatError::UnsupportedVersion(FORMAT_VERSION + 1)
+        );
+        let mut other_library = bytes;
+        // The version string follows the magic, the format version and its own length
+        let version_start = MAGIC.len() + 2;
+        other_library[version_start] = b'x';
+        let mut other_version = LIBRARY_VERSION.to_owned();
+        other_version.replace_range(..1, "x");
+        assert_eq!(
+            from_bytes(&other_library).unwrap_err(),
+            BinaryFormatError::UnsupportedLibraryVersion(other_version)
+        );
+    }
+
+    #[test]
+    fn cache_slots_are_assigned_on_load() {
+        let stylesheet = sample_stylesheet();
+        let restored = CascadeStyle::<RawPropertyKey>::from_bytes(&stylesheet.to_bytes()).unwrap();
+        let slots = |stylesheet: &CascadeStyle| {
+            stylesheet
+                .rules()
+                .iter()
+                .flat_map(|rule| &rule.properties)
+                .map(|clause| clause.value.slot)
+                .collect::<Vec<_>>()
+        };
+        assert_eq!(slots(&restored), slots(&stylesheet));
+        assert!(slots(&restored).iter().any(Option::is_some));
+    }
+}
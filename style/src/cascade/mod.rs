@@ -1,7 +1,15 @@
 //! Utilities for stylesheet resolution.
 
+mod automaton;
+mod binary;
 mod selector_resolver;
 mod style;
 
-pub use selector_resolver::{SelectionCaret, SelectorResolver};
-pub use style::{CascadeSelector, CascadeStyle, CascadeStyleRule};
+pub use binary::{BinaryFormat, BinaryFormatError, BinaryReader, BinaryWriter};
+pub use selector_resolver::{
+    DetachedResolver, ResolverCheckpoint, ResolverStatistics, SelectionCaret, SelectorResolver,
+    SequencePointRecord,
+};
+pub use style::{
+    CascadeSelector, CascadeStyle, CascadeStyleClause, CascadeStyleRule, CompiledExpression,
+};
@@ -1,9 +1,12 @@
 //! Helper for [`CascadeSelector`] resolution.
 
-use super::style::{CascadeSelector, FlatSelectorSegment};
-use crate::eval::{context::EvaluationContext, evaluate};
+use super::{
+    automaton::{AutomatonCache, StateSetId, close_over_node},
+    style::CascadeSelector,
+};
+use crate::eval::{context::EvaluationContext, evaluate_compiled};
 use aili_model::state::{EdgeLabel, NodeId, ProgramStateGraph};
-use std::collections::{BTreeSet, HashSet};
+use std::{cell::RefCell, collections::HashSet, rc::Rc, sync::Arc};
 
 /// Helper object for the resolution of stylesheets.
 #[derive(Clone)]
@@ -11,6 +14,10 @@ pub struct SelectorResolver<'a, T: NodeId> {
     /// The compiled selectors that are being resolved.
     selectors: &'a CascadeSelector,
 
+    /// Transitions of the selectors that have been determinized so far,
+    /// shared by all snapshots of the resolver.
+    automaton: Rc<RefCell<AutomatonCache>>,
+
     /// Pairs of nodes and selector sequence points
     /// that have already been matched.
     ///
@@ -19,46 +26,126 @@ pub struct SelectorResolver<'a, T: NodeId> {
     ///
     /// A sequence point is a [`FlatSelectorSegment::MatchNode`]
     /// transition in the state machine.
-    matched_sequence_points: HashSet<(T, SelectorState)>,
+    matched_sequence_points: MatchedSequencePoints<T>,
 
     /// The resolution stack that tracks the current path to root.
     stack: Vec<ResolveFrame>,
+
+    /// Log of all checks of [`SelectorResolver::matched_sequence_points`]
+    /// in the order they were made, if logging is enabled.
+    sequence_point_log: Option<Vec<SequencePointRecord<T>>>,
+
+    /// Counters of the work done by this resolver.
+    statistics: ResolverStatistics,
 }
 
 impl<'a, T: NodeId> SelectorResolver<'a, T> {
     /// Constructs a new resolver that resolves a particular stylesheet.
     pub fn new(selectors: &'a CascadeSelector) -> Self {
+        let mut automaton = AutomatonCache::new();
+        let active_states = automaton.intern(selectors.all_starting_states());
         Self {
             selectors,
-            matched_sequence_points: HashSet::new(),
-            stack: vec![ResolveFrame {
-                active_states: selectors.all_starting_states(),
-            }],
+            automaton: Rc::new(RefCell::new(automaton)),
+            matched_sequence_points: MatchedSequencePoints::default(),
+            stack: vec![ResolveFrame { active_states }],
+            sequence_point_log: None,
+            statistics: ResolverStatistics::default(),
         }
     }
 
+    /// Enables logging of sequence point checks.
+    ///
+    /// The log can be used to replay the effects of resolving
+    /// a part of the graph without resolving it again.
+    /// See [`SelectorResolver::replay_sequence_points`].
+    pub fn with_sequence_point_log(mut self) -> Self {
+        self.sequence_point_log = Some(Vec::new());
+        self
+    }
+
+    /// Accesses the log of sequence point checks.
+    ///
+    /// The log is empty if it has not been enabled
+    /// with [`SelectorResolver::with_sequence_point_log`].
+    pub fn sequence_point_log(&self) -> &[SequencePointRecord<T>] {
+        self.sequence_point_log.as_deref().unwrap_or_default()
+    }
+
+    /// Takes the log of sequence point checks out of the resolver,
+    /// leaving it empty.
+    pub fn take_sequence_point_log(&mut self) -> Vec<SequencePointRecord<T>> {
+        self.sequence_point_log
+            .as_mut()
+            .map(std::mem::take)
+            .unwrap_or_default()
+    }
+
+    /// Checks whether a sequence of sequence point checks,
+    /// previously obtained from [`SelectorResolver::sequence_point_log`],
+    /// would have the same outcomes if they were made now.
+    pub fn can_replay_sequence_points(&self, records: &[SequencePointRecord<T>]) -> bool {
+        // Points that would be inserted by the records themselves
+        let mut inserted = HashSet::new();
+        records.iter().all(|record| {
+            let key = (record.node.clone(), record.state);
+            let is_free = !self.matched_sequence_points.contains(&key) && !inserted.contains(&key);
+            if record.committed {
+                inserted.insert(key);
+            }
+            is_free == record.committed
+        })
+    }
+
+    /// Applies the effects of a sequence of sequence point checks,
+    /// previously obtained from [`SelectorResolver::sequence_point_log`],
+    /// as if the part of the graph they were made in has been resolved again.
+    ///
+    /// The caller should verify that the replay is valid
+    /// with [`SelectorResolver::can_replay_sequence_points`].
+    pub fn replay_sequence_points(&mut self, records: &[SequencePointRecord<T>]) {
+        for record in records {
+            if record.committed {
+                self.matched_sequence_points
+                    .insert((record.node.clone(), record.state));
+            }
+        }
+        if let Some(log) = &mut self.sequence_point_log {
+            log.extend_from_slice(records);
+        }
+    }
+
+    /// Counters of the work done by the resolver since it was constructed.
+    ///
+    /// [Snapshots](SelectorResolver::snapshot) and [detached](SelectorResolver::detach)
+    /// copies of a resolver start counting from zero.
+    pub fn statistics(&self) -> ResolverStatistics {
+        self.statistics
+    }
+
+    /// Captures the state of the selectors that are awaiting
+    /// the next node or edge.
+    ///
+    /// Two resolvers with equal checkpoints and equal
+    /// matched sequence points resolve the same way.
+    pub fn checkpoint(&self) -> ResolverCheckpoint {
+        let active_states = self.stack.last().unwrap().active_states;
+        ResolverCheckpoint(self.automaton.borrow().set(active_states).clone())
+    }
+
     /// Notifies the resolver that an edge has been traversed.
     ///
     /// Advances all selectors that are awaiting an edge.
     pub fn push_edge(&mut self, edge_label: &EdgeLabel) {
-        let active_states = self
+        let from = self
             .stack
             .last()
             .expect("The bottommost stack frame should never be popped")
-            .active_states
-            .iter()
-            .filter(|state| {
-                self.selectors.0[state.rule_index]
-                    .path
-                    .get(state.instruction_index)
-                    .is_some_and(|instruction| match instruction {
-                        FlatSelectorSegment::MatchEdge(matcher) => matcher.matches(edge_label),
-                        _ => false,
-                    })
-            })
-            .copied()
-            .map(SelectorState::advance)
-            .collect();
+            .active_states;
+        let active_states =
+            self.automaton
+                .borrow_mut()
+                .edge_transition(self.selectors, from, edge_label);
         self.stack.push(ResolveFrame { active_states });
     }
 
@@ -77,86 +164,70 @@ impl<'a, T: NodeId> SelectorResolver<'a, T> {
         node: T,
         eval_context: &EvaluationContext<impl ProgramStateGraph>,
     ) -> Vec<(usize, SelectionCaret)> {
-        // States of the selector state machine that have been visited
-        // while evaluating this node
-        let mut visited_states = BTreeSet::new();
-        // States that are yet to be visited and whether the node has already
-        // been committed when we reach them
-        let mut open_states = Vec::from_iter(
-            self.stack
-                .pop()
-                .unwrap()
-                .active_states
-                .into_iter()
-                .map(|s| (s, SelectionCaret::PrecedingEdge)),
-        );
-        // States that are blocked by an edge matcher
-        // and must be resolved by traversing further down the graph
-        let mut output_states = Vec::new();
-        // Rules whose selector selected this element or a related entity
-        let mut matched_rules = Vec::new();
-
-        // Make a transitive closure of selector states reachable at this node
-        while let Some((state, target)) = open_states.pop() {
-            let selector = &self.selectors.0[state.rule_index].path;
-            if state.instruction_index >= selector.len() {
-                // We made it to the end of the selector
-                // That means it has matched the node
-                matched_rules.push((state.rule_index, target));
-                continue;
-            }
-            // Proceed, unless we have been here already
-            // This prevents infinite loops caused by poorly written selectors
-            if !visited_states.insert(state) {
-                continue;
-            }
-            match &selector[state.instruction_index] {
-                FlatSelectorSegment::MatchEdge(_) => {
-                    // Traversing an edge is only permitted if the node has already been committed
-                    // This ensures the resolver halts by only allowing each edge to be traversed once
-                    if target == SelectionCaret::Node {
-                        // This is where we must halt and send the selector
-                        // along the edge later on, after we are done with
-                        // all partial matches on this node
-                        output_states.push(state);
-                    }
-                    // TODO: Emit a warning if we fail this check?
-                    // This can never happen when using flattened regular selectors
-                    // but it is possible to manually construct a flat selector
-                    // that does not uphold this invariant
-                }
-                FlatSelectorSegment::MatchNode => {
-                    // Proceed only if the selector has never partially matched
-                    // this node in this way
-                    if self.matched_sequence_points.insert((node.clone(), state)) {
-                        // Continue traversing the state machine linearly
-                        // and commit to the node
-                        open_states.push((state.advance(), SelectionCaret::Node));
-                    }
-                }
-                FlatSelectorSegment::Restrict(condition) => {
-                    // Proceed only if the condition holds
-                    if evaluate(condition, eval_context).is_truthy() {
-                        // continue traversing the state machine linearly
-                        open_states.push((state.advance(), target));
-                    }
-                }
-                FlatSelectorSegment::Branch(next_state) => {
-                    // Continue both linearly and from the indicated state
-                    open_states.push((state.jump(*next_state), target));
-                    open_states.push((state.advance(), target));
-                }
-                FlatSelectorSegment::Jump(next_state) => {
-                    // Continue only from the indicated state
-                    open_states.push((state.jump(*next_state), target));
+        let from = self.stack.pop().unwrap().active_states;
+        self.statistics.nodes_resolved += 1;
+        // Selectors without conditions resolve the same way over all nodes
+        // that none of them have partially matched yet,
+        // and selectors that only test types resolve the same way
+        // over all such nodes of the same type
+        let cached = {
+            let mut automaton = self.automaton.borrow_mut();
+            automaton.node_transition(self.selectors, from).or_else(|| {
+                let class = self.selectors.node_classifier.classify(eval_context);
+                automaton.typed_node_transition(self.selectors, from, class)
+            })
+        };
+        if let Some(transition) = cached
+            && transition.sequence_points.iter().all(|state| {
+                !self
+                    .matched_sequence_points
+                    .contains(&(node.clone(), *state))
+            })
+        {
+            for state in &transition.sequence_points {
+                self.matched_sequence_points.insert((node.clone(), *state));
+                if let Some(log) = &mut self.sequence_point_log {
+                    log.push(SequencePointRecord {
+                        node: node.clone(),
+                        state: *state,
+                        committed: true,
+                    });
                 }
             }
+            self.stack.push(ResolveFrame {
+                active_states: transition.output,
+            });
+            self.statistics.cached_transitions += 1;
+            return transition.matched_rules.clone();
         }
 
+        let states = self.automaton.borrow().set(from).clone();
+        self.statistics.states_evaluated += states.len();
+        let conditions_evaluated = &mut self.statistics.conditions_evaluated;
+        let (output_states, matched_rules) = close_over_node(
+            self.selectors,
+            &states,
+            |condition| {
+                *conditions_evaluated += 1;
+                Some(evaluate_compiled(condition, eval_context).is_truthy())
+            },
+            |state| {
+                let committed = self.matched_sequence_points.insert((node.clone(), state));
+                if let Some(log) = &mut self.sequence_point_log {
+                    log.push(SequencePointRecord {
+                        node: node.clone(),
+                        state,
+                        committed,
+                    });
+                }
+                committed
+            },
+        )
+        .expect("Conditions are always evaluated, so the resolution is never aborted");
+
         // Push back the frame that we popped earlier, with updates states
-        self.stack.push(ResolveFrame {
-            active_states: output_states,
-        });
+        let active_states = self.automaton.borrow_mut().intern(output_states);
+        self.stack.push(ResolveFrame { active_states });
         matched_rules
     }
 
@@ -165,7 +236,7 @@ impl<'a, T: NodeId> SelectorResolver<'a, T> {
     /// If this returns false, calling [`SelectorResolver::push_edge`]
     /// or [`SelectorResolver::resolve_node`] will yield no new results.
     pub fn has_edges_to_resolve(&self) -> bool {
-        !self.stack.last().unwrap().active_states.is_empty()
+        self.stack.last().unwrap().active_states != AutomatonCache::EMPTY_SET
     }
 
     /// Creates a copy of the resolver that is frozen at current frame
@@ -173,17 +244,149 @@ impl<'a, T: NodeId> SelectorResolver<'a, T> {
     pub fn snapshot(&self) -> Self {
         Self {
             selectors: self.selectors,
+            automaton: self.automaton.clone(),
             matched_sequence_points: self.matched_sequence_points.clone(),
             stack: vec![self.stack.last().unwrap().clone()],
+            sequence_point_log: None,
+            statistics: ResolverStatistics::default(),
         }
     }
+
+    /// Creates a copy of the resolver that is frozen at current frame,
+    /// like [`SelectorResolver::snapshot`], but does not share any state
+    /// with the original, so it can be moved to another thread.
+    ///
+    /// The copy must be [attached](DetachedResolver::attach)
+    /// before it can resolve selectors. It does not have access
+    /// to transitions determinized by the original, so it determinizes
+    /// them again as needed.
+    ///
+    /// Matched sequence points are shared by the original and the copy,
+    /// and by all resolvers attached from it, instead of being copied.
+    pub fn detach(&mut self) -> DetachedResolver<T> {
+        let active_states = self.stack.last().unwrap().active_states;
+        DetachedResolver {
+            active_states: self.automaton.borrow().set(active_states).to_vec(),
+            matched_sequence_points: self.matched_sequence_points.share(),
+        }
+    }
+}
+
+/// Copy of a [`SelectorResolver`] that does not depend
+/// on the compiled selectors, obtained from [`SelectorResolver::detach`].
+#[derive(Clone, Debug)]
+pub struct DetachedResolver<T: NodeId> {
+    /// States that were active in the current frame of the original resolver.
+    active_states: Vec<SelectorState>,
+
+    /// Sequence points that had been matched by the original resolver.
+    matched_sequence_points: Option<Arc<SharedSequencePoints<T>>>,
+}
+
+impl<T: NodeId> DetachedResolver<T> {
+    /// Reconstructs a resolver from the detached copy.
+    ///
+    /// The selectors must be the same ones the original resolver resolved.
+    /// The new resolver logs sequence point checks, so its effects
+    /// can be [replayed](SelectorResolver::replay_sequence_points)
+    /// on the original.
+    pub fn attach<'a>(&self, selectors: &'a CascadeSelector) -> SelectorResolver<'a, T> {
+        let mut automaton = AutomatonCache::new();
+        let active_states = automaton.intern(self.active_states.clone());
+        SelectorResolver {
+            selectors,
+            automaton: Rc::new(RefCell::new(automaton)),
+            matched_sequence_points: MatchedSequencePoints {
+                shared: self.matched_sequence_points.clone(),
+                own: HashSet::new(),
+            },
+            stack: vec![ResolveFrame { active_states }],
+            sequence_point_log: Some(Vec::new()),
+            statistics: ResolverStatistics::default(),
+        }
+    }
+}
+
+/// Pairs of nodes and selector sequence points matched by a [`SelectorResolver`].
+///
+/// Points matched before the resolver has been [detached](SelectorResolver::detach)
+/// are shared with the detached copies, so forking the resolution
+/// does not copy them.
+#[derive(Clone, Debug)]
+struct MatchedSequencePoints<T: NodeId> {
+    /// Points shared with detached copies of the resolver.
+    shared: Option<Arc<SharedSequencePoints<T>>>,
+
+    /// Points matched since the resolver has last been detached.
+    own: HashSet<(T, SelectorState)>,
+}
+
+/// Matched sequence points shared by several resolvers.
+#[derive(Debug)]
+struct SharedSequencePoints<T: NodeId> {
+    /// Points matched by the resolver that has shared them.
+    points: HashSet<(T, SelectorState)>,
+
+    /// Points that resolver itself had shared with others,
+    /// if they were still in use when it shared its own.
+    parent: Option<Arc<SharedSequencePoints<T>>>,
+}
+
+impl<T: NodeId> Default for MatchedSequencePoints<T> {
+    fn default() -> Self {
+        Self {
+            shared: None,
+            own: HashSet::new(),
+        }
+    }
+}
+
+impl<T: NodeId> MatchedSequencePoints<T> {
+    /// Checks whether a point has been matched.
+    fn contains(&self, point: &(T, SelectorState)) -> bool {
+        self.own.contains(point) || self.is_shared(point)
+    }
+
+    /// Marks a point as matched.
+    ///
+    /// ## Return Value
+    /// True if the point has not been matched before.
+    fn insert(&mut self, point: (T, SelectorState)) -> bool {
+        !self.is_shared(&point) && self.own.insert(point)
+    }
+
+    /// Checks whether a point is among the shared ones.
+    fn is_shared(&self, point: &(T, SelectorState)) -> bool {
+        std::iter::successors(self.shared.as_deref(), |shared| shared.parent.as_deref())
+            .any(|shared| shared.points.contains(point))
+    }
+
+    /// Makes all matched points shared so they can be used by another resolver.
+    ///
+    /// The points are added to the ones shared before if nobody else
+    /// uses those anymore, otherwise they are layered on top of them.
+    /// Either way, no points are copied.
+    fn share(&mut self) -> Option<Arc<SharedSequencePoints<T>>> {
+        if !self.own.is_empty() {
+            let own = std::mem::take(&mut self.own);
+            if let Some(shared) = self.shared.as_mut().and_then(Arc::get_mut) {
+                shared.points.extend(own);
+            } else {
+                self.shared = Some(Arc::new(SharedSequencePoints {
+                    points: own,
+                    parent: self.shared.take(),
+                }));
+            }
+        }
+        self.shared.clone()
+    }
 }
 
 impl CascadeSelector {
     /// Retrieves the list of all starting states of all selectors
     /// in a stalesheet.
     fn all_starting_states(&self) -> Vec<SelectorState> {
-        (0..self.0.len())
+        (0..self.selectors.len())
             .map(|i| SelectorState {
                 rule_index: i,
                 instruction_index: 0,
@@ -202,24 +405,69 @@ pub enum SelectionCaret {
     PrecedingEdge,
 }
 
+/// Record of a single check of a selector sequence point,
+/// as logged by [`SelectorResolver::sequence_point_log`].
+#[derive(Clone, PartialEq, Eq, Debug)]
+pub struct SequencePointRecord<T: NodeId> {
+    /// The node at which the check was made.
+    node: T,
+    /// The sequence point that was checked.
+    state: SelectorState,
+    /// Whether the check passed and the node has been committed.
+    committed: bool,
+}
+
+/// Counters of the work done by a [`SelectorResolver`],
+/// obtained from [`SelectorResolver::statistics`].
+#[derive(Clone, Copy, PartialEq, Eq, Default, Debug)]
+pub struct ResolverStatistics {
+    /// Number of nodes the selectors have been resolved over.
+    pub nodes_resolved: usize,
+
+    /// Number of node resolutions that reused a transition
+    /// of the selectors that had been determinized before.
+    pub cached_transitions: usize,
+
+    /// Number of selector states that have been advanced over a node
+    /// without a determinized transition.
+    pub states_evaluated: usize,
+
+    /// Number of selector conditions that have been evaluated.
+    pub conditions_evaluated: usize,
+}
+
+impl std::ops::AddAssign for ResolverStatistics {
+    fn add_assign(&mut self, rhs: Self) {
+        self.nodes_resolved += rhs.nodes_resolved;
+        self.cached_transitions += rhs.cached_transitions;
+        self.states_evaluated += rhs.states_evaluated;
+        self.conditions_evaluated += rhs.conditions_evaluated;
+    }
+}
+
+/// Opaque state of selectors tracked by [`SelectorResolver`],
+/// obtained from [`SelectorResolver::checkpoint`].
+#[derive(Clone, PartialEq, Eq, Debug)]
+pub struct ResolverCheckpoint(Arc<[SelectorState]>);
+
 /// Unique identifier of an instruction in a selector.
 #[derive(Clone, Copy, PartialEq, Eq, PartialOrd, Ord, Debug, Hash)]
-struct SelectorState {
+pub(super) struct SelectorState {
     /// Index of the selector.
-    rule_index: usize,
+    pub rule_index: usize,
     /// Index of the instruction within the selector.
-    instruction_index: usize,
+    pub instruction_index: usize,
 }
 
 impl SelectorState {
     /// Constructs a new state id that targets the following instruction.
-    fn advance(self) -> Self {
+    pub fn advance(self) -> Self {
         self.jump(self.instruction_index + 1)
     }
 
     /// Constructs a new state id that targets the same rule,
     /// with a different instruction index.
-    fn jump(self, next_instruction: usize) -> Self {
+    pub fn jump(self, next_instruction: usize) -> Self {
         Self {
             rule_index: self.rule_index,
             instruction_index: next_instruction,
@@ -231,6 +479,63 @@ impl SelectorState {
 #[derive(Clone)]
 struct ResolveFrame {
     /// All states in all selectors where their state machines
-    /// currently are.
-    active_states: Vec<SelectorState>,
+    /// currently are, interned by [`AutomatonCache`].
+    active_states: StateSetId,
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    fn point(node: usize) -> (usize, SelectorState) {
+        let state = SelectorState {
+            rule_index: 0,
+            instruction_index: 0,
+        };
+        (node, state)
+    }
+
+    #[test]
+    fn shared_points_are_reused_when_unused() {
+        let mut points = MatchedSequencePoints::default();
+        assert!(points.insert(point(0)));
+        let first = points.share().unwrap();
+        let first_address = Arc::as_ptr(&first);
+        drop(first);
+        assert!(points.insert(point(1)));
+        let second = points.share().unwrap();
+        // Nobody else used the shared points, so they have been extended
+        assert_eq!(Arc::as_ptr(&second), first_address);
+        assert!(second.parent.is_none());
+        assert_eq!(second.points.len(), 2);
+    }
+
+    #[test]
+    fn shared_points_are_layered_when_in_use() {
+        let mut points = MatchedSequencePoints::default();
+        assert!(points.insert(point(0)));
+        let first = points.share().unwrap();
+        assert!(points.insert(point(1)));
+        let second = points.share().unwrap();
+        assert!(Arc::ptr_eq(second.parent.as_ref().unwrap(), &first));
+        // Each layer only holds the points matched since the previous one
+        assert_eq!(first.points.len(), 1);
+        assert_eq!(second.points.len(), 1);
+        assert!(!points.insert(point(0)));
+        assert!(!points.insert(point(1)));
+    }
+
+    #[test]
+    fn attached_resolvers_see_shared_points() {
+        let mut points = MatchedSequencePoints::default();
+        assert!(points.insert(point(0)));
+        let mut attached = MatchedSequencePoints {
+            shared: points.share(),
+            own: HashSet::new(),
+        };
+        assert!(!attached.insert(point(0)));
+        assert!(attached.insert(point(1)));
+        // The original does not see points matched by the attached copy
+        assert!(points.insert(point(1)));
+    }
 }
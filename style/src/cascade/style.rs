@@ -1,6 +1,14 @@
 //! Preprocessing of [`Stylesheet`]s to simplify matching.
 
-use crate::stylesheet::{expression::Expression, selector::*, *};
+use super::{
+    automaton::{EdgeClassifier, NodeClassifier},
+    selector_resolver::SelectorState,
+};
+use crate::stylesheet::{
+    expression::{Expression, ExpressionDependency},
+    selector::*,
+    *,
+};
 use derive_more::Debug;
 
 /// Compiled stylesheet that can be used to evaluate the cascade.
@@ -14,7 +22,7 @@ impl<K: PropertyKey> CascadeStyle<K> {
     /// Constructs an empty stylesheet.
     pub fn empty() -> Self {
         Self {
-            selectors: CascadeSelector(Vec::new()),
+            selectors: CascadeSelector::new(Vec::new()),
             rules: Vec::new(),
         }
     }
@@ -31,6 +39,43 @@ impl<K: PropertyKey> CascadeStyle<K> {
     pub fn rule_at(&self, index: usize) -> &CascadeStyleRule<K> {
         &self.rules[index]
     }
+
+    /// Gets all rules of the stylesheet, in order of their indices.
+    pub fn rules(&self) -> &[CascadeStyleRule<K>] {
+        &self.rules
+    }
+
+    /// Assembles a stylesheet from already compiled parts
+    /// and assigns cache slots to their node-local expressions.
+    ///
+    /// There must be exactly one rule for each selector.
+    pub(super) fn from_parts(
+        mut selectors: Vec<FlatSelector>,
+        mut rules: Vec<CascadeStyleRule<K>>,
+    ) -> Self {
+        debug_assert_eq!(selectors.len(), rules.len());
+        // Structurally equal node-local expressions share values,
+        // so they also share slots in evaluation caches
+        let mut slots = Vec::new();
+        let conditions = selectors
+            .iter_mut()
+            .flat_map(|selector| &mut selector.path)
+            .filter_map(|segment| match segment {
+                FlatSelectorSegment::Restrict(condition) => Some(condition),
+                _ => None,
+            });
+        let values = rules
+            .iter_mut()
+            .flat_map(|rule| &mut rule.properties)
+            .map(|clause| &mut clause.value);
+        for expression in conditions.chain(values) {
+            expression.assign_slot(&mut slots);
+        }
+        Self {
+            selectors: CascadeSelector::new(selectors),
+            rules,
+        }
+    }
 }
 
 impl<K: PropertyKey> Default for CascadeStyle<K> {
@@ -49,21 +94,50 @@ impl<K: PropertyKey> From<Stylesheet<K>> for CascadeStyle<K> {
                 let selector = rule.selector.into();
                 let body = CascadeStyleRule {
                     extra_label,
-                    properties: rule.properties,
+                    properties: rule
+                        .properties
+                        .into_iter()
+                        .map(CascadeStyleClause::from)
+                        .collect(),
                 };
                 (selector, body)
             })
             .unzip();
-        Self {
-            selectors: CascadeSelector(selectors),
-            rules,
-        }
+        Self::from_parts(selectors, rules)
     }
 }
 
 /// Compiled bundle of selectors.
 #[derive(Debug)]
-pub struct CascadeSelector(pub(super) Vec<FlatSelector>);
+pub struct CascadeSelector {
+    /// State machines of the individual selectors.
+    pub(super) selectors: Vec<FlatSelector>,
+
+    /// Classification of edges by the selectors that match them.
+    pub(super) edge_classifier: EdgeClassifier,
+
+    /// Classification of nodes by the type conditions that they pass.
+    pub(super) node_classifier: NodeClassifier,
+}
+
+impl CascadeSelector {
+    /// Bundles compiled selectors.
+    pub(super) fn new(selectors: Vec<FlatSelector>) -> Self {
+        Self {
+            edge_classifier: EdgeClassifier::new(&selectors),
+            node_classifier: NodeClassifier::new(&selectors),
+            selectors,
+        }
+    }
+
+    /// Retrieves the instruction at a state of the state machine,
+    /// or [`None`] if the state is at the end of its selector.
+    pub(super) fn instruction(&self, state: SelectorState) -> Option<&FlatSelectorSegment> {
+        self.selectors[state.rule_index]
+            .path
+            .get(state.instruction_index)
+    }
+}
 
 /// Body of a single rule in a compiled [`CascadeStyle`].
 ///
@@ -76,7 +150,82 @@ pub struct CascadeStyleRule<K: PropertyKey = RawPropertyKey> {
     pub extra_label: Option<String>,
 
     /// Properties in the body of the original rule.
-    pub properties: Vec<StyleClause<K>>,
+    pub properties: Vec<CascadeStyleClause<K>>,
+}
+
+/// [`StyleClause`] in a compiled [`CascadeStyle`].
+#[derive(Debug)]
+#[debug("{key:?}: ({value:?})")]
+pub struct CascadeStyleClause<K: PropertyKey = RawPropertyKey> {
+    /// Name of the property or variable to assign.
+    pub key: StyleKey<K>,
+
+    /// Expression that is evaluated to obtain the value of the property.
+    pub value: CompiledExpression,
+}
+
+impl<K: PropertyKey> From<StyleClause<K>> for CascadeStyleClause<K> {
+    fn from(value: StyleClause<K>) -> Self {
+        Self {
+            key: value.key,
+            value: value.value.into(),
+        }
+    }
+}
+
+/// [`Expression`] prepared for repeated evaluation.
+///
+/// Constant subexpressions are folded and the expression
+/// is classified by its [dependency](Expression::dependency).
+#[derive(Clone, PartialEq, Eq, Debug)]
+#[debug("{expression:?}")]
+pub struct CompiledExpression {
+    /// The expression with constants folded.
+    pub expression: Expression,
+
+    /// What the value of the expression depends on.
+    pub dependency: ExpressionDependency,
+
+    /// Slot of the expression in an
+    /// [`EvaluationCache`](crate::eval::cache::EvaluationCache),
+    /// assigned to node-local expressions of a [`CascadeStyle`].
+    pub slot: Option<usize>,
+}
+
+impl CompiledExpression {
+    /// Assigns a cache slot to a node-local expression,
+    /// sharing it with a structurally equal expression if there is one.
+    fn assign_slot(&mut self, slots: &mut Vec<Expression>) {
+        if self.dependency != ExpressionDependency::NodeLocal {
+            return;
+        }
+        let slot = slots
+            .iter()
+            .position(|e| *e == self.expression)
+            .unwrap_or_else(|| {
+                slots.push(self.expression.clone());
+                slots.len() - 1
+            });
+        self.slot = Some(slot);
+    }
+}
+
+impl From<Expression> for CompiledExpression {
+    fn from(mut value: Expression) -> Self {
+        value.fold_constants();
+        Self {
+            dependency: value.dependency(),
+            expression: value,
+            slot: None,
+        }
+    }
+}
+
+impl std::ops::Deref for CompiledExpression {
+    type Target = Expression;
+    fn deref(&self) -> &Self::Target {
+        &self.expression
+    }
 }
 
 /// [`Selector`] flattened to simplify matching against it.
@@ -156,7 +305,7 @@ pub enum FlatSelectorSegment {
     /// to a [truthy](crate::values::PropertyValue::is_truthy)
     /// value in order to take the transition.
     #[debug("if ({_0:?})")]
-    Restrict(Expression),
+    Restrict(CompiledExpression),
 
     /// Epsilon transition to a state specified by its index.
     ///
@@ -257,7 +406,7 @@ fn flatten_selector_segment(segment: SelectorSegment, output: &mut Vec<FlatSelec
         }
         SelectorSegment::Condition(condition) => {
             // Match if the condition passes
-            output.push(FlatSelectorSegment::Restrict(condition));
+            output.push(FlatSelectorSegment::Restrict(condition.into()));
         }
     }
 }
@@ -353,7 +502,7 @@ mod test {
                     SelectorPath(vec![SelectorSegment::Match(EdgeMatcher::Any)]),
                     SelectorPath(vec![
                         SelectorSegment::Match(EdgeMatcher::AnyNamed),
-                        SelectorSegment::Match(EdgeMatcher::Named("hello".to_owned())),
+                        SelectorSegment::Match(EdgeMatcher::Named("hello".into())),
                     ]),
                     SelectorPath(vec![SelectorSegment::Match(EdgeMatcher::AnyIndex)]),
                 ]),
@@ -374,7 +523,7 @@ mod test {
                 /* 7 */ MatchNode,
                 MatchEdge(EdgeMatcher::AnyNamed),
                 MatchNode,
-                MatchEdge(EdgeMatcher::Named("hello".to_owned())),
+                MatchEdge(EdgeMatcher::Named("hello".into())),
                 Jump(14),
                 /* 12 */ MatchNode,
                 MatchEdge(EdgeMatcher::AnyIndex),
@@ -0,0 +1,57 @@
+//! Memoization of expression values.
+
+use crate::values::PropertyValue;
+use aili_model::state::NodeId;
+use std::collections::HashMap;
+
+/// Values of [node-local](crate::stylesheet::expression::ExpressionDependency::NodeLocal)
+/// expressions, memoized by the nodes they have been evaluated from.
+///
+/// Expressions are identified by the slots assigned to them
+/// when the [stylesheet is compiled](crate::cascade::CascadeStyle).
+/// A cache is only valid for a single stylesheet and a single
+/// unmodified graph. It should be discarded when either changes.
+#[derive(Debug)]
+pub struct EvaluationCache<T: NodeId> {
+    values: HashMap<(usize, T), PropertyValue<T>>,
+}
+
+impl<T: NodeId> EvaluationCache<T> {
+    /// Constructs an empty cache.
+    pub fn new() -> Self {
+        Self {
+            values: HashMap::new(),
+        }
+    }
+
+    /// Retrieves a memoized value of an expression.
+    pub fn get(&self, slot: usize, node: &T) -> Option<&PropertyValue<T>> {
+        self.values.get(&(slot, node.clone()))
+    }
+
+    /// Memoizes a value of an expression.
+    pub fn insert(&mut self, slot: usize, node: T, value: PropertyValue<T>) {
+        self.values.insert((slot, node), value);
+    }
+
+    /// Discards all memoized values.
+    pub fn clear(&mut self) {
+        self.values.clear();
+    }
+
+    /// Number of memoized values.
+    pub fn len(&self) -> usize {
+        self.values.len()
+    }
+
+    /// Checks whether the cache contains any memoized values.
+    pub fn is_empty(&self) -> bool {
+        self.values.is_empty()
+    }
+}
+
+impl<T: NodeId> Default for EvaluationCache<T> {
+    fn default() -> Self {
+        Self::new()
+    }
+}
@@ -1,7 +1,8 @@
 //! Contexts for expression evaluation.
 
-use super::variable_pool::VariablePool;
+use super::{cache::EvaluationCache, variable_pool::VariablePool};
 use aili_model::state::{EdgeLabel, NodeTypeId, ProgramStateGraph, ProgramStateNode};
+use std::cell::RefCell;
 
 /// Provides stateful context for expression evaluation.
 pub struct EvaluationContext<'a, T>
@@ -34,6 +35,10 @@ where
     /// [`MagicVariableKey::EdgeDiscriminator`](crate::stylesheet::expression::MagicVariableKey::EdgeDiscriminator)
     /// should resolve to.
     pub edge_discriminator: Option<usize>,
+
+    /// Memoized values of node-local expressions,
+    /// used by [`evaluate_compiled`](super::evaluate_compiled).
+    pub cache: Option<&'a RefCell<EvaluationCache<T::NodeId>>>,
 }
 
 impl<'a, T> EvaluationContext<'a, T>
@@ -56,6 +61,7 @@ where
             edge_index: None,
             edge_discriminator: None,
             edge_name: None,
+            cache: None,
         }
     }
 
@@ -67,6 +73,12 @@ where
         self
     }
 
+    /// Adds a cache for memoizing values of node-local expressions.
+    pub fn with_cache(mut self, cache: &'a RefCell<EvaluationCache<T::NodeId>>) -> Self {
+        self.cache = Some(cache);
+        self
+    }
+
     /// Adds an edge index for evaluating the
     /// [`MagicVariableKey::EdgeIndex`](crate::stylesheet::expression::MagicVariableKey::EdgeIndex)
     /// magic variable.
@@ -102,7 +114,7 @@ where
                 self.edge_index = Some(*index);
             }
             EdgeLabel::Named(name, discriminator) => {
-                self.edge_name = Some(name);
+                self.edge_name = Some(name.as_str());
                 self.edge_discriminator = Some(*discriminator);
             }
             _ => {}
@@ -133,6 +145,7 @@ where
             edge_index: None,
             edge_discriminator: None,
             edge_name: None,
+            cache: None,
         }
     }
 }
@@ -1,10 +1,16 @@
 //! Expression evaluation.
 
+pub mod cache;
 pub mod context;
 mod evaluator;
+mod persistent_map;
 pub mod variable_pool;
 
-use crate::{stylesheet::expression::Expression, values::PropertyValue};
+use crate::{
+    cascade::CompiledExpression,
+    stylesheet::expression::{Expression, ExpressionDependency},
+    values::PropertyValue,
+};
 use aili_model::state::ProgramStateGraph;
 use context::EvaluationContext;
 use evaluator::Evaluator;
@@ -17,6 +23,36 @@ pub fn evaluate<T: ProgramStateGraph>(
     Evaluator(context).evaluate(expression)
 }
 
+/// Evaluates a compiled expression in a provided context.
+///
+/// If the context has a [cache](EvaluationContext::with_cache),
+/// values of node-local expressions are memoized in it
+/// by the [origin node](EvaluationContext::select_origin).
+pub fn evaluate_compiled<T: ProgramStateGraph>(
+    expression: &CompiledExpression,
+    context: &EvaluationContext<T>,
+) -> PropertyValue<T::NodeId> {
+    let (Some(slot), Some(cache), Some(origin)) =
+        (expression.slot, context.cache, &context.select_origin)
+    else {
+        return evaluate(&expression.expression, context);
+    };
+    debug_assert_eq!(expression.dependency, ExpressionDependency::NodeLocal);
+    if let Some(value) = cache.borrow().get(slot, origin) {
+        // The value has been read from the origin node,
+        // so make sure the graph still observes the access
+        if let Some(graph) = context.graph {
+            graph.get(origin);
+        }
+        return value.clone();
+    }
+    let value = evaluate(&expression.expression, context);
+    cache
+        .borrow_mut()
+        .insert(slot, origin.clone(), value.clone());
+    value
+}
+
 /// If a [`PropertyValue`] is a [`PropertyValue::Selection`],
 /// evaluates the node and returns its value.
 ///
@@ -0,0 +1,235 @@
+//! Hash map with structural sharing for cheap snapshots.
+
+use std::{
+    hash::{BuildHasher, Hash, RandomState},
+    sync::Arc,
+};
+
+/// Number of hash bits consumed by each level of the trie.
+const BITS_PER_LEVEL: u32 = 4;
+
+/// Number of children of each branch of the trie.
+const BRANCH_WIDTH: usize = 1 << BITS_PER_LEVEL;
+
+/// Hash map whose clones share storage.
+///
+/// Entries are stored in a hash trie whose nodes are reference counted.
+/// Cloning the map only clones the reference to the root,
+/// and a modification only copies the nodes on the path to the modified entry
+/// that are still shared with another clone, so the cost of both
+/// does not depend on the number of entries.
+#[derive(Clone)]
+pub(super) struct PersistentMap<K, V> {
+    root: Option<Arc<TrieNode<K, V>>>,
+    hasher: RandomState,
+}
+
+#[derive(Clone)]
+enum TrieNode<K, V> {
+    Branch([Option<Arc<TrieNode<K, V>>>; BRANCH_WIDTH]),
+    /// Entries whose keys all have the same hash.
+    Leaf(u64, Vec<(K, V)>),
+}
+
+impl<K, V> PersistentMap<K, V>
+where
+    K: Hash + Eq + Clone,
+    V: Clone,
+{
+    /// Constructs an empty map.
+    pub fn new() -> Self {
+        Self {
+            root: None,
+            hasher: RandomState::new(),
+        }
+    }
+
+    /// Accesses the value of a key.
+    pub fn get<Q>(&self, key: &Q) -> Option<&V>
+    where
+        Q: Hash + Eq + ?Sized,
+        K: std::borrow::Borrow<Q>,
+    {
+        let hash = self.hasher.hash_one(key);
+        let mut node = self.root.as_deref()?;
+        let mut shift = 0;
+        loop {
+            match node {
+                TrieNode::Branch(children) => {
+                    node = children[Self::child_index(hash, shift)].as_deref()?;
+                    shift += BITS_PER_LEVEL;
+                }
+                TrieNode::Leaf(leaf_hash, entries) => {
+                    if *leaf_hash != hash {
+                        return None;
+                    }
+                    return entries
+                        .iter()
+                        .find(|(k, _)| k.borrow() == key)
+                        .map(|(_, v)| v);
+                }
+            }
+        }
+    }
+
+    /// Assigns a value to a key.
+    ///
+    /// ## Return Value
+    /// The value the key had before, if any.
+    pub fn insert(&mut self, key: K, value: V) -> Option<V> {
+        let hash = self.hasher.hash_one(&key);
+        Self::insert_into(&mut self.root, hash, 0, key, value)
+    }
+
+    /// Removes a key from the map.
+    ///
+    /// ## Return Value
+    /// The value the key had, if any.
+    pub fn remove<Q>(&mut self, key: &Q) -> Option<V>
+    where
+        Q: Hash + Eq + ?Sized,
+        K: std::borrow::Borrow<Q>,
+    {
+        let hash = self.hasher.hash_one(key);
+        Self::remove_from(&mut self.root, hash, 0, key)
+    }
+
+    /// Iterates over all entries of the map in an unspecified order.
+    pub fn iter(&self) -> impl Iterator<Item = (&K, &V)> {
+        let mut to_visit = Vec::from_iter(self.root.as_deref());
+        let mut entries: std::slice::Iter<(K, V)> = [].iter();
+        std::iter::from_fn(move || {
+            loop {
+                if let Some((k, v)) = entries.next() {
+                    return Some((k, v));
+                }
+                match to_visit.pop()? {
+                    TrieNode::Branch(children) => {
+                        to_visit.extend(children.iter().filter_map(Option::as_deref))
+                    }
+                    TrieNode::Leaf(_, leaf_entries) => entries = leaf_entries.iter(),
+                }
+            }
+        })
+    }
+
+    fn child_index(hash: u64, shift: u32) -> usize {
+        ((hash >> shift) as usize) & (BRANCH_WIDTH - 1)
+    }
+
+    fn insert_into(
+        slot: &mut Option<Arc<TrieNode<K, V>>>,
+        hash: u64,
+        shift: u32,
+        key: K,
+        value: V,
+    ) -> Option<V> {
+        let Some(node) = slot else {
+            *slot = Some(Arc::new(TrieNode::Leaf(hash, vec![(key, value)])));
+            return None;
+        };
+        // A leaf with a different hash must be pushed one level down
+        if let TrieNode::Leaf(leaf_hash, _) = **node
+            && leaf_hash != hash
+        {
+            // Hashes that have run out of bits can only be equal
+            debug_assert!(shift < u64::BITS);
+            let mut children = std::array::from_fn(|_| None);
+            children[Self::child_index(leaf_hash, shift)] = Some(node.clone());
+            *node = Arc::new(TrieNode::Branch(children));
+        }
+        match Arc::make_mut(node) {
+            TrieNode::Branch(children) => Self::insert_into(
+                &mut children[Self::child_index(hash, shift)],
+                hash,
+                shift + BITS_PER_LEVEL,
+                key,
+                value,
+            ),
+            TrieNode::Leaf(_, entries) => {
+                if let Some((_, old_value)) = entries.iter_mut().find(|(k, _)| *k == key) {
+                    Some(std::mem::replace(old_value, value))
+                } else {
+                    entries.push((key, value));
+                    None
+                }
+            }
+        }
+    }
+
+    fn remove_from<Q>(
+        slot: &mut Option<Arc<TrieNode<K, V>>>,
+        hash: u64,
+        shift: u32,
+        key: &Q,
+    ) -> Option<V>
+    where
+        Q: Hash + Eq + ?Sized,
+        K: std::borrow::Borrow<Q>,
+    {
+        let node = slot.as_mut()?;
+        // Check that the key is present before anything is copied
+        if let TrieNode::Leaf(leaf_hash, entries) = &**node
+            && (*leaf_hash != hash || !entries.iter().any(|(k, _)| k.borrow() == key))
+        {
+            return None;
+        }
+        let (removed, is_empty) = match Arc::make_mut(node) {
+            TrieNode::Branch(children) => {
+                let removed = Self::remove_from(
+                    &mut children[Self::child_index(hash, shift)],
+                    hash,
+                    shift + BITS_PER_LEVEL,
+                    key,
+                );
+                (removed, children.iter().all(Option::is_none))
+            }
+            TrieNode::Leaf(_, entries) => {
+                let position = entries.iter().position(|(k, _)| k.borrow() == key)?;
+                let (_, removed) = entries.swap_remove(position);
+                (Some(removed), entries.is_empty())
+            }
+        };
+        if is_empty {
+            *slot = None;
+        }
+        removed
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    #[test]
+    fn clones_do_not_see_modifications() {
+        let mut map = PersistentMap::new();
+        for i in 0..1000 {
+            map.insert(i, i * 2);
+        }
+        let mut clone = map.clone();
+        clone.insert(1, 0);
+        assert_eq!(clone.remove(&2), Some(4));
+        map.insert(1000, 0);
+        assert_eq!(map.get(&1), Some(&2));
+        assert_eq!(map.get(&2), Some(&4));
+        assert_eq!(clone.get(&1), Some(&0));
+        assert_eq!(clone.get(&2), None);
+        assert_eq!(clone.get(&1000), None);
+        assert_eq!(map.iter().count(), 1001);
+        assert_eq!(clone.iter().count(), 999);
+    }
+
+    #[test]
+    fn removing_all_entries_empties_the_map() {
+        let mut map = PersistentMap::new();
+        for i in 0..100 {
+            assert_eq!(map.insert(i, i), None);
+        }
+        for i in 0..100 {
+            assert_eq!(map.remove(&i), Some(i));
+            assert_eq!(map.remove(&i), None);
+        }
+        assert!(map.root.is_none());
+    }
+}
@@ -1,24 +1,58 @@
 //! Container for storing interpreter variables.
 
+use super::persistent_map::PersistentMap;
 use crate::values::PropertyValue;
 use aili_model::state::NodeId;
-use std::collections::HashMap;
+use std::collections::HashSet;
 
 /// Container that stores variables for the interpreter in a layered stack structure.
+///
+/// Only the current value of each variable is stored in a single map,
+/// so lookup does not depend on the number of frames.
+/// Values that have been overwritten are kept in an undo log
+/// and reinstated when the frame that overwrote them is popped.
 #[derive(Clone)]
-pub struct VariablePool<K, T>(Vec<HashMap<K, PropertyValue<T>>>)
+pub struct VariablePool<K, T>
 where
-    K: std::hash::Hash + Eq,
-    T: NodeId;
+    K: std::hash::Hash + Eq + Clone,
+    T: NodeId,
+{
+    /// Current values of all variables.
+    ///
+    /// The map shares storage with [snapshots](VariablePool::snapshot),
+    /// so only the parts that either of them modifies are copied.
+    values: PersistentMap<K, PropertyValue<T>>,
+
+    /// Variables assigned in pushed frames, in order of (first) assignment,
+    /// along with the values they had before the frame.
+    undo_log: Vec<(K, Option<PropertyValue<T>>)>,
+
+    /// Pushed frames, starting from the bottom.
+    frames: Vec<VariablePoolFrame<K>>,
+}
+
+/// Frame pushed to a [`VariablePool`].
+#[derive(Clone)]
+struct VariablePoolFrame<K> {
+    /// Length of [`VariablePool::undo_log`] at the start of the frame.
+    undo_log_start: usize,
+
+    /// Variables that have been assigned in the frame.
+    assigned: HashSet<K>,
+}
 
 impl<K, T> VariablePool<K, T>
 where
-    K: std::hash::Hash + Eq,
+    K: std::hash::Hash + Eq + Clone,
     T: NodeId,
 {
     /// Construct a new variable pool with one (permanent) frame.
     pub fn new() -> Self {
-        Self(vec![HashMap::new()])
+        Self {
+            values: PersistentMap::new(),
+            undo_log: Vec::new(),
+            frames: Vec::new(),
+        }
     }
 
     /// Pushes a variable pool frame.
@@ -27,7 +61,10 @@ where
     /// to the new frame and will be discarded by a matching call
     /// to [`VariablePool::pop`].
     pub fn push(&mut self) {
-        self.0.push(HashMap::new());
+        self.frames.push(VariablePoolFrame {
+            undo_log_start: self.undo_log.len(),
+            assigned: HashSet::new(),
+        });
     }
 
     /// Pops a variable pool frame.
@@ -38,8 +75,15 @@ where
     ///
     /// If there are no frames except the bottom, this operation does nothing.
     pub fn pop(&mut self) {
-        if self.0.len() > 1 {
-            self.0.pop();
+        let Some(frame) = self.frames.pop() else {
+            return;
+        };
+        for (key, old_value) in self.undo_log.drain(frame.undo_log_start..).rev() {
+            if let Some(old_value) = old_value {
+                self.values.insert(key, old_value);
+            } else {
+                self.values.remove(&key);
+            }
         }
     }
 
@@ -52,11 +96,7 @@ where
         Q: std::hash::Hash + Eq + ?Sized,
         K: std::borrow::Borrow<Q>,
     {
-        self.0
-            .iter()
-            .rev()
-            .filter_map(|frame| frame.get(key))
-            .next()
+        self.values.get(key)
     }
 
     /// Assigns a value to a variable by its key.
@@ -64,34 +104,102 @@ where
     /// The value will be discarded on the next call to [`VariablePool::pop`].
     /// If the variable already had a value, the old value will be reinstated.
     pub fn insert(&mut self, variable_name: K, value: PropertyValue<T>) {
-        self.0
-            .last_mut()
-            .expect("The bottom frame of variable pool should never be popped")
-            .insert(variable_name, value);
+        let old_value = self.values.insert(variable_name.clone(), value);
+        // Only the value from before the frame needs to be reinstated,
+        // so repeated assignments within a frame are not logged
+        if let Some(frame) = self.frames.last_mut()
+            && frame.assigned.insert(variable_name.clone())
+        {
+            self.undo_log.push((variable_name, old_value));
+        }
+    }
+
+    /// Iterates over variables that have been assigned
+    /// since the last call to [`VariablePool::push`].
+    pub fn current_frame(&self) -> impl Iterator<Item = (&K, &PropertyValue<T>)> {
+        // All variables belong to the bottom frame
+        // until another frame is pushed
+        let Some(frame) = self.frames.last() else {
+            let all: Box<dyn Iterator<Item = _>> = Box::new(self.values.iter());
+            return all;
+        };
+        Box::new(
+            self.undo_log[frame.undo_log_start..]
+                .iter()
+                .map(|(key, _)| (key, self.get(key).expect("Assigned variables have values"))),
+        )
     }
 
     /// Creates a copy of the pool that is frozen at the current
     /// frame and cannot be popped past it.
     ///
-    /// Frames of this pool are flattened to save memory in the clone.
-    pub fn snapshot(&self) -> Self
-    where
-        K: Clone,
-    {
-        let mut frame = HashMap::new();
-        for (key, value) in self.0.iter().rev().flat_map(|f| f.iter()) {
-            frame.entry(key.clone()).or_insert_with(|| value.clone());
+    /// The copy shares storage with this pool, so taking a snapshot
+    /// is cheap regardless of the number of variables and frames,
+    /// and so are the modifications of either of them afterwards.
+    pub fn snapshot(&self) -> Self {
+        Self {
+            values: self.values.clone(),
+            undo_log: Vec::new(),
+            frames: Vec::new(),
         }
-        Self(vec![frame])
     }
 }
 
 impl<K, T> Default for VariablePool<K, T>
 where
-    K: std::hash::Hash + Eq,
+    K: std::hash::Hash + Eq + Clone,
     T: NodeId,
 {
     fn default() -> Self {
         Self::new()
     }
 }
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    #[test]
+    fn pop_reinstates_overwritten_values() {
+        let mut pool = VariablePool::<&str, usize>::new();
+        pool.insert("a", 1u64.into());
+        pool.push();
+        pool.insert("a", 2u64.into());
+        pool.insert("b", 3u64.into());
+        pool.insert("a", 4u64.into());
+        assert_eq!(pool.get("a"), Some(&4u64.into()));
+        pool.pop();
+        assert_eq!(pool.get("a"), Some(&1u64.into()));
+        assert_eq!(pool.get("b"), None);
+        // The bottom frame is never popped
+        pool.pop();
+        assert_eq!(pool.get("a"), Some(&1u64.into()));
+    }
+
+    #[test]
+    fn current_frame_lists_each_variable_once() {
+        let mut pool = VariablePool::<&str, usize>::new();
+        pool.insert("a", 1u64.into());
+        pool.push();
+        pool.insert("b", 2u64.into());
+        pool.insert("b", 3u64.into());
+        let frame = Vec::from_iter(pool.current_frame());
+        assert_eq!(frame, [(&"b", &3u64.into())]);
+    }
+
+    #[test]
+    fn snapshot_is_independent_of_original() {
+        let mut pool = VariablePool::<&str, usize>::new();
+        pool.insert("a", 1u64.into());
+        pool.push();
+        pool.insert("b", 2u64.into());
+        let mut snapshot = pool.snapshot();
+        pool.pop();
+        snapshot.pop();
+        assert_eq!(pool.get("b"), None);
+        assert_eq!(snapshot.get("b"), Some(&2u64.into()));
+        snapshot.insert("a", 3u64.into());
+        assert_eq!(pool.get("a"), Some(&1u64.into()));
+        assert_eq!(snapshot.current_frame().count(), 2);
+    }
+}
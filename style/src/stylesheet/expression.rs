@@ -1,6 +1,13 @@
 //! Stylesheet expressions that evaluate to property values.
 
-use aili_model::state::{EdgeLabel, NodeTypeClass};
+use crate::{
+    eval::{
+        context::{Never, StatelessEvaluation},
+        evaluate,
+    },
+    values::PropertyValue,
+};
+use aili_model::state::{EdgeLabel, NodeTypeClass, NodeValue};
 use derive_more::{Debug, From};
 
 /// Stylesheet expression.
@@ -59,6 +66,116 @@ pub enum Expression {
     Conditional(Box<Expression>, Box<Expression>, Box<Expression>),
 }
 
+impl Expression {
+    /// Determines what the value of the expression depends on.
+    pub fn dependency(&self) -> ExpressionDependency {
+        use Expression::*;
+        match self {
+            Unset | Bool(_) | String(_) | Int(_) => ExpressionDependency::Constant,
+            Variable(_) | MagicVariable(_) => ExpressionDependency::VariableDependent,
+            Select(selector) => selector.dependency(),
+            UnaryOperator(_, operand) => operand.dependency(),
+            BinaryOperator(left, _, right) => left.dependency().max(right.dependency()),
+            Conditional(condition, if_true, if_false) => condition
+                .dependency()
+                .max(if_true.dependency())
+                .max(if_false.dependency()),
+        }
+    }
+
+    /// Replaces all subexpressions whose values are
+    /// [constant](ExpressionDependency::Constant) with literals.
+    ///
+    /// Conditional expressions with constant conditions
+    /// are also replaced with the branch that would be taken.
+    pub fn fold_constants(&mut self) {
+        use Expression::*;
+        match self {
+            Unset | Bool(_) | String(_) | Int(_) | Variable(_) | MagicVariable(_) => return,
+            Select(selector) => {
+                if let Some(origin) = &mut selector.origin {
+                    origin.fold_constants();
+                }
+                for segment in &mut selector.path {
+                    if let LimitedEdgeMatcher::DynIndex(index) = segment {
+                        index.fold_constants();
+                    }
+                }
+                return;
+            }
+            UnaryOperator(_, operand) => operand.fold_constants(),
+            BinaryOperator(left, _, right) => {
+                left.fold_constants();
+                right.fold_constants();
+            }
+            Conditional(condition, if_true, if_false) => {
+                condition.fold_constants();
+                if_true.fold_constants();
+                if_false.fold_constants();
+                if condition.dependency() == ExpressionDependency::Constant {
+                    let branch = if Self::constant_value(condition).is_truthy() {
+                        if_true
+                    } else {
+                        if_false
+                    };
+                    *self = std::mem::replace(branch.as_mut(), Unset);
+                    return;
+                }
+            }
+        }
+        if self.dependency() == ExpressionDependency::Constant
+            && let Some(literal) = Self::literal(Self::constant_value(self))
+        {
+            *self = literal;
+        }
+    }
+
+    /// Evaluates an expression that has no dependencies.
+    fn constant_value(&self) -> PropertyValue<Never> {
+        evaluate(self, &StatelessEvaluation::new())
+    }
+
+    /// Constructs a literal expression that evaluates to a value,
+    /// if there is one.
+    fn literal(value: PropertyValue<Never>) -> Option<Self> {
+        match value {
+            PropertyValue::Unset => Some(Self::Unset),
+            PropertyValue::Value(NodeValue::Bool(b)) => Some(Self::Bool(b)),
+            PropertyValue::Value(NodeValue::Uint(u)) => Some(Self::Int(u)),
+            // Integer literals evaluate to unsigned values,
+            // so only negative signed values can be written as literals
+            PropertyValue::Value(NodeValue::Int(i)) if i < 0 && i != i64::MIN => Some(
+                Self::UnaryOperator(UnaryOperator::Minus, Box::new(Self::Int(i.unsigned_abs()))),
+            ),
+            PropertyValue::String(s) => Some(Self::String(s)),
+            _ => None,
+        }
+    }
+}
+
+/// Classification of [`Expression`]s by what their values depend on.
+///
+/// The classes are ordered from the least to the most dependent.
+/// An expression depends on everything its subexpressions depend on.
+#[derive(Clone, Copy, PartialEq, Eq, PartialOrd, Ord, Debug)]
+pub enum ExpressionDependency {
+    /// The expression always evaluates to the same value.
+    Constant,
+
+    /// The expression only depends on the node from which it is evaluated.
+    ///
+    /// Its value does not change as long as the node does not change.
+    NodeLocal,
+
+    /// The expression selects nodes other than the one
+    /// from which it is evaluated.
+    SelectDependent,
+
+    /// The expression depends on variables or on the edge
+    /// along which the node has been reached.
+    VariableDependent,
+}
+
 /// Identifiers of variables that can be invoked within expressions.
 #[derive(Clone, PartialEq, Eq, Debug)]
 pub enum VariableKey {
@@ -367,6 +484,30 @@ impl LimitedSelector {
     }
 }
 
+impl LimitedSelector {
+    /// Determines what the selected entity depends on.
+    ///
+    /// See [`Expression::dependency`].
+    pub fn dependency(&self) -> ExpressionDependency {
+        // Without an origin or a path, the selector selects
+        // the node from which it is evaluated
+        let mut dependency = if self.origin.is_none() && self.path.is_empty() {
+            ExpressionDependency::NodeLocal
+        } else {
+            ExpressionDependency::SelectDependent
+        };
+        if let Some(origin) = &self.origin {
+            dependency = dependency.max(origin.dependency());
+        }
+        for segment in &self.path {
+            if let LimitedEdgeMatcher::DynIndex(index) = segment {
+                dependency = dependency.max(index.dependency());
+            }
+        }
+        dependency
+    }
+}
+
 impl std::fmt::Debug for LimitedSelector {
     fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
         if let Some(origin) = &self.origin {
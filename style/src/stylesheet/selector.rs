@@ -2,7 +2,7 @@
 //! that lead to them.
 
 use super::expression::Expression;
-use aili_model::state::EdgeLabel;
+use aili_model::{state::EdgeLabel, symbol::Symbol};
 use derive_more::{Debug, From};
 
 /// Pattern against which an [`EdgeLabel`] can be matched.
@@ -28,7 +28,7 @@ pub enum EdgeMatcher {
     /// Matches all [`EdgeLabel::Named`] edges with a particular name,
     /// but with any secondary index.
     #[debug("{_0:?}")]
-    Named(String),
+    Named(Symbol),
 }
 
 impl EdgeMatcher {
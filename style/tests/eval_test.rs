@@ -4,14 +4,16 @@ mod test_graph;
 
 use aili_model::state::RootedProgramStateGraph as _;
 use aili_style::{
-    eval::{context::EvaluationContext, evaluate},
+    cascade::CompiledExpression,
+    eval::{cache::EvaluationCache, context::EvaluationContext, evaluate, evaluate_compiled},
     stylesheet::expression::{
         BinaryOperator as BinaryOp,
         Expression::{self, *},
-        UnaryOperator as UnaryOp,
+        ExpressionDependency, LimitedSelector, MagicVariableKey, UnaryOperator as UnaryOp,
     },
     values::PropertyValue,
 };
+use std::cell::RefCell;
 use test_graph::TestGraph;
 
 /// Evaluate an expression at the root node of the [`TestGraph::default_graph`].
@@ -785,3 +787,105 @@ fn conditional_returns_third_argument_if_first_is_falsy() {
     );
     assert_eq!(eval_on_default_graph(&expr), 42u64.into());
 }
+
+#[test]
+fn literals_are_constant() {
+    let expr = BinaryOperator(Int(1).into(), BinaryOp::Plus, String("a".to_owned()).into());
+    assert_eq!(expr.dependency(), ExpressionDependency::Constant);
+}
+
+#[test]
+fn selecting_origin_is_node_local() {
+    let expr = UnaryOperator(
+        UnaryOp::NodeValue,
+        Select(LimitedSelector::default().into()).into(),
+    );
+    assert_eq!(expr.dependency(), ExpressionDependency::NodeLocal);
+}
+
+#[test]
+fn selecting_successor_is_select_dependent() {
+    let expr = BinaryOperator(
+        Select(LimitedSelector::default().into()).into(),
+        BinaryOp::And,
+        Select(TestGraph::numeric_node_selector().into()).into(),
+    );
+    assert_eq!(expr.dependency(), ExpressionDependency::SelectDependent);
+}
+
+#[test]
+fn variables_are_variable_dependent() {
+    let expr = BinaryOperator(
+        Variable("x".to_owned()).into(),
+        BinaryOp::Plus,
+        Select(TestGraph::numeric_node_selector().into()).into(),
+    );
+    assert_eq!(expr.dependency(), ExpressionDependency::VariableDependent);
+    let expr = MagicVariable(MagicVariableKey::EdgeIndex);
+    assert_eq!(expr.dependency(), ExpressionDependency::VariableDependent);
+}
+
+#[test]
+fn constant_subexpressions_are_folded() {
+    let mut expr = BinaryOperator(
+        BinaryOperator(Int(2).into(), BinaryOp::Minus, Int(5).into()).into(),
+        BinaryOp::Mul,
+        Variable("x".to_owned()).into(),
+    );
+    expr.fold_constants();
+    let expected = BinaryOperator(
+        UnaryOperator(UnaryOp::Minus, Int(3).into()).into(),
+        BinaryOp::Mul,
+        Variable("x".to_owned()).into(),
+    );
+    assert_eq!(expr, expected);
+}
+
+#[test]
+fn conditional_with_constant_condition_is_folded() {
+    let mut expr = Conditional(
+        BinaryOperator(Int(1).into(), BinaryOp::Lt, Int(2).into()).into(),
+        Variable("x".to_owned()).into(),
+        Variable("y".to_owned()).into(),
+    );
+    expr.fold_constants();
+    assert_eq!(expr, Variable("x".to_owned()));
+}
+
+#[test]
+fn folding_preserves_value() {
+    let expressions = [
+        UnaryOperator(UnaryOp::Minus, Int(i64::MAX as u64).into()),
+        BinaryOperator(
+            UnaryOperator(UnaryOp::Minus, Int(7).into()).into(),
+            BinaryOp::Plus,
+            Int(10).into(),
+        ),
+        BinaryOperator(String("a".to_owned()).into(), BinaryOp::Plus, Int(1).into()),
+        UnaryOperator(UnaryOp::IsSet, Unset.into()),
+    ];
+    for expr in expressions {
+        let mut folded = expr.clone();
+        folded.fold_constants();
+        assert_eq!(eval_on_default_graph(&folded), eval_on_default_graph(&expr));
+    }
+}
+
+#[test]
+fn compiled_node_local_expression_is_memoized() {
+    let graph = TestGraph::default_graph();
+    let cache = RefCell::new(EvaluationCache::new());
+    let mut expr = CompiledExpression::from(UnaryOperator(
+        UnaryOp::IsSet,
+        Select(LimitedSelector::default().into()).into(),
+    ));
+    assert_eq!(expr.dependency, ExpressionDependency::NodeLocal);
+    // Slots are normally assigned when a stylesheet is compiled
+    expr.slot = Some(0);
+    let context = EvaluationContext::from_graph(&graph, graph.root()).with_cache(&cache);
+    let value = evaluate_compiled(&expr, &context);
+    assert_eq!(value, evaluate(&expr, &context));
+    assert_eq!(cache.borrow().len(), 1);
+    assert_eq!(evaluate_compiled(&expr, &context), value);
+    assert_eq!(cache.borrow().len(), 1);
+}
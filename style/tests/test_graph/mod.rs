@@ -13,7 +13,7 @@ impl TestGraph {
         use EdgeLabel::*;
         Self(vec![
             // 0 - root and valueless node
-            TestNode([(Named("a".to_owned(), 0), 1)].into(), None),
+            TestNode([(Named("a".into(), 0), 1)].into(), None),
             // 1 - numeric node
             TestNode([].into(), Some(NodeValue::Uint(Self::NUMERIC_NODE_VALUE))),
         ])
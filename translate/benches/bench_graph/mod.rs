@@ -0,0 +1,255 @@
+//! Synthetic program state graphs for benchmarking.
+//!
+//! The graphs are shaped like graphs produced by a debugger:
+//! the root leads to a single stack frame, whose local variables
+//! hold the generated structures.
+
+use aili_model::state::*;
+
+/// Program state graph stored as a list of nodes.
+pub struct BenchGraph(Vec<BenchNode>);
+
+/// Node of [`BenchGraph`].
+pub struct BenchNode {
+    successors: Vec<(EdgeLabel, usize)>,
+    type_class: NodeTypeClass,
+    type_name: Option<&'static str>,
+    value: Option<NodeValue>,
+}
+
+impl BenchGraph {
+    /// Index of the only stack frame in all generated graphs.
+    const FRAME: usize = 1;
+
+    /// Constructs a graph with a root and an empty `main` stack frame.
+    fn with_frame() -> Self {
+        let mut graph = Self(Vec::new());
+        let root = graph.add(NodeTypeClass::Root, None, None);
+        let frame = graph.add(NodeTypeClass::Frame, Some("main"), None);
+        graph.connect(root, EdgeLabel::Main, frame);
+        graph
+    }
+
+    /// Singly linked list of `length` nodes, held by local variable `list`.
+    ///
+    /// Each node is a `node` structure with
+    /// an integer `value` and a pointer `next`.
+    pub fn list(length: usize) -> Self {
+        let mut graph = Self::with_frame();
+        let head = graph.add(NodeTypeClass::Ref, Some("node *"), None);
+        graph.connect(Self::FRAME, EdgeLabel::Named("list".into(), 0), head);
+        let mut pointer = head;
+        for i in 0..length {
+            let node = graph.add_list_node(i);
+            graph.connect(pointer, EdgeLabel::Deref, node);
+            pointer = graph.0[node].successors[1].1;
+        }
+        graph
+    }
+
+    /// Singly linked list of `length` nodes whose last node
+    /// points back to the first one.
+    pub fn cycle(length: usize) -> Self {
+        let mut graph = Self::list(length);
+        let first = graph.0[graph.0[Self::FRAME].successors[0].1].successors[0].1;
+        let last_pointer = graph.0.len() - 1;
+        graph.connect(last_pointer, EdgeLabel::Deref, first);
+        graph
+    }
+
+    /// Array of `length` integers, held by local variable `array`,
+    /// along with the `min`, `max`, `mid` and `find` locals
+    /// of a binary search over it, like in the binary search example.
+    pub fn array(length: usize) -> Self {
+        let mut graph = Self::with_frame();
+        let array = graph.add(NodeTypeClass::Array, Some("int[]"), None);
+        graph.connect(Self::FRAME, EdgeLabel::Named("array".into(), 0), array);
+        for i in 0..length {
+            let element = graph.add_atom(i);
+            graph.connect(array, EdgeLabel::Index(i), element);
+        }
+        let length_node = graph.add_atom(length);
+        graph.connect(array, EdgeLabel::Length, length_node);
+        for (name, value) in [
+            ("min", 0),
+            ("max", length),
+            ("mid", length / 2),
+            ("find", length / 2),
+        ] {
+            let local = graph.add_atom(value);
+            graph.connect(Self::FRAME, EdgeLabel::Named(name.into(), 0), local);
+        }
+        graph
+    }
+
+    /// Complete binary tree of `tree_node` structures with a given depth,
+    /// held by local variable `tree`.
+    ///
+    /// Each node has an integer `key` and pointers `left` and `right`,
+    /// like in the AVL tree example.
+    pub fn tree(depth: usize) -> Self {
+        let mut graph = Self::with_frame();
+        let root_pointer = graph.add(NodeTypeClass::Ref, Some("tree_node *"), None);
+        graph.connect(
+            Self::FRAME,
+            EdgeLabel::Named("tree".into(), 0),
+            root_pointer,
+        );
+        let mut level = vec![root_pointer];
+        for _ in 0..depth {
+            let mut next_level = Vec::new();
+            for pointer in level {
+                let node = graph.add_tree_node(graph.0.len());
+                graph.connect(pointer, EdgeLabel::Deref, node);
+                next_level.extend(graph.0[node].successors[1..].iter().map(|(_, p)| *p));
+            }
+            level = next_level;
+        }
+        graph
+    }
+
+    /// Array of `length` pointers held by local variable `pointers`,
+    /// where every `fan_in` consecutive pointers point to the same `node` structure.
+    ///
+    /// The shared structures form a linked list, so each of them
+    /// is also reachable from the previous one.
+    pub fn dag(length: usize, fan_in: usize) -> Self {
+        let mut graph = Self::with_frame();
+        let array = graph.add(NodeTypeClass::Array, Some("node *[]"), None);
+        graph.connect(Self::FRAME, EdgeLabel::Named("pointers".into(), 0), array);
+        let mut shared = Vec::new();
+        let mut previous_next = None;
+        for i in 0..length.div_ceil(fan_in.max(1)) {
+            let node = graph.add_list_node(i);
+            if let Some(previous_next) = previous_next {
+                graph.connect(previous_next, EdgeLabel::Deref, node);
+            }
+            previous_next = Some(graph.0[node].successors[1].1);
+            shared.push(node);
+        }
+        for i in 0..length {
+            let pointer = graph.add(NodeTypeClass::Ref, Some("node *"), None);
+            graph.connect(array, EdgeLabel::Index(i), pointer);
+            graph.connect(pointer, EdgeLabel::Deref, shared[i / fan_in.max(1)]);
+        }
+        graph
+    }
+
+    /// Number of nodes in the graph.
+    pub fn len(&self) -> usize {
+        self.0.len()
+    }
+
+    /// Changes the value of every atom whose index is divisible by `stride`.
+    ///
+    /// ## Return Value
+    /// Nodes that have been changed.
+    pub fn modify_values(&mut self, stride: usize) -> Vec<usize> {
+        let mut changed = Vec::new();
+        for (i, node) in self.0.iter_mut().enumerate() {
+            if let Some(NodeValue::Uint(value)) = &mut node.value
+                && i % stride == 0
+            {
+                *value += 1;
+                changed.push(i);
+            }
+        }
+        changed
+    }
+
+    fn add(
+        &mut self,
+        type_class: NodeTypeClass,
+        type_name: Option<&'static str>,
+        value: Option<NodeValue>,
+    ) -> usize {
+        self.0.push(BenchNode {
+            successors: Vec::new(),
+            type_class,
+            type_name,
+            value,
+        });
+        self.0.len() - 1
+    }
+
+    fn add_atom(&mut self, value: usize) -> usize {
+        self.add(
+            NodeTypeClass::Atom,
+            Some("int"),
+            Some((value as u64).into()),
+        )
+    }
+
+    /// Adds a `node` structure with a value and a dangling `next` pointer.
+    fn add_list_node(&mut self, value: usize) -> usize {
+        let node = self.add(NodeTypeClass::Struct, Some("node"), None);
+        let value = self.add_atom(value);
+        let next = self.add(NodeTypeClass::Ref, Some("node *"), None);
+        self.connect(node, EdgeLabel::Named("value".into(), 0), value);
+        self.connect(node, EdgeLabel::Named("next".into(), 0), next);
+        node
+    }
+
+    /// Adds a `tree_node` structure with a key and dangling `left` and `right` pointers.
+    fn add_tree_node(&mut self, key: usize) -> usize {
+        let node = self.add(NodeTypeClass::Struct, Some("tree_node"), None);
+        let key = self.add_atom(key);
+        let left = self.add(NodeTypeClass::Ref, Some("tree_node *"), None);
+        let right = self.add(NodeTypeClass::Ref, Some("tree_node *"), None);
+        self.connect(node, EdgeLabel::Named("key".into(), 0), key);
+        self.connect(node, EdgeLabel::Named("left".into(), 0), left);
+        self.connect(node, EdgeLabel::Named("right".into(), 0), right);
+        node
+    }
+
+    fn connect(&mut self, from: usize, edge: EdgeLabel, to: usize) {
+        self.0[from].successors.push((edge, to));
+    }
+}
+
+impl ProgramStateGraph for BenchGraph {
+    type NodeId = usize;
+    type NodeRef<'a> = &'a BenchNode;
+    fn get(&self, id: &Self::NodeId) -> Option<Self::NodeRef<'_>> {
+        self.0.get(*id)
+    }
+}
+
+impl RootedProgramStateGraph for BenchGraph {
+    fn root(&self) -> Self::NodeId {
+        0
+    }
+}
+
+impl ProgramStateNode for &BenchNode {
+    type NodeId = usize;
+    type NodeTypeId<'a>
+        = &'a str
+    where
+        Self: 'a;
+    fn get_successor(&self, edge: &EdgeLabel) -> Option<Self::NodeId> {
+        // Elements of arrays are stored in order
+        if let EdgeLabel::Index(index) = edge
+            && let Some((EdgeLabel::Index(i), successor)) = self.successors.get(*index)
+            && i == index
+        {
+            return Some(*successor);
+        }
+        self.successors
+            .iter()
+            .find(|(label, _)| label == edge)
+            .map(|(_, successor)| *successor)
+    }
+    fn successors(&self) -> impl Iterator<Item = (&EdgeLabel, Self::NodeId)> {
+        self.successors.iter().map(|(label, id)| (label, *id))
+    }
+    fn node_type_class(&self) -> NodeTypeClass {
+        self.type_class
+    }
+    fn node_type_id(&self) -> Option<Self::NodeTypeId<'_>> {
+        self.type_name
+    }
+    fn value(&self) -> Option<NodeValue> {
+        self.value
+    }
+}
@@ -0,0 +1,189 @@
+//! Benchmarks of the stages of the translation pipeline.
+//!
+//! - `cascade` only resolves selectors over the whole graph.
+//! - `apply` evaluates the whole stylesheet and builds the property mapping,
+//!   so the difference between it and `cascade` is the cost
+//!   of evaluating properties and building the mapping.
+//! - `incremental` re-applies the stylesheet after a few values have changed.
+//! - `forward` renders a property mapping into an empty visualization tree.
+//! - `forward-update` updates a visualization tree with the mapping
+//!   it already reflects.
+//!
+//! Each stage is measured with the stylesheets of the debugger examples
+//! whose structures the benchmark graphs imitate, and with a stylesheet
+//! that renders every node of the graph.
+
+mod bench_graph;
+#[allow(
+    dead_code,
+    reason = "Only the tree itself is needed, not the test utilities"
+)]
+#[path = "../tests/test_vis/mod.rs"]
+mod test_vis;
+
+use aili_bench::Harness;
+use aili_model::state::{EdgeLabel, ProgramStateGraph, ProgramStateNode, RootedProgramStateGraph};
+use aili_parser::parse_stylesheet;
+use aili_style::{
+    cascade::{CascadeStyle, SelectorResolver},
+    eval::context::EvaluationContext,
+};
+use aili_translate::{
+    cascade::{ApplyStylesheetCache, apply_stylesheet, apply_stylesheet_incremental},
+    forward::VisTreeWriter,
+    property::PropertyKey,
+};
+use bench_graph::BenchGraph;
+use std::collections::HashSet;
+use test_vis::TestVisTree;
+
+/// Benchmark graph along with its name.
+type NamedGraph = (&'static str, fn() -> BenchGraph);
+
+/// Stylesheets of the debugger examples
+/// whose structures the benchmark graphs imitate.
+const EXAMPLES: &[(&str, &str)] = &[
+    (
+        "list",
+        include_str!("../../debugger/examples/list/style.txt"),
+    ),
+    ("avl", include_str!("../../debugger/examples/avl/style.txt")),
+    (
+        "binsearch",
+        include_str!("../../debugger/examples/binsearch/style.txt"),
+    ),
+];
+
+fn main() {
+    let harness = Harness::from_env();
+    let graphs: [NamedGraph; 5] = [
+        ("list", || BenchGraph::list(2000)),
+        ("cycle", || BenchGraph::cycle(2000)),
+        ("array", || BenchGraph::array(10000)),
+        ("tree", || BenchGraph::tree(11)),
+        ("dag", || BenchGraph::dag(4000, 8)),
+    ];
+    let stylesheets = EXAMPLES
+        .iter()
+        .chain([&("everything", EVERYTHING_STYLESHEET)])
+        .map(|(name, source)| {
+            let stylesheet =
+                parse_stylesheet(source, |_| {}).expect("Benchmark stylesheets should parse");
+            (name, CascadeStyle::from(stylesheet.map_key()))
+        })
+        .collect::<Vec<_>>();
+    for (style_name, stylesheet) in &stylesheets {
+        for (graph_name, make_graph) in &graphs {
+            bench_stages(
+                &harness,
+                &format!("{style_name}/{graph_name}"),
+                stylesheet,
+                make_graph,
+            );
+        }
+    }
+}
+
+/// Runs benchmarks of all stages of the pipeline over one graph.
+fn bench_stages(
+    harness: &Harness,
+    name: &str,
+    stylesheet: &CascadeStyle<PropertyKey>,
+    make_graph: impl Fn() -> BenchGraph,
+) {
+    let graph = make_graph();
+    let nodes = graph.len();
+    harness.bench(
+        &format!("cascade/{name}"),
+        nodes,
+        "nodes",
+        || (),
+        |()| {
+            let mut resolver = SelectorResolver::new(stylesheet.selector_machine());
+            resolve_from(&mut resolver, &graph, graph.root(), None)
+        },
+    );
+    harness.bench(
+        &format!("apply/{name}"),
+        nodes,
+        "nodes",
+        || (),
+        |()| apply_stylesheet(stylesheet, &graph),
+    );
+    harness.bench(
+        &format!("incremental/{name}"),
+        nodes,
+        "nodes",
+        || {
+            let mut graph = make_graph();
+            let mut cache = ApplyStylesheetCache::new();
+            apply_stylesheet_incremental(stylesheet, &graph, &mut cache, &HashSet::new());
+            let changed = HashSet::from_iter(graph.modify_values(97));
+            (graph, cache, changed)
+        },
+        |(graph, mut cache, changed)| {
+            apply_stylesheet_incremental(stylesheet, &graph, &mut cache, &changed)
+        },
+    );
+    let mapping = apply_stylesheet(stylesheet, &graph);
+    let entities = mapping.0.len();
+    harness.bench(
+        &format!("forward/{name}"),
+        entities,
+        "entities",
+        || (VisTreeWriter::new(TestVisTree::default()), mapping.clone()),
+        |(mut writer, mapping)| {
+            writer.update(mapping);
+            writer
+        },
+    );
+    harness.bench(
+        &format!("forward-update/{name}"),
+        entities,
+        "entities",
+        || {
+            let mut writer = VisTreeWriter::new(TestVisTree::default());
+            writer.update(mapping.clone());
+            (writer, mapping.clone())
+        },
+        |(mut writer, mapping)| {
+            writer.update(mapping);
+            writer
+        },
+    );
+}
+
+/// Resolves selectors over the graph the same way a stylesheet
+/// application does, without evaluating any properties.
+///
+/// ## Return Value
+/// Number of matched rules.
+fn resolve_from(
+    resolver: &mut SelectorResolver<usize>,
+    graph: &BenchGraph,
+    node: usize,
+    previous_edge: Option<&EdgeLabel>,
+) -> usize {
+    let context =
+        EvaluationContext::from_graph(graph, node).with_optional_preceding_edge(previous_edge);
+    let mut matched = resolver.resolve_node(node, &context).len();
+    let Some(node) = graph.get(&node).filter(|_| resolver.has_edges_to_resolve()) else {
+        return matched;
+    };
+    for (edge_label, successor) in node.successors() {
+        resolver.push_edge(edge_label);
+        matched += resolve_from(resolver, graph, successor, Some(edge_label));
+        resolver.pop_edge();
+    }
+    matched
+}
+
+/// Stylesheet that renders every node.
+const EVERYTHING_STYLESHEET: &str = "
+.many(*) {
+  display: cell;
+  value: @;
+  parent: --parent;
+  --parent: @;
+}
+";
@@ -1,29 +1,110 @@
 //! Evaluation of an entire stylesheet.
 
-use super::mapping_builder::PropertyMappingBuilder;
+#[cfg(feature = "parallel")]
+mod parallel;
+
+use super::{
+    cache::{ApplyStylesheetCache, MappingOperation, TrackedGraph, VisitEntry, VisitRecord},
+    mapping_builder::PropertyMappingBuilder,
+};
 use crate::property::{EntityPropertyMapping, PropertyKey};
-use aili_model::state::{EdgeLabel, ProgramStateNode, RootedProgramStateGraph};
+use aili_model::state::{EdgeLabel, NodeId, ProgramStateNode, RootedProgramStateGraph};
 use aili_style::{
-    cascade::{CascadeStyle, SelectionCaret, SelectorResolver},
-    eval::{context::EvaluationContext, evaluate, variable_pool::VariablePool},
+    cascade::{CascadeStyle, ResolverStatistics, SelectionCaret, SelectorResolver},
+    eval::{
+        cache::EvaluationCache, context::EvaluationContext, evaluate_compiled,
+        variable_pool::VariablePool,
+    },
     selectable::Selectable,
     stylesheet::StyleKey,
 };
+use std::{
+    cell::RefCell,
+    collections::{HashMap, HashSet},
+    ops::Range,
+};
+
+#[cfg(feature = "parallel")]
+pub use parallel::{ParallelOptions, apply_stylesheet_parallel};
 
 /// Applies a stylesheet to a graph.
 pub fn apply_stylesheet<T: RootedProgramStateGraph>(
     stylesheet: &CascadeStyle<PropertyKey>,
     graph: &T,
 ) -> EntityPropertyMapping<T::NodeId> {
-    let mut helper = ApplyStylesheet::new(stylesheet, graph);
+    let mut helper = ApplyStylesheet::new(stylesheet, graph, None);
     helper.run();
     helper.result()
 }
 
+/// Applies a stylesheet to a graph and reports
+/// how much work the application has done.
+///
+/// The result is the same as that of [`apply_stylesheet`].
+pub fn apply_stylesheet_with_statistics<T: RootedProgramStateGraph>(
+    stylesheet: &CascadeStyle<PropertyKey>,
+    graph: &T,
+) -> (EntityPropertyMapping<T::NodeId>, ApplyStatistics) {
+    let mut helper = ApplyStylesheet::new(stylesheet, graph, None);
+    helper.run();
+    let statistics = helper.statistics();
+    (helper.result(), statistics)
+}
+
+/// Applies a stylesheet to a graph, reusing the results
+/// of a previous application for parts of the graph
+/// that have not changed since.
+///
+/// The result is the same as that of [`apply_stylesheet`],
+/// but only subtrees of the traversal that access a changed node
+/// are evaluated again. Results for the remaining subtrees
+/// are replayed from the cache.
+///
+/// ## Parameters
+/// - `cache` - Results of the previous application, which are replaced
+///   with the results of this one. It must be empty or have been populated
+///   by an application of the same stylesheet.
+/// - `changed_nodes` - All nodes that have been added, removed or modified
+///   since the previous application. A superset is permitted.
+pub fn apply_stylesheet_incremental<T: RootedProgramStateGraph>(
+    stylesheet: &CascadeStyle<PropertyKey>,
+    graph: &T,
+    cache: &mut ApplyStylesheetCache<T::NodeId>,
+    changed_nodes: &HashSet<T::NodeId>,
+) -> EntityPropertyMapping<T::NodeId> {
+    let previous = std::mem::take(cache);
+    let incremental = IncrementalState::new(previous, changed_nodes);
+    let mut helper = ApplyStylesheet::new(stylesheet, graph, Some(incremental));
+    helper.run();
+    let (mapping, new_cache) = helper.result_with_cache();
+    *cache = new_cache;
+    mapping
+}
+
+/// Counters of the work done by a stylesheet application.
+///
+/// Statistics of [incremental](apply_stylesheet_incremental) applications
+/// are available from [`ApplyStylesheetCache::statistics`].
+#[derive(Clone, Copy, PartialEq, Eq, Default, Debug)]
+pub struct ApplyStatistics {
+    /// Number of node visits in which the stylesheet has been evaluated.
+    pub nodes_visited: usize,
+
+    /// Number of node visits whose results have been
+    /// replayed from the cache of an incremental application.
+    pub visits_replayed: usize,
+
+    /// Number of property and variable values that have been evaluated.
+    pub expressions_evaluated: usize,
+
+    /// Counters of the selector resolution.
+    pub selectors: ResolverStatistics,
+}
+
 /// Helper for stylesheet applications.
 struct ApplyStylesheet<'a, 'g, T: RootedProgramStateGraph> {
     /// The graph being traversed.
-    graph: &'g T,
+    graph: TrackedGraph<'g, T>,
 
     /// The stylesheet being evaluated.
     stylesheet: &'a CascadeStyle<PropertyKey>,
@@ -36,48 +117,147 @@ struct ApplyStylesheet<'a, 'g, T: RootedProgramStateGraph> {
 
     /// Variables that are active at the moment
     variable_pool: VariablePool<&'a str, T::NodeId>,
+
+    /// Memoized values of node-local expressions.
+    ///
+    /// The graph does not change during the application,
+    /// so the values stay valid until it ends.
+    expression_cache: RefCell<EvaluationCache<T::NodeId>>,
+
+    /// Counters of the work done by the application,
+    /// save for the selector resolution, which the resolver counts itself.
+    statistics: ApplyStatistics,
+
+    /// Cached and newly recorded results,
+    /// if this is an incremental application.
+    incremental: Option<IncrementalState<T::NodeId>>,
+
+    /// Operations on the mapping, if they are being recorded
+    /// instead of being applied to [`ApplyStylesheet::mapping`].
+    ///
+    /// Subtrees that are traversed on other threads record their operations,
+    /// so they can be replayed in order once all of them have finished.
+    recorded_operations: Option<Vec<MappingOperation<T::NodeId>>>,
+
+    /// Pool of threads that can traverse successors of a node concurrently,
+    /// if this is a parallel application.
+    #[cfg(feature = "parallel")]
+    fork: Option<&'a dyn parallel::ForkTraversal<'a, T>>,
 }
 
 impl<'a, 'g, T: RootedProgramStateGraph> ApplyStylesheet<'a, 'g, T> {
-    fn new(stylesheet: &'a CascadeStyle<PropertyKey>, graph: &'g T) -> Self {
+    fn new(
+        stylesheet: &'a CascadeStyle<PropertyKey>,
+        graph: &'g T,
+        incremental: Option<IncrementalState<T::NodeId>>,
+    ) -> Self {
+        let resolver = SelectorResolver::new(stylesheet.selector_machine());
+        // Incremental applications need to know what was read
+        // and checked, so it can be reused later
+        let (graph, resolver) = if incremental.is_some() {
+            (
+                TrackedGraph::tracked(graph),
+                resolver.with_sequence_point_log(),
+            )
+        } else {
+            (TrackedGraph::untracked(graph), resolver)
+        };
         Self {
             graph,
             stylesheet,
-            resolver: SelectorResolver::new(stylesheet.selector_machine()),
+            resolver,
             mapping: PropertyMappingBuilder::new(),
             variable_pool: VariablePool::new(),
+            expression_cache: RefCell::default(),
+            statistics: ApplyStatistics::default(),
+            incremental,
+            recorded_operations: None,
+            #[cfg(feature = "parallel")]
+            fork: None,
+        }
+    }
+
+    fn statistics(&self) -> ApplyStatistics {
+        ApplyStatistics {
+            selectors: self.resolver.statistics(),
+            ..self.statistics
         }
     }
 
     fn result(self) -> EntityPropertyMapping<T::NodeId> {
-        self.mapping.build(self.graph)
+        self.mapping.build(self.graph.graph)
+    }
+
+    fn result_with_cache(
+        mut self,
+    ) -> (
+        EntityPropertyMapping<T::NodeId>,
+        ApplyStylesheetCache<T::NodeId>,
+    ) {
+        let statistics = self.statistics();
+        let cache = self
+            .incremental
+            .take()
+            .map(|incremental| ApplyStylesheetCache {
+                visits: incremental.visits,
+                reads: self.graph.take_reads(),
+                operations: incremental.operations,
+                sequence_points: self.resolver.take_sequence_point_log(),
+                statistics,
+            })
+            .unwrap_or_default();
+        (self.result(), cache)
     }
 
     fn run(&mut self) {
-        self.run_from(self.graph.root(), None, None);
+        let root = self.graph.graph.root();
+        let cached_root = self
+            .incremental
+            .as_ref()
+            .and_then(|incremental| incremental.previous.visits.first())
+            .filter(|visit| visit.node == root)
+            .map(|_| 0);
+        self.run_from(root, None, None, cached_root);
     }
 
     /// Traverses depth-first from a specified node and evaluates the selector.
+    ///
+    /// If `cached_visit` is provided, it is the index of a cached visit
+    /// of the same node along the same edge with the same variables in scope.
     fn run_from(
         &mut self,
         node: T::NodeId,
         previous_node: Option<T::NodeId>,
         previous_edge: Option<&EdgeLabel>,
+        cached_visit: Option<usize>,
     ) {
+        if let Some(cached_visit) = cached_visit
+            && self.try_replay_visit(cached_visit)
+        {
+            return;
+        }
+
+        let visit = self.begin_visit(&node, previous_edge);
+        self.statistics.nodes_visited += 1;
+
         let matched_rules = self.resolve_node(node.clone(), previous_edge);
 
-        self.mapping.push();
+        self.push_mapping();
 
         self.resolve_matched_rules(&node, previous_node, previous_edge, matched_rules);
 
+        let cached_successors = self.record_visit_variables(visit, cached_visit);
+
         // This is our termination condition:
         // We stop once there is nothing else to explore
         if self.resolver.has_edges_to_resolve() {
             // Traverse down the tree through all edges
-            self.traverse_outgoing_edges(node);
+            self.traverse_outgoing_edges(node, cached_successors);
         }
 
-        self.mapping.pop();
+        self.pop_mapping();
+
+        self.end_visit(visit);
     }
 
     fn resolve_matched_rules(
@@ -120,30 +300,116 @@ impl<'a, 'g, T: RootedProgramStateGraph> ApplyStylesheet<'a, 'g, T> {
         node: T::NodeId,
         previous_edge: Option<&EdgeLabel>,
     ) -> Vec<(usize, SelectionCaret)> {
-        let context = EvaluationContext::from_graph(self.graph, node.clone())
+        let context = EvaluationContext::from_graph(&self.graph, node.clone())
             .with_variables(&self.variable_pool)
-            .with_optional_preceding_edge(previous_edge);
+            .with_optional_preceding_edge(previous_edge)
+            .with_cache(&self.expression_cache);
         self.resolver.resolve_node(node, &context)
     }
 
     /// Traverses depth-first through all outgoing edges of a node.
-    fn traverse_outgoing_edges(&mut self, starting_node: T::NodeId) {
-        let Some(node) = self.graph.get(&starting_node) else {
+    ///
+    /// `cached_successors` maps outgoing edges to cached visits
+    /// of their target nodes that are eligible for reuse.
+    fn traverse_outgoing_edges(
+        &mut self,
+        starting_node: T::NodeId,
+        cached_successors: HashMap<EdgeLabel, usize>,
+    ) {
+        let Some(node) = self.graph.get_detached(&starting_node) else {
             return;
         };
-        for (edge_label, successor_node) in node.successors() {
-            // Push a state so we can pop it later
-            self.variable_pool.push();
-            self.resolver.push_edge(edge_label);
-            // Resolve the following edge and node
-            self.run_from(
-                successor_node,
-                Some(starting_node.clone()),
-                Some(edge_label),
+        #[cfg(feature = "parallel")]
+        if let Some(fork) = self.fork {
+            let successors = Vec::from_iter(node.successors());
+            let forked = fork.traverse_forked(
+                &starting_node,
+                &successors,
+                &mut self.resolver,
+                &self.variable_pool,
             );
-            // Discard all variables that were created here
-            self.resolver.pop_edge();
-            self.variable_pool.pop();
+            if let Some(forked) = forked {
+                for subtrees in forked {
+                    self.merge_forked(&starting_node, &successors, subtrees);
+                }
+            } else {
+                for (edge_label, successor_node) in successors {
+                    self.visit_successor(&starting_node, edge_label, successor_node, None);
+                }
+            }
+            return;
+        }
+        for (edge_label, successor_node) in node.successors() {
+            let cached_visit = cached_successors.get(edge_label).copied().filter(|&i| {
+                self.incremental.as_ref().is_some_and(|incremental| {
+                    incremental.previous.visits[i].node == successor_node
+                })
+            });
+            self.visit_successor(&starting_node, edge_label, successor_node, cached_visit);
+        }
+    }
+
+    /// Traverses depth-first through one outgoing edge of a node.
+    fn visit_successor(
+        &mut self,
+        starting_node: &T::NodeId,
+        edge_label: &EdgeLabel,
+        successor_node: T::NodeId,
+        cached_visit: Option<usize>,
+    ) {
+        // Push a state so we can pop it later
+        self.variable_pool.push();
+        self.resolver.push_edge(edge_label);
+        // Resolve the following edge and node
+        self.run_from(
+            successor_node,
+            Some(starting_node.clone()),
+            Some(edge_label),
+            cached_visit,
+        );
+        // Discard all variables that were created here
+        self.resolver.pop_edge();
+        self.variable_pool.pop();
+    }
+
+    /// Applies the results of successors of a node that have been
+    /// traversed on another thread, as if they were traversed now.
+    ///
+    /// If the other thread's view of matched sequence points has diverged
+    /// from this one, the successors are traversed again instead,
+    /// so the result is always the same as that of a sequential traversal.
+    #[cfg(feature = "parallel")]
+    fn merge_forked(
+        &mut self,
+        starting_node: &T::NodeId,
+        successors: &[(&EdgeLabel, T::NodeId)],
+        subtrees: parallel::ForkedSubtrees<T::NodeId>,
+    ) {
+        if self
+            .resolver
+            .can_replay_sequence_points(&subtrees.sequence_points)
+        {
+            self.resolver
+                .replay_sequence_points(&subtrees.sequence_points);
+            for operation in subtrees.operations {
+                self.apply_operation(operation);
+            }
+        } else {
+            // A previous subtree has matched some of the same nodes,
+            // which the other thread could not have known
+            for (edge_label, successor_node) in &successors[subtrees.successors] {
+                self.visit_successor(starting_node, edge_label, successor_node.clone(), None);
+            }
+        }
+    }
+
+    /// Applies an operation to the mapping,
+    /// or records it if recording is enabled.
+    fn apply_operation(&mut self, operation: MappingOperation<T::NodeId>) {
+        if let Some(recorded) = &mut self.recorded_operations {
+            recorded.push(operation);
+        } else {
+            operation.replay(&mut self.mapping);
         }
     }
 
@@ -155,8 +421,25 @@ impl<'a, 'g, T: RootedProgramStateGraph> ApplyStylesheet<'a, 'g, T> {
         previous_edge: Option<&EdgeLabel>,
     ) {
         // Adjust the mapping to the new entity
-        self.mapping
-            .selected_entity(target, select_origin, rule_index);
+        if let Some(incremental) = &mut self.incremental {
+            incremental
+                .operations
+                .push(MappingOperation::SelectedEntity {
+                    target: target.clone(),
+                    select_origin: select_origin.clone(),
+                    static_precedence: rule_index,
+                });
+        }
+        if let Some(recorded) = &mut self.recorded_operations {
+            recorded.push(MappingOperation::SelectedEntity {
+                target: target.clone(),
+                select_origin: select_origin.clone(),
+                static_precedence: rule_index,
+            });
+        } else {
+            self.mapping
+                .selected_entity(target, select_origin, rule_index);
+        }
         // Extra entities get their own variable scope
         // so they cannot affect anything outside
         if target.is_extra() {
@@ -164,13 +447,32 @@ impl<'a, 'g, T: RootedProgramStateGraph> ApplyStylesheet<'a, 'g, T> {
         }
         let properties = &self.stylesheet.rule_at(rule_index).properties;
         for property in properties {
-            let context = EvaluationContext::from_graph(self.graph, select_origin.clone())
+            let context = EvaluationContext::from_graph(&self.graph, select_origin.clone())
                 .with_variables(&self.variable_pool)
-                .with_optional_preceding_edge(previous_edge);
-            let value = evaluate(&property.value, &context);
+                .with_optional_preceding_edge(previous_edge)
+                .with_cache(&self.expression_cache);
+            let value = evaluate_compiled(&property.value, &context);
+            self.statistics.expressions_evaluated += 1;
             match &property.key {
                 StyleKey::Property(key) => {
-                    self.mapping.assign(target, key, value, rule_index);
+                    if let Some(incremental) = &mut self.incremental {
+                        incremental.operations.push(MappingOperation::Assign {
+                            target: target.clone(),
+                            key: key.clone(),
+                            value: value.clone(),
+                            static_precedence: rule_index,
+                        });
+                    }
+                    if let Some(recorded) = &mut self.recorded_operations {
+                        recorded.push(MappingOperation::Assign {
+                            target: target.clone(),
+                            key: key.clone(),
+                            value,
+                            static_precedence: rule_index,
+                        });
+                    } else {
+                        self.mapping.assign(target, key, value, rule_index);
+                    }
                 }
                 StyleKey::Variable(name) => {
                     self.variable_pool.insert(name, value);
@@ -181,4 +483,217 @@ impl<'a, 'g, T: RootedProgramStateGraph> ApplyStylesheet<'a, 'g, T> {
             self.variable_pool.pop();
         }
     }
+
+    fn push_mapping(&mut self) {
+        if let Some(incremental) = &mut self.incremental {
+            incremental.operations.push(MappingOperation::Push);
+        }
+        self.apply_operation(MappingOperation::Push);
+    }
+
+    fn pop_mapping(&mut self) {
+        if let Some(incremental) = &mut self.incremental {
+            incremental.operations.push(MappingOperation::Pop);
+        }
+        self.apply_operation(MappingOperation::Pop);
+    }
+
+    /// Starts recording a visit of a node, if this is an incremental application.
+    ///
+    /// ## Return Value
+    /// Index of the new visit record, if one has been created.
+    fn begin_visit(
+        &mut self,
+        node: &T::NodeId,
+        previous_edge: Option<&EdgeLabel>,
+    ) -> Option<usize> {
+        let incremental = self.incremental.as_mut()?;
+        let index = incremental.visits.len();
+        let reads_start = self.graph.read_count();
+        let operations_start = incremental.operations.len();
+        let sequence_points_start = self.resolver.sequence_point_log().len();
+        incremental.visits.push(VisitRecord {
+            node: node.clone(),
+            edge: previous_edge.cloned(),
+            entry: VisitEntry {
+                resolver: self.resolver.checkpoint(),
+                auto_parent: self.mapping.auto_parent().cloned(),
+            },
+            variables: Vec::new(),
+            end: index,
+            reads: reads_start..reads_start,
+            operations: operations_start..operations_start,
+            sequence_points: sequence_points_start..sequence_points_start,
+        });
+        Some(index)
+    }
+
+    /// Saves the variables assigned at a visited node before its successors are visited.
+    ///
+    /// ## Return Value
+    /// Cached visits of successors of the node that are eligible for reuse, by edge label.
+    /// They are eligible if the cached visit of the node has seen the same variables.
+    fn record_visit_variables(
+        &mut self,
+        visit: Option<usize>,
+        cached_visit: Option<usize>,
+    ) -> HashMap<EdgeLabel, usize> {
+        let (Some(incremental), Some(visit)) = (&mut self.incremental, visit) else {
+            return HashMap::new();
+        };
+        let mut variables = self
+            .variable_pool
+            .current_frame()
+            .map(|(name, value)| ((*name).to_owned(), value.clone()))
+            .collect::<Vec<_>>();
+        variables.sort_by(|(a, _), (b, _)| a.cmp(b));
+        let cached_successors = cached_visit
+            .filter(|&i| incremental.previous.visits[i].variables == variables)
+            .map(|i| incremental.previous.successors_of(i))
+            .unwrap_or_default();
+        incremental.visits[visit].variables = variables;
+        cached_successors
+    }
+
+    /// Finishes recording a visit of a node and its successors.
+    fn end_visit(&mut self, visit: Option<usize>) {
+        let (Some(incremental), Some(visit)) = (&mut self.incremental, visit) else {
+            return;
+        };
+        let end = incremental.visits.len();
+        let reads_end = self.graph.read_count();
+        let operations_end = incremental.operations.len();
+        let sequence_points_end = self.resolver.sequence_point_log().len();
+        let record = &mut incremental.visits[visit];
+        record.end = end;
+        record.reads.end = reads_end;
+        record.operations.end = operations_end;
+        record.sequence_points.end = sequence_points_end;
+    }
+
+    /// Replays a cached visit if it is still valid.
+    ///
+    /// ## Return Value
+    /// True if the visit has been replayed, false if it must be evaluated again.
+    fn try_replay_visit(&mut self, cached_visit: usize) -> bool {
+        let Some(incremental) = &mut self.incremental else {
+            return false;
+        };
+        let previous = &incremental.previous;
+        let record = &previous.visits[cached_visit];
+        // The visit must not have accessed anything that has changed
+        if incremental.is_dirty(&record.reads) {
+            return false;
+        }
+        // The visit must have started from the same state
+        if record.entry.resolver != self.resolver.checkpoint()
+            || record.entry.auto_parent.as_ref() != self.mapping.auto_parent()
+        {
+            return false;
+        }
+        let sequence_points = &previous.sequence_points[record.sequence_points.clone()];
+        if !self.resolver.can_replay_sequence_points(sequence_points) {
+            return false;
+        }
+        // Replay effects of the subtree
+        self.statistics.visits_replayed += record.end - cached_visit;
+        let reads_start = self.graph.read_count();
+        let operations_start = incremental.operations.len();
+        let sequence_points_start = self.resolver.sequence_point_log().len();
+        let visits_start = incremental.visits.len();
+        self.resolver.replay_sequence_points(sequence_points);
+        self.graph
+            .extend_reads(&previous.reads[record.reads.clone()]);
+        for operation in &previous.operations[record.operations.clone()] {
+            operation.replay(&mut self.mapping);
+        }
+        // Carry the records over to the new cache
+        incremental
+            .operations
+            .extend_from_slice(&previous.operations[record.operations.clone()]);
+        for cached in &previous.visits[cached_visit..record.end] {
+            incremental.visits.push(VisitRecord {
+                node: cached.node.clone(),
+                edge: cached.edge.clone(),
+                entry: cached.entry.clone(),
+                variables: cached.variables.clone(),
+                end: cached.end - cached_visit + visits_start,
+                reads: rebase(&cached.reads, record.reads.start, reads_start),
+                operations: rebase(
+                    &cached.operations,
+                    record.operations.start,
+                    operations_start,
+                ),
+                sequence_points: rebase(
+                    &cached.sequence_points,
+                    record.sequence_points.start,
+                    sequence_points_start,
+                ),
+            });
+        }
+        true
+    }
+}
+
+/// Cached and newly recorded results of an incremental application.
+struct IncrementalState<T: NodeId> {
+    /// Results of the previous application.
+    previous: ApplyStylesheetCache<T>,
+
+    /// Number of changed nodes in [`ApplyStylesheetCache::reads`]
+    /// of the previous application before each index.
+    changed_reads_before: Vec<usize>,
+
+    /// Visits recorded in this application.
+    visits: Vec<VisitRecord<T>>,
+
+    /// Mapping operations recorded in this application.
+    operations: Vec<MappingOperation<T>>,
+}
+
+impl<T: NodeId> IncrementalState<T> {
+    fn new(previous: ApplyStylesheetCache<T>, changed_nodes: &HashSet<T>) -> Self {
+        let mut changed_reads_before = Vec::with_capacity(previous.reads.len() + 1);
+        let mut count = 0;
+        changed_reads_before.push(count);
+        for read in &previous.reads {
+            if changed_nodes.contains(read) {
+                count += 1;
+            }
+            changed_reads_before.push(count);
+        }
+        Self {
+            previous,
+            changed_reads_before,
+            visits: Vec::new(),
+            operations: Vec::new(),
+        }
+    }
+
+    /// Checks whether a range of the previous reads
+    /// contains a node that has changed.
+    fn is_dirty(&self, reads: &Range<usize>) -> bool {
+        self.changed_reads_before[reads.start] != self.changed_reads_before[reads.end]
+    }
+}
+
+impl<T: NodeId> ApplyStylesheetCache<T> {
+    /// Lists the direct successors of a visit by the edges they were entered through.
+    fn successors_of(&self, visit: usize) -> HashMap<EdgeLabel, usize> {
+        let mut successors = HashMap::new();
+        let mut next = visit + 1;
+        while next < self.visits[visit].end {
+            let successor = &self.visits[next];
+            if let Some(edge) = &successor.edge {
+                successors.insert(edge.clone(), next);
+            }
+            next = successor.end;
+        }
+        successors
+    }
+}
+
+/// Moves a range that is relative to one position so it is relative to another.
+fn rebase(range: &Range<usize>, old_start: usize, new_start: usize) -> Range<usize> {
+    (range.start - old_start + new_start)..(range.end - old_start + new_start)
 }
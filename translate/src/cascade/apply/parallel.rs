@@ -0,0 +1,248 @@
+//! Parallel evaluation of an entire stylesheet on native targets.
+
+use super::ApplyStylesheet;
+use crate::{
+    cascade::{cache::MappingOperation, mapping_builder::PropertyMappingBuilder},
+    property::{EntityPropertyMapping, PropertyKey},
+};
+use aili_model::state::{EdgeLabel, NodeId, RootedProgramStateGraph};
+use aili_style::{
+    cascade::{CascadeStyle, DetachedResolver, SelectorResolver, SequencePointRecord},
+    eval::variable_pool::VariablePool,
+};
+use std::{
+    num::NonZeroUsize,
+    ops::Range,
+    sync::atomic::{AtomicUsize, Ordering},
+    thread,
+};
+
+/// Applies a stylesheet to a graph, traversing independent subtrees
+/// of the graph on multiple threads.
+///
+/// The result is the same as that of [`apply_stylesheet`](super::apply_stylesheet).
+/// Successors of nodes with many outgoing edges, such as stack frames
+/// or large arrays, are split into chunks that are traversed concurrently
+/// and then merged in their original order. A chunk that matched a node
+/// also matched by a preceding chunk is traversed again after the merge,
+/// so graphs where many paths lead to the same nodes may not benefit.
+///
+/// Threads are only spawned during the application, so this is not
+/// available on targets that do not support threads, such as WebAssembly.
+pub fn apply_stylesheet_parallel<T>(
+    stylesheet: &CascadeStyle<PropertyKey>,
+    graph: &T,
+    options: &ParallelOptions,
+) -> EntityPropertyMapping<T::NodeId>
+where
+    T: RootedProgramStateGraph + Sync,
+    T::NodeId: Send + Sync,
+{
+    let pool = ParallelApply {
+        stylesheet,
+        graph,
+        idle_threads: AtomicUsize::new(options.threads.get() - 1),
+        min_fan_out: options.min_fan_out.max(2),
+    };
+    let mut helper = ApplyStylesheet::new(stylesheet, graph, None);
+    helper.fork = Some(&pool);
+    helper.run();
+    helper.result()
+}
+
+/// Configuration of [`apply_stylesheet_parallel`].
+#[derive(Clone, Debug)]
+pub struct ParallelOptions {
+    /// Maximum number of threads that traverse the graph at once,
+    /// including the calling thread.
+    ///
+    /// Defaults to the available parallelism of the system.
+    pub threads: NonZeroUsize,
+
+    /// Minimum number of outgoing edges of a node
+    /// for its successors to be traversed concurrently.
+    ///
+    /// Smaller subtrees are not worth the cost of moving them to another thread.
+    pub min_fan_out: usize,
+}
+
+impl Default for ParallelOptions {
+    fn default() -> Self {
+        Self {
+            threads: thread::available_parallelism().unwrap_or(NonZeroUsize::MIN),
+            min_fan_out: Self::DEFAULT_MIN_FAN_OUT,
+        }
+    }
+}
+
+impl ParallelOptions {
+    /// Default value of [`ParallelOptions::min_fan_out`].
+    pub const DEFAULT_MIN_FAN_OUT: usize = 8;
+
+    /// Number of chunks the successors of a node are split into
+    /// for each participating thread, so threads that finish early
+    /// can pick up work from the others.
+    const CHUNKS_PER_THREAD: usize = 4;
+}
+
+/// Extension point of [`ApplyStylesheet`] that traverses
+/// successors of a node on other threads.
+pub(super) trait ForkTraversal<'a, T: RootedProgramStateGraph> {
+    /// Traverses successors of a node concurrently, if it is worth it
+    /// and there are threads available.
+    ///
+    /// ## Return Value
+    /// Results of the traversal in chunks, in the order of the successors,
+    /// or [`None`] if the successors should be traversed by the caller.
+    fn traverse_forked(
+        &self,
+        starting_node: &T::NodeId,
+        successors: &[(&EdgeLabel, T::NodeId)],
+        resolver: &mut SelectorResolver<'a, T::NodeId>,
+        variable_pool: &VariablePool<&'a str, T::NodeId>,
+    ) -> Option<Vec<ForkedSubtrees<T::NodeId>>>;
+}
+
+/// Results of traversing a chunk of successors of a node on another thread.
+pub(super) struct ForkedSubtrees<T: NodeId> {
+    /// Indices of the successors that have been traversed.
+    pub successors: Range<usize>,
+
+    /// Operations on the mapping made by the traversal, in order.
+    pub operations: Vec<MappingOperation<T>>,
+
+    /// Sequence point checks made by the traversal, in order.
+    pub sequence_points: Vec<SequencePointRecord<T>>,
+}
+
+/// Shared state of the threads of a parallel application.
+struct ParallelApply<'a, 'g, T: RootedProgramStateGraph> {
+    /// The stylesheet being evaluated.
+    stylesheet: &'a CascadeStyle<PropertyKey>,
+
+    /// The graph being traversed.
+    graph: &'g T,
+
+    /// Number of threads that can still be spawned.
+    idle_threads: AtomicUsize,
+
+    /// See [`ParallelOptions::min_fan_out`].
+    min_fan_out: usize,
+}
+
+impl<'a, 'g, T> ParallelApply<'a, 'g, T>
+where
+    T: RootedProgramStateGraph + Sync,
+    T::NodeId: Send + Sync,
+{
+    /// Reserves up to a specified number of idle threads.
+    ///
+    /// ## Return Value
+    /// Number of threads that have been reserved.
+    fn acquire_threads(&self, max_count: usize) -> usize {
+        self.idle_threads
+            .fetch_update(Ordering::Acquire, Ordering::Relaxed, |idle| {
+                (idle > 0).then(|| idle - idle.min(max_count))
+            })
+            .map_or(0, |idle| idle.min(max_count))
+    }
+
+    /// Returns threads reserved by [`ParallelApply::acquire_threads`].
+    fn release_threads(&self, count: usize) {
+        self.idle_threads.fetch_add(count, Ordering::Release);
+    }
+
+    /// Traverses chunks of successors of a node until there are none left.
+    fn run_worker<'s>(
+        &'s self,
+        starting_node: &T::NodeId,
+        successors: &[(&EdgeLabel, T::NodeId)],
+        resolver: &DetachedResolver<T::NodeId>,
+        variable_pool: &VariablePool<&'s str, T::NodeId>,
+        next_chunk: &AtomicUsize,
+        chunk_size: usize,
+    ) -> Vec<ForkedSubtrees<T::NodeId>> {
+        let mut worker = ApplyStylesheet {
+            graph: super::TrackedGraph::untracked(self.graph),
+            stylesheet: self.stylesheet,
+            resolver: resolver.attach(self.stylesheet.selector_machine()),
+            mapping: PropertyMappingBuilder::new(),
+            variable_pool: variable_pool.snapshot(),
+            expression_cache: Default::default(),
+            statistics: Default::default(),
+            incremental: None,
+            recorded_operations: Some(Vec::new()),
+            fork: Some(self),
+        };
+        let mut forked = Vec::new();
+        loop {
+            let start = next_chunk.fetch_add(chunk_size, Ordering::Relaxed);
+            if start >= successors.len() {
+                break;
+            }
+            let chunk = start..(start + chunk_size).min(successors.len());
+            for (edge_label, successor_node) in &successors[chunk.clone()] {
+                worker.visit_successor(starting_node, edge_label, successor_node.clone(), None);
+            }
+            // Matched sequence points are kept for the following chunks,
+            // they are merged after this one anyway
+            forked.push(ForkedSubtrees {
+                successors: chunk,
+                operations: worker.recorded_operations.replace(Vec::new()).unwrap(),
+                sequence_points: worker.resolver.take_sequence_point_log(),
+            });
+        }
+        forked
+    }
+}
+
+impl<'s, 'a: 's, 'g: 's, T> ForkTraversal<'s, T> for ParallelApply<'a, 'g, T>
+where
+    T: RootedProgramStateGraph + Sync,
+    T::NodeId: Send + Sync,
+{
+    fn traverse_forked(
+        &self,
+        starting_node: &T::NodeId,
+        successors: &[(&EdgeLabel, T::NodeId)],
+        resolver: &mut SelectorResolver<'s, T::NodeId>,
+        variable_pool: &VariablePool<&'s str, T::NodeId>,
+    ) -> Option<Vec<ForkedSubtrees<T::NodeId>>> {
+        if successors.len() < self.min_fan_out {
+            return None;
+        }
+        let spawned = self.acquire_threads(successors.len() - 1);
+        if spawned == 0 {
+            return None;
+        }
+        let chunk_count = (spawned + 1) * ParallelOptions::CHUNKS_PER_THREAD;
+        let chunk_size = successors.len().div_ceil(chunk_count);
+        let resolver = resolver.detach();
+        let next_chunk = AtomicUsize::new(0);
+        let run_worker = || {
+            self.run_worker(
+                starting_node,
+                successors,
+                &resolver,
+                variable_pool,
+                &next_chunk,
+                chunk_size,
+            )
+        };
+        let mut forked = thread::scope(|scope| {
+            let handles = Vec::from_iter((0..spawned).map(|_| scope.spawn(run_worker)));
+            // The calling thread takes part as well
+            let mut forked = run_worker();
+            for handle in handles {
+                match handle.join() {
+                    Ok(chunks) => forked.extend(chunks),
+                    Err(panic) => std::panic::resume_unwind(panic),
+                }
+            }
+            forked
+        });
+        self.release_threads(spawned);
+        forked.sort_unstable_by_key(|subtrees| subtrees.successors.start);
+        Some(forked)
+    }
+}
@@ -0,0 +1,226 @@
+//! Intermediate results of stylesheet applications
+//! retained for [incremental updates](super::apply_stylesheet_incremental).
+
+use super::{apply::ApplyStatistics, mapping_builder::PropertyMappingBuilder};
+use crate::property::PropertyKey;
+use aili_model::state::{EdgeLabel, NodeId, ProgramStateGraph};
+use aili_style::{
+    cascade::{ResolverCheckpoint, SequencePointRecord},
+    selectable::Selectable,
+    values::PropertyValue,
+};
+use std::{cell::RefCell, ops::Range};
+
+/// Intermediate results of a stylesheet application
+/// that allow a later application over a modified graph
+/// to only re-evaluate the parts of the graph that have changed.
+///
+/// The cache is only valid for the stylesheet it has been populated with.
+/// It must be [cleared](ApplyStylesheetCache::clear) before it is used
+/// with a different stylesheet.
+#[derive(Debug)]
+pub struct ApplyStylesheetCache<T: NodeId> {
+    /// Records of all node visits, in depth-first order.
+    pub(super) visits: Vec<VisitRecord<T>>,
+
+    /// All nodes that have been accessed during the application,
+    /// in order of access.
+    pub(super) reads: Vec<T>,
+
+    /// All operations on the mapping builder, in order.
+    pub(super) operations: Vec<MappingOperation<T>>,
+
+    /// All sequence point checks made by the selector resolver, in order.
+    pub(super) sequence_points: Vec<SequencePointRecord<T>>,
+
+    /// Counters of the application that has populated the cache.
+    pub(super) statistics: ApplyStatistics,
+}
+
+impl<T: NodeId> ApplyStylesheetCache<T> {
+    /// Constructs an empty cache.
+    pub fn new() -> Self {
+        Self {
+            visits: Vec::new(),
+            reads: Vec::new(),
+            operations: Vec::new(),
+            sequence_points: Vec::new(),
+            statistics: ApplyStatistics::default(),
+        }
+    }
+
+    /// Discards all cached results.
+    pub fn clear(&mut self) {
+        *self = Self::new();
+    }
+
+    /// Checks whether the cache contains any results.
+    pub fn is_empty(&self) -> bool {
+        self.visits.is_empty()
+    }
+
+    /// Counters of the work done by the application that has populated the cache.
+    pub fn statistics(&self) -> &ApplyStatistics {
+        &self.statistics
+    }
+}
+
+impl<T: NodeId> Default for ApplyStylesheetCache<T> {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+/// Record of a single visit of a node during a stylesheet application.
+///
+/// All ranges refer to the logs of the owning [`ApplyStylesheetCache`]
+/// and cover the whole subtree of the visit.
+#[derive(Debug)]
+pub(super) struct VisitRecord<T: NodeId> {
+    /// The node that has been visited.
+    pub node: T,
+
+    /// The edge along which the node was entered,
+    /// [`None`] for the root of the traversal.
+    pub edge: Option<EdgeLabel>,
+
+    /// State of the application when the node was entered.
+    pub entry: VisitEntry<T>,
+
+    /// Variables assigned while resolving the node itself,
+    /// which are visible to all its successors.
+    /// Sorted by name.
+    pub variables: Vec<(String, PropertyValue<T>)>,
+
+    /// Index of the first visit after the subtree of this visit.
+    pub end: usize,
+
+    /// Range of [`ApplyStylesheetCache::reads`] made in the subtree.
+    pub reads: Range<usize>,
+
+    /// Range of [`ApplyStylesheetCache::operations`] made in the subtree.
+    pub operations: Range<usize>,
+
+    /// Range of [`ApplyStylesheetCache::sequence_points`] made in the subtree.
+    pub sequence_points: Range<usize>,
+}
+
+/// State of a stylesheet application that is relevant to the evaluation
+/// of a subtree, save for the variable pool and matched sequence points,
+/// which are tracked separately.
+#[derive(Clone, PartialEq, Debug)]
+pub(super) struct VisitEntry<T: NodeId> {
+    /// Selectors awaiting the visited node.
+    pub resolver: ResolverCheckpoint,
+
+    /// Default parent entity at the time the node was entered.
+    pub auto_parent: Option<Selectable<T>>,
+}
+
+/// Call to a [`PropertyMappingBuilder`] that can be replayed.
+#[derive(Clone, Debug)]
+pub(super) enum MappingOperation<T: NodeId> {
+    /// Call to [`PropertyMappingBuilder::push`].
+    Push,
+
+    /// Call to [`PropertyMappingBuilder::pop`].
+    Pop,
+
+    /// Call to [`PropertyMappingBuilder::selected_entity`].
+    SelectedEntity {
+        target: Selectable<T>,
+        select_origin: T,
+        static_precedence: usize,
+    },
+
+    /// Call to [`PropertyMappingBuilder::assign`].
+    Assign {
+        target: Selectable<T>,
+        key: PropertyKey,
+        value: PropertyValue<T>,
+        static_precedence: usize,
+    },
+}
+
+impl<T: NodeId> MappingOperation<T> {
+    /// Repeats the operation on a builder.
+    pub fn replay(&self, builder: &mut PropertyMappingBuilder<T>) {
+        match self {
+            Self::Push => builder.push(),
+            Self::Pop => builder.pop(),
+            Self::SelectedEntity {
+                target,
+                select_origin,
+                static_precedence,
+            } => builder.selected_entity(target, select_origin, *static_precedence),
+            Self::Assign {
+                target,
+                key,
+                value,
+                static_precedence,
+            } => builder.assign(target, key, value.clone(), *static_precedence),
+        }
+    }
+}
+
+/// Wrapper over a [`ProgramStateGraph`] that optionally logs
+/// which nodes have been accessed.
+pub(super) struct TrackedGraph<'g, G: ProgramStateGraph> {
+    /// The underlying graph.
+    pub graph: &'g G,
+
+    /// Log of accessed nodes, if enabled.
+    reads: Option<RefCell<Vec<G::NodeId>>>,
+}
+
+impl<'g, G: ProgramStateGraph> TrackedGraph<'g, G> {
+    /// Wraps a graph without logging.
+    pub fn untracked(graph: &'g G) -> Self {
+        Self { graph, reads: None }
+    }
+
+    /// Wraps a graph and logs all accesses.
+    pub fn tracked(graph: &'g G) -> Self {
+        Self {
+            graph,
+            reads: Some(RefCell::default()),
+        }
+    }
+
+    /// Accesses a node by its ID, like [`ProgramStateGraph::get`],
+    /// without borrowing the wrapper.
+    pub fn get_detached(&self, id: &G::NodeId) -> Option<G::NodeRef<'g>> {
+        if let Some(log) = &self.reads {
+            log.borrow_mut().push(id.clone());
+        }
+        self.graph.get(id)
+    }
+
+    /// Number of accesses logged so far.
+    pub fn read_count(&self) -> usize {
+        self.reads.as_ref().map_or(0, |r| r.borrow().len())
+    }
+
+    /// Appends accesses to the log, as if they were made now.
+    pub fn extend_reads(&self, reads: &[G::NodeId]) {
+        if let Some(log) = &self.reads {
+            log.borrow_mut().extend_from_slice(reads);
+        }
+    }
+
+    /// Takes the log of accesses.
+    pub fn take_reads(&self) -> Vec<G::NodeId> {
+        self.reads.as_ref().map(|r| r.take()).unwrap_or_default()
+    }
+}
+
+impl<G: ProgramStateGraph> ProgramStateGraph for TrackedGraph<'_, G> {
+    type NodeId = G::NodeId;
+    type NodeRef<'a>
+        = G::NodeRef<'a>
+    where
+        Self: 'a;
+    fn get(&self, id: &Self::NodeId) -> Option<Self::NodeRef<'_>> {
+        self.get_detached(id)
+    }
+}
@@ -1,17 +1,13 @@
 //! Helper for construction of [`EntityPropertyMapping`]s.
 
-use crate::property::{DisplayMode, EntityPropertyMapping, PropertyKey};
+use crate::property::{DisplayMode, EntityPropertyMapping, FragmentKey, PropertyKey, PropertyMap};
 use aili_model::state::{NodeId, ProgramStateGraph, ProgramStateNode};
 use aili_style::{
     eval::{context::EvaluationContext, unwrap_node_value},
     selectable::Selectable,
     values::PropertyValue,
 };
-use std::collections::{HashMap, hash_map::Entry};
-
-/// Identifier of a property variable on an entity.
-#[derive(PartialEq, Eq, Debug, Hash)]
-struct EntityPropertyKey<T: NodeId>(Selectable<T>, PropertyKey);
+use std::collections::HashMap;
 
 /// Value assigned to a property variable based on a rule
 #[derive(Debug)]
@@ -48,10 +44,211 @@ impl<T: NodeId> RulePropertyValue<T> {
     }
 }
 
+/// Overwrites a property value with a new one, but only
+/// if there is none yet or the new value has greater or equal precedence.
+///
+/// ## Return Value
+/// True if the new value was written, false otherwise.
+fn write_slot<T: NodeId>(
+    slot: &mut Option<RulePropertyValue<T>>,
+    candidate_value: RulePropertyValue<T>,
+) -> bool {
+    match slot {
+        Some(existing) => existing.assign_new_value(candidate_value),
+        None => {
+            *slot = Some(candidate_value);
+            true
+        }
+    }
+}
+
+/// Values assigned to all properties of one entity.
+///
+/// Properties with special meaning are stored in their own slots,
+/// so that only attributes need to be looked up by name.
+#[derive(Debug)]
+struct EntityRecord<T: NodeId> {
+    /// The entity whose properties are stored in the record.
+    entity: Selectable<T>,
+    /// Value of [`PropertyKey::Display`].
+    display: Option<RulePropertyValue<T>>,
+    /// Value of [`PropertyKey::Parent`].
+    parent: Option<RulePropertyValue<T>>,
+    /// Value of [`PropertyKey::Target`].
+    target: Option<RulePropertyValue<T>>,
+    /// Values of [`PropertyKey::Attribute`]s.
+    attributes: AttributeSlots<T>,
+    /// Values of [`PropertyKey::FragmentAttribute`]s,
+    /// indexed by [`fragment_slot`].
+    fragment_attributes: [AttributeSlots<T>; FRAGMENT_SLOT_COUNT],
+}
+
+impl<T: NodeId> EntityRecord<T> {
+    fn new(entity: Selectable<T>) -> Self {
+        Self {
+            entity,
+            display: None,
+            parent: None,
+            target: None,
+            attributes: AttributeSlots::default(),
+            fragment_attributes: Default::default(),
+        }
+    }
+
+    /// Assigns a value to a property, if it has greater or equal
+    /// precedence than the value that is already present.
+    ///
+    /// ## Return value
+    /// True if the property has been written, false if there was already
+    /// a value with greater precedence present.
+    fn write_property(&mut self, key: &PropertyKey, value: RulePropertyValue<T>) -> bool {
+        match key {
+            PropertyKey::Attribute(name) => self.attributes.write(name, value),
+            PropertyKey::FragmentAttribute(fragment, name) => {
+                self.fragment_attributes[fragment_slot(*fragment)].write(name, value)
+            }
+            PropertyKey::Display => write_slot(&mut self.display, value),
+            PropertyKey::Parent => write_slot(&mut self.parent, value),
+            PropertyKey::Target => write_slot(&mut self.target, value),
+            // Detachment has no effect on the mapping
+            PropertyKey::Detach => true,
+        }
+    }
+
+    /// Converts the values assigned to the entity to their final form.
+    ///
+    /// ## Return Value
+    /// The entity and its properties, or [`None`] if none of them are set,
+    /// in which case the entity should not be in the mapping at all.
+    fn build(
+        self,
+        graph: &impl ProgramStateGraph<NodeId = T>,
+    ) -> Option<(Selectable<T>, PropertyMap<T>)> {
+        let mut is_set = false;
+        let mut properties = PropertyMap::new();
+        for (name, value) in self.attributes.build(graph) {
+            properties.attributes.insert(name, value);
+            is_set = true;
+        }
+        for (fragment, attributes) in FRAGMENT_SLOTS.into_iter().zip(self.fragment_attributes) {
+            let attributes = HashMap::from_iter(attributes.build(graph));
+            if !attributes.is_empty() {
+                properties.fragment_attributes.insert(fragment, attributes);
+                is_set = true;
+            }
+        }
+        if let Some(RulePropertyValue { value, .. }) = self.display {
+            let display_mode = match &value {
+                PropertyValue::Unset => None,
+                PropertyValue::Selection(sel) => {
+                    if sel.is_node() {
+                        graph
+                            .get(&sel.node_id)
+                            .and_then(|node| node.value())
+                            .map(PropertyValue::<T>::from)
+                            .as_ref()
+                            .map(PropertyValue::to_string)
+                            .map(DisplayMode::from_name)
+                    } else {
+                        None
+                    }
+                }
+                _ => Some(DisplayMode::from_name(value.to_string())),
+            };
+            if display_mode.is_some() {
+                properties.display = display_mode;
+                is_set = true;
+            }
+        }
+        if let Some(RulePropertyValue {
+            value: PropertyValue::Selection(sel),
+            ..
+        }) = self.parent
+        {
+            properties.parent = Some(*sel);
+            is_set = true;
+        }
+        if let Some(RulePropertyValue {
+            value: PropertyValue::Selection(sel),
+            ..
+        }) = self.target
+        {
+            properties.target = Some(*sel);
+            is_set = true;
+        }
+        is_set.then_some((self.entity, properties))
+    }
+}
+
+/// Values of attributes of an entity, by name.
+///
+/// Entities only have a handful of attributes,
+/// so they are stored in a list and searched linearly.
+#[derive(Debug)]
+struct AttributeSlots<T: NodeId>(Vec<(String, RulePropertyValue<T>)>);
+
+impl<T: NodeId> AttributeSlots<T> {
+    /// Assigns a value to an attribute if it has greater or equal
+    /// precedence than the value that is already present.
+    fn write(&mut self, name: &str, value: RulePropertyValue<T>) -> bool {
+        match self.0.iter_mut().find(|(n, _)| n == name) {
+            Some((_, existing)) => existing.assign_new_value(value),
+            None => {
+                self.0.push((name.to_owned(), value));
+                true
+            }
+        }
+    }
+
+    /// Converts the values to their final form, omitting unset attributes.
+    fn build(
+        self,
+        graph: &impl ProgramStateGraph<NodeId = T>,
+    ) -> impl Iterator<Item = (String, String)> {
+        self.0
+            .into_iter()
+            .filter_map(|(name, RulePropertyValue { value, .. })| {
+                let value = PropertyMappingBuilder::to_true_value(value, graph);
+                // If value if Unset, the attribute should not be saved at all
+                (value != PropertyValue::Unset).then(|| (name, value.to_string()))
+            })
+    }
+}
+
+impl<T: NodeId> Default for AttributeSlots<T> {
+    fn default() -> Self {
+        Self(Vec::new())
+    }
+}
+
+/// Number of distinct [`FragmentKey`]s.
+const FRAGMENT_SLOT_COUNT: usize = 2;
+
+/// Index of a fragment's attributes in [`EntityRecord::fragment_attributes`].
+fn fragment_slot(fragment: FragmentKey) -> usize {
+    match fragment {
+        FragmentKey::Start => 0,
+        FragmentKey::End => 1,
+    }
+}
+
+/// Inverse of [`fragment_slot`].
+const FRAGMENT_SLOTS: [FragmentKey; FRAGMENT_SLOT_COUNT] = [FragmentKey::Start, FragmentKey::End];
+
 /// Helper object for constructing an [`EntityPropertyMapping`].
 pub struct PropertyMappingBuilder<T: NodeId> {
-    /// Values assigned to each property on each node.
-    properties: HashMap<EntityPropertyKey<T>, RulePropertyValue<T>>,
+    /// Values assigned to the properties of each entity,
+    /// in order of first assignment.
+    entities: Vec<EntityRecord<T>>,
+
+    /// Indices into [`PropertyMappingBuilder::entities`] by entity.
+    entity_indices: HashMap<Selectable<T>, usize>,
+
+    /// Index of the entity that has been assigned to most recently.
+    ///
+    /// Rules assign all their properties to the same entity in a row,
+    /// so this saves hashing the entity for each of them.
+    last_entity: Option<usize>,
 
     /// Stack that tracks the information necessary to assign auto-defaults.
     auto_stack: Vec<AutoAssignmentContext<T>>,
@@ -61,7 +258,9 @@ impl<T: NodeId> PropertyMappingBuilder<T> {
     /// Constructs an empty mapping builder.
     pub fn new() -> Self {
         Self {
-            properties: HashMap::new(),
+            entities: Vec::new(),
+            entity_indices: HashMap::new(),
+            last_entity: None,
             auto_stack: vec![AutoAssignmentContext::default()],
         }
     }
@@ -80,70 +279,16 @@ impl<T: NodeId> PropertyMappingBuilder<T> {
     }
 
     /// Finalizes the property mapping.
-    pub fn build(mut self, graph: &impl ProgramStateGraph<NodeId = T>) -> EntityPropertyMapping<T> {
-        let mut mapping = EntityPropertyMapping::new();
-        for (EntityPropertyKey(entity, property), RulePropertyValue { value, .. }) in
-            std::mem::take(&mut self.properties)
-        {
-            // Insert the property map lazily
-            let entity_properties = || mapping.0.entry(entity).or_default();
-            match property {
-                PropertyKey::Attribute(name) => {
-                    let value = Self::to_true_value(value, graph);
-                    // If value if Unset, the attribute should not be saved at all
-                    if value != PropertyValue::Unset {
-                        entity_properties()
-                            .attributes
-                            .insert(name, value.to_string());
-                    }
-                }
-                PropertyKey::FragmentAttribute(fragment, name) => {
-                    let value = Self::to_true_value(value, graph);
-                    // If value is Unset, the attribute should not be saved at all
-                    if value != PropertyValue::Unset {
-                        entity_properties()
-                            .fragment_attributes
-                            .entry(fragment)
-                            .or_default()
-                            .insert(name, value.to_string());
-                    }
-                }
-                PropertyKey::Display => {
-                    let display_mode = match &value {
-                        PropertyValue::Unset => None,
-                        PropertyValue::Selection(sel) => {
-                            if sel.is_node() {
-                                graph
-                                    .get(&sel.node_id)
-                                    .and_then(|node| node.value())
-                                    .map(PropertyValue::<T>::from)
-                                    .as_ref()
-                                    .map(PropertyValue::to_string)
-                                    .map(DisplayMode::from_name)
-                            } else {
-                                None
-                            }
-                        }
-                        _ => Some(DisplayMode::from_name(value.to_string())),
-                    };
-                    if display_mode.is_some() {
-                        entity_properties().display = display_mode;
-                    }
-                }
-                PropertyKey::Parent => {
-                    if let PropertyValue::Selection(sel) = value {
-                        entity_properties().parent = Some(*sel);
-                    }
-                }
-                PropertyKey::Target => {
-                    if let PropertyValue::Selection(sel) = value {
-                        entity_properties().target = Some(*sel);
-                    }
-                }
-                PropertyKey::Detach => {}
-            }
-        }
-        mapping
+    pub fn build(self, graph: &impl ProgramStateGraph<NodeId = T>) -> EntityPropertyMapping<T> {
+        // Each entity is stored exactly once, so the mapping
+        // can be allocated up front and never needs to grow
+        let mut mapping = HashMap::with_capacity(self.entities.len());
+        mapping.extend(
+            self.entities
+                .into_iter()
+                .filter_map(|record| record.build(graph)),
+        );
+        EntityPropertyMapping(mapping)
     }
 
     /// Notifies the builder that an entity has been encountered.
@@ -157,29 +302,26 @@ impl<T: NodeId> PropertyMappingBuilder<T> {
         // Edges that are selected are automatically displayed as conenctors
         if target.is_edge() {
             // Display as connector
-            let display_key = EntityPropertyKey(target.clone(), PropertyKey::Display);
             let display_value = RulePropertyValue {
                 value: PropertyValue::String(DisplayMode::CONNECTOR_NAME.to_owned()),
                 static_precedence,
                 passive: true,
             };
-            self.write_property(display_key, display_value);
+            self.write_property(target, &PropertyKey::Display, display_value);
             // Parent is source
-            let parent_key = EntityPropertyKey(target.clone(), PropertyKey::Parent);
             let parent_value = RulePropertyValue {
                 value: PropertyValue::Selection(Selectable::node(target.node_id.clone()).into()),
                 static_precedence,
                 passive: true,
             };
-            self.write_property(parent_key, parent_value);
+            self.write_property(target, &PropertyKey::Parent, parent_value);
             // Target is target
-            let target_key = EntityPropertyKey(target.clone(), PropertyKey::Target);
             let target_value = RulePropertyValue {
                 value: PropertyValue::Selection(Selectable::node(select_origin.clone()).into()),
                 static_precedence,
                 passive: true,
             };
-            self.write_property(target_key, target_value);
+            self.write_property(target, &PropertyKey::Target, target_value);
         }
     }
 
@@ -191,13 +333,12 @@ impl<T: NodeId> PropertyMappingBuilder<T> {
         value: PropertyValue<T>,
         static_precedence: usize,
     ) {
-        let full_key = EntityPropertyKey(target.clone(), key.clone());
         let full_value = RulePropertyValue {
             value,
             static_precedence,
             passive: false,
         };
-        let updated_property = self.write_property(full_key, full_value);
+        let updated_property = self.write_property(target, key, full_value);
         // If we just chaned the display mode of an entity,
         // we should auto-assign common values to other properties
         if updated_property && *key == PropertyKey::Display {
@@ -208,28 +349,35 @@ impl<T: NodeId> PropertyMappingBuilder<T> {
                 self.auto_stack.last_mut().unwrap().parent = Some(target.clone());
                 // Likewise, it is adopted by its predecessor, if any
                 if let Some(parent) = self.prev_auto_frame().and_then(|f| f.parent.as_ref()) {
-                    let parent_key = EntityPropertyKey(target.clone(), PropertyKey::Parent);
                     let parent_value = RulePropertyValue {
                         value: PropertyValue::Selection(parent.clone().into()),
                         static_precedence,
                         passive: true,
                     };
-                    self.write_property(parent_key, parent_value);
+                    self.write_property(target, &PropertyKey::Parent, parent_value);
                 }
             }
             if target.is_extra() {
                 // Extra will be adopted by its owner
-                let parent_key = EntityPropertyKey(target.clone(), PropertyKey::Parent);
                 let parent_value = RulePropertyValue {
                     value: PropertyValue::Selection(target.clone().without_extra().into()),
                     static_precedence,
                     passive: true,
                 };
-                self.write_property(parent_key, parent_value);
+                self.write_property(target, &PropertyKey::Parent, parent_value);
             }
         }
     }
 
+    /// Retrieves the entity that is currently the default parent
+    /// of newly displayed nodes.
+    ///
+    /// Together with the order of calls, this is the only state of the builder
+    /// that decides how auto-defaults are assigned in the next context frame.
+    pub fn auto_parent(&self) -> Option<&Selectable<T>> {
+        self.auto_stack.last().unwrap().parent.as_ref()
+    }
+
     /// Retrieves the second-to-last [`AutoAssignmentContext`], if present.
     /// This should be used to acquire context from previous entities.
     fn prev_auto_frame(&self) -> Option<&AutoAssignmentContext<T>> {
@@ -240,19 +388,41 @@ impl<T: NodeId> PropertyMappingBuilder<T> {
         }
     }
 
-    /// Shorthand for assigning a [`RulePropertyValue`] to an [`EntityPropertyKey`].
+    /// Shorthand for assigning a [`RulePropertyValue`] to a property of an entity.
     ///
     /// ## Return value
     /// True if the property has been written, false if there was already
     /// a value with greater precedence present.
-    fn write_property(&mut self, key: EntityPropertyKey<T>, value: RulePropertyValue<T>) -> bool {
-        match self.properties.entry(key) {
-            Entry::Occupied(mut existing) => existing.get_mut().assign_new_value(value),
-            Entry::Vacant(entry) => {
-                entry.insert(value);
-                true
-            }
+    fn write_property(
+        &mut self,
+        target: &Selectable<T>,
+        key: &PropertyKey,
+        value: RulePropertyValue<T>,
+    ) -> bool {
+        let index = self.entity_index(target);
+        self.entities[index].write_property(key, value)
+    }
+
+    /// Finds the record of an entity, creating it if it does not exist yet.
+    ///
+    /// ## Return Value
+    /// Index of the record in [`PropertyMappingBuilder::entities`].
+    fn entity_index(&mut self, target: &Selectable<T>) -> usize {
+        if let Some(index) = self.last_entity
+            && self.entities[index].entity == *target
+        {
+            return index;
         }
+        let entities = &mut self.entities;
+        let index = *self
+            .entity_indices
+            .entry(target.clone())
+            .or_insert_with_key(|target| {
+                entities.push(EntityRecord::new(target.clone()));
+                entities.len() - 1
+            });
+        self.last_entity = Some(index);
+        index
     }
 
     /// Converts a [`PropertyValue::Selection`] to an explicit value.
@@ -2,6 +2,13 @@
 //! of [state graphs](aili_model::state).
 
 mod apply;
+mod cache;
 mod mapping_builder;
 
-pub use apply::apply_stylesheet;
+pub use apply::{
+    ApplyStatistics, apply_stylesheet, apply_stylesheet_incremental,
+    apply_stylesheet_with_statistics,
+};
+#[cfg(feature = "parallel")]
+pub use apply::{ParallelOptions, apply_stylesheet_parallel};
+pub use cache::ApplyStylesheetCache;
@@ -7,7 +7,7 @@ use crate::property::{DisplayMode, EntityPropertyMapping, FragmentKey, PropertyM
 use aili_model::{state::NodeId, vis::*};
 use aili_style::selectable::Selectable;
 use derive_more::Display;
-use std::collections::HashMap;
+use std::collections::{HashMap, HashSet};
 
 /// Describes an occurrence in a [`VisTreeWriter`]
 /// that should not arise when using it as intended
@@ -33,8 +33,53 @@ pub struct VisTreeWriter<'w, T: NodeId, V: VisTree> {
     /// of all visualized entities.
     current_mappping: HashMap<Selectable<T>, EntityRendering<T, V>>,
 
+    /// Entities whose relations to other entities could not be
+    /// forwarded to the vis tree on the last update,
+    /// and should be retried on the next one.
+    unresolved_relations: HashSet<Selectable<T>>,
+
     /// Handler that processes warnings emited by the writer.
     warning_handler: Option<Box<dyn FnMut(VisTreeWriterWarning<T>) + 'w>>,
+
+    /// Counters of modifications made to the vis tree
+    /// since they were last [taken](VisTreeWriter::take_statistics).
+    statistics: VisTreeWriterStatistics,
+}
+
+/// Counters of modifications of a [`VisTree`] made by a [`VisTreeWriter`].
+#[derive(Clone, Copy, PartialEq, Eq, Default, Debug)]
+pub struct VisTreeWriterStatistics {
+    /// Number of elements that have been created.
+    pub elements_created: usize,
+
+    /// Number of connectors that have been created.
+    pub connectors_created: usize,
+
+    /// Number of elements and connectors that have been detached
+    /// because their entities are no longer rendered the same way.
+    pub renderings_removed: usize,
+
+    /// Number of attributes that have been set or unset.
+    pub attributes_set: usize,
+
+    /// Number of parent assignments of elements and target
+    /// assignments of pins, including retried ones.
+    pub relations_updated: usize,
+
+    /// Number of times the root of the tree has been replaced.
+    pub root_updates: usize,
+}
+
+impl VisTreeWriterStatistics {
+    /// Total number of operations issued to the vis tree.
+    pub fn operations(&self) -> usize {
+        self.elements_created
+            + self.connectors_created
+            + self.renderings_removed
+            + self.attributes_set
+            + self.relations_updated
+            + self.root_updates
+    }
 }
 
 impl<'w, T: NodeId, V: VisTree> VisTreeWriter<'w, T, V> {
@@ -44,7 +89,9 @@ impl<'w, T: NodeId, V: VisTree> VisTreeWriter<'w, T, V> {
             vis_tree,
             current_root: None,
             current_mappping: HashMap::new(),
+            unresolved_relations: HashSet::new(),
             warning_handler: None,
+            statistics: VisTreeWriterStatistics::default(),
         }
     }
 
@@ -71,6 +118,20 @@ impl<'w, T: NodeId, V: VisTree> VisTreeWriter<'w, T, V> {
         self.vis_tree
     }
 
+    /// Accesses the [`VisTree`] that was passed to the constructor.
+    ///
+    /// The writer assumes it is the only one modifying the tree,
+    /// so this should not be used to change its structure.
+    pub fn vis_tree_mut(&mut self) -> &mut V {
+        &mut self.vis_tree
+    }
+
+    /// Takes the counters of modifications made to the vis tree
+    /// since they were last taken, resetting them to zero.
+    pub fn take_statistics(&mut self) -> VisTreeWriterStatistics {
+        std::mem::take(&mut self.statistics)
+    }
+
     /// Gets the current root element, if any.
     pub fn get_root(&self) -> Option<&Selectable<T>> {
         self.current_root.as_ref()
@@ -95,33 +156,78 @@ impl<'w, T: NodeId, V: VisTree> VisTreeWriter<'w, T, V> {
     }
 
     /// Updates the properties of all visual elements.
+    ///
+    /// Only entities whose properties differ from the previous update,
+    /// or whose relatives have had their renderings replaced,
+    /// are forwarded to the vis tree.
     pub fn update(&mut self, mut new_mapping: EntityPropertyMapping<T>) {
         let mut updated_mapping = HashMap::new();
+        // Entities whose renderings have been created, recreated or removed
+        let mut replaced = HashSet::new();
+        // Entities whose relations to other entities must be forwarded
+        let mut dirty = std::mem::take(&mut self.unresolved_relations);
         // Create renderings for entities that are not yet rendered and update those that are
         for (key, new_properties) in new_mapping.0.drain() {
-            if let Some(new_entity_mapping) = self.update_or_create_rendering(&key, new_properties)
-            {
-                updated_mapping.insert(key, new_entity_mapping);
+            let (rendering, change) = self.update_or_create_rendering(&key, new_properties);
+            match change {
+                RenderingChange::Unchanged => {}
+                RenderingChange::RelationsChanged => {
+                    dirty.insert(key.clone());
+                }
+                RenderingChange::Replaced => {
+                    replaced.insert(key.clone());
+                    dirty.insert(key.clone());
+                }
+            }
+            if let Some(rendering) = rendering {
+                updated_mapping.insert(key, rendering);
             }
         }
         // current_mapping now only contains entities that were rendered, but are no longer
         // supposed to be, so we destroy their renderings
-        for (_, mapping) in std::mem::take(&mut self.current_mappping).drain() {
+        for (key, mapping) in std::mem::take(&mut self.current_mappping).drain() {
             self.remove_rendering(mapping);
+            replaced.insert(key);
         }
         // Put the new mapping in its place
         self.current_mappping = updated_mapping;
         // Inter-entity relationships should only be updated now,
         // after all entity recreating is completed
-        self.update_inter_entity_relations();
-        // Root element may have changed or its rendering may have been recreated
-        self.forward_update_root();
+        self.update_inter_entity_relations(&dirty, &replaced);
+        // Root element's rendering may have been recreated
+        if self
+            .current_root
+            .as_ref()
+            .is_some_and(|root| replaced.contains(root))
+        {
+            self.forward_update_root();
+        }
     }
 
-    /// Updates the parent-child and pin-target relationships of all active visual entities.
-    fn update_inter_entity_relations(&mut self) {
+    /// Updates the parent-child and pin-target relationships of visual entities
+    /// that have changed, or whose relatives have changed.
+    ///
+    /// ## Parameters
+    /// - `dirty` - Entities whose relations have changed.
+    /// - `replaced` - Entities whose renderings have been replaced,
+    ///   so entities related to them must be reattached.
+    fn update_inter_entity_relations(
+        &mut self,
+        dirty: &HashSet<Selectable<T>>,
+        replaced: &HashSet<Selectable<T>>,
+    ) {
         let mut retry_element_insertions = Vec::new();
+        let is_affected = |selectable: &Selectable<T>, properties: &PropertyMap<T>| {
+            dirty.contains(selectable)
+                || [&properties.parent, &properties.target]
+                    .into_iter()
+                    .flatten()
+                    .any(|key| replaced.contains(key))
+        };
         for (selectable, mapping) in &self.current_mappping {
+            if !is_affected(selectable, &mapping.properties) {
+                continue;
+            }
             match &mapping.vis_handle {
                 EitherVisHandle::Element(handle) => {
                     let mut element = self
@@ -134,6 +240,7 @@ impl<'w, T: NodeId, V: VisTree> VisTreeWriter<'w, T, V> {
                         .as_ref()
                         .and_then(|key| self.current_mappping.get(key))
                         .and_then(|mapping| mapping.vis_handle.element());
+                    self.statistics.relations_updated += 1;
                     match element.insert_into(parent_handle) {
                         Ok(()) => {}
                         Err(ParentAssignmentError::InvalidHandle(_)) => {
@@ -170,6 +277,7 @@ impl<'w, T: NodeId, V: VisTree> VisTreeWriter<'w, T, V> {
                         .as_ref()
                         .and_then(|key| self.current_mappping.get(key))
                         .and_then(|mapping| mapping.vis_handle.element());
+                    self.statistics.relations_updated += 2;
                     connector
                         .start_mut()
                         .attach_to(start_handle)
@@ -184,6 +292,7 @@ impl<'w, T: NodeId, V: VisTree> VisTreeWriter<'w, T, V> {
         // We have inserted everything except a few elements that we have detached
         // from their parents. This is where we retry failed assignments
         for (child_handle, parent_handle, selectable) in retry_element_insertions {
+            self.statistics.relations_updated += 1;
             let result = self
                 .vis_tree
                 .get_element(child_handle)
@@ -197,6 +306,9 @@ impl<'w, T: NodeId, V: VisTree> VisTreeWriter<'w, T, V> {
                     panic!("The handle should remain valid")
                 }
                 Err(ParentAssignmentError::StructureViolation) => {
+                    // Another entity may move out of the way later,
+                    // so try again on the next update
+                    self.unresolved_relations.insert(selectable.clone());
                     if let Some(warning_handler) = &mut self.warning_handler {
                         warning_handler(VisTreeWriterWarning::VisStructureViolation(
                             selectable.clone(),
@@ -213,28 +325,48 @@ impl<'w, T: NodeId, V: VisTree> VisTreeWriter<'w, T, V> {
         &mut self,
         key: &Selectable<T>,
         new_properties: PropertyMap<T>,
-    ) -> Option<EntityRendering<T, V>> {
+    ) -> (Option<EntityRendering<T, V>>, RenderingChange) {
         // Get the existing mapping for the entity and remove it from the container
         if let Some(mut old_mapping) = self.current_mappping.remove(key) {
-            if old_mapping.properties.display == new_properties.display {
+            if old_mapping.properties == new_properties {
+                // Nothing to do here, leave the rendering as is
+                (Some(old_mapping), RenderingChange::Unchanged)
+            } else if old_mapping.properties.display == new_properties.display {
                 // The entity is already displayed and its display mode has not changed,
                 // so we update the existing rendering instead of creating a new one
+                let relations_changed = old_mapping.properties.parent != new_properties.parent
+                    || old_mapping.properties.target != new_properties.target;
                 self.update_attributes(&mut old_mapping, new_properties);
-                Some(old_mapping)
+                let change = if relations_changed {
+                    RenderingChange::RelationsChanged
+                } else {
+                    RenderingChange::Unchanged
+                };
+                (Some(old_mapping), change)
             } else {
                 // The entity's display mode has changed, so we destroy its existing
                 // rendering and create a new one
                 self.remove_rendering(old_mapping);
-                self.try_create_rendering(new_properties)
+                (
+                    self.try_create_rendering(new_properties),
+                    RenderingChange::Replaced,
+                )
             }
         } else {
             // The entity is not displayed yet, so we create a new rendering for it
-            self.try_create_rendering(new_properties)
+            let rendering = self.try_create_rendering(new_properties);
+            let change = if rendering.is_some() {
+                RenderingChange::Replaced
+            } else {
+                RenderingChange::Unchanged
+            };
+            (rendering, change)
         }
     }
 
     /// Detaches and drops an existing entity rendering.
     fn remove_rendering(&mut self, mapping: EntityRendering<T, V>) {
+        self.statistics.renderings_removed += 1;
         match mapping.vis_handle {
             EitherVisHandle::Element(handle) => {
                 // Remove the element from its parent
@@ -269,11 +401,12 @@ impl<'w, T: NodeId, V: VisTree> VisTreeWriter<'w, T, V> {
         let vis_handle = match &properties.display {
             Some(DisplayMode::ElementTag(tag_name)) => {
                 let handle = self.vis_tree.add_element(tag_name);
+                self.statistics.elements_created += 1;
                 let mut element = self
                     .vis_tree
                     .get_element(&handle)
                     .expect("The element was just created");
-                Self::set_attributes(
+                self.statistics.attributes_set += Self::set_attributes(
                     &mut element,
                     properties
                         .attributes
@@ -284,11 +417,12 @@ impl<'w, T: NodeId, V: VisTree> VisTreeWriter<'w, T, V> {
             }
             Some(DisplayMode::Connector) => {
                 let handle = self.vis_tree.add_connector();
+                self.statistics.connectors_created += 1;
                 let mut connector = self
                     .vis_tree
                     .get_connector(&handle)
                     .expect("The connector was just created");
-                Self::set_attributes(
+                self.statistics.attributes_set += Self::set_attributes(
                     &mut connector,
                     properties
                         .attributes
@@ -296,13 +430,13 @@ impl<'w, T: NodeId, V: VisTree> VisTreeWriter<'w, T, V> {
                         .map(|(k, v)| (k.as_str(), v.as_str())),
                 );
                 if let Some(start_attrs) = properties.fragment_attributes.get(&FragmentKey::Start) {
-                    Self::set_attributes(
+                    self.statistics.attributes_set += Self::set_attributes(
                         &mut connector.start_mut(),
                         start_attrs.iter().map(|(k, v)| (k.as_str(), v.as_str())),
                     );
                 }
                 if let Some(end_attrs) = properties.fragment_attributes.get(&FragmentKey::End) {
-                    Self::set_attributes(
+                    self.statistics.attributes_set += Self::set_attributes(
                         &mut connector.end_mut(),
                         end_attrs.iter().map(|(k, v)| (k.as_str(), v.as_str())),
                     );
@@ -331,7 +465,7 @@ impl<'w, T: NodeId, V: VisTree> VisTreeWriter<'w, T, V> {
                     .vis_tree
                     .get_element(handle)
                     .expect("The handle should remain valid");
-                Self::update_attribute_map(
+                self.statistics.attributes_set += Self::update_attribute_map(
                     &mut element,
                     std::mem::take(&mut mapping.properties.attributes),
                     properties
@@ -346,7 +480,7 @@ impl<'w, T: NodeId, V: VisTree> VisTreeWriter<'w, T, V> {
                     .vis_tree
                     .get_connector(handle)
                     .expect("The handle should remain valid");
-                Self::update_attribute_map(
+                self.statistics.attributes_set += Self::update_attribute_map(
                     &mut connector,
                     std::mem::take(&mut mapping.properties.attributes),
                     properties
@@ -354,7 +488,7 @@ impl<'w, T: NodeId, V: VisTree> VisTreeWriter<'w, T, V> {
                         .iter()
                         .map(|(k, v)| (k.as_str(), v.as_str())),
                 );
-                Self::update_attribute_map(
+                self.statistics.attributes_set += Self::update_attribute_map(
                     &mut connector.start_mut(),
                     mapping
                         .properties
@@ -368,7 +502,7 @@ impl<'w, T: NodeId, V: VisTree> VisTreeWriter<'w, T, V> {
                         .flatten()
                         .map(|(k, v)| (k.as_str(), v.as_str())),
                 );
-                Self::update_attribute_map(
+                self.statistics.attributes_set += Self::update_attribute_map(
                     &mut connector.end_mut(),
                     mapping
                         .properties
@@ -388,28 +522,45 @@ impl<'w, T: NodeId, V: VisTree> VisTreeWriter<'w, T, V> {
     }
 
     /// Initializes attributes of a visual entity.
+    ///
+    /// ## Return Value
+    /// Number of attributes that have been set.
     fn set_attributes<'a>(
         target: &mut impl AttributeMap,
         values: impl IntoIterator<Item = (&'a str, &'a str)>,
-    ) {
+    ) -> usize {
+        let mut count = 0;
         for (key, value) in values {
             target.set_attribute(key, Some(value));
+            count += 1;
         }
+        count
     }
 
     /// Updates attributes of a visual entity.
+    ///
+    /// ## Return Value
+    /// Number of attributes that have been set or unset.
     fn update_attribute_map<'a>(
         target: &mut impl AttributeMap,
         mut old_values: HashMap<String, String>,
         values: impl IntoIterator<Item = (&'a str, &'a str)>,
-    ) {
+    ) -> usize {
+        let mut count = 0;
         for (key, value) in values {
-            target.set_attribute(key, Some(value));
-            old_values.remove(key);
+            // Only forward the attributes that have actually changed
+            if old_values
+                .remove(key)
+                .is_none_or(|old_value| old_value != value)
+            {
+                target.set_attribute(key, Some(value));
+                count += 1;
+            }
         }
         for key in old_values.keys() {
             target.set_attribute(key, None);
         }
+        count + old_values.len()
     }
 
     /// Updates the root element in the visualization tree.
@@ -422,12 +573,27 @@ impl<'w, T: NodeId, V: VisTree> VisTreeWriter<'w, T, V> {
             .as_ref()
             .and_then(|key| self.current_mappping.get(key))
             .and_then(|mapping| mapping.vis_handle.element());
+        self.statistics.root_updates += 1;
         self.vis_tree
             .set_root(root_handle)
             .expect("The handle should remain valid");
     }
 }
 
+/// Effect of [`VisTreeWriter::update`] on the rendering of a single entity.
+enum RenderingChange {
+    /// The rendering has been kept and its relations
+    /// to other entities have not changed.
+    Unchanged,
+
+    /// The rendering has been kept, but its parent
+    /// or target has changed.
+    RelationsChanged,
+
+    /// The rendering has been created, recreated, or removed.
+    Replaced,
+}
+
 /// Represents a selectable entity that has a visual representation.
 struct EntityRendering<T: NodeId, V: VisTree> {
     /// Handle to the visual associated with the entity.
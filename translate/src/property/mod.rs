@@ -3,7 +3,10 @@
 pub mod symbols;
 
 use aili_model::state::NodeId;
-use aili_style::selectable::Selectable;
+use aili_style::{
+    cascade::{BinaryFormat, BinaryFormatError, BinaryReader, BinaryWriter},
+    selectable::Selectable,
+};
 use derive_more::{Debug, From};
 use std::collections::HashMap;
 
@@ -30,6 +33,40 @@ pub enum PropertyKey {
     Detach,
 }
 
+impl BinaryFormat for PropertyKey {
+    fn write(&self, writer: &mut BinaryWriter) {
+        match self {
+            Self::Attribute(name) => {
+                writer.write_tag(0);
+                writer.write_str(name);
+            }
+            Self::FragmentAttribute(fragment, name) => {
+                writer.write_tag(1);
+                fragment.write(writer);
+                writer.write_str(name);
+            }
+            Self::Display => writer.write_tag(2),
+            Self::Parent => writer.write_tag(3),
+            Self::Target => writer.write_tag(4),
+            Self::Detach => writer.write_tag(5),
+        }
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        match reader.read_tag()? {
+            0 => Ok(Self::Attribute(String::read(reader)?)),
+            1 => Ok(Self::FragmentAttribute(
+                FragmentKey::read(reader)?,
+                String::read(reader)?,
+            )),
+            2 => Ok(Self::Display),
+            3 => Ok(Self::Parent),
+            4 => Ok(Self::Target),
+            5 => Ok(Self::Detach),
+            tag => Err(BinaryFormatError::InvalidTag(tag)),
+        }
+    }
+}
+
 /// Properties of a visual element, pre-processed to the required form.
 #[derive(Clone, PartialEq, Eq)]
 pub struct PropertyMap<T: NodeId> {
@@ -170,6 +207,22 @@ pub enum FragmentKey {
     End,
 }
 
+impl BinaryFormat for FragmentKey {
+    fn write(&self, writer: &mut BinaryWriter) {
+        match self {
+            Self::Start => writer.write_tag(0),
+            Self::End => writer.write_tag(1),
+        }
+    }
+    fn read(reader: &mut BinaryReader) -> Result<Self, BinaryFormatError> {
+        match reader.read_tag()? {
+            0 => Ok(Self::Start),
+            1 => Ok(Self::End),
+            tag => Err(BinaryFormatError::InvalidTag(tag)),
+        }
+    }
+}
+
 /// Represents the mapping between selectable entities and their display
 /// properties, computed by evaluating the cascade.
 #[derive(Clone, PartialEq, Eq, From, Debug)]
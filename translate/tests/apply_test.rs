@@ -23,7 +23,7 @@ fn apply_stylesheet_with_one_rule() {
         selector: Selector::from_path(
             [
                 SelectorSegment::anything_any_number_of_times(),
-                SelectorSegment::Match(EdgeMatcher::Named("a".to_owned())),
+                SelectorSegment::Match(EdgeMatcher::Named("a".into())),
             ]
             .into(),
         ),
@@ -173,7 +173,7 @@ fn select_edge() {
             [
                 SelectorSegment::anything_any_number_of_times(),
                 SelectorSegment::Condition(Expression::Select(
-                    LimitedSelector::from_path([EdgeLabel::Named("a".to_owned(), 0).into()]).into(),
+                    LimitedSelector::from_path([EdgeLabel::Named("a".into(), 0).into()]).into(),
                 )),
             ]
             .into(),
@@ -193,14 +193,14 @@ fn select_edge() {
                 .with_target(Selectable::node(1)),
         ),
         (
-            Selectable::edge(0, EdgeLabel::Named("a".to_owned(), 0)),
+            Selectable::edge(0, EdgeLabel::Named("a".into(), 0)),
             PropertyMap::new()
                 .with_display(DisplayMode::Connector)
                 .with_parent(Selectable::node(0))
                 .with_target(Selectable::node(5)),
         ),
         (
-            Selectable::edge(1, EdgeLabel::Named("a".to_owned(), 0)),
+            Selectable::edge(1, EdgeLabel::Named("a".into(), 0)),
             PropertyMap::new()
                 .with_display(DisplayMode::Connector)
                 .with_parent(Selectable::node(1))
@@ -214,7 +214,7 @@ fn select_edge() {
                 .with_target(Selectable::node(3)),
         ),
         (
-            Selectable::edge(5, EdgeLabel::Named("a".to_owned(), 0)),
+            Selectable::edge(5, EdgeLabel::Named("a".into(), 0)),
             PropertyMap::new()
                 .with_display(DisplayMode::Connector)
                 .with_parent(Selectable::node(5))
@@ -276,7 +276,7 @@ fn coerce_values() {
         },
         StyleRule {
             selector: Selector::from_path(
-                [SelectorSegment::Match(EdgeMatcher::Named("a".to_owned()))].into(),
+                [SelectorSegment::Match(EdgeMatcher::Named("a".into()))].into(),
             ),
             properties: vec![
                 StyleClause {
@@ -719,7 +719,7 @@ fn rule_precedence_in_declaration_order() {
         StyleRule {
             selector: Selector::from_path(
                 [
-                    SelectorSegment::Match(EdgeMatcher::Named("a".to_owned())),
+                    SelectorSegment::Match(EdgeMatcher::Named("a".into())),
                     SelectorSegment::anything_any_number_of_times(),
                     SelectorSegment::Match(EdgeLabel::Deref.into()),
                 ]
@@ -737,7 +737,7 @@ fn rule_precedence_in_declaration_order() {
                     SelectorSegment::AnyNumberOfTimes(
                         [SelectorSegment::Match(EdgeLabel::Next.into())].into(),
                     ),
-                    SelectorSegment::Match(EdgeMatcher::Named("a".to_owned())),
+                    SelectorSegment::Match(EdgeMatcher::Named("a".into())),
                 ]
                 .into(),
             ),
@@ -750,7 +750,7 @@ fn rule_precedence_in_declaration_order() {
             selector: Selector::from_path(
                 [
                     SelectorSegment::anything_any_number_of_times(),
-                    SelectorSegment::Match(EdgeMatcher::Named("b".to_owned())),
+                    SelectorSegment::Match(EdgeMatcher::Named("b".into())),
                 ]
                 .into(),
             ),
@@ -1089,14 +1089,14 @@ fn automatic_node_parent_assignment() {
                     [SelectorSegment::Match(EdgeLabel::Main.into())].into(),
                     [
                         SelectorSegment::Match(EdgeLabel::Main.into()),
-                        SelectorSegment::Match(EdgeMatcher::Named("a".to_owned())),
+                        SelectorSegment::Match(EdgeMatcher::Named("a".into())),
                     ]
                     .into(),
-                    [SelectorSegment::Match(EdgeMatcher::Named("a".to_owned()))].into(),
+                    [SelectorSegment::Match(EdgeMatcher::Named("a".into()))].into(),
                     [
-                        SelectorSegment::Match(EdgeMatcher::Named("a".to_owned())),
+                        SelectorSegment::Match(EdgeMatcher::Named("a".into())),
                         SelectorSegment::Match(EdgeLabel::Deref.into()),
-                        SelectorSegment::Match(EdgeMatcher::Named("a".to_owned())),
+                        SelectorSegment::Match(EdgeMatcher::Named("a".into())),
                     ]
                     .into(),
                 ])]
@@ -1251,7 +1251,7 @@ fn select_origin_override() {
             properties: vec![StyleClause {
                 key: Property(Attribute("value".to_owned())),
                 value: Expression::Select(
-                    LimitedSelector::from_path([EdgeLabel::Named("a".to_owned(), 0).into()])
+                    LimitedSelector::from_path([EdgeLabel::Named("a".into(), 0).into()])
                         .with_origin(Expression::Variable("--root".to_owned()))
                         .into(),
                 ),
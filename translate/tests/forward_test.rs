@@ -4,8 +4,8 @@ mod test_vis;
 
 use aili_style::selectable::Selectable;
 use aili_translate::{
-    forward::{VisTreeWriter, VisTreeWriterWarning},
-    property::{DisplayMode, FragmentKey, PropertyMap},
+    forward::{VisTreeWriter, VisTreeWriterStatistics, VisTreeWriterWarning},
+    property::{DisplayMode, EntityPropertyMapping, FragmentKey, PropertyMap},
 };
 use std::collections::HashMap;
 use test_vis::*;
@@ -154,6 +154,56 @@ fn update_element_attributes() {
     );
 }
 
+#[test]
+fn statistics_count_modifications() {
+    let mut renderer = VisTreeWriter::new(TestVisTree::default());
+    let attributes = HashMap::from_iter([
+        ("hello".to_owned(), "world".to_owned()),
+        ("a".to_owned(), "b".to_owned()),
+    ]);
+    let updated_attributes = HashMap::from_iter([("a".to_owned(), "c".to_owned())]);
+    renderer.update_root(Some(Selectable::node(0)));
+    renderer.update(mapping![
+        0 => {
+            display: Some(DisplayMode::ElementTag("cell".to_owned())),
+            attributes: attributes.clone(),
+        },
+        1 => { display: Some(DisplayMode::Connector), target: Some(Selectable::node(0)) },
+    ]);
+    assert_eq!(
+        renderer.take_statistics(),
+        VisTreeWriterStatistics {
+            elements_created: 1,
+            connectors_created: 1,
+            attributes_set: 2,
+            relations_updated: 3,
+            root_updates: 2,
+            ..Default::default()
+        }
+    );
+    renderer.update(mapping![
+        0 => {
+            display: Some(DisplayMode::ElementTag("cell".to_owned())),
+            attributes: updated_attributes,
+        },
+    ]);
+    // One attribute is updated and one is removed
+    let statistics = renderer.take_statistics();
+    assert_eq!(
+        statistics,
+        VisTreeWriterStatistics {
+            renderings_removed: 1,
+            attributes_set: 2,
+            ..Default::default()
+        }
+    );
+    assert_eq!(statistics.operations(), 3);
+    assert_eq!(
+        renderer.take_statistics(),
+        VisTreeWriterStatistics::default()
+    );
+}
+
 #[test]
 fn create_element_with_parent() {
     let mut renderer = VisTreeWriter::new(TestVisTree::default());
@@ -560,3 +610,74 @@ fn create_loop_in_vis_tree() {
     drop(renderer);
     assert!(warning_was_emited);
 }
+
+#[test]
+fn resolve_loop_in_vis_tree_when_it_is_broken() {
+    let mut renderer = VisTreeWriter::new(TestVisTree::default());
+    renderer.update(mapping![
+        0 => {
+            display: Some(DisplayMode::ElementTag("cell".to_owned())),
+            parent: Some(Selectable::node(1)),
+        },
+        1 => {
+            display: Some(DisplayMode::ElementTag("cell".to_owned())),
+            parent: Some(Selectable::node(0)),
+        },
+    ]);
+    renderer.update(mapping![
+        0 => {
+            display: Some(DisplayMode::ElementTag("cell".to_owned())),
+            parent: Some(Selectable::node(1)),
+        },
+        1 => { display: Some(DisplayMode::ElementTag("cell".to_owned())) },
+    ]);
+    let vis_tree = renderer.reclaim_vis_tree();
+    expect_one_parent_and_child(&vis_tree);
+}
+
+/// Mapping of three elements in a chain, with attributes.
+fn chain_mapping(top_attribute: &str) -> EntityPropertyMapping<usize> {
+    mapping![
+        0 => {
+            display: Some(DisplayMode::ElementTag("cell".to_owned())),
+            attributes: [("a".to_owned(), top_attribute.to_owned())].into(),
+        },
+        1 => {
+            display: Some(DisplayMode::ElementTag("cell".to_owned())),
+            attributes: [("a".to_owned(), "1".to_owned())].into(),
+            parent: Some(Selectable::node(0)),
+        },
+        2 => {
+            display: Some(DisplayMode::ElementTag("cell".to_owned())),
+            attributes: [("a".to_owned(), "2".to_owned())].into(),
+            parent: Some(Selectable::node(1)),
+        },
+    ]
+}
+
+#[test]
+fn unchanged_entities_are_not_forwarded() {
+    let mut renderer = VisTreeWriter::new(TestVisTree::default());
+    renderer.update(chain_mapping("0"));
+    let initial_writes = renderer.reclaim_vis_tree().element_writes;
+
+    let mut renderer = VisTreeWriter::new(TestVisTree::default());
+    renderer.update(chain_mapping("0"));
+    renderer.update(chain_mapping("0"));
+    assert_eq!(renderer.reclaim_vis_tree().element_writes, initial_writes);
+}
+
+#[test]
+fn only_changed_attributes_are_forwarded() {
+    let mut renderer = VisTreeWriter::new(TestVisTree::default());
+    renderer.update(chain_mapping("0"));
+    let initial_writes = renderer.reclaim_vis_tree().element_writes;
+
+    let mut renderer = VisTreeWriter::new(TestVisTree::default());
+    renderer.update(chain_mapping("0"));
+    renderer.update(chain_mapping("changed"));
+    let vis_tree = renderer.reclaim_vis_tree();
+    assert_eq!(vis_tree.element_writes, initial_writes + 1);
+    let top = vis_tree.expect_find_element(|e| e.parent_index.is_none());
+    assert_eq!(vis_tree.elements[top].attributes["a"], "changed");
+}
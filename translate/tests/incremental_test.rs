@@ -0,0 +1,264 @@
+//! Tests for [`apply_stylesheet_incremental`].
+
+mod test_graph;
+
+use aili_model::state::{EdgeLabel, NodeValue, ProgramStateGraph, RootedProgramStateGraph};
+use aili_style::{
+    cascade::CascadeStyle,
+    stylesheet::{StyleKey::*, expression::*, selector::*, *},
+};
+use aili_translate::{
+    cascade::{
+        ApplyStylesheetCache, apply_stylesheet, apply_stylesheet_incremental,
+        apply_stylesheet_with_statistics,
+    },
+    property::PropertyKey::{self, *},
+};
+use std::{cell::Cell, collections::HashSet};
+use test_graph::TestGraph;
+
+/// Stylesheet that exercises variables, conditions,
+/// and expressions that look at other nodes.
+fn test_stylesheet() -> CascadeStyle<PropertyKey> {
+    // .many(*) "a" {
+    //   display: cell;
+    //   --v: @;
+    //   value: @ + 1;
+    // }
+    //
+    // .many(*) [] {
+    //   display: cell;
+    //   title: --v;
+    // }
+    //
+    // .many(*) .if(@("a") + 0) {
+    //   next: @("a") + 1;
+    // }
+    //
+    // :: main .many(next) {
+    //   display: kvt;
+    // }
+    CascadeStyle::from(Stylesheet(vec![
+        StyleRule {
+            selector: Selector::from_path(
+                [
+                    SelectorSegment::anything_any_number_of_times(),
+                    SelectorSegment::Match(EdgeMatcher::Named("a".into())),
+                ]
+                .into(),
+            ),
+            properties: vec![
+                StyleClause {
+                    key: Property(Display),
+                    value: Expression::String("cell".to_owned()),
+                },
+                StyleClause {
+                    key: Variable("--v".to_owned()),
+                    value: Expression::Select(LimitedSelector::default().into()),
+                },
+                StyleClause {
+                    key: Property(Attribute("value".to_owned())),
+                    value: Expression::BinaryOperator(
+                        Expression::Select(LimitedSelector::default().into()).into(),
+                        BinaryOperator::Plus,
+                        Expression::Int(1).into(),
+                    ),
+                },
+            ],
+        },
+        StyleRule {
+            selector: Selector::from_path(
+                [
+                    SelectorSegment::anything_any_number_of_times(),
+                    SelectorSegment::Match(EdgeMatcher::AnyIndex),
+                ]
+                .into(),
+            ),
+            properties: vec![
+                StyleClause {
+                    key: Property(Display),
+                    value: Expression::String("cell".to_owned()),
+                },
+                StyleClause {
+                    key: Property(Attribute("title".to_owned())),
+                    value: Expression::Variable("--v".to_owned()),
+                },
+            ],
+        },
+        StyleRule {
+            selector: Selector::from_path(
+                [
+                    SelectorSegment::anything_any_number_of_times(),
+                    SelectorSegment::Condition(successor_value_plus(0)),
+                ]
+                .into(),
+            ),
+            properties: vec![StyleClause {
+                key: Property(Attribute("next".to_owned())),
+                value: successor_value_plus(1),
+            }],
+        },
+        StyleRule {
+            selector: Selector::from_path(
+                [
+                    SelectorSegment::Match(EdgeLabel::Main.into()),
+                    SelectorSegment::AnyNumberOfTimes(
+                        [SelectorSegment::Match(EdgeLabel::Next.into())].into(),
+                    ),
+                ]
+                .into(),
+            ),
+            properties: vec![StyleClause {
+                key: Property(Display),
+                value: Expression::String("kvt".to_owned()),
+            }],
+        },
+    ]))
+}
+
+/// Shorthand for `@("a") + addend`.
+fn successor_value_plus(addend: u64) -> Expression {
+    Expression::BinaryOperator(
+        Expression::Select(
+            LimitedSelector::from_path([EdgeLabel::Named("a".into(), 0).into()]).into(),
+        )
+        .into(),
+        BinaryOperator::Plus,
+        Expression::Int(addend).into(),
+    )
+}
+
+/// Applies the test stylesheet incrementally, then checks
+/// that the result matches a full application.
+fn assert_incremental_matches_full(
+    graph: &TestGraph,
+    cache: &mut ApplyStylesheetCache<usize>,
+    changed_nodes: impl IntoIterator<Item = usize>,
+) {
+    let stylesheet = test_stylesheet();
+    let changed_nodes = HashSet::from_iter(changed_nodes);
+    let resolved = apply_stylesheet_incremental(&stylesheet, graph, cache, &changed_nodes);
+    assert_eq!(resolved, apply_stylesheet(&stylesheet, graph));
+}
+
+#[test]
+fn incremental_application_without_cache() {
+    let graph = TestGraph::default_graph();
+    let mut cache = ApplyStylesheetCache::new();
+    assert_incremental_matches_full(&graph, &mut cache, []);
+    assert!(!cache.is_empty());
+}
+
+#[test]
+fn incremental_application_without_changes() {
+    let graph = TestGraph::default_graph();
+    let mut cache = ApplyStylesheetCache::new();
+    assert_incremental_matches_full(&graph, &mut cache, []);
+    assert_incremental_matches_full(&graph, &mut cache, []);
+    assert_incremental_matches_full(&graph, &mut cache, []);
+}
+
+#[test]
+fn incremental_application_after_value_change() {
+    let mut graph = TestGraph::default_graph();
+    let mut cache = ApplyStylesheetCache::new();
+    assert_incremental_matches_full(&graph, &mut cache, []);
+    graph.set_value(6, Some(NodeValue::Uint(100)));
+    assert_incremental_matches_full(&graph, &mut cache, [6]);
+    graph.set_value(5, None);
+    assert_incremental_matches_full(&graph, &mut cache, [5]);
+}
+
+#[test]
+fn incremental_application_after_edge_change() {
+    let mut graph = TestGraph::default_graph();
+    let mut cache = ApplyStylesheetCache::new();
+    assert_incremental_matches_full(&graph, &mut cache, []);
+    // Remove an edge
+    graph.set_successor(11, EdgeLabel::Index(1), None);
+    assert_incremental_matches_full(&graph, &mut cache, [11]);
+    // Add an edge
+    graph.set_successor(9, EdgeLabel::Named("a".into(), 0), Some(6));
+    assert_incremental_matches_full(&graph, &mut cache, [9]);
+    // Redirect an edge
+    graph.set_successor(4, EdgeLabel::Result, Some(8));
+    assert_incremental_matches_full(&graph, &mut cache, [4]);
+}
+
+#[test]
+fn incremental_application_after_multiple_changes() {
+    let mut graph = TestGraph::default_graph();
+    let mut cache = ApplyStylesheetCache::new();
+    assert_incremental_matches_full(&graph, &mut cache, []);
+    graph.set_value(12, Some(NodeValue::Uint(5)));
+    graph.set_successor(2, EdgeLabel::Named("a".into(), 0), Some(12));
+    graph.set_successor(3, EdgeLabel::Next, None);
+    assert_incremental_matches_full(&graph, &mut cache, [2, 3, 12]);
+}
+
+#[test]
+fn incremental_application_after_cache_is_cleared() {
+    let mut graph = TestGraph::default_graph();
+    let mut cache = ApplyStylesheetCache::new();
+    assert_incremental_matches_full(&graph, &mut cache, []);
+    // Changes are not reported, but the cache is discarded
+    graph.set_value(6, Some(NodeValue::Uint(100)));
+    cache.clear();
+    assert!(cache.is_empty());
+    assert_incremental_matches_full(&graph, &mut cache, []);
+}
+
+#[test]
+fn statistics_count_replayed_visits() {
+    let stylesheet = test_stylesheet();
+    let graph = TestGraph::default_graph();
+    let mut cache = ApplyStylesheetCache::new();
+    apply_stylesheet_incremental(&stylesheet, &graph, &mut cache, &HashSet::new());
+    let (_, full_statistics) = apply_stylesheet_with_statistics(&stylesheet, &graph);
+    assert_eq!(*cache.statistics(), full_statistics);
+    assert!(full_statistics.nodes_visited > 0);
+    assert!(full_statistics.expressions_evaluated > 0);
+    assert_eq!(full_statistics.visits_replayed, 0);
+    apply_stylesheet_incremental(&stylesheet, &graph, &mut cache, &HashSet::new());
+    let statistics = cache.statistics();
+    // Nothing has changed, so the whole traversal is replayed
+    assert_eq!(statistics.nodes_visited, 0);
+    assert_eq!(statistics.visits_replayed, full_statistics.nodes_visited);
+    assert_eq!(statistics.expressions_evaluated, 0);
+}
+
+#[test]
+fn unchanged_nodes_are_not_resolved_again() {
+    let stylesheet = test_stylesheet();
+    let mut graph = CountingGraph(TestGraph::default_graph(), Cell::new(0));
+    let mut cache = ApplyStylesheetCache::new();
+    apply_stylesheet_incremental(&stylesheet, &graph, &mut cache, &HashSet::new());
+    let full_access_count = graph.1.replace(0);
+    apply_stylesheet_incremental(&stylesheet, &graph, &mut cache, &HashSet::new());
+    let cached_access_count = graph.1.replace(0);
+    // Only the final construction of the mapping should need to access the graph
+    assert!(cached_access_count < full_access_count);
+    // Changing one node should not require the whole graph to be resolved
+    graph.0.set_value(9, Some(NodeValue::Uint(1)));
+    apply_stylesheet_incremental(&stylesheet, &graph, &mut cache, &HashSet::from([9]));
+    let partial_access_count = graph.1.replace(0);
+    assert!(partial_access_count < full_access_count);
+}
+
+/// [`TestGraph`] that counts how many times its nodes have been accessed.
+struct CountingGraph(TestGraph, Cell<usize>);
+
+impl ProgramStateGraph for CountingGraph {
+    type NodeId = usize;
+    type NodeRef<'a> = <TestGraph as ProgramStateGraph>::NodeRef<'a>;
+    fn get(&self, id: &Self::NodeId) -> Option<Self::NodeRef<'_>> {
+        self.1.set(self.1.get() + 1);
+        self.0.get(id)
+    }
+}
+
+impl RootedProgramStateGraph for CountingGraph {
+    fn root(&self) -> Self::NodeId {
+        self.0.root()
+    }
+}
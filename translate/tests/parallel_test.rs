@@ -0,0 +1,146 @@
+//! Tests for [`apply_stylesheet_parallel`].
+
+#![cfg(feature = "parallel")]
+
+mod test_graph;
+
+use aili_model::state::EdgeLabel;
+use aili_style::{
+    cascade::CascadeStyle,
+    stylesheet::{StyleKey::*, expression::*, selector::*, *},
+};
+use aili_translate::{
+    cascade::{ParallelOptions, apply_stylesheet, apply_stylesheet_parallel},
+    property::PropertyKey::{self, *},
+};
+use std::num::NonZeroUsize;
+use test_graph::TestGraph;
+
+/// Stylesheet that exercises variables and precedence of rules.
+fn test_stylesheet() -> CascadeStyle<PropertyKey> {
+    // .many(*) "a" {
+    //   display: cell;
+    //   --v: @;
+    //   value: @ + 1;
+    // }
+    //
+    // .many(*) [] {
+    //   display: text;
+    //   title: --v;
+    // }
+    //
+    // :: main .many(next) {
+    //   display: kvt;
+    // }
+    CascadeStyle::from(Stylesheet(vec![
+        StyleRule {
+            selector: Selector::from_path(
+                [
+                    SelectorSegment::anything_any_number_of_times(),
+                    SelectorSegment::Match(EdgeMatcher::Named("a".into())),
+                ]
+                .into(),
+            ),
+            properties: vec![
+                StyleClause {
+                    key: Property(Display),
+                    value: Expression::String("cell".to_owned()),
+                },
+                StyleClause {
+                    key: Variable("--v".to_owned()),
+                    value: Expression::Select(LimitedSelector::default().into()),
+                },
+                StyleClause {
+                    key: Property(Attribute("value".to_owned())),
+                    value: Expression::BinaryOperator(
+                        Expression::Select(LimitedSelector::default().into()).into(),
+                        BinaryOperator::Plus,
+                        Expression::Int(1).into(),
+                    ),
+                },
+            ],
+        },
+        StyleRule {
+            selector: Selector::from_path(
+                [
+                    SelectorSegment::anything_any_number_of_times(),
+                    SelectorSegment::Match(EdgeMatcher::AnyIndex),
+                ]
+                .into(),
+            ),
+            properties: vec![
+                StyleClause {
+                    key: Property(Display),
+                    value: Expression::String("text".to_owned()),
+                },
+                StyleClause {
+                    key: Property(Attribute("title".to_owned())),
+                    value: Expression::Variable("--v".to_owned()),
+                },
+            ],
+        },
+        StyleRule {
+            selector: Selector::from_path(
+                [
+                    SelectorSegment::Match(EdgeLabel::Main.into()),
+                    SelectorSegment::AnyNumberOfTimes(
+                        [SelectorSegment::Match(EdgeLabel::Next.into())].into(),
+                    ),
+                ]
+                .into(),
+            ),
+            properties: vec![StyleClause {
+                key: Property(Display),
+                value: Expression::String("kvt".to_owned()),
+            }],
+        },
+    ]))
+}
+
+/// Options that fork at every node, so the smallest graphs
+/// are traversed concurrently.
+fn eager_options(threads: usize) -> ParallelOptions {
+    ParallelOptions {
+        threads: NonZeroUsize::new(threads).unwrap(),
+        min_fan_out: 2,
+    }
+}
+
+/// Applies the test stylesheet in parallel, then checks
+/// that the result matches a sequential application.
+fn assert_parallel_matches_sequential(graph: &TestGraph, options: &ParallelOptions) {
+    let stylesheet = test_stylesheet();
+    let resolved = apply_stylesheet_parallel(&stylesheet, graph, options);
+    assert_eq!(resolved, apply_stylesheet(&stylesheet, graph));
+}
+
+#[test]
+fn parallel_application_with_one_thread() {
+    let graph = TestGraph::default_graph();
+    assert_parallel_matches_sequential(&graph, &eager_options(1));
+}
+
+#[test]
+fn parallel_application_with_default_options() {
+    let graph = TestGraph::default_graph();
+    assert_parallel_matches_sequential(&graph, &ParallelOptions::default());
+}
+
+#[test]
+fn parallel_application_with_many_threads() {
+    let graph = TestGraph::default_graph();
+    assert_parallel_matches_sequential(&graph, &eager_options(8));
+}
+
+#[test]
+fn parallel_application_over_shared_nodes() {
+    // Many edges of the root lead to the same nodes,
+    // so concurrently traversed subtrees match the same nodes
+    let mut graph = TestGraph::default_graph();
+    for i in 0..40 {
+        graph.set_successor(0, EdgeLabel::Index(i), Some(1 + i % 13));
+    }
+    for threads in [2, 3, 8] {
+        assert_parallel_matches_sequential(&graph, &eager_options(threads));
+    }
+}
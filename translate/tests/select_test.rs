@@ -136,7 +136,7 @@ fn select_named_anywhere() {
     let style = construct_style(Selector::from_path(
         [
             SelectorSegment::anything_any_number_of_times(),
-            SelectorSegment::Match(EdgeMatcher::Named("a".to_owned())),
+            SelectorSegment::Match(EdgeMatcher::Named("a".into())),
         ]
         .into(),
     ));
@@ -150,8 +150,8 @@ fn select_named_successor_of_named_anywhere() {
     let style = construct_style(Selector::from_path(
         [
             SelectorSegment::anything_any_number_of_times(),
-            SelectorSegment::Match(EdgeMatcher::Named("a".to_owned())),
-            SelectorSegment::Match(EdgeMatcher::Named("a".to_owned())),
+            SelectorSegment::Match(EdgeMatcher::Named("a".into())),
+            SelectorSegment::Match(EdgeMatcher::Named("a".into())),
         ]
         .into(),
     ));
@@ -164,8 +164,8 @@ fn select_dereference_anywhere_after_double_named() {
     // "a" "a" iter(*) deref
     let style = construct_style(Selector::from_path(
         [
-            SelectorSegment::Match(EdgeMatcher::Named("a".to_owned())),
-            SelectorSegment::Match(EdgeMatcher::Named("a".to_owned())),
+            SelectorSegment::Match(EdgeMatcher::Named("a".into())),
+            SelectorSegment::Match(EdgeMatcher::Named("a".into())),
             SelectorSegment::anything_any_number_of_times(),
             SelectorSegment::Match(EdgeLabel::Deref.into()),
         ]
@@ -199,7 +199,7 @@ fn select_next_frame_or_named() {
             SelectorSegment::AnyNumberOfTimes(
                 [SelectorSegment::Branch(vec![
                     [SelectorSegment::Match(EdgeLabel::Next.into())].into(),
-                    [SelectorSegment::Match(EdgeMatcher::Named("a".to_owned()))].into(),
+                    [SelectorSegment::Match(EdgeMatcher::Named("a".into()))].into(),
                 ])]
                 .into(),
             ),
@@ -31,25 +31,21 @@ impl TestGraph {
         use EdgeLabel::*;
         Self(vec![
             /* 0 */
-            TestNode([(Main, 1), (Named("a".to_owned(), 0), 5)].into(), None),
+            TestNode([(Main, 1), (Named("a".into(), 0), 5)].into(), None),
             /* 1 */
-            TestNode([(Next, 2), (Named("a".to_owned(), 0), 10)].into(), None),
+            TestNode([(Next, 2), (Named("a".into(), 0), 10)].into(), None),
             /* 2 */ TestNode([(Next, 3)].into(), None),
             /* 3 */
-            TestNode([(Next, 4), (Named("a".to_owned(), 0), 7)].into(), None),
+            TestNode([(Next, 4), (Named("a".into(), 0), 7)].into(), None),
             /* 4 */ TestNode([(Result, 13)].into(), None),
             /* 5 */
             TestNode(
-                [(Named("a".to_owned(), 0), 6), (Index(0), 8), (Deref, 10)].into(),
+                [(Named("a".into(), 0), 6), (Index(0), 8), (Deref, 10)].into(),
                 Some(Self::NUMERIC_NODE_VALUE.into()),
             ),
             /* 6 */
             TestNode(
-                [
-                    (Named("a".to_owned(), 0), 11),
-                    (Named("b".to_owned(), 0), 7),
-                ]
-                .into(),
+                [(Named("a".into(), 0), 11), (Named("b".into(), 0), 7)].into(),
                 Some(3u64.into()),
             ),
             /* 7 */ TestNode([(Deref, 5)].into(), None),
@@ -57,11 +53,7 @@ impl TestGraph {
             /* 9 */ TestNode([].into(), None),
             /* 10 */
             TestNode(
-                [
-                    (Named("a".to_owned(), 0), 11),
-                    (Named("a".to_owned(), 1), 12),
-                ]
-                .into(),
+                [(Named("a".into(), 0), 11), (Named("a".into(), 1), 12)].into(),
                 None,
             ),
             /* 11 */ TestNode([(Index(0), 13), (Index(1), 12)].into(), None),
@@ -74,6 +66,22 @@ impl TestGraph {
     /// [`numeric_node_selector`](TestGraph::numeric_node_selector)
     /// in the [`default_graph`](TestGraph::default_graph)
     pub const NUMERIC_NODE_VALUE: u64 = 37;
+
+    /// Replaces the value of a node.
+    #[allow(dead_code, reason = "Not all tests modify the graph")]
+    pub fn set_value(&mut self, id: usize, value: Option<NodeValue>) {
+        self.0[id].1 = value;
+    }
+
+    /// Inserts, replaces, or removes an outgoing edge of a node.
+    #[allow(dead_code, reason = "Not all tests modify the graph")]
+    pub fn set_successor(&mut self, id: usize, edge: EdgeLabel, successor: Option<usize>) {
+        if let Some(successor) = successor {
+            self.0[id].0.insert(edge, successor);
+        } else {
+            self.0[id].0.remove(&edge);
+        }
+    }
 }
 
 impl ProgramStateGraph for TestGraph {
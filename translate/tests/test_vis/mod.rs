@@ -8,6 +8,8 @@ pub struct TestVisTree {
     pub elements: Vec<TestVisElement>,
     pub connectors: Vec<TestVisConnector>,
     pub root_index: Option<usize>,
+    /// Number of times an attribute or the parent of an element has been set.
+    pub element_writes: usize,
 }
 
 #[derive(PartialEq, Eq, Debug, Default)]
@@ -77,6 +79,7 @@ impl AttributeMap for TestVisElementRef<'_> {
     }
 
     fn set_attribute(&mut self, name: &str, value: Option<&str>) {
+        self.0.element_writes += 1;
         if let Some(value) = value {
             self.element_mut()
                 .attributes
@@ -91,6 +94,7 @@ impl VisElement for TestVisElementRef<'_> {
     type Handle = usize;
 
     fn insert_into(&mut self, parent: Option<&Self::Handle>) -> Result<(), ParentAssignmentError> {
+        self.0.element_writes += 1;
         if parent.is_some_and(|p| self.0.is_ancestor_of(self.1, *p)) {
             Err(ParentAssignmentError::StructureViolation)
         } else {
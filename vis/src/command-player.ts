@@ -0,0 +1,217 @@
+/**
+ * Replays batched modifications of the visualization tree.
+ *
+ * @module
+ */
+
+import { Hook, Hookable } from 'aili-hooligan';
+import { batchVisTreeUpdates, VisConnector, VisElement, VisPin } from './tree';
+import { AttributeMap } from './attributes';
+
+/**
+ * Opcodes of commands accepted by {@link VisTreeCommandPlayer.applyCommands}.
+ */
+export enum VisTreeCommand {
+    /**
+     * Creates a new element. Operands: id, tag name.
+     */
+    CREATE_ELEMENT = 0,
+    /**
+     * Creates a new connector. Operands: id.
+     */
+    CREATE_CONNECTOR = 1,
+    /**
+     * Updates an attribute value. Operands: id, part, attribute name, value.
+     */
+    SET_ATTRIBUTE = 2,
+    /**
+     * Updates the parent of an element. Operands: id, parent id.
+     */
+    SET_PARENT = 3,
+    /**
+     * Updates the target of a connector pin. Operands: connector id, part, target id.
+     */
+    ATTACH_PIN = 4,
+    /**
+     * Updates the root element. Operands: id.
+     */
+    SET_ROOT = 5,
+    /**
+     * Discards an identifier that will not be used anymore. Operands: id.
+     */
+    RELEASE = 6,
+}
+
+/**
+ * Parts of an entity that have attributes, as encoded
+ * in {@link VisTreeCommand.SET_ATTRIBUTE} and {@link VisTreeCommand.ATTACH_PIN}.
+ */
+export enum VisTreeCommandPart {
+    /**
+     * The element or connector itself.
+     */
+    SELF = 0,
+    /**
+     * Start pin of a connector.
+     */
+    START = 1,
+    /**
+     * End pin of a connector.
+     */
+    END = 2,
+}
+
+/**
+ * Encoding of a missing operand, such as removed attribute value
+ * or a detached parent.
+ */
+export const NO_OPERAND = 0xffffffff;
+
+/**
+ * Container that receives the elements created by a {@link VisTreeCommandPlayer}.
+ */
+export interface VisTreeCommandTarget {
+    /**
+     * Constructs a new element.
+     *
+     * @param tagName Tag name of the element.
+     */
+    createElement(tagName: string): VisElement;
+    /**
+     * Constructs a new connector.
+     */
+    createConnector(): VisConnector;
+    /**
+     * Updates the root element of the tree.
+     */
+    set root(root: VisElement | undefined);
+}
+
+/**
+ * Applies batches of encoded modifications to a visualization tree.
+ *
+ * Each batch is applied with {@link batchVisTreeUpdates},
+ * so connector projections are only updated once per batch.
+ */
+export class VisTreeCommandPlayer {
+    /**
+     * Constructs a player that modifies a provided tree.
+     *
+     * @param target Container that creates elements and holds the root.
+     */
+    constructor(target: VisTreeCommandTarget) {
+        this.target = target;
+        this.entities = new Map();
+        this._onBatchApplied = new Hook();
+    }
+    /**
+     * Replays a batch of modifications.
+     *
+     * @param commands Encoded commands, see {@link VisTreeCommand}.
+     * @param strings String table referenced by the commands.
+     *
+     * @throws The commands are malformed or reference entities that do not exist.
+     */
+    applyCommands(commands: Uint32Array, strings: string[]): void {
+        batchVisTreeUpdates(() => {
+            let i = 0;
+            while (i < commands.length) {
+                i = this.applyCommand(commands, i, strings);
+            }
+        });
+        this._onBatchApplied.trigger();
+    }
+    /**
+     * Triggers after a batch of modifications has been applied.
+     *
+     * @event
+     */
+    get onBatchApplied(): Hookable<[]> {
+        return this._onBatchApplied;
+    }
+    /**
+     * Applies a single command.
+     *
+     * @param commands Encoded commands.
+     * @param i Index of the opcode of the command.
+     * @param strings String table referenced by the commands.
+     * @returns Index of the opcode of the next command.
+     */
+    private applyCommand(commands: Uint32Array, i: number, strings: string[]): number {
+        switch (commands[i]) {
+            case VisTreeCommand.CREATE_ELEMENT:
+                this.entities.set(
+                    commands[i + 1],
+                    this.target.createElement(strings[commands[i + 2]]),
+                );
+                return i + 3;
+            case VisTreeCommand.CREATE_CONNECTOR:
+                this.entities.set(commands[i + 1], this.target.createConnector());
+                return i + 2;
+            case VisTreeCommand.SET_ATTRIBUTE: {
+                const attributes = this.attributesOf(commands[i + 1], commands[i + 2]);
+                const value = commands[i + 4];
+                attributes[strings[commands[i + 3]]].value =
+                    value === NO_OPERAND ? undefined : strings[value];
+                return i + 5;
+            }
+            case VisTreeCommand.SET_PARENT:
+                this.element(commands[i + 1]).parent = this.optionalElement(commands[i + 2]);
+                return i + 3;
+            case VisTreeCommand.ATTACH_PIN:
+                this.pin(commands[i + 1], commands[i + 2]).target = this.optionalElement(
+                    commands[i + 3],
+                );
+                return i + 4;
+            case VisTreeCommand.SET_ROOT:
+                this.target.root = this.optionalElement(commands[i + 1]);
+                return i + 2;
+            case VisTreeCommand.RELEASE:
+                this.entities.delete(commands[i + 1]);
+                return i + 2;
+            default:
+                throw new Error(`Unknown vis tree command: ${commands[i]}`);
+        }
+    }
+    private attributesOf(id: number, part: number): AttributeMap {
+        if (part === VisTreeCommandPart.SELF) {
+            return this.entity(id).attributes;
+        } else {
+            return this.pin(id, part).attributes;
+        }
+    }
+    private pin(id: number, part: number): VisPin {
+        const connector = this.entity(id);
+        if (!(connector instanceof VisConnector)) {
+            throw new Error(`Vis tree entity ${id} is not a connector`);
+        }
+        switch (part) {
+            case VisTreeCommandPart.START:
+                return connector.start;
+            case VisTreeCommandPart.END:
+                return connector.end;
+            default:
+                throw new Error(`Unknown connector part: ${part}`);
+        }
+    }
+    private optionalElement(id: number): VisElement | undefined {
+        return id === NO_OPERAND ? undefined : this.element(id);
+    }
+    private element(id: number): VisElement {
+        const element = this.entity(id);
+        if (!(element instanceof VisElement)) {
+            throw new Error(`Vis tree entity ${id} is not an element`);
+        }
+        return element;
+    }
+    private entity(id: number): VisElement | VisConnector {
+        const entity = this.entities.get(id);
+        if (!entity) {
+            throw new Error(`Vis tree entity ${id} does not exist`);
+        }
+        return entity;
+    }
+    private readonly target: VisTreeCommandTarget;
+    private readonly entities: Map<number, VisElement | VisConnector>;
+    private readonly _onBatchApplied: Hook<[]>;
+}
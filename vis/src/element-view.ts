@@ -4,11 +4,13 @@
  * @module
  */
 
+import { Hook, Hookable, ObserverHandle } from 'aili-hooligan';
 import { ReadonlyVisElement, VisElement } from './tree';
 import { ViewModel, ViewLayoutMode } from './model';
-import { ElementViewSlot } from './slots';
+import { ElementViewSlot, ViewSlotPopulator } from './slots';
 import { ViewBase, ViewContainer } from './view-container';
 import { ContextFreeViewModelFactory } from './model-factory';
+import { PlaceholderViewModel, VisibilityTracker } from './virtualization';
 
 /**
  * Container that manages the {@link ElementView}s of individual {@link ReadonlyVisElement}s.
@@ -17,6 +19,9 @@ export class ElementViewContainer extends ViewContainer<ReadonlyVisElement, Elem
     /**
      * Constructs an empty view container.
      *
+     * If the factory's context provides a {@link ViewportContext.visibilityTracker},
+     * elements laid out inline are only rendered while they are visible.
+     *
      * @param modelFactory Factory for constructing view models for elements.
      */
     constructor(modelFactory: ContextFreeViewModelFactory) {
@@ -24,8 +29,15 @@ export class ElementViewContainer extends ViewContainer<ReadonlyVisElement, Elem
         this.modelFactory = modelFactory;
     }
     protected createNew(element: VisElement): ElementView {
-        const model = this.modelFactory.createViewModel(element);
-        return new ElementViewImpl(element, model);
+        const createModel = () => this.modelFactory.createViewModel(element);
+        const { ownerDocument, visibilityTracker } = this.modelFactory.context;
+        // Companions are laid out relative to their parents,
+        // so only inline elements can be replaced with placeholders
+        const layoutMode = this.modelFactory.getPreferredLayoutMode(element);
+        if (visibilityTracker && layoutMode === ViewLayoutMode.INLINE) {
+            return new ElementViewImpl(element, createModel, { ownerDocument, visibilityTracker });
+        }
+        return new ElementViewImpl(element, createModel);
     }
     private readonly modelFactory: ContextFreeViewModelFactory;
 }
@@ -81,6 +93,34 @@ export interface ElementView extends ViewBase {
      * the view in an explicit slot.
      */
     readonly hasExplicitEmbedding: boolean;
+    /**
+     * Whether the element is currently replaced by a placeholder
+     * because it is outside the visible area of the viewport.
+     *
+     * Children and connectors of a deferred element should not be rendered.
+     * If not provided, the view is never deferred.
+     */
+    readonly deferred?: boolean;
+    /**
+     * Triggers when {@link deferred} changes.
+     *
+     * @event
+     */
+    readonly onDeferredChanged?: Hookable<[]>;
+}
+
+/**
+ * Settings of an {@link ElementViewImpl} that may be replaced by a placeholder.
+ */
+interface ElementVirtualization {
+    /**
+     * Document that will own the placeholder's DOM.
+     */
+    ownerDocument: Document;
+    /**
+     * Tracker that determines whether the element should be rendered.
+     */
+    visibilityTracker: VisibilityTracker;
 }
 
 class ElementViewImpl implements ElementView {
@@ -88,13 +128,28 @@ class ElementViewImpl implements ElementView {
      * Constructs a view for a given element.
      *
      * @param element The element to be viewed.
-     * @param model View model that determines the rendering of the element.
-     *              The model will be owned by the view and will be destroyed
-     *              with it.
+     * @param createModel Function that creates the view model that determines
+     *                    the rendering of the element. The models will be owned
+     *                    by the view and will be destroyed with it.
+     * @param virtualization If specified, the element is rendered as a placeholder
+     *                       until it becomes visible and the model is only created then.
+     *                       The model is destroyed again when the element stops being visible.
      */
-    constructor(element: ReadonlyVisElement, model: ViewModel) {
+    constructor(
+        element: ReadonlyVisElement,
+        createModel: () => ViewModel,
+        virtualization?: ElementVirtualization,
+    ) {
         this.element = element;
-        this.model = model;
+        this.createModel = createModel;
+        this.virtualization = virtualization;
+        this._onDeferredChanged = new Hook();
+        if (virtualization) {
+            this._model = new PlaceholderViewModel(virtualization.ownerDocument);
+            this._deferred = true;
+        } else {
+            this._model = createModel();
+        }
     }
     useEmbedding(embedding: ViewEmbedding): void {
         const slotIsUpToDate = !!embedding.slot && embedding.slot === this.slot;
@@ -103,6 +158,12 @@ class ElementViewImpl implements ElementView {
             return;
         }
         this._hasExplicitEmbedding = !!embedding.slot;
+        if (this._hasExplicitEmbedding && this.virtualization) {
+            // Explicitly embedded elements are roots of the rendering,
+            // so they are always rendered in full
+            this.virtualization = undefined;
+            this.visibilityChanged(true);
+        }
         this.moveToSlot(
             embedding.slot ?? (embedding.parent ? this.getSlot(embedding.parent) : undefined),
         );
@@ -118,7 +179,72 @@ class ElementViewImpl implements ElementView {
         }
         this.slot?.destroy();
         this.slot = slot;
-        this.model.useSlot(slot?.populator);
+        this.renderModel();
+    }
+    /**
+     * Renders the current model into the current slot,
+     * tracking the visibility of the rendering if needed.
+     */
+    private renderModel(): void {
+        this.visibilityObserver?.unhook();
+        this.visibilityObserver = undefined;
+        this.renderedHtml = undefined;
+        const populator = this.slot?.populator;
+        if (!populator || !this.virtualization) {
+            this._model.useSlot(populator);
+            return;
+        }
+        const { visibilityTracker } = this.virtualization;
+        // Intercept the insertion so we know which content to track.
+        // Other members are inherited so that specialized populators keep working
+        const trackingPopulator: ViewSlotPopulator = Object.create(populator);
+        trackingPopulator.insertFlowHtml = html => {
+            populator.insertFlowHtml(html);
+            this.visibilityObserver?.unhook();
+            this.renderedHtml = html;
+            this.visibilityObserver = visibilityTracker.observe(html, visible =>
+                this.visibilityChanged(visible),
+            );
+        };
+        this._model.useSlot(trackingPopulator);
+    }
+    /**
+     * Switches between the placeholder and the actual model.
+     *
+     * @param visible Whether the element is now visible.
+     */
+    private visibilityChanged(visible: boolean): void {
+        if (visible !== this._deferred) {
+            return;
+        }
+        if (visible) {
+            this.replaceModel(this.createModel());
+            this._deferred = false;
+            this._onDeferredChanged.trigger();
+        } else {
+            // Keep the size so that the layout around the element does not shift
+            const bounds = this.renderedHtml?.getBoundingClientRect();
+            // Drop the children while the model that hosts them still exists
+            this._deferred = true;
+            this._onDeferredChanged.trigger();
+            this.replaceModel(
+                new PlaceholderViewModel(
+                    (this.virtualization as ElementVirtualization).ownerDocument,
+                    bounds && { width: bounds.width, height: bounds.height },
+                ),
+            );
+        }
+    }
+    /**
+     * Replaces the view model, keeping the slot.
+     *
+     * @param model The new view model.
+     */
+    private replaceModel(model: ViewModel): void {
+        this._model.useSlot(undefined);
+        this._model.destroy();
+        this._model = model;
+        this.renderModel();
     }
     /**
      * Cleans up after the view has expired.
@@ -130,29 +256,47 @@ class ElementViewImpl implements ElementView {
         // Slot switch handler should perform the necessary cleanup
         this.useEmbedding({});
         // Drop the view model, nobody else should own it
-        this.model.destroy();
+        this._model.destroy();
     }
     /**
      * Requests an inline or companion slot for an element
      * from its parent.
      *
+     * If the element is deferred, the slot is requested for the placeholder
+     * and reused by the actual model once the element becomes visible.
+     *
      * @param parentView View for the parent element.
      * @returns Slot provided by the parent element's model.
      */
     private getSlot(parentView: ElementView): ElementViewSlot {
-        const renderMode = this.model.preferredLayoutMode;
+        const renderMode = this._model.preferredLayoutMode;
         switch (renderMode) {
             case ViewLayoutMode.INLINE:
-                return parentView.model.createInlineSlot(this.element, this.model);
+                return parentView.model.createInlineSlot(this.element, this._model);
             case ViewLayoutMode.COMPANION:
                 return parentView.model.companionSlot;
         }
     }
+    get model(): ViewModel {
+        return this._model;
+    }
     get hasExplicitEmbedding(): boolean {
         return this._hasExplicitEmbedding;
     }
+    get deferred(): boolean {
+        return this._deferred;
+    }
+    get onDeferredChanged(): Hookable<[]> {
+        return this._onDeferredChanged;
+    }
     readonly element: ReadonlyVisElement;
-    readonly model: ViewModel;
+    private readonly createModel: () => ViewModel;
+    private readonly _onDeferredChanged: Hook<[]>;
+    private virtualization: ElementVirtualization | undefined;
+    private _model: ViewModel;
     private slot?: ElementViewSlot;
+    private renderedHtml: HTMLElement | undefined;
+    private visibilityObserver: ObserverHandle | undefined;
     private _hasExplicitEmbedding: boolean = false;
+    private _deferred: boolean = false;
 }
@@ -5,6 +5,8 @@
 
 export * as binds from './attribute-binds';
 export * from './attributes';
+export * from './command-player';
+export * from './layout-scheduler';
 export * from './model-factory';
 export * from './model';
 export * from './models';
@@ -12,3 +14,4 @@ export * from './slots';
 export * from './tree';
 export * from './viewport';
 export * from './viewport-dom';
+export * from './virtualization';
@@ -0,0 +1,135 @@
+/**
+ * Coalescing of layout recalculations.
+ *
+ * @module
+ */
+
+import { Hook, Hookable } from 'aili-hooligan';
+
+/**
+ * View model component whose layout is calculated by script
+ * and can be scheduled by a {@link LayoutScheduler}.
+ */
+export interface ScheduledLayout {
+    /**
+     * Recalculates the layout and updates the DOM according to it.
+     *
+     * @returns Promise that resolves when the layout has been fully updated.
+     */
+    updateLayoutNow(): Promise<void>;
+    /**
+     * Whether {@link updateLayoutNow} may be called again before
+     * the previous call has finished, cancelling the previous call.
+     *
+     * If not set, the scheduler waits for the previous call to finish.
+     */
+    readonly cancelsPendingLayout?: boolean;
+}
+
+/**
+ * Function that schedules a callback to run before the next repaint.
+ */
+export type FrameRequestFunction = (callback: () => void) => void;
+
+/**
+ * Collects layout update requests and dispatches them
+ * at most once per layout per animation frame.
+ *
+ * Visualization tree modifications, including whole replayed command batches,
+ * are applied synchronously, so all requests made while they are processed
+ * are coalesced into a single frame.
+ * A layout whose previous recalculation has not finished yet
+ * is deferred to the frame after it finishes,
+ * unless the new recalculation can cancel the previous one.
+ */
+export class LayoutScheduler {
+    /**
+     * Constructs a scheduler with no pending layouts.
+     *
+     * @param requestFrame Function that schedules the dispatch.
+     *                     Defaults to `requestAnimationFrame`.
+     */
+    constructor(requestFrame?: FrameRequestFunction) {
+        this.requestFrame = requestFrame ?? (callback => requestAnimationFrame(callback));
+        this.dirty = new Set();
+        this.running = new Map();
+        this._onLayoutsUpdated = new Hook();
+    }
+    /**
+     * Marks a layout as outdated, scheduling its recalculation
+     * on the next animation frame.
+     *
+     * @param layout The layout that should be recalculated.
+     */
+    markDirty(layout: ScheduledLayout): void {
+        this.dirty.add(layout);
+        this.scheduleFrame();
+    }
+    /**
+     * Discards a pending recalculation of a layout.
+     * This should be called when the layout is destroyed.
+     *
+     * @param layout The layout that should not be recalculated anymore.
+     */
+    cancel(layout: ScheduledLayout): void {
+        this.dirty.delete(layout);
+    }
+    /**
+     * Triggers after all layouts recalculated in a frame have been updated.
+     *
+     * @event
+     */
+    get onLayoutsUpdated(): Hookable<[]> {
+        return this._onLayoutsUpdated;
+    }
+    private scheduleFrame(): void {
+        // If a dispatch is already scheduled, let it also pick up new requests
+        if (this.frameRequested) {
+            return;
+        }
+        this.frameRequested = true;
+        this.requestFrame(() => this.dispatch());
+    }
+    private async dispatch(): Promise<void> {
+        this.frameRequested = false;
+        // Layouts that are still being recalculated stay dirty until the next frame
+        const layouts = [...this.dirty].filter(
+            layout => layout.cancelsPendingLayout || !this.running.has(layout),
+        );
+        if (layouts.length === 0) {
+            return;
+        }
+        for (const layout of layouts) {
+            this.dirty.delete(layout);
+            this.running.set(layout, (this.running.get(layout) ?? 0) + 1);
+        }
+        // One failed layout should not hold back the others
+        await Promise.allSettled(
+            layouts.map(async layout => {
+                try {
+                    await layout.updateLayoutNow();
+                } finally {
+                    const count = (this.running.get(layout) ?? 1) - 1;
+                    if (count > 0) {
+                        this.running.set(layout, count);
+                    } else {
+                        this.running.delete(layout);
+                    }
+                }
+            }),
+        );
+        this._onLayoutsUpdated.trigger();
+        // Requests made during the recalculation, including deferred ones
+        if (this.dirty.size > 0) {
+            this.scheduleFrame();
+        }
+    }
+    private readonly requestFrame: FrameRequestFunction;
+    private readonly dirty: Set<ScheduledLayout>;
+    /**
+     * Numbers of recalculations in progress for each layout.
+     */
+    private readonly running: Map<ScheduledLayout, number>;
+    private readonly _onLayoutsUpdated: Hook<[]>;
+    private frameRequested: boolean = false;
+}
@@ -4,20 +4,25 @@
  * @module
  */
 
-import { ViewModel } from './model';
+import { ViewLayoutMode, ViewModel } from './model';
 import { ReadonlyVisElement } from './tree';
 import { ViewportContext } from './viewport-dom';
 
 /**
  * Constructor for {@link ViewModel} that can be used with a {@link ContextFreeViewModelFactory}.
  *
+ * The constructor may also provide the {@link ViewModel.preferredLayoutMode}
+ * of its models as a static property, so that it is known before a model is constructed.
+ * Only elements whose models declare {@link ViewLayoutMode.INLINE} this way
+ * can be replaced by placeholders in virtualized viewports.
+ *
  * @param element Element that should be modeled.
  * @param context Context for constructing visuals.
  */
-export type ViewModelConstructor = new (
+export type ViewModelConstructor = (new (
     element: ReadonlyVisElement,
     context: ViewportContext,
-) => ViewModel;
+) => ViewModel) & { readonly preferredLayoutMode?: ViewLayoutMode };
 
 /**
  * Factory that provides {@link ViewModel}s for {@link ReadonlyVisElement}s
@@ -53,9 +58,23 @@ export class ViewModelFactory {
      * @returns New view model for `element`.
      */
     createViewModel(element: ReadonlyVisElement, context: ViewportContext): ViewModel {
-        const constructor = this.models.get(element.tagName) ?? this.fallback;
+        const constructor = this.getConstructor(element);
         return new constructor(element, context);
     }
+    /**
+     * Determines the layout mode of the view model that would be constructed
+     * for a provided element, without constructing it.
+     *
+     * @param element Element whose model should be inspected.
+     * @returns The layout mode declared statically by the model constructor,
+     *          or `undefined` if the constructor does not declare it.
+     */
+    getPreferredLayoutMode(element: ReadonlyVisElement): ViewLayoutMode | undefined {
+        return this.getConstructor(element).preferredLayoutMode;
+    }
+    private getConstructor(element: ReadonlyVisElement): ViewModelConstructor {
+        return this.models.get(element.tagName) ?? this.fallback;
+    }
     private readonly models: ReadonlyMap<string, ViewModelConstructor>;
     private readonly fallback: ViewModelConstructor;
 }
@@ -93,6 +112,20 @@ export class ContextFreeViewModelFactory {
     createViewModel(element: ReadonlyVisElement): ViewModel {
         return this.factory.createViewModel(element, this.context);
     }
+    /**
+     * Determines the layout mode of the view model that would be constructed
+     * for a provided element, without constructing it.
+     *
+     * @param element Element whose model should be inspected.
+     * @returns The layout mode declared statically by the model constructor,
+     *          or `undefined` if the constructor does not declare it.
+     */
+    getPreferredLayoutMode(element: ReadonlyVisElement): ViewLayoutMode | undefined {
+        return this.factory.getPreferredLayoutMode(element);
+    }
+    /**
+     * Context that is passed to the constructed models.
+     */
+    readonly context: ViewportContext;
     private readonly factory: ViewModelFactory;
-    private readonly context: ViewportContext;
 }
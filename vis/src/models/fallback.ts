@@ -13,6 +13,7 @@ import { NULL_SLOT, ElementViewSlot } from '../slots';
  * Intended to be used as a sentinel model for invalid elements.
  */
 export class FallbackViewModel implements ViewModel {
+    static readonly preferredLayoutMode = ViewLayoutMode.COMPANION;
     readonly preferredLayoutMode = ViewLayoutMode.COMPANION;
     readonly pinContainer = undefined;
     readonly companionSlot = NULL_SLOT;
@@ -63,6 +63,7 @@ export abstract class FlowViewModel implements ViewModel {
     protected unhookOnDestroy(...handle: ObserverHandle[]): void {
         this.observers.push(...handle);
     }
+    static readonly preferredLayoutMode: ViewLayoutMode = ViewLayoutMode.INLINE;
     readonly preferredLayoutMode: ViewLayoutMode = ViewLayoutMode.INLINE;
     readonly companionSlot: ElementViewSlot;
     readonly pinContainer: Element;
@@ -11,16 +11,40 @@ import {
     GraphLayoutModel,
     GraphLayoutSettings,
 } from './layout-settings';
+import { GraphvizPositions, layoutGraph, POINTS_PER_INCH } from './graphviz-protocol';
+import { defaultGraphvizWorkerPool, GraphvizWorkerPool } from './graphviz-worker-pool';
 import * as graphviz from '@viz-js/viz';
 
+/**
+ * Largest fraction of nodes that may be affected by changes
+ * for a {@link GraphvizLayout} to still lay out the graph incrementally.
+ */
+export const INCREMENTAL_LAYOUT_THRESHOLD: number = 0.25;
+
 /**
  * {@link GraphLayout} that constructs its layouts using [Graphviz](https://graphviz.org/).
+ *
+ * Layouts are calculated by a pool of workers, if available,
+ * so large graphs do not block the main thread.
+ * A new layout cancels the previous one if it has not started yet.
+ *
+ * With layout models that support it, layouts are incremental.
+ * Nodes keep their previous positions unless they, or their neighbors,
+ * have changed since the last layout. If too much of the graph
+ * has changed (see {@link INCREMENTAL_LAYOUT_THRESHOLD}),
+ * all nodes are laid out again, starting from their previous positions.
  */
 export class GraphvizLayout implements GraphLayout, GraphLayoutSettings {
-    constructor() {
+    /**
+     * Constructs an empty layout.
+     *
+     * @param pool Workers that calculate the layout. If there are none,
+     *             the layout is calculated on the current thread.
+     */
+    constructor(pool: GraphvizWorkerPool | undefined = defaultGraphvizWorkerPool()) {
         this.nodes = {};
         this.edges = {};
-        this.graphviz = graphviz.instance();
+        this.pool = pool;
         this.graph = {
             nodes: [],
             edges: [],
@@ -35,14 +59,17 @@ export class GraphvizLayout implements GraphLayout, GraphLayoutSettings {
         this.gap = GRAPH_DEFAULT_GAP;
     }
     set layoutModel(layout: GraphLayoutModel) {
+        this.requireFullLayout();
         this.graph.graphAttributes ??= {};
         this.graph.graphAttributes.layout = LAYOUT_MODEL_TO_GRAPHVIZ[layout];
     }
     set layoutDirection(direction: GraphLayoutDirection) {
+        this.requireFullLayout();
         this.graph.graphAttributes ??= {};
         this.graph.graphAttributes.rankdir = LAYOUT_DIRECTION_TO_GRAPHVIZ[direction];
     }
     set gap(gap: number) {
+        this.requireFullLayout();
         this.graph.graphAttributes ??= {};
         // For DOT and TWOPI layout
         this.graph.graphAttributes.nodesep = gap / POINTS_PER_INCH;
@@ -56,7 +83,9 @@ export class GraphvizLayout implements GraphLayout, GraphLayoutSettings {
     addNode(): LayoutNode {
         const nodeId = String(this.nextNodeId++);
         const node = new GraphvizLayoutNode(nodeId);
+        node.sizeChanged = () => this.markChanged(nodeId);
         this.nodes[nodeId] = node;
+        this.markChanged(nodeId);
         this.graph.nodes ??= [];
         node.index = this.graph.nodes.length;
         this.graph.nodes.push(node.node);
@@ -76,6 +105,7 @@ export class GraphvizLayout implements GraphLayout, GraphLayoutSettings {
         }
         // Forget the slot data to make it eligible for GC
         delete this.nodes[nodeId];
+        this.changedNodes.delete(nodeId);
     }
     addEdge(startId: string, endId: string): LayoutEdge {
         const layoutEdge = { tail: startId, head: endId, attributes: {} };
@@ -86,6 +116,9 @@ export class GraphvizLayout implements GraphLayout, GraphLayoutSettings {
         edge.index = index;
         edge.edgeOrderChanged = () => this.rebuildEdgeOrder();
         this.edges[edgeId] = edge;
+        // Endpoints of the new edge may need to move closer
+        this.markChanged(startId);
+        this.markChanged(endId);
         return edge;
     }
     getEdgeById(id: string): LayoutEdge | undefined {
@@ -97,25 +130,122 @@ export class GraphvizLayout implements GraphLayout, GraphLayoutSettings {
             return;
         }
         if (this.graph.edges) {
+            const { tail, head } = this.graph.edges[edge.index];
+            this.markChanged(tail);
+            this.markChanged(head);
             delete this.graph.edges[edge.index];
         }
         delete this.edges[id];
     }
-    async recalculateLayout(): Promise<void> {
-        const graphviz = await this.graphviz;
-        const layout = graphviz.renderJSON(this.graph);
-        const bb = (layout as { bb: string }).bb.split(',').map(Number.parseFloat);
-        this.width = bb[2];
-        this.height = bb[3];
-        for (const object of (
-            layout as { objects: { name: string; pos: string; width: string; height: string }[] }
-        ).objects ?? []) {
-            const slot = this.nodes[object.name];
-            const pos = object.pos.split(',').map(Number.parseFloat);
-            slot.left = pos[0] - (Number.parseFloat(object.width) * POINTS_PER_INCH) / 2;
-            slot.top =
-                this.height - (Number.parseFloat(object.height) * POINTS_PER_INCH) / 2 - pos[1];
-            slot.node.attributes.pos = `${(pos[0] * POINTS_PER_INCH) / 2},${(pos[1] * POINTS_PER_INCH) / 2}`;
+    get cancelsPendingLayout(): boolean {
+        return this.pool !== undefined;
+    }
+    async recalculateLayout(): Promise<boolean> {
+        const generation = this.changeGeneration;
+        this.pinStableNodes();
+        // Removed nodes and edges leave holes that need not be sent anywhere
+        const graph = {
+            ...this.graph,
+            nodes: this.graph.nodes?.filter(node => node !== undefined),
+            edges: this.graph.edges?.filter(edge => edge !== undefined),
+        };
+        let positions: GraphvizPositions | undefined;
+        if (this.pool) {
+            positions = await this.pool.layout(this, graph);
+            if (!positions) {
+                // A newer layout has been requested, it will apply its own result
+                return false;
+            }
+        } else {
+            this.graphviz ??= graphviz.instance();
+            positions = layoutGraph(await this.graphviz, graph);
+        }
+        this.forgetChanges(generation);
+        this.width = positions.width;
+        this.height = positions.height;
+        for (const { name, left, top, pos } of positions.nodes) {
+            const slot = this.nodes[name];
+            if (!slot) {
+                // The node has been removed while the layout was being calculated
+                continue;
+            }
+            slot.left = left;
+            slot.top = top;
+            slot.position = pos;
+        }
+        return true;
+    }
+    /**
+     * Sets the starting positions of all nodes for the next layout,
+     * fixing the positions of nodes that are not near any change.
+     */
+    private pinStableNodes(): void {
+        const nodes = Object.values(this.nodes);
+        const layoutEngine = this.graph.graphAttributes?.layout as string;
+        let moving: Set<string> | undefined = undefined;
+        if (this.fullLayoutGeneration === undefined && PINNING_LAYOUTS.has(layoutEngine)) {
+            moving = this.changedNeighborhood();
+            if (moving.size > nodes.length * INCREMENTAL_LAYOUT_THRESHOLD) {
+                // Too much has changed, the graph is better off laid out as a whole
+                moving = undefined;
+            }
+        }
+        for (const node of nodes) {
+            if (node.position === undefined) {
+                delete node.node.attributes.pos;
+            } else if (moving && !moving.has(node.id)) {
+                // Exclamation mark pins the node in place
+                node.node.attributes.pos = `${node.position}!`;
+            } else {
+                node.node.attributes.pos = node.position;
+            }
+        }
+    }
+    /**
+     * Collects nodes that have changed since the last layout,
+     * along with their neighbors.
+     */
+    private changedNeighborhood(): Set<string> {
+        const neighborhood = new Set(this.changedNodes.keys());
+        for (const edge of this.graph.edges ?? []) {
+            if (!edge) {
+                continue;
+            }
+            if (this.changedNodes.has(edge.tail)) {
+                neighborhood.add(edge.head);
+            }
+            if (this.changedNodes.has(edge.head)) {
+                neighborhood.add(edge.tail);
+            }
+        }
+        return neighborhood;
+    }
+    /**
+     * Records that a node should be laid out again.
+     */
+    private markChanged(nodeId: string): void {
+        this.changedNodes.set(nodeId, ++this.changeGeneration);
+    }
+    /**
+     * Records that all nodes should be laid out again.
+     */
+    private requireFullLayout(): void {
+        this.fullLayoutGeneration = ++this.changeGeneration;
+    }
+    /**
+     * Forgets changes that have been reflected in a finished layout.
+     *
+     * @param generation Value of {@link changeGeneration} when the layout started.
+     *                   Changes made after that are kept for the next layout.
+     */
+    private forgetChanges(generation: number): void {
+        for (const [nodeId, changeGeneration] of this.changedNodes) {
+            if (changeGeneration <= generation) {
+                this.changedNodes.delete(nodeId);
+            }
+        }
+        if (this.fullLayoutGeneration !== undefined && this.fullLayoutGeneration <= generation) {
+            this.fullLayoutGeneration = undefined;
         }
     }
     /**
@@ -150,9 +280,24 @@ export class GraphvizLayout implements GraphLayout, GraphLayoutSettings {
     private nextNodeId: number = 1;
     private nextEdgeId: number = 1;
     private readonly graph: graphviz.Graph;
-    private readonly graphviz: Promise<graphviz.Viz>;
+    private readonly pool: GraphvizWorkerPool | undefined;
+    private graphviz: Promise<graphviz.Viz> | undefined = undefined;
     private readonly nodes: Record<string, GraphvizLayoutNode>;
     private readonly edges: Record<string, GraphvizLayoutEdge>;
+    /**
+     * Nodes that have changed since the last finished layout,
+     * along with the value of {@link changeGeneration} at the time of the latest change.
+     */
+    private readonly changedNodes: Map<string, number> = new Map();
+    /**
+     * Value of {@link changeGeneration} when a full layout was last requested,
+     * or `undefined` if the last finished layout already covers it.
+     */
+    private fullLayoutGeneration: number | undefined = 0;
+    /**
+     * Counter that orders changes relative to layout requests.
+     */
+    private changeGeneration: number = 0;
 }
 
 class GraphvizLayoutNode implements LayoutNode {
@@ -160,8 +305,14 @@ class GraphvizLayoutNode implements LayoutNode {
         this.node = { name: id, attributes: {} };
     }
     setSize(width: number, height: number): void {
-        this.node.attributes.width = width / POINTS_PER_INCH;
-        this.node.attributes.height = height / POINTS_PER_INCH;
+        width /= POINTS_PER_INCH;
+        height /= POINTS_PER_INCH;
+        if (width === this.node.attributes.width && height === this.node.attributes.height) {
+            return;
+        }
+        this.node.attributes.width = width;
+        this.node.attributes.height = height;
+        this.sizeChanged();
     }
     left: number = 0;
     top: number = 0;
@@ -170,6 +321,11 @@ class GraphvizLayoutNode implements LayoutNode {
     }
     readonly node: { name: string; attributes: Record<string, string | number> };
     index: number;
+    /**
+     * Position of the node in the last finished layout, in Graphviz input units.
+     */
+    position: string | undefined = undefined;
+    sizeChanged: () => void;
     set orderedOutEdges(value: boolean) {
         this.node.attributes.ordering = value ? 'out' : '';
     }
@@ -201,6 +357,12 @@ const LAYOUT_DIRECTION_TO_GRAPHVIZ = {
     [GraphLayoutDirection.WEST]: 'RL',
 };
 
+/**
+ * Graphviz layout engines that can keep some nodes
+ * in fixed positions while laying out the rest.
+ */
+const PINNING_LAYOUTS: ReadonlySet<string> = new Set(['neato', 'fdp']);
+
 const LAYOUT_MODEL_TO_GRAPHVIZ = {
     [GraphLayoutModel.LAYERED]: 'dot',
     [GraphLayoutModel.UNORIENTED]: 'neato',
@@ -210,5 +372,3 @@ const LAYOUT_MODEL_TO_GRAPHVIZ = {
     [GraphLayoutModel.GRAPHVIZ_CIRCO]: 'circo',
     [GraphLayoutModel.GRAPHVIZ_TWOPI]: 'twopi',
 };
-
-const POINTS_PER_INCH: number = 72;
@@ -0,0 +1,121 @@
+/**
+ * Messages exchanged between {@link GraphvizLayout} and the layout workers,
+ * and conversion of Graphviz output into node positions.
+ *
+ * @module
+ */
+
+import * as graphviz from '@viz-js/viz';
+
+/**
+ * Request to lay out a graph, sent to a layout worker.
+ */
+export interface GraphvizLayoutRequest {
+    /**
+     * Identifier that matches the response to the request.
+     */
+    id: number;
+    /**
+     * Graph that should be laid out.
+     */
+    graph: graphviz.Graph;
+}
+
+/**
+ * Response to a {@link GraphvizLayoutRequest}, sent by a layout worker.
+ */
+export type GraphvizLayoutResponse =
+    | {
+          /**
+           * Identifier of the request.
+           */
+          id: number;
+          /**
+           * Result of the layout.
+           */
+          positions: GraphvizPositions;
+      }
+    | {
+          /**
+           * Identifier of the request.
+           */
+          id: number;
+          /**
+           * Description of the error that prevented the layout.
+           */
+          error: string;
+      };
+
+/**
+ * Positions of nodes in a finished layout.
+ */
+export interface GraphvizPositions {
+    /**
+     * Width of the layout's bounding box, in pixels.
+     */
+    width: number;
+    /**
+     * Height of the layout's bounding box, in pixels.
+     */
+    height: number;
+    /**
+     * Positions of individual nodes.
+     */
+    nodes: GraphvizNodePosition[];
+}
+
+/**
+ * Position of a node in a finished layout.
+ */
+export interface GraphvizNodePosition {
+    /**
+     * Name of the node in the Graphviz graph.
+     */
+    name: string;
+    /**
+     * Offset of the left side of the node's bounding box, in pixels.
+     */
+    left: number;
+    /**
+     * Offset of the top side of the node's bounding box, in pixels.
+     */
+    top: number;
+    /**
+     * Position of the node in Graphviz input coordinates (inches),
+     * for use as the starting position of the next layout.
+     */
+    pos: string;
+}
+
+/**
+ * Number of Graphviz units (points) in an inch.
+ */
+export const POINTS_PER_INCH: number = 72;
+
+/**
+ * Lays out a graph and extracts its node positions.
+ *
+ * @param viz Graphviz instance.
+ * @param graph Graph that should be laid out.
+ * @returns Positions of the nodes.
+ */
+export function layoutGraph(viz: graphviz.Viz, graph: graphviz.Graph): GraphvizPositions {
+    const layout = viz.renderJSON(graph) as {
+        bb: string;
+        objects?: { name: string; pos: string; width: string; height: string }[];
+    };
+    const bb = layout.bb.split(',').map(Number.parseFloat);
+    const width = bb[2];
+    const height = bb[3];
+    const nodes = (layout.objects ?? []).map(object => {
+        const pos = object.pos.split(',').map(Number.parseFloat);
+        return {
+            name: object.name,
+            left: pos[0] - (Number.parseFloat(object.width) * POINTS_PER_INCH) / 2,
+            top: height - (Number.parseFloat(object.height) * POINTS_PER_INCH) / 2 - pos[1],
+            // Output is in points, but input positions are read in inches
+            pos: `${pos[0] / POINTS_PER_INCH},${pos[1] / POINTS_PER_INCH}`,
+        };
+    });
+    return { width, height, nodes };
+}
@@ -0,0 +1,207 @@
+/**
+ * Pool of workers that lay out graphs off the main thread.
+ *
+ * @module
+ */
+
+/// <reference types="vite/client" />
+
+import * as graphviz from '@viz-js/viz';
+import {
+    GraphvizLayoutRequest,
+    GraphvizLayoutResponse,
+    GraphvizPositions,
+} from './graphviz-protocol';
+import GraphvizWorker from './graphviz-worker?worker&inline';
+
+/**
+ * Maximum number of workers in the {@link defaultGraphvizWorkerPool}.
+ */
+const MAX_DEFAULT_POOL_SIZE: number = 4;
+
+/**
+ * Layout request that is waiting for a worker or being processed by one.
+ */
+interface GraphvizJob {
+    /**
+     * Identifier of the request.
+     */
+    id: number;
+    /**
+     * Identity of the requester. A newer request with the same owner
+     * supersedes this one.
+     */
+    owner: object;
+    /**
+     * Graph that should be laid out.
+     */
+    graph: graphviz.Graph;
+    /**
+     * Resolves the request. Superseded requests resolve with `undefined`.
+     */
+    resolve(positions: GraphvizPositions | undefined): void;
+    /**
+     * Rejects the request.
+     */
+    reject(error: Error): void;
+}
+
+/**
+ * Worker of the pool along with the job it is processing.
+ */
+interface GraphvizWorkerSlot {
+    worker: Worker;
+    job: GraphvizJob | undefined;
+}
+
+/**
+ * Distributes layout requests among a fixed number of workers.
+ *
+ * Each requester only cares about its most recent request,
+ * so a new request supersedes any older queued request from the same requester.
+ * A request that is already being processed is allowed to finish,
+ * so a requester that keeps sending requests still receives results.
+ * Requests from the same requester are processed one at a time,
+ * so their results arrive in the order in which they were requested.
+ */
+export class GraphvizWorkerPool {
+    /**
+     * Constructs a pool of workers.
+     *
+     * @param size Number of workers in the pool.
+     * @param createWorker Function that starts a new layout worker.
+     */
+    constructor(size: number, createWorker: () => Worker = () => new GraphvizWorker()) {
+        this.createWorker = createWorker;
+        this.queue = [];
+        this.slots = [];
+        for (let i = 0; i < size; ++i) {
+            this.slots.push(this.createSlot());
+        }
+    }
+    /**
+     * Lays out a graph in one of the workers.
+     *
+     * @param owner Identity of the requester.
+     * @param graph Graph that should be laid out.
+     * @returns Promise that resolves with the positions of the nodes,
+     *          or with `undefined` if the request has been superseded
+     *          by a newer request from the same owner before it was processed.
+     */
+    layout(owner: object, graph: graphviz.Graph): Promise<GraphvizPositions | undefined> {
+        this.supersede(owner);
+        return new Promise((resolve, reject) => {
+            this.queue.push({ id: this.nextJobId++, owner, graph, resolve, reject });
+            this.dispatch();
+        });
+    }
+    /**
+     * Terminates all workers and drops all requests.
+     */
+    terminate(): void {
+        for (const slot of this.slots) {
+            slot.worker.terminate();
+            slot.job?.resolve(undefined);
+        }
+        for (const job of this.queue) {
+            job.resolve(undefined);
+        }
+        this.slots.length = 0;
+        this.queue.length = 0;
+    }
+    /**
+     * Drops the queued request from an owner.
+     *
+     * Graphviz cannot be interrupted, so a request that is being processed
+     * is left alone. Terminating its worker would discard work that is
+     * already done and, if requests keep coming, no request would ever finish.
+     */
+    private supersede(owner: object): void {
+        const queueIndex = this.queue.findIndex(job => job.owner === owner);
+        if (queueIndex >= 0) {
+            this.queue[queueIndex].resolve(undefined);
+            this.queue.splice(queueIndex, 1);
+        }
+    }
+    /**
+     * Hands queued requests to idle workers.
+     */
+    private dispatch(): void {
+        for (const slot of this.slots) {
+            if (slot.job) {
+                continue;
+            }
+            // Wait for the previous request of an owner to finish before
+            // starting the next one, so results cannot arrive out of order
+            const queueIndex = this.queue.findIndex(job => !this.isProcessing(job.owner));
+            if (queueIndex < 0) {
+                return;
+            }
+            const [job] = this.queue.splice(queueIndex, 1);
+            slot.job = job;
+            const request: GraphvizLayoutRequest = { id: job.id, graph: job.graph };
+            slot.worker.postMessage(request);
+        }
+    }
+    /**
+     * Checks whether a request from an owner is being processed.
+     */
+    private isProcessing(owner: object): boolean {
+        return this.slots.some(slot => slot.job?.owner === owner);
+    }
+    private createSlot(): GraphvizWorkerSlot {
+        const slot: GraphvizWorkerSlot = { worker: this.createWorker(), job: undefined };
+        slot.worker.onmessage = (e: MessageEvent<GraphvizLayoutResponse>) => {
+            const job = slot.job;
+            if (!job || job.id !== e.data.id) {
+                // Response to a request that has been dropped
+                return;
+            }
+            slot.job = undefined;
+            if ('positions' in e.data) {
+                job.resolve(e.data.positions);
+            } else {
+                job.reject(new Error(e.data.error));
+            }
+            this.dispatch();
+        };
+        slot.worker.onerror = e => {
+            // The worker is in unknown state, so replace it
+            const index = this.slots.indexOf(slot);
+            if (index >= 0) {
+                slot.worker.terminate();
+                this.slots[index] = this.createSlot();
+            }
+            slot.job?.reject(new Error(e.message));
+            this.dispatch();
+        };
+        return slot;
+    }
+    private readonly createWorker: () => Worker;
+    private readonly queue: GraphvizJob[];
+    private readonly slots: GraphvizWorkerSlot[];
+    private nextJobId: number = 0;
+}
+
+/**
+ * Pool shared by all graphs that do not specify their own.
+ */
+let defaultPool: GraphvizWorkerPool | undefined = undefined;
+
+/**
+ * Gets the pool shared by all graphs, creating it if necessary.
+ *
+ * @returns The shared pool, or `undefined` if workers
+ *          are not available in the current environment.
+ */
+export function defaultGraphvizWorkerPool(): GraphvizWorkerPool | undefined {
+    if (typeof Worker === 'undefined') {
+        return undefined;
+    }
+    // Leave one core to the main thread
+    const cores = globalThis.navigator?.hardwareConcurrency ?? 2;
+    defaultPool ??= new GraphvizWorkerPool(
+        Math.min(MAX_DEFAULT_POOL_SIZE, Math.max(1, cores - 1)),
+    );
+    return defaultPool;
+}
@@ -0,0 +1,28 @@
+/**
+ * Entry point of a worker that lays out graphs with Graphviz.
+ *
+ * @module
+ */
+
+import * as graphviz from '@viz-js/viz';
+import { GraphvizLayoutRequest, GraphvizLayoutResponse, layoutGraph } from './graphviz-protocol';
+
+/**
+ * Global scope of the worker, as far as this module is concerned.
+ */
+const scope = self as unknown as {
+    onmessage: ((e: MessageEvent<GraphvizLayoutRequest>) => void) | null;
+    postMessage(message: GraphvizLayoutResponse): void;
+};
+
+// Each worker owns a separate Graphviz instance
+const viz = graphviz.instance();
+
+scope.onmessage = async e => {
+    const { id, graph } = e.data;
+    try {
+        scope.postMessage({ id, positions: layoutGraph(await viz, graph) });
+    } catch (error) {
+        scope.postMessage({ id, error: String(error) });
+    }
+};
@@ -100,9 +100,18 @@ export interface GraphLayout {
     /**
      * Asynchronously recalculates the layout of the graph.
      *
-     * @returns Promise that resolves when the calculation is done.
+     * @returns Promise that resolves when the calculation is done,
+     *          with `false` if it has been cancelled by a newer call
+     *          (see {@link cancelsPendingLayout}) and the layout has not changed.
      */
-    recalculateLayout(): Promise<void>;
+    recalculateLayout(): Promise<boolean>;
+    /**
+     * Whether {@link recalculateLayout} may be called again before
+     * the previous call has finished, cancelling the previous call.
+     *
+     * If not set, the previous call should be awaited first.
+     */
+    readonly cancelsPendingLayout?: boolean;
     /**
      * Width of the layout's bounding box.
      */
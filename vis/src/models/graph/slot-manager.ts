@@ -9,6 +9,7 @@ import { ObserverHandle } from 'aili-hooligan';
 import { setAttributeBindings } from '../../attributes';
 import { ReadonlyVisConnector, ReadonlyVisElement } from '../../tree';
 import { ViewportContext } from '../../viewport-dom';
+import { ScheduledLayout } from '../../layout-scheduler';
 import { GraphLayout, LayoutEdge, LayoutNode } from './layout';
 import * as bind from '../../attribute-binds';
 
@@ -24,8 +25,11 @@ export const INVALID_GRAPH_SLOT: string = '';
  * Layout is recalculated when structure of the visualization tree
  * or the visual models of child elements change, and immediately
  * reflected in the DOM. A layout update can also be triggered manually.
+ *
+ * Recalculations are dispatched by the {@link ViewportContext.layoutScheduler},
+ * so any number of changes within a frame only cause one recalculation.
  */
-export class GraphSlotManager {
+export class GraphSlotManager implements ScheduledLayout {
     /**
      * Constructs an empty slot manager and binds it to a DOM element.
      *
@@ -141,29 +145,36 @@ export class GraphSlotManager {
     destroy(): void {
         // Stop observing everything if there are still active slots left
         this.slotResizeObserver.disconnect();
+        // There is no point in laying out a destroyed graph
+        this.context.layoutScheduler.cancel(this);
+    }
+    get cancelsPendingLayout(): boolean {
+        return this.layout.cancelsPendingLayout ?? false;
     }
+    /**
+     * Schedules recalculation of the layout on the next frame.
+     */
     updateLayout(): void {
-        // If an update is already scheduled, skip it
-        if (this.layoutUpdateQueued) {
-            return;
-        }
-        // Prevent additional updates until this one is dispatched
-        this.layoutUpdateQueued = true;
-        // Schedule the update to run on next frame
-        requestAnimationFrame(() => {
-            this.updateLayoutNow();
-            this.layoutUpdateQueued = false;
-        });
+        this.context.layoutScheduler.markDirty(this);
     }
     /**
      * Asynchronously recalculates layout using the layout engine
      * received on construction and updates the DOM according to it.
      *
+     * Connectors are repainted by the viewport once all layouts
+     * scheduled for the frame have been updated.
+     *
      * @returns Promise that resolves when the layout has been fully updated.
      */
-    private async updateLayoutNow(): Promise<void> {
+    async updateLayoutNow(): Promise<void> {
+        const generation = ++this.requestedLayoutGeneration;
         // Recalculate the layout
-        await this.layout.recalculateLayout();
+        const updated = await this.layout.recalculateLayout();
+        if (!updated || generation < this.appliedLayoutGeneration) {
+            // The layout has been superseded, the newer one applies its own result
+            return;
+        }
+        this.appliedLayoutGeneration = generation;
         // Update bounding box dimensions
         this.container.style.width = String(this.layout.width) + 'px';
         this.container.style.height = String(this.layout.height) + 'px';
@@ -176,8 +187,6 @@ export class GraphSlotManager {
                 html.style.top = String(node.top) + 'px';
             }
         }
-        // Connectors will need to be recalculated too
-        this.context.jsplumb.repaintEverything();
     }
     private getOrAddElementToLayout(element: ReadonlyVisElement): {
         node: LayoutNode;
@@ -286,7 +295,15 @@ export class GraphSlotManager {
     private readonly slotAssignments: WeakMap<ReadonlyVisElement, string>;
     private readonly layoutConnectors: WeakMap<ReadonlyVisConnector, LayoutActiveConnector>;
     private readonly slotResizeObserver: ResizeObserver;
-    private layoutUpdateQueued: boolean = false;
+    /**
+     * Number of layout recalculations that have been started.
+     */
+    private requestedLayoutGeneration: number = 0;
+    /**
+     * Value of {@link requestedLayoutGeneration} when the layout
+     * that is currently reflected in the DOM was started.
+     */
+    private appliedLayoutGeneration: number = 0;
 }
 
 /**
@@ -301,5 +301,6 @@ export class LabelViewModel extends FlowViewModel {
             }),
         );
     }
+    static readonly preferredLayoutMode: ViewLayoutMode = ViewLayoutMode.COMPANION;
     preferredLayoutMode: ViewLayoutMode = ViewLayoutMode.COMPANION;
 }
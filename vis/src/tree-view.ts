@@ -24,7 +24,8 @@ import { ViewContainer } from './view-container';
  * ### Tracking invariants
  *
  * A {@link ReadonlyVisElement} is tracked if and only if it is a root
- * element (registered with {@link addRootElement}) or a descendant thereof.
+ * element (registered with {@link addRootElement}) or a child
+ * of a tracked element that is not {@link ElementView.deferred}.
  *
  * A {@link ReadonlyVisConnector} is tracked if and only if both
  * of its endpoints are attached to tracked elements.
@@ -102,10 +103,44 @@ export class TreeView {
      * connectors that are fully attached to the subtree,
      * and attaches mutation observers to the element
      * so its subtree can be kept up-to-date.
+     * If the element is deferred, this only happens
+     * once it stops being deferred.
      *
      * @param view View for the newly added element.
      */
     private afterAddedNewElement(view: ElementView): void {
+        // Put all observers aside so they can be unhooked when the element is removed
+        const observers: ElementObservers = {};
+        this.elementObservers.set(view.element, observers);
+
+        // Parents of root elements are out of scope by definition, so we ignore them
+        // Otherwise always remove the element when it is detached
+        const dependOnParent = !view.hasExplicitEmbedding;
+        if (dependOnParent) {
+            observers.parentChanged = view.element.onParentChanged.hook(() => {
+                this.removeElementWithSubtreeAndConnectors(view.element);
+            });
+        }
+
+        // Contents of a deferred element are only tracked while it is not deferred
+        observers.deferredChanged = view.onDeferredChanged?.hook(() => {
+            if (view.deferred) {
+                this.untrackContents(view.element, observers);
+            } else {
+                this.trackContents(view, observers);
+            }
+        });
+        if (!view.deferred) {
+            this.trackContents(view, observers);
+        }
+    }
+    /**
+     * Starts tracking the children and connectors of a tracked element.
+     *
+     * @param view View for the element.
+     * @param observers Observers of the element, which will be updated.
+     */
+    private trackContents(view: ElementView, observers: ElementObservers): void {
         // Add all child elements to rendering, even ones that appear in the future
         const addChildElement = (child: ReadonlyVisElement) => {
             this.elementMovedToEmbedding(child, { parent: view });
@@ -113,7 +148,7 @@ export class TreeView {
         for (const child of view.element.children) {
             addChildElement(child);
         }
-        const addChildObserver = view.element.onAddChild.hook(addChildElement);
+        observers.addChild = view.element.onAddChild.hook(addChildElement);
 
         // Add all attached pins to rendering, even ones that appear in the future
         const addAttachedPin = (pin: ReadonlyVisPin) => {
@@ -122,24 +157,26 @@ export class TreeView {
         for (const pin of view.element.pins) {
             addAttachedPin(pin);
         }
-        const addPinObserver = view.element.onAddPin.hook(addAttachedPin);
-
-        // Parents of root elements are out of scope by definition, so we ignore them
-        // Otherwise always remove the element when it is detached
-        let parentChangedObserver: ObserverHandle | undefined;
-        const dependOnParent = !view.hasExplicitEmbedding;
-        if (dependOnParent) {
-            parentChangedObserver = view.element.onParentChanged.hook(() => {
-                this.removeElementWithSubtreeAndConnectors(view.element);
-            });
+        observers.addPin = view.element.onAddPin.hook(addAttachedPin);
+    }
+    /**
+     * Stops tracking the children and connectors of a tracked element,
+     * but keeps tracking the element itself.
+     *
+     * @param element The element whose contents should be removed.
+     * @param observers Observers of the element, which will be updated.
+     */
+    private untrackContents(element: ReadonlyVisElement, observers: ElementObservers): void {
+        observers.addChild?.unhook();
+        observers.addPin?.unhook();
+        observers.addChild = undefined;
+        observers.addPin = undefined;
+        for (const child of element.children) {
+            this.removeElementWithSubtreeAndConnectors(child);
+        }
+        for (const pin of element.pins) {
+            this.removeConnector(pin.connector);
         }
-
-        // Put all observers aside so they can be unhooked when the element is removed
-        this.elementObservers.set(view.element, {
-            addChild: addChildObserver,
-            addPin: addPinObserver,
-            parentChanged: parentChangedObserver,
-        });
     }
     /**
      * Handles the attachment of a connector pin to a tracked element.
@@ -208,6 +245,7 @@ export class TreeView {
         observers?.addChild?.unhook();
         observers?.addPin?.unhook();
         observers?.parentChanged?.unhook();
+        observers?.deferredChanged?.unhook();
         this.elementObservers.delete(element);
         // Drop the element's view
         this.elementViews.remove(element);
@@ -243,9 +281,10 @@ export class TreeView {
  * that is tracked by a {@link TreeView}.
  */
 interface ElementObservers {
-    addChild: ObserverHandle;
-    addPin: ObserverHandle;
-    parentChanged?: ObserverHandle;
+    addChild?: ObserverHandle | undefined;
+    addPin?: ObserverHandle | undefined;
+    parentChanged?: ObserverHandle | undefined;
+    deferredChanged?: ObserverHandle | undefined;
 }
 
 /**
@@ -276,7 +276,7 @@ export class VisElement implements ReadonlyVisElement {
     }
     private updateConnectorProjectionsRecursive(): void {
         for (const pin of this.pins) {
-            pin.connector._updateProjection();
+            pin.connector._requestProjectionUpdate();
         }
         for (const child of this.children) {
             child.updateConnectorProjectionsRecursive();
@@ -343,7 +343,7 @@ export class VisPin implements ReadonlyVisPin {
         target?.pins?.add(this);
         this.onTargetChanged.trigger(target, previousTarget);
         target?.onAddPin?.trigger(this);
-        this.connector._updateProjection();
+        this.connector._requestProjectionUpdate();
     }
     /**
      * @internal
@@ -372,6 +372,19 @@ export class VisConnector implements ReadonlyVisConnector {
         return this._projectedParent;
     }
     readonly onProjectedParentChanged: Hook<[VisElement | undefined, VisElement | undefined]>;
+    /**
+     * Updates the projection of the connector, or schedules the update
+     * for the end of the current {@link batchVisTreeUpdates} call.
+     *
+     * @internal
+     */
+    _requestProjectionUpdate(): void {
+        if (pendingProjectionUpdates) {
+            pendingProjectionUpdates.add(this);
+        } else {
+            this._updateProjection();
+        }
+    }
     /**
      * Finds the current projection of the connector
      * and updates it if it has changed.
@@ -448,6 +461,49 @@ export class VisConnector implements ReadonlyVisConnector {
     private _projectedParent: VisElement | undefined = undefined;
 }
 
+/**
+ * Connectors whose projections should be updated at the end
+ * of the current {@link batchVisTreeUpdates} call,
+ * or `undefined` if no batch is in progress.
+ */
+let pendingProjectionUpdates: Set<VisConnector> | undefined = undefined;
+
+/**
+ * Performs a batch of modifications to visualization trees,
+ * updating connector projections only once at the end of the batch.
+ *
+ * Moving an element updates projections of all connectors attached
+ * to its subtree, so a batch that builds a large subtree
+ * can avoid most of that work. Observers of
+ * {@link ReadonlyVisConnector.onProjectedParentChanged},
+ * {@link ReadonlyVisPin.onProjectedTargetChanged},
+ * {@link ReadonlyVisElement.onAddProjectedPin}, and
+ * {@link ReadonlyVisElement.onAddProjectedConnector}
+ * are notified once per batch, after all modifications have been made.
+ * Until then, projections report their state from before the batch.
+ *
+ * Nested calls are merged into the outermost batch.
+ *
+ * @typeParam T Return value of the action.
+ * @param action The action that modifies the trees.
+ * @returns Return value of `action`.
+ */
+export function batchVisTreeUpdates<T>(action: () => T): T {
+    if (pendingProjectionUpdates) {
+        return action();
+    }
+    const pending = new Set<VisConnector>();
+    pendingProjectionUpdates = pending;
+    try {
+        return action();
+    } finally {
+        pendingProjectionUpdates = undefined;
+        for (const connector of pending) {
+            connector._updateProjection();
+        }
+    }
+}
+
 /**
  * Exception that indicates a modification was attempted
  * that would violate structural invariants of the visualization tree.
@@ -5,6 +5,8 @@
  */
 
 import { ElementViewSlot, ViewSlotPopulator } from './slots';
+import { LayoutScheduler } from './layout-scheduler';
+import { IntersectionVisibilityTracker, VisibilityTracker } from './virtualization';
 import * as jsplumb from '@jsplumb/browser-ui';
 import './viewport-dom.css';
 
@@ -34,6 +36,37 @@ export interface ViewportContext {
      * Instance of the JSPlumb library for rendering connectors.
      */
     jsplumb: jsplumb.BrowserJsPlumbInstance;
+    /**
+     * Scheduler that coalesces layout recalculations
+     * of all view models in the viewport.
+     */
+    layoutScheduler: LayoutScheduler;
+    /**
+     * Tracker of the visible area of the viewport.
+     * If specified, elements outside the visible area
+     * are rendered as placeholders.
+     */
+    visibilityTracker?: VisibilityTracker | undefined;
+}
+
+/**
+ * Optional settings of a viewport.
+ */
+export interface ViewportOptions {
+    /**
+     * Whether only the elements near the visible area of the viewport should be rendered.
+     * Other elements are replaced by placeholders with their last known size,
+     * along with their subtrees and connectors.
+     *
+     * This is ignored if the environment does not support `IntersectionObserver`.
+     */
+    virtualize?: boolean;
+    /**
+     * Margin around the visible area within which elements are still rendered,
+     * as a CSS margin.
+     * Defaults to {@link DEFAULT_VIRTUALIZATION_MARGIN}.
+     */
+    virtualizationMargin?: string;
 }
 
 /**
@@ -44,8 +77,9 @@ export class ViewportDOMRoot {
      * Constructs a viewport root over a provided DOM container.
      *
      * @param container The element that will contain the viewport.
+     * @param options Optional settings of the viewport.
      */
-    constructor(container: HTMLElement) {
+    constructor(container: HTMLElement, options: ViewportOptions = {}) {
         const scrollbox = container.ownerDocument.createElement('div');
         const inner = container.ownerDocument.createElement('div');
         scrollbox.className = CLASS_VIEWPORT;
@@ -53,9 +87,18 @@ export class ViewportDOMRoot {
         scrollbox.append(inner);
         container.append(scrollbox);
         this.slot = new ViewportRootSlot(inner);
+        const jsplumbInstance = jsplumb.newInstance({ container: inner, elementsDraggable: false });
+        const layoutScheduler = new LayoutScheduler();
+        // Connectors only need to be repainted once after all layouts in a frame
+        layoutScheduler.onLayoutsUpdated.hook(() => jsplumbInstance.repaintEverything());
         this.context = {
             ownerDocument: container.ownerDocument,
-            jsplumb: jsplumb.newInstance({ container: inner, elementsDraggable: false }),
+            jsplumb: jsplumbInstance,
+            layoutScheduler,
+            visibilityTracker:
+                options.virtualize && typeof IntersectionObserver !== 'undefined'
+                    ? new IntersectionVisibilityTracker(scrollbox, options.virtualizationMargin)
+                    : undefined,
         };
     }
     /**
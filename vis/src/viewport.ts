@@ -4,11 +4,12 @@
  * @module
  */
 
+import { Hookable } from 'aili-hooligan';
 import { ReadonlyVisElement } from './tree';
 import { ElementViewContainer } from './element-view';
 import { ConnectorViewContainer } from './connector-view';
 import { TreeView } from './tree-view';
-import { ViewportDOMRoot } from './viewport-dom';
+import { ViewportDOMRoot, ViewportOptions } from './viewport-dom';
 import { ContextFreeViewModelFactory, ViewModelFactory } from './model-factory';
 
 /**
@@ -23,9 +24,14 @@ export class Viewport {
      * @param container The DOM element that the viewport will render to.
      * @param viewModelFactory Factory that creates view models
      *        for {@link ReadonlyVisElement}s.
+     * @param options Optional settings of the viewport.
      */
-    constructor(container: HTMLElement, viewModelFactory: ViewModelFactory) {
-        const root = new ViewportDOMRoot(container);
+    constructor(
+        container: HTMLElement,
+        viewModelFactory: ViewModelFactory,
+        options: ViewportOptions = {},
+    ) {
+        const root = new ViewportDOMRoot(container, options);
         const modelFactory = new ContextFreeViewModelFactory(viewModelFactory, root.context);
         const elementViews = new ElementViewContainer(modelFactory);
         const connectorViews = new ConnectorViewContainer(root.context);
@@ -59,6 +65,15 @@ export class Viewport {
     get root(): ReadonlyVisElement | undefined {
         return this.currentRoot;
     }
+    /**
+     * Triggers after all layouts recalculated in an animation frame
+     * have been updated, so the rendering of the viewport is up to date.
+     *
+     * @event
+     */
+    get onLayoutsUpdated(): Hookable<[]> {
+        return this.rootDom.context.layoutScheduler.onLayoutsUpdated;
+    }
     private treeView: TreeView;
     private rootDom: ViewportDOMRoot;
     private currentRoot: ReadonlyVisElement | undefined;
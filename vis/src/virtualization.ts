@@ -0,0 +1,126 @@
+/**
+ * Support for rendering only the elements that are near the visible area of a viewport.
+ *
+ * @module
+ */
+
+import { ObserverHandle } from 'aili-hooligan';
+import { ViewLayoutMode, ViewModel } from './model';
+import { NULL_SLOT, ElementViewSlot, ViewSlotPopulator } from './slots';
+import './virtualization.css';
+
+/**
+ * CSS class for the box that replaces an element that is not rendered.
+ */
+export const CLASS_PLACEHOLDER: string = 'aili-placeholder';
+
+/**
+ * Default margin around the visible area of a viewport
+ * within which elements are still rendered.
+ */
+export const DEFAULT_VIRTUALIZATION_MARGIN: string = '50%';
+
+/**
+ * Callback that receives changes in visibility of an HTML element.
+ *
+ * @param visible Whether the element is now within the tracked area.
+ */
+export type VisibilityObserver = (visible: boolean) => void;
+
+/**
+ * Tracks whether HTML elements are within some area of interest,
+ * usually the visible area of a viewport.
+ */
+export interface VisibilityTracker {
+    /**
+     * Starts tracking the visibility of an HTML element.
+     *
+     * The observer is notified asynchronously, including the initial state.
+     *
+     * @param html The element whose visibility should be tracked.
+     * @param observer Callback that is notified of visibility changes.
+     * @returns Handle that stops the tracking.
+     */
+    observe(html: Element, observer: VisibilityObserver): ObserverHandle;
+}
+
+/**
+ * {@link VisibilityTracker} that tracks intersections with a scrollable container.
+ */
+export class IntersectionVisibilityTracker implements VisibilityTracker {
+    /**
+     * Constructs a tracker that does not track any elements yet.
+     *
+     * @param root The scrollable element whose visible area is tracked.
+     * @param margin Margin that extends the tracked area, as a CSS margin.
+     */
+    constructor(root: Element, margin: string = DEFAULT_VIRTUALIZATION_MARGIN) {
+        this.observers = new Map();
+        this.intersectionObserver = new IntersectionObserver(
+            entries => this.intersectionsChanged(entries),
+            { root, rootMargin: margin },
+        );
+    }
+    observe(html: Element, observer: VisibilityObserver): ObserverHandle {
+        this.observers.set(html, observer);
+        this.intersectionObserver.observe(html);
+        return {
+            unhook: () => {
+                // The element may be observed again by someone else in the meantime
+                if (this.observers.get(html) === observer) {
+                    this.observers.delete(html);
+                    this.intersectionObserver.unobserve(html);
+                }
+            },
+        };
+    }
+    private intersectionsChanged(entries: readonly IntersectionObserverEntry[]): void {
+        for (const entry of entries) {
+            this.observers.get(entry.target)?.(entry.isIntersecting);
+        }
+    }
+    private readonly observers: Map<Element, VisibilityObserver>;
+    private readonly intersectionObserver: IntersectionObserver;
+}
+
+/**
+ * {@link ViewModel} that renders an empty box in place of an element
+ * that is not rendered because it is outside the visible area.
+ */
+export class PlaceholderViewModel implements ViewModel {
+    /**
+     * Constructs a placeholder.
+     *
+     * @param ownerDocument Document that will own the placeholder's DOM.
+     * @param size Size that the placeholder should occupy, in pixels.
+     *             This is normally the last known size of the element it replaces.
+     *             If not specified, the placeholder has a small default size.
+     */
+    constructor(ownerDocument: Document, size?: { width: number; height: number }) {
+        this.html = ownerDocument.createElement('div');
+        this.html.className = CLASS_PLACEHOLDER;
+        if (size) {
+            // Override the default minimum size as well
+            this.html.style.width = this.html.style.minWidth = `${size.width}px`;
+            this.html.style.height = this.html.style.minHeight = `${size.height}px`;
+        }
+    }
+    useSlot(populator: ViewSlotPopulator | undefined): void {
+        if (populator) {
+            populator.insertFlowHtml(this.html);
+        } else {
+            this.html.remove();
+        }
+    }
+    createInlineSlot(): ElementViewSlot {
+        // Children of a placeholder are not rendered
+        return NULL_SLOT;
+    }
+    destroy(): void {
+        // Nothing to clean up
+    }
+    readonly preferredLayoutMode = ViewLayoutMode.INLINE;
+    readonly pinContainer = undefined;
+    readonly companionSlot = NULL_SLOT;
+    private readonly html: HTMLElement;
+}
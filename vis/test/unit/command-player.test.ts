@@ -0,0 +1,150 @@
+import {
+    NO_OPERAND,
+    VisTreeCommand,
+    VisTreeCommandPart,
+    VisTreeCommandPlayer,
+} from '../../src/command-player';
+import { VisConnector, VisElement } from '../../src/tree';
+import { beforeEach, describe, expect, it, jest } from '@jest/globals';
+
+const {
+    CREATE_ELEMENT,
+    CREATE_CONNECTOR,
+    SET_ATTRIBUTE,
+    SET_PARENT,
+    ATTACH_PIN,
+    SET_ROOT,
+    RELEASE,
+} = VisTreeCommand;
+const { SELF, START, END } = VisTreeCommandPart;
+
+/**
+ * Concatenates commands into a command buffer.
+ */
+function encode(...commands: number[][]): Uint32Array {
+    return new Uint32Array(commands.flat());
+}
+
+describe(VisTreeCommandPlayer, () => {
+    let root: VisElement | undefined;
+    let created: (VisElement | VisConnector)[];
+    let player: VisTreeCommandPlayer;
+
+    beforeEach(() => {
+        root = undefined;
+        created = [];
+        player = new VisTreeCommandPlayer({
+            createElement(tagName) {
+                const element = new VisElement(tagName);
+                created.push(element);
+                return element;
+            },
+            createConnector() {
+                const connector = new VisConnector();
+                created.push(connector);
+                return connector;
+            },
+            set root(element: VisElement | undefined) {
+                root = element;
+            },
+        });
+    });
+
+    it('builds a tree', () => {
+        player.applyCommands(
+            encode(
+                [CREATE_ELEMENT, 0, 0],
+                [CREATE_ELEMENT, 1, 1],
+                [SET_PARENT, 1, 0],
+                [SET_ATTRIBUTE, 1, SELF, 2, 3],
+                [SET_ROOT, 0],
+            ),
+            ['parent', 'child', 'value', '42'],
+        );
+        expect(root?.tagName).toBe('parent');
+        const [child] = root?.children ?? [];
+        expect(child.tagName).toBe('child');
+        expect(child.attributes.value.value).toBe('42');
+    });
+
+    it('attaches connectors', () => {
+        player.applyCommands(
+            encode(
+                [CREATE_ELEMENT, 0, 0],
+                [CREATE_CONNECTOR, 1],
+                [ATTACH_PIN, 1, START, 0],
+                [ATTACH_PIN, 1, END, 0],
+                [SET_ATTRIBUTE, 1, END, 1, 0],
+            ),
+            ['cell', 'label'],
+        );
+        const element = created[0] as VisElement;
+        const connector = created[1] as VisConnector;
+        expect(connector.start.target).toBe(element);
+        expect(connector.end.target).toBe(element);
+        expect(connector.end.attributes.label.value).toBe('cell');
+        expect(connector.projectedParent).toBe(element);
+    });
+
+    it('detaches entities with missing operands', () => {
+        player.applyCommands(
+            encode([CREATE_ELEMENT, 0, 0], [SET_ATTRIBUTE, 0, SELF, 0, 0], [SET_ROOT, 0]),
+            ['cell'],
+        );
+        player.applyCommands(
+            encode([SET_ATTRIBUTE, 0, SELF, 0, NO_OPERAND], [SET_ROOT, NO_OPERAND]),
+            ['cell'],
+        );
+        expect(root).toBeUndefined();
+        expect(created[0].attributes.cell.value).toBeUndefined();
+    });
+
+    it('updates connector projections once per batch', () => {
+        player.applyCommands(
+            encode(
+                [CREATE_ELEMENT, 0, 0],
+                [CREATE_ELEMENT, 1, 0],
+                [CREATE_ELEMENT, 2, 0],
+                [CREATE_ELEMENT, 3, 0],
+                [SET_PARENT, 1, 0],
+                [SET_PARENT, 2, 0],
+                [CREATE_CONNECTOR, 4],
+                [ATTACH_PIN, 4, START, 1],
+                [ATTACH_PIN, 4, END, 2],
+            ),
+            ['cell'],
+        );
+        const [parent, start, , wrapper] = created as VisElement[];
+        const connector = created[4] as VisConnector;
+        const parentObserver = jest.fn();
+        const startObserver = jest.fn();
+        connector.onProjectedParentChanged.hook(parentObserver);
+        connector.start.onProjectedTargetChanged.hook(startObserver);
+        // Moving the start into a detached element would remove the projection
+        // if it was not immediately reattached within the same batch
+        player.applyCommands(encode([SET_PARENT, 1, 3], [SET_PARENT, 3, 0]), []);
+        expect(parentObserver).not.toHaveBeenCalled();
+        expect(startObserver).toHaveBeenCalledTimes(1);
+        expect(startObserver).toHaveBeenCalledWith(wrapper, start);
+        expect(connector.projectedParent).toBe(parent);
+    });
+
+    it('notifies observers once per batch', () => {
+        const observer = jest.fn();
+        player.onBatchApplied.hook(observer);
+        player.applyCommands(
+            encode([CREATE_ELEMENT, 0, 0], [CREATE_ELEMENT, 1, 0], [SET_PARENT, 1, 0]),
+            ['cell'],
+        );
+        expect(observer).toHaveBeenCalledTimes(1);
+    });
+
+    it('rejects released entities', () => {
+        expect(() =>
+            player.applyCommands(
+                encode([CREATE_ELEMENT, 0, 0], [RELEASE, 0], [SET_ROOT, 0]),
+                ['cell'],
+            ),
+        ).toThrow();
+    });
+});
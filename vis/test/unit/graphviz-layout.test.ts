@@ -0,0 +1,175 @@
+import {
+    GraphvizLayout,
+    INCREMENTAL_LAYOUT_THRESHOLD,
+} from '../../src/models/graph/graphviz-layout';
+import { GraphvizWorkerPool } from '../../src/models/graph/graphviz-worker-pool';
+import { GraphvizPositions } from '../../src/models/graph/graphviz-protocol';
+import { GraphLayoutDirection } from '../../src/models/graph/layout-settings';
+import { LayoutNode } from '../../src/models/graph/layout';
+import { beforeEach, describe, expect, it } from '@jest/globals';
+import * as graphviz from '@viz-js/viz';
+
+/**
+ * Layout request as seen by the pool.
+ */
+interface FakeRequest {
+    /**
+     * Starting positions of the nodes at the time of the request.
+     */
+    positions: Map<string, string | undefined>;
+    /**
+     * Finishes the request, placing each node at a distinct position.
+     */
+    respond(): void;
+    /**
+     * Finishes the request as if it has been superseded.
+     */
+    supersede(): void;
+}
+
+/**
+ * Pool that records requests and only responds when told to.
+ */
+class FakePool {
+    layout(_owner: object, graph: graphviz.Graph): Promise<GraphvizPositions | undefined> {
+        const nodes = graph.nodes ?? [];
+        return new Promise(resolve => {
+            this.requests.push({
+                positions: new Map(
+                    nodes.map(node => [node.name, node.attributes?.pos as string | undefined]),
+                ),
+                respond: () =>
+                    resolve({
+                        width: 100,
+                        height: 100,
+                        nodes: nodes.map((node, i) => ({
+                            name: node.name,
+                            left: i,
+                            top: i,
+                            pos: `${i},${i}`,
+                        })),
+                    }),
+                supersede: () => resolve(undefined),
+            });
+        });
+    }
+    readonly requests: FakeRequest[] = [];
+}
+
+describe(GraphvizLayout, () => {
+    /**
+     * Number of nodes of the test graph, chosen so that
+     * a single changed edge stays within the incremental threshold.
+     */
+    const NODE_COUNT = 12;
+
+    let pool: FakePool;
+    let layout: GraphvizLayout;
+    let nodes: LayoutNode[];
+
+    /**
+     * Runs a layout to completion and returns the request it has made.
+     */
+    async function runLayout(): Promise<FakeRequest> {
+        const done = layout.recalculateLayout();
+        const request = pool.requests[pool.requests.length - 1];
+        request.respond();
+        await done;
+        return request;
+    }
+
+    /**
+     * Collects the nodes that were allowed to move in a request.
+     */
+    function movingNodes(request: FakeRequest): string[] {
+        return [...request.positions]
+            .filter(([, pos]) => !pos?.endsWith('!'))
+            .map(([name]) => name)
+            .sort();
+    }
+
+    beforeEach(async () => {
+        pool = new FakePool();
+        layout = new GraphvizLayout(pool as unknown as GraphvizWorkerPool);
+        nodes = [];
+        for (let i = 0; i < NODE_COUNT; ++i) {
+            nodes.push(layout.addNode());
+        }
+        layout.addEdge(nodes[0].id, nodes[1].id);
+        // Settle the initial layout so that all nodes have positions
+        await runLayout();
+    });
+
+    it('lays out the graph as a whole the first time', () => {
+        const [first] = pool.requests;
+        expect(movingNodes(first)).toHaveLength(NODE_COUNT);
+        expect([...first.positions.values()].every(pos => pos === undefined)).toBe(true);
+    });
+
+    it('pins nodes that are not near any change', async () => {
+        nodes[0].setSize(10, 10);
+        const request = await runLayout();
+        // The changed node moves along with its neighbor
+        expect(movingNodes(request)).toEqual([nodes[0].id, nodes[1].id].sort());
+    });
+
+    it('moves changed nodes without neighbors on their own', async () => {
+        nodes[5].setSize(10, 10);
+        const request = await runLayout();
+        expect(movingNodes(request)).toEqual([nodes[5].id]);
+    });
+
+    it('forgets changes once they have been laid out', async () => {
+        nodes[5].setSize(10, 10);
+        await runLayout();
+        const request = await runLayout();
+        expect(movingNodes(request)).toEqual([]);
+    });
+
+    it('lays out the whole graph when too much has changed', async () => {
+        const changedCount = Math.floor(NODE_COUNT * INCREMENTAL_LAYOUT_THRESHOLD) + 1;
+        for (let i = 2; i < 2 + changedCount; ++i) {
+            nodes[i].setSize(10, 10);
+        }
+        const request = await runLayout();
+        expect(movingNodes(request)).toHaveLength(NODE_COUNT);
+    });
+
+    it('lays out the whole graph when settings change', async () => {
+        layout.layoutDirection = GraphLayoutDirection.EAST;
+        const request = await runLayout();
+        expect(movingNodes(request)).toHaveLength(NODE_COUNT);
+        // The full layout has been done, so the next one is incremental again
+        expect(movingNodes(await runLayout())).toEqual([]);
+    });
+
+    it('keeps changes made during a layout for the next one', async () => {
+        nodes[5].setSize(10, 10);
+        const done = layout.recalculateLayout();
+        const inFlight = pool.requests[pool.requests.length - 1];
+        nodes[7].setSize(10, 10);
+        inFlight.respond();
+        await done;
+        expect(movingNodes(inFlight)).toEqual([nodes[5].id]);
+        const request = await runLayout();
+        expect(movingNodes(request)).toEqual([nodes[7].id]);
+    });
+
+    it('keeps changes of superseded layouts', async () => {
+        nodes[5].setSize(10, 10);
+        const superseded = layout.recalculateLayout();
+        pool.requests[pool.requests.length - 1].supersede();
+        await expect(superseded).resolves.toBe(false);
+        const request = await runLayout();
+        expect(movingNodes(request)).toEqual([nodes[5].id]);
+    });
+
+    it('applies positions of finished layouts', async () => {
+        nodes[5].setSize(10, 10);
+        const done = layout.recalculateLayout();
+        pool.requests[pool.requests.length - 1].respond();
+        await expect(done).resolves.toBe(true);
+        expect(layout.getNodeById(nodes[5].id)?.left).toBe(5);
+        expect(layout.width).toBe(100);
+    });
+});
@@ -0,0 +1,36 @@
+import { layoutGraph, POINTS_PER_INCH } from '../../src/models/graph/graphviz-protocol';
+import { describe, expect, it } from '@jest/globals';
+import * as graphviz from '@viz-js/viz';
+
+/**
+ * Graphviz instance that always returns the same layout.
+ */
+function fakeViz(layout: object): graphviz.Viz {
+    return { renderJSON: () => layout } as unknown as graphviz.Viz;
+}
+
+describe(layoutGraph, () => {
+    it('converts node centers to offsets from the top left corner', () => {
+        const viz = fakeViz({
+            bb: '0,0,144,72',
+            objects: [{ name: '1', pos: '36,36', width: '1', height: '0.5' }],
+        });
+        const positions = layoutGraph(viz, {});
+        expect(positions.width).toBe(144);
+        expect(positions.height).toBe(72);
+        expect(positions.nodes).toEqual([{ name: '1', left: 0, top: 18, pos: '0.5,0.5' }]);
+    });
+
+    it('reports node positions in input units', () => {
+        const viz = fakeViz({
+            bb: '0,0,288,288',
+            objects: [{ name: '1', pos: `${2 * POINTS_PER_INCH},${3 * POINTS_PER_INCH}` }],
+        });
+        expect(layoutGraph(viz, {}).nodes[0].pos).toBe('2,3');
+    });
+
+    it('accepts layouts without nodes', () => {
+        const positions = layoutGraph(fakeViz({ bb: '0,0,8,8' }), {});
+        expect(positions).toEqual({ width: 8, height: 8, nodes: [] });
+    });
+});
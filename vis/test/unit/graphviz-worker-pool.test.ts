@@ -0,0 +1,105 @@
+import { GraphvizWorkerPool } from '../../src/models/graph/graphviz-worker-pool';
+import {
+    GraphvizLayoutRequest,
+    GraphvizLayoutResponse,
+    GraphvizPositions,
+} from '../../src/models/graph/graphviz-protocol';
+import { beforeEach, describe, expect, it } from '@jest/globals';
+
+/**
+ * Worker that records requests and only responds when told to.
+ */
+class FakeWorker {
+    postMessage(request: GraphvizLayoutRequest): void {
+        this.requests.push(request);
+    }
+    terminate(): void {
+        this.terminated = true;
+    }
+    /**
+     * Responds to the last request the worker has received.
+     */
+    respond(response: { positions: GraphvizPositions } | { error: string }): void {
+        const { id } = this.requests[this.requests.length - 1];
+        this.onmessage?.({ data: { id, ...response } } as MessageEvent<GraphvizLayoutResponse>);
+    }
+    onmessage: ((e: MessageEvent<GraphvizLayoutResponse>) => void) | null = null;
+    onerror: ((e: ErrorEvent) => void) | null = null;
+    readonly requests: GraphvizLayoutRequest[] = [];
+    terminated: boolean = false;
+}
+
+const GRAPH = { nodes: [{ name: '1' }] };
+const POSITIONS: GraphvizPositions = { width: 1, height: 1, nodes: [] };
+
+describe(GraphvizWorkerPool, () => {
+    let workers: FakeWorker[];
+    let pool: GraphvizWorkerPool;
+
+    beforeEach(() => {
+        workers = [];
+        pool = new GraphvizWorkerPool(2, () => {
+            const worker = new FakeWorker();
+            workers.push(worker);
+            return worker as unknown as Worker;
+        });
+    });
+
+    it('resolves requests with the positions from the worker', async () => {
+        const result = pool.layout({}, GRAPH);
+        expect(workers[0].requests).toEqual([{ id: expect.any(Number), graph: GRAPH }]);
+        workers[0].respond({ positions: POSITIONS });
+        await expect(result).resolves.toEqual(POSITIONS);
+    });
+
+    it('rejects requests that fail in the worker', async () => {
+        const result = pool.layout({}, GRAPH);
+        workers[0].respond({ error: 'syntax error' });
+        await expect(result).rejects.toThrow('syntax error');
+    });
+
+    it('processes requests from different owners in parallel', () => {
+        pool.layout({}, GRAPH);
+        pool.layout({}, GRAPH);
+        expect(workers[0].requests).toHaveLength(1);
+        expect(workers[1].requests).toHaveLength(1);
+    });
+
+    it('lets a request in progress finish when it is superseded', async () => {
+        const owner = {};
+        const first = pool.layout(owner, GRAPH);
+        const second = pool.layout(owner, GRAPH);
+        expect(workers.some(worker => worker.terminated)).toBe(false);
+        // The second request waits for the first instead of taking the idle worker
+        expect(workers[1].requests).toHaveLength(0);
+        workers[0].respond({ positions: POSITIONS });
+        await expect(first).resolves.toEqual(POSITIONS);
+        expect(workers[0].requests).toHaveLength(2);
+        workers[0].respond({ positions: POSITIONS });
+        await expect(second).resolves.toEqual(POSITIONS);
+    });
+
+    it('drops queued requests that have been superseded', async () => {
+        const owner = {};
+        pool.layout(owner, GRAPH);
+        const queued = pool.layout(owner, GRAPH);
+        const latest = pool.layout(owner, GRAPH);
+        await expect(queued).resolves.toBeUndefined();
+        workers[0].respond({ positions: POSITIONS });
+        // Only the latest request is sent after the first one
+        expect(workers[0].requests).toHaveLength(2);
+        expect(workers[1].requests).toHaveLength(0);
+        workers[0].respond({ positions: POSITIONS });
+        await expect(latest).resolves.toEqual(POSITIONS);
+    });
+
+    it('resolves pending requests when terminated', async () => {
+        const owner = {};
+        const running = pool.layout(owner, GRAPH);
+        const queued = pool.layout(owner, GRAPH);
+        pool.terminate();
+        await expect(running).resolves.toBeUndefined();
+        await expect(queued).resolves.toBeUndefined();
+        expect(workers.every(worker => worker.terminated)).toBe(true);
+    });
+});
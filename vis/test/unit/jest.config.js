@@ -8,6 +8,8 @@ export default {
     moduleNameMapper: {
         // Ignore CSS file imports
         '\\.css$': 'identity-obj-proxy',
+        // Workers are bundled by Vite, tests provide their own
+        '\\?worker(&inline)?$': '<rootDir>/worker-stub.ts',
     },
     globals: {
         'ts-jest': {
@@ -0,0 +1,95 @@
+import { LayoutScheduler, ScheduledLayout } from '../../src/layout-scheduler';
+import { beforeEach, describe, expect, it, jest } from '@jest/globals';
+
+describe(LayoutScheduler, () => {
+    let frames: (() => void)[];
+    let scheduler: LayoutScheduler;
+
+    /**
+     * Runs all frame callbacks that are currently scheduled
+     * and waits for the layouts they start to settle.
+     */
+    async function runFrame(): Promise<void> {
+        const callbacks = frames;
+        frames = [];
+        callbacks.forEach(callback => callback());
+        // Let dispatched layouts resolve
+        await new Promise(resolve => setTimeout(resolve));
+    }
+
+    function mockLayout(): ScheduledLayout & { updateLayoutNow: jest.Mock<() => Promise<void>> } {
+        return { updateLayoutNow: jest.fn(() => Promise.resolve()) };
+    }
+
+    beforeEach(() => {
+        frames = [];
+        scheduler = new LayoutScheduler(callback => frames.push(callback));
+    });
+
+    it('does not recalculate layouts before the next frame', () => {
+        const layout = mockLayout();
+        scheduler.markDirty(layout);
+        expect(layout.updateLayoutNow).not.toHaveBeenCalled();
+    });
+
+    it('coalesces requests within a frame', async () => {
+        const layout = mockLayout();
+        scheduler.markDirty(layout);
+        scheduler.markDirty(layout);
+        scheduler.markDirty(layout);
+        expect(frames).toHaveLength(1);
+        await runFrame();
+        expect(layout.updateLayoutNow).toHaveBeenCalledTimes(1);
+    });
+
+    it('recalculates each dirty layout in the same frame', async () => {
+        const layouts = [mockLayout(), mockLayout()];
+        layouts.forEach(layout => scheduler.markDirty(layout));
+        await runFrame();
+        layouts.forEach(layout => expect(layout.updateLayoutNow).toHaveBeenCalledTimes(1));
+    });
+
+    it('notifies observers once per frame', async () => {
+        const observer = jest.fn();
+        scheduler.onLayoutsUpdated.hook(observer);
+        scheduler.markDirty(mockLayout());
+        scheduler.markDirty(mockLayout());
+        await runFrame();
+        expect(observer).toHaveBeenCalledTimes(1);
+    });
+
+    it('defers layouts that are still being recalculated', async () => {
+        let finish: () => void = () => {};
+        const layout = mockLayout();
+        layout.updateLayoutNow.mockImplementationOnce(
+            () => new Promise<void>(resolve => (finish = resolve)),
+        );
+        scheduler.markDirty(layout);
+        await runFrame();
+        scheduler.markDirty(layout);
+        await runFrame();
+        expect(layout.updateLayoutNow).toHaveBeenCalledTimes(1);
+        finish();
+        await runFrame();
+        await runFrame();
+        expect(layout.updateLayoutNow).toHaveBeenCalledTimes(2);
+    });
+
+    it('does not defer layouts that cancel pending recalculations', async () => {
+        const layout = { ...mockLayout(), cancelsPendingLayout: true };
+        layout.updateLayoutNow.mockImplementationOnce(() => new Promise<void>(() => {}));
+        scheduler.markDirty(layout);
+        await runFrame();
+        scheduler.markDirty(layout);
+        await runFrame();
+        expect(layout.updateLayoutNow).toHaveBeenCalledTimes(2);
+    });
+
+    it('skips cancelled layouts', async () => {
+        const layout = mockLayout();
+        scheduler.markDirty(layout);
+        scheduler.cancel(layout);
+        await runFrame();
+        expect(layout.updateLayoutNow).not.toHaveBeenCalled();
+    });
+});
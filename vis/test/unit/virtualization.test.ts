@@ -0,0 +1,142 @@
+/**
+ * @jest-environment jsdom
+ */
+
+import { afterEach, beforeEach, describe, expect, it } from '@jest/globals';
+import { Viewport } from '../../src/viewport';
+import { VisConnector, VisElement } from '../../src/tree';
+import { ViewLayoutMode } from '../../src/model';
+import { ViewModelFactory } from '../../src/model-factory';
+import { CLASS_PLACEHOLDER } from '../../src/virtualization';
+import { CLASS_ELEMENT, TestViewModel } from './test-model';
+import * as jsplumb from '@jsplumb/browser-ui';
+
+const ELEMENT_TAG_NAME = 'test';
+const CONTAINER_ID = 'app';
+const SELECTOR_ELEMENT = `#${CONTAINER_ID} .${CLASS_ELEMENT}`;
+const SELECTOR_PLACEHOLDER = `#${CONTAINER_ID} .${CLASS_PLACEHOLDER}`;
+const SELECTOR_CONNECTOR = `#${CONTAINER_ID} .${jsplumb.CLASS_CONNECTOR}`;
+
+/**
+ * Test view model that can be replaced by a placeholder.
+ */
+class InlineTestViewModel extends TestViewModel {
+    static readonly preferredLayoutMode = ViewLayoutMode.INLINE;
+}
+
+/**
+ * Stand-in for `IntersectionObserver`, which is not provided by jsdom.
+ */
+class MockIntersectionObserver {
+    constructor(callback: (entries: Partial<IntersectionObserverEntry>[]) => void) {
+        this.callback = callback;
+        this.targets = new Set();
+        observers.push(this);
+    }
+    observe(target: Element): void {
+        this.targets.add(target);
+    }
+    unobserve(target: Element): void {
+        this.targets.delete(target);
+    }
+    disconnect(): void {
+        this.targets.clear();
+    }
+    /**
+     * Notifies the observer about the current visibility of all its targets.
+     */
+    report(isIntersecting: boolean): void {
+        this.callback([...this.targets].map(target => ({ target, isIntersecting })));
+    }
+    private readonly callback: (entries: Partial<IntersectionObserverEntry>[]) => void;
+    private readonly targets: Set<Element>;
+}
+
+let observers: MockIntersectionObserver[];
+
+const viewModelFactory = new ViewModelFactory(new Map(), InlineTestViewModel);
+
+describe('virtualized viewport', () => {
+    let container: HTMLDivElement;
+    let root: VisElement;
+
+    /**
+     * Makes all tracked elements visible or invisible.
+     */
+    function setVisible(visible: boolean): void {
+        observers.forEach(observer => observer.report(visible));
+    }
+
+    beforeEach(() => {
+        observers = [];
+        Object.assign(globalThis, { IntersectionObserver: MockIntersectionObserver });
+        container = document.createElement('div');
+        container.id = CONTAINER_ID;
+        document.body.append(container);
+        root = new VisElement(ELEMENT_TAG_NAME);
+        new Viewport(container, viewModelFactory, { virtualize: true }).root = root;
+    });
+
+    afterEach(() => {
+        container.remove();
+        delete (globalThis as { IntersectionObserver?: unknown }).IntersectionObserver;
+    });
+
+    it('renders children as placeholders until they are visible', () => {
+        for (let i = 0; i < 3; ++i) {
+            new VisElement(ELEMENT_TAG_NAME).parent = root;
+        }
+        expect(document.querySelectorAll(SELECTOR_ELEMENT)).toHaveLength(1);
+        expect(document.querySelectorAll(SELECTOR_PLACEHOLDER)).toHaveLength(3);
+        setVisible(true);
+        expect(document.querySelectorAll(SELECTOR_ELEMENT)).toHaveLength(4);
+        expect(document.querySelectorAll(SELECTOR_PLACEHOLDER)).toHaveLength(0);
+    });
+
+    it('does not render the subtree of a placeholder', () => {
+        const child = new VisElement(ELEMENT_TAG_NAME);
+        const grandchild = new VisElement(ELEMENT_TAG_NAME);
+        grandchild.parent = child;
+        child.parent = root;
+        expect(document.querySelectorAll(SELECTOR_PLACEHOLDER)).toHaveLength(1);
+        setVisible(true);
+        // The grandchild starts as a placeholder once the child is rendered
+        expect(document.querySelectorAll(SELECTOR_ELEMENT)).toHaveLength(2);
+        expect(document.querySelectorAll(SELECTOR_PLACEHOLDER)).toHaveLength(1);
+        setVisible(true);
+        expect(document.querySelectorAll(SELECTOR_ELEMENT)).toHaveLength(3);
+        expect(document.querySelectorAll(SELECTOR_PLACEHOLDER)).toHaveLength(0);
+    });
+
+    it('replaces elements that stop being visible with placeholders', () => {
+        const child = new VisElement(ELEMENT_TAG_NAME);
+        const grandchild = new VisElement(ELEMENT_TAG_NAME);
+        grandchild.parent = child;
+        child.parent = root;
+        setVisible(true);
+        setVisible(true);
+        setVisible(false);
+        expect(document.querySelectorAll(SELECTOR_ELEMENT)).toHaveLength(1);
+        expect(document.querySelectorAll(SELECTOR_PLACEHOLDER)).toHaveLength(1);
+    });
+
+    it('renders a connector once both of its ends are visible', () => {
+        const left = new VisElement(ELEMENT_TAG_NAME);
+        const right = new VisElement(ELEMENT_TAG_NAME);
+        const conn = new VisConnector();
+        left.parent = root;
+        right.parent = root;
+        conn.start.target = left;
+        conn.end.target = right;
+        expect(document.querySelectorAll(SELECTOR_CONNECTOR)).toHaveLength(0);
+        setVisible(true);
+        expect(document.querySelectorAll(SELECTOR_CONNECTOR)).toHaveLength(1);
+        setVisible(false);
+        expect(document.querySelectorAll(SELECTOR_CONNECTOR)).toHaveLength(0);
+    });
+
+    it('always renders the root element', () => {
+        setVisible(false);
+        expect(document.querySelectorAll(SELECTOR_ELEMENT)).toHaveLength(1);
+    });
+});
@@ -0,0 +1,9 @@
+/**
+ * Stand-in for worker modules imported with Vite's `?worker` suffix,
+ * which Jest cannot load.
+ */
+export default class WorkerStub {
+    constructor() {
+        throw new Error('Bundled workers are not available in unit tests');
+    }
+}